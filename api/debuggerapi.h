@@ -16,6 +16,7 @@ limitations under the License.
 
 #pragma once
 
+#include <future>
 #include "binaryninjaapi.h"
 #include "ffi.h"
 
@@ -276,6 +277,11 @@ namespace BinaryNinjaDebuggerAPI {
 	{
 		std::uint32_t m_pid {};
 		std::string m_processName {};
+		// Left empty (or zero) when the backend does not know them
+		std::uint32_t m_parentPid {};
+		std::string m_user {};
+		std::string m_architecture {};
+		std::string m_commandLine {};
 
 		DebugProcess() {}
 
@@ -285,7 +291,9 @@ namespace BinaryNinjaDebuggerAPI {
 
 		bool operator==(const DebugProcess& rhs) const
 		{
-			return (m_pid == rhs.m_pid) && (m_processName == rhs.m_processName);
+			return (m_pid == rhs.m_pid) && (m_processName == rhs.m_processName) && (m_parentPid == rhs.m_parentPid)
+				&& (m_user == rhs.m_user) && (m_architecture == rhs.m_architecture)
+				&& (m_commandLine == rhs.m_commandLine);
 		}
 
 		bool operator!=(const DebugProcess& rhs) const { return !(*this == rhs); }
@@ -358,6 +366,27 @@ namespace BinaryNinjaDebuggerAPI {
 		uint64_t offset;
 		uint64_t address;
 		bool enabled;
+		std::string condition;
+		std::string logMessage;
+		uint64_t hitCount;
+	};
+
+
+	typedef BNDebugBreakpointType DebugBreakpointType;
+
+	struct DebugHardwareBreakpoint
+	{
+		uint64_t address;
+		DebugBreakpointType type;
+		size_t size;
+	};
+
+
+	struct DebugSoftwareWatchpoint
+	{
+		uint64_t address;
+		size_t size;
+		DebugBreakpointType type;
 	};
 
 
@@ -391,6 +420,19 @@ namespace BinaryNinjaDebuggerAPI {
 
 	typedef BNDebuggerEventType DebuggerEventType;
 	typedef BNDebugStopReason DebugStopReason;
+	typedef BNDebuggerEventCallbackAffinity DebuggerEventCallbackAffinity;
+	typedef BNTargetOutputChannel TargetOutputChannel;
+	typedef BNDebuggerCommandType DebuggerCommandType;
+
+	// A mask of event types, with the bit (1 << type) set for each type
+	typedef uint64_t DebuggerEventTypeMask;
+	static constexpr DebuggerEventTypeMask AllDebuggerEventTypes = BN_DEBUGGER_ALL_EVENT_TYPES;
+	static_assert(BreakpointLogEventType < 64, "DebuggerEventTypeMask cannot hold all event types");
+
+	constexpr DebuggerEventTypeMask DebuggerEventTypeBit(DebuggerEventType type)
+	{
+		return 1ULL << type;
+	}
 
 	struct TargetStoppedEventData
 	{
@@ -418,6 +460,8 @@ namespace BinaryNinjaDebuggerAPI {
 	struct StdoutMessageEventData
 	{
 		std::string message;
+		TargetOutputChannel channel = TargetStdoutChannel;
+		uint64_t droppedBytes = 0;
 	};
 
 
@@ -451,6 +495,13 @@ namespace BinaryNinjaDebuggerAPI {
 			std::function<void(const DebuggerEvent&)> action;
 		};
 
+		struct DebuggerCommandObject
+		{
+			std::promise<DebugStopReason> promise;
+			std::function<void(DebugStopReason)> completion;
+		};
+		static void DebuggerCommandCallback(void* ctxt, BNDebugStopReason reason);
+
 	public:
 		DebuggerController(BNDebuggerController* controller);
 		static DbgRef<DebuggerController> GetController(Ref<BinaryNinja::BinaryView> data);
@@ -511,10 +562,27 @@ namespace BinaryNinjaDebuggerAPI {
 		bool StepOverReverse(BNFunctionGraphType il = NormalFunctionGraph);
 		bool StepReturn();
 		bool StepReturnReverse();
+		// Steps `count` instructions, and only stops once at the end, unless something else stops the target first
+		bool StepInstructions(uint64_t count);
 
 		bool RunTo(uint64_t remoteAddresses);
 		bool RunTo(const std::vector<uint64_t>& remoteAddresses);
 		void Pause();
+		// The asynchronous APIs above are queued and run one after another
+		size_t CancelPendingCommands();
+		size_t GetPendingCommandCount();
+		// Queues one of the operations above, see BNDebuggerSubmitCommand(). The future resolves with the stop reason,
+		// and `completion` is called with it on the thread that runs the commands. `id` receives the id to pass to
+		// CancelCommand(). Returns an invalid future if the operation is rejected.
+		std::shared_future<DebugStopReason> SubmitCommand(DebuggerCommandType type,
+			std::function<void(DebugStopReason)> completion = nullptr, BNFunctionGraphType il = NormalFunctionGraph,
+			uint64_t count = 1, const std::vector<uint64_t>& remoteAddresses = {}, size_t* id = nullptr);
+		// Cancels a command that has not started yet. Its future resolves with InvalidStatusOrOperation.
+		bool CancelCommand(size_t id);
+
+		// Skips the work that only serves the UI on every stop, for scripts that drive the target in a tight loop
+		bool IsAutomationMode();
+		void SetAutomationMode(bool enabled);
 
 		DebugStopReason GoAndWait();
 		DebugStopReason GoReverseAndWait();
@@ -524,6 +592,7 @@ namespace BinaryNinjaDebuggerAPI {
 		DebugStopReason StepOverReverseAndWait(BNFunctionGraphType il);
 		DebugStopReason StepReturnAndWait();
 		DebugStopReason StepReturnReverseAndWait();
+		DebugStopReason StepInstructionsAndWait(uint64_t count);
 		DebugStopReason RunToAndWait(uint64_t remoteAddresses);
 		DebugStopReason RunToAndWait(const std::vector<uint64_t>& remoteAddresses);
 		DebugStopReason PauseAndWait();
@@ -560,24 +629,73 @@ namespace BinaryNinjaDebuggerAPI {
 		void AddBreakpoint(const ModuleNameAndOffset& breakpoint);
 		bool ContainsBreakpoint(uint64_t address);
 		bool ContainsBreakpoint(const ModuleNameAndOffset& breakpoint);
+		void FlushBreakpoints();
+		bool AddHardwareBreakpoint(uint64_t address, DebugBreakpointType type, size_t size = 1);
+		bool RemoveHardwareBreakpoint(uint64_t address, DebugBreakpointType type, size_t size = 1);
+		std::vector<DebugHardwareBreakpoint> GetHardwareBreakpoints();
+		bool AddSoftwareWatchpoint(uint64_t address, size_t size, DebugBreakpointType type);
+		bool RemoveSoftwareWatchpoint(uint64_t address, size_t size, DebugBreakpointType type);
+		std::vector<DebugSoftwareWatchpoint> GetSoftwareWatchpoints();
+
+		bool StartCoverage();
+		void StopCoverage();
+		bool IsCoverageActive();
+		size_t GetCoverageBlockCount();
+		std::vector<uint64_t> GetCoveredBlocks();
+		bool ExportCoverageDrcov(const std::string& path);
+		bool ExportCoverageLcov(const std::string& path);
+		void ApplyCoverageHighlights();
+		bool SetBreakpointCondition(uint64_t address, const std::string& condition);
+		bool SetBreakpointCondition(const ModuleNameAndOffset& breakpoint, const std::string& condition);
+		std::string GetBreakpointCondition(uint64_t address);
+		std::string GetBreakpointCondition(const ModuleNameAndOffset& breakpoint);
+		bool SetBreakpointLogMessage(uint64_t address, const std::string& message);
+		bool SetBreakpointLogMessage(const ModuleNameAndOffset& breakpoint, const std::string& message);
+		bool SetBreakpointIgnoreCount(uint64_t address, uint64_t count);
+		bool SetBreakpointIgnoreCount(const ModuleNameAndOffset& breakpoint, uint64_t count);
+		uint64_t GetBreakpointHitCount(uint64_t address);
+		uint64_t GetBreakpointHitCount(const ModuleNameAndOffset& breakpoint);
 
 		uint64_t IP();
 		uint64_t GetLastIP();
 		bool SetIP(uint64_t address);
+
+		// Cache validation. The stop epoch changes every time the target runs. The other epochs change whenever the
+		// corresponding data may have changed, including while the target is stopped. Data derived from the target
+		// can be cached with the epoch it was computed in, and stays valid as long as the epoch does not change.
+		uint64_t GetStopEpoch();
+		uint64_t GetRegistersEpoch();
+		uint64_t GetMemoryEpoch();
+		uint64_t GetModulesEpoch();
+		uint64_t GetThreadsEpoch();
 		uint32_t GetExitCode();
 
 		uint64_t RelativeAddressToAbsolute(const ModuleNameAndOffset& address);
 		ModuleNameAndOffset AbsoluteAddressToRelative(uint64_t address);
 
-		size_t RegisterEventCallback(
-			std::function<void(const DebuggerEvent& event)> callback, const std::string& name = "");
+		// Callbacks run on the main thread by default. Inline callbacks block the adapter until they return, so they
+		// must be quick.
+		size_t RegisterEventCallback(std::function<void(const DebuggerEvent& event)> callback,
+			const std::string& name = "",
+			DebuggerEventCallbackAffinity affinity = MainThreadEventCallbackAffinity,
+			DebuggerEventTypeMask eventTypes = AllDebuggerEventTypes);
 		void RecordTrace();
 		static void DebuggerEventCallback(void* ctxt, BNDebuggerEvent* view);
+		static void FreeDebuggerEventCallback(void* ctxt);
 
 		void RemoveEventCallback(size_t index);
 
 		void WriteStdin(const std::string& msg);
 
+		// Pulls the output of the target, independently of the StdoutMessageEventType events. Every byte of a channel
+		// has a position, which only grows. Pass the position read up to, starting at 0, or at
+		// GetTargetOutputPosition() to skip the output so far. `position` is moved past what is returned. Only the
+		// latest output is kept (see the "debugger.targetOutputBufferSize" setting); `droppedBytes` receives how much
+		// was lost since `position`.
+		DataBuffer ReadTargetOutput(TargetOutputChannel channel, uint64_t& position, uint64_t& droppedBytes,
+			size_t maxSize = 0x10000);
+		uint64_t GetTargetOutputPosition(TargetOutputChannel channel);
+
 		std::string InvokeBackendCommand(const std::string& command);
 
 		static std::string GetDebugStopReasonString(DebugStopReason reason);
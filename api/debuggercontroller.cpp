@@ -144,6 +144,10 @@ std::vector<DebugProcess> DebuggerController::GetProcessList()
 		DebugProcess process;
 		process.m_pid = processes[i].m_pid;
 		process.m_processName = processes[i].m_processName;
+		process.m_parentPid = processes[i].m_parentPid;
+		process.m_user = processes[i].m_user;
+		process.m_architecture = processes[i].m_architecture;
+		process.m_commandLine = processes[i].m_commandLine;
 		result.push_back(process);
 	}
 	BNDebuggerFreeProcessList(processes, count);
@@ -383,6 +387,68 @@ void DebuggerController::Pause()
 }
 
 
+size_t DebuggerController::CancelPendingCommands()
+{
+	return BNDebuggerCancelPendingCommands(m_object);
+}
+
+
+size_t DebuggerController::GetPendingCommandCount()
+{
+	return BNDebuggerGetPendingCommandCount(m_object);
+}
+
+
+std::shared_future<DebugStopReason> DebuggerController::SubmitCommand(DebuggerCommandType type,
+	std::function<void(DebugStopReason)> completion, BNFunctionGraphType il, uint64_t count,
+	const std::vector<uint64_t>& remoteAddresses, size_t* id)
+{
+	DebuggerCommandObject* object = new DebuggerCommandObject;
+	object->completion = std::move(completion);
+	std::shared_future<DebugStopReason> future = object->promise.get_future().share();
+
+	// The object is freed by the callback, which may run before BNDebuggerSubmitCommand() returns
+	size_t commandId = BNDebuggerSubmitCommand(m_object, type, il, count, remoteAddresses.data(),
+		remoteAddresses.size(), DebuggerCommandCallback, object);
+	if (id)
+		*id = commandId;
+	if (commandId == 0)
+	{
+		delete object;
+		return {};
+	}
+	return future;
+}
+
+
+void DebuggerController::DebuggerCommandCallback(void* ctxt, BNDebugStopReason reason)
+{
+	DebuggerCommandObject* object = (DebuggerCommandObject*)ctxt;
+	object->promise.set_value(reason);
+	if (object->completion)
+		object->completion(reason);
+	delete object;
+}
+
+
+bool DebuggerController::CancelCommand(size_t id)
+{
+	return BNDebuggerCancelCommand(m_object, id);
+}
+
+
+bool DebuggerController::IsAutomationMode()
+{
+	return BNDebuggerIsAutomationMode(m_object);
+}
+
+
+void DebuggerController::SetAutomationMode(bool enabled)
+{
+	BNDebuggerSetAutomationMode(m_object, enabled);
+}
+
+
 // Convenience function, either launch the target process or connect to a remote, depending on the selected adapter
 void DebuggerController::LaunchOrConnect()
 {
@@ -439,6 +505,12 @@ bool DebuggerController::StepReturnReverse()
 }
 
 
+bool DebuggerController::StepInstructions(uint64_t count)
+{
+	return BNDebuggerStepInstructions(m_object, count);
+}
+
+
 bool DebuggerController::RunTo(uint64_t remoteAddresses)
 {
 	return RunTo(std::vector<uint64_t> {remoteAddresses});
@@ -486,6 +558,12 @@ DebugStopReason DebuggerController::StepReturnReverseAndWait()
 }
 
 
+DebugStopReason DebuggerController::StepInstructionsAndWait(uint64_t count)
+{
+	return BNDebuggerStepInstructionsAndWait(m_object, count);
+}
+
+
 DebugStopReason DebuggerController::RunToAndWait(uint64_t remoteAddresses)
 {
 	return RunToAndWait(std::vector<uint64_t> {remoteAddresses});
@@ -682,6 +760,9 @@ std::vector<DebugBreakpoint> DebuggerController::GetBreakpoints()
 		bp.offset = breakpoints[i].offset;
 		bp.address = breakpoints[i].address;
 		bp.enabled = breakpoints[i].enabled;
+		bp.condition = breakpoints[i].condition;
+		bp.logMessage = breakpoints[i].logMessage;
+		bp.hitCount = breakpoints[i].hitCount;
 		result[i] = bp;
 	}
 
@@ -726,6 +807,194 @@ bool DebuggerController::ContainsBreakpoint(const ModuleNameAndOffset& breakpoin
 }
 
 
+void DebuggerController::FlushBreakpoints()
+{
+	BNDebuggerFlushBreakpoints(m_object);
+}
+
+
+bool DebuggerController::AddHardwareBreakpoint(uint64_t address, DebugBreakpointType type, size_t size)
+{
+	return BNDebuggerAddHardwareBreakpoint(m_object, address, type, size);
+}
+
+
+bool DebuggerController::RemoveHardwareBreakpoint(uint64_t address, DebugBreakpointType type, size_t size)
+{
+	return BNDebuggerRemoveHardwareBreakpoint(m_object, address, type, size);
+}
+
+
+std::vector<DebugHardwareBreakpoint> DebuggerController::GetHardwareBreakpoints()
+{
+	size_t count;
+	BNDebugHardwareBreakpoint* breakpoints = BNDebuggerGetHardwareBreakpoints(m_object, &count);
+	std::vector<DebugHardwareBreakpoint> result;
+	result.reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		DebugHardwareBreakpoint bp;
+		bp.address = breakpoints[i].address;
+		bp.type = breakpoints[i].type;
+		bp.size = breakpoints[i].size;
+		result.push_back(bp);
+	}
+	BNDebuggerFreeHardwareBreakpoints(breakpoints);
+	return result;
+}
+
+
+bool DebuggerController::AddSoftwareWatchpoint(uint64_t address, size_t size, DebugBreakpointType type)
+{
+	return BNDebuggerAddSoftwareWatchpoint(m_object, address, size, type);
+}
+
+
+bool DebuggerController::RemoveSoftwareWatchpoint(uint64_t address, size_t size, DebugBreakpointType type)
+{
+	return BNDebuggerRemoveSoftwareWatchpoint(m_object, address, size, type);
+}
+
+
+std::vector<DebugSoftwareWatchpoint> DebuggerController::GetSoftwareWatchpoints()
+{
+	size_t count;
+	BNDebugSoftwareWatchpoint* watchpoints = BNDebuggerGetSoftwareWatchpoints(m_object, &count);
+	std::vector<DebugSoftwareWatchpoint> result;
+	result.reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		DebugSoftwareWatchpoint wp;
+		wp.address = watchpoints[i].address;
+		wp.size = watchpoints[i].size;
+		wp.type = watchpoints[i].type;
+		result.push_back(wp);
+	}
+	BNDebuggerFreeSoftwareWatchpoints(watchpoints);
+	return result;
+}
+
+
+bool DebuggerController::StartCoverage()
+{
+	return BNDebuggerStartCoverage(m_object);
+}
+
+
+void DebuggerController::StopCoverage()
+{
+	BNDebuggerStopCoverage(m_object);
+}
+
+
+bool DebuggerController::IsCoverageActive()
+{
+	return BNDebuggerIsCoverageActive(m_object);
+}
+
+
+size_t DebuggerController::GetCoverageBlockCount()
+{
+	return BNDebuggerGetCoverageBlockCount(m_object);
+}
+
+
+std::vector<uint64_t> DebuggerController::GetCoveredBlocks()
+{
+	size_t count;
+	uint64_t* blocks = BNDebuggerGetCoveredBlocks(m_object, &count);
+	std::vector<uint64_t> result(blocks, blocks + count);
+	BNDebuggerFreeCoveredBlocks(blocks);
+	return result;
+}
+
+
+bool DebuggerController::ExportCoverageDrcov(const std::string& path)
+{
+	return BNDebuggerExportCoverageDrcov(m_object, path.c_str());
+}
+
+
+bool DebuggerController::ExportCoverageLcov(const std::string& path)
+{
+	return BNDebuggerExportCoverageLcov(m_object, path.c_str());
+}
+
+
+void DebuggerController::ApplyCoverageHighlights()
+{
+	BNDebuggerApplyCoverageHighlights(m_object);
+}
+
+
+bool DebuggerController::SetBreakpointCondition(uint64_t address, const std::string& condition)
+{
+	return BNDebuggerSetAbsoluteBreakpointCondition(m_object, address, condition.c_str());
+}
+
+
+bool DebuggerController::SetBreakpointCondition(const ModuleNameAndOffset& breakpoint, const std::string& condition)
+{
+	return BNDebuggerSetRelativeBreakpointCondition(
+		m_object, breakpoint.module.c_str(), breakpoint.offset, condition.c_str());
+}
+
+
+std::string DebuggerController::GetBreakpointCondition(uint64_t address)
+{
+	char* condition = BNDebuggerGetAbsoluteBreakpointCondition(m_object, address);
+	std::string result = std::string(condition);
+	BNDebuggerFreeString(condition);
+	return result;
+}
+
+
+std::string DebuggerController::GetBreakpointCondition(const ModuleNameAndOffset& breakpoint)
+{
+	char* condition = BNDebuggerGetRelativeBreakpointCondition(m_object, breakpoint.module.c_str(), breakpoint.offset);
+	std::string result = std::string(condition);
+	BNDebuggerFreeString(condition);
+	return result;
+}
+
+
+bool DebuggerController::SetBreakpointLogMessage(uint64_t address, const std::string& message)
+{
+	return BNDebuggerSetAbsoluteBreakpointLogMessage(m_object, address, message.c_str());
+}
+
+
+bool DebuggerController::SetBreakpointLogMessage(const ModuleNameAndOffset& breakpoint, const std::string& message)
+{
+	return BNDebuggerSetRelativeBreakpointLogMessage(
+		m_object, breakpoint.module.c_str(), breakpoint.offset, message.c_str());
+}
+
+
+bool DebuggerController::SetBreakpointIgnoreCount(uint64_t address, uint64_t count)
+{
+	return BNDebuggerSetAbsoluteBreakpointIgnoreCount(m_object, address, count);
+}
+
+
+bool DebuggerController::SetBreakpointIgnoreCount(const ModuleNameAndOffset& breakpoint, uint64_t count)
+{
+	return BNDebuggerSetRelativeBreakpointIgnoreCount(m_object, breakpoint.module.c_str(), breakpoint.offset, count);
+}
+
+
+uint64_t DebuggerController::GetBreakpointHitCount(uint64_t address)
+{
+	return BNDebuggerGetAbsoluteBreakpointHitCount(m_object, address);
+}
+
+
+uint64_t DebuggerController::GetBreakpointHitCount(const ModuleNameAndOffset& breakpoint)
+{
+	return BNDebuggerGetRelativeBreakpointHitCount(m_object, breakpoint.module.c_str(), breakpoint.offset);
+}
+
+
 uint64_t DebuggerController::RelativeAddressToAbsolute(const ModuleNameAndOffset& address)
 {
 	return BNDebuggerRelativeAddressToAbsolute(m_object, address.module.c_str(), address.offset);
@@ -755,6 +1024,36 @@ uint64_t DebuggerController::GetLastIP()
 }
 
 
+uint64_t DebuggerController::GetStopEpoch()
+{
+	return BNDebuggerGetStopEpoch(m_object);
+}
+
+
+uint64_t DebuggerController::GetRegistersEpoch()
+{
+	return BNDebuggerGetRegistersEpoch(m_object);
+}
+
+
+uint64_t DebuggerController::GetMemoryEpoch()
+{
+	return BNDebuggerGetMemoryEpoch(m_object);
+}
+
+
+uint64_t DebuggerController::GetModulesEpoch()
+{
+	return BNDebuggerGetModulesEpoch(m_object);
+}
+
+
+uint64_t DebuggerController::GetThreadsEpoch()
+{
+	return BNDebuggerGetThreadsEpoch(m_object);
+}
+
+
 bool DebuggerController::SetIP(uint64_t address)
 {
 	return BNDebuggerSetIP(m_object, address);
@@ -767,12 +1066,19 @@ uint32_t DebuggerController::GetExitCode()
 }
 
 
-size_t DebuggerController::RegisterEventCallback(
-	std::function<void(const DebuggerEvent& event)> callback, const std::string& name)
+size_t DebuggerController::RegisterEventCallback(std::function<void(const DebuggerEvent& event)> callback,
+	const std::string& name, DebuggerEventCallbackAffinity affinity, DebuggerEventTypeMask eventTypes)
 {
 	DebuggerEventCallbackObject* object = new DebuggerEventCallbackObject;
 	object->action = callback;
-	return BNDebuggerRegisterEventCallback(GetObject(), DebuggerEventCallback, name.c_str(), object);
+	return BNDebuggerRegisterEventCallback(
+		GetObject(), DebuggerEventCallback, FreeDebuggerEventCallback, name.c_str(), object, affinity, eventTypes);
+}
+
+
+void DebuggerController::FreeDebuggerEventCallback(void* ctxt)
+{
+	delete (DebuggerEventCallbackObject*)ctxt;
 }
 
 
@@ -798,6 +1104,8 @@ void DebuggerController::DebuggerEventCallback(void* ctxt, BNDebuggerEvent* even
 	evt.data.absoluteAddress = event->data.absoluteAddress;
 
 	evt.data.messageData.message = string(event->data.messageData.message);
+	evt.data.messageData.channel = event->data.messageData.channel;
+	evt.data.messageData.droppedBytes = event->data.messageData.droppedBytes;
 
 	object->action(evt);
 }
@@ -815,6 +1123,19 @@ void DebuggerController::WriteStdin(const std::string& msg)
 }
 
 
+DataBuffer DebuggerController::ReadTargetOutput(
+	TargetOutputChannel channel, uint64_t& position, uint64_t& droppedBytes, size_t maxSize)
+{
+	return DataBuffer(BNDebuggerReadTargetOutput(m_object, channel, &position, &droppedBytes, maxSize));
+}
+
+
+uint64_t DebuggerController::GetTargetOutputPosition(TargetOutputChannel channel)
+{
+	return BNDebuggerGetTargetOutputPosition(m_object, channel);
+}
+
+
 std::string DebuggerController::InvokeBackendCommand(const std::string& command)
 {
 	char* output = BNDebuggerInvokeBackendCommand(m_object, command.c_str());
@@ -903,6 +1224,8 @@ void DebuggerController::PostDebuggerEvent(const DebuggerEvent &event)
 	evt->data.absoluteAddress = event.data.absoluteAddress;
 
 	evt->data.messageData.message = BNDebuggerAllocString(event.data.messageData.message.c_str());
+	evt->data.messageData.channel = event.data.messageData.channel;
+	evt->data.messageData.droppedBytes = event.data.messageData.droppedBytes;
 
 	BNDebuggerPostDebuggerEvent(m_object, evt);
 
@@ -0,0 +1,175 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <vector>
+#include "binaryninjaapi.h"
+#include "lowlevelilinstruction.h"
+
+namespace BinaryNinjaDebuggerAPI {
+	// Caches the result of decoding an instruction, so the same instruction is not lifted or disassembled again every
+	// time we step over it or repaint it. Entries are keyed by the architecture, the address and a hash of the bytes,
+	// so a changed instruction (e.g., patched or self-modifying code) is never served from the cache. Invalidate()
+	// should still be called on memory writes to free the stale entries.
+	//
+	// This is header-only since it is shared by the core, the UI and the CLI, which do not link a common library
+	// other than the Binary Ninja API.
+	class DecodedInstructionCache
+	{
+	public:
+		struct DecodedInstruction
+		{
+			// False if the architecture cannot decode the bytes
+			bool valid = false;
+			BinaryNinja::InstructionInfo info;
+			bool isReturn = false;
+			// Filled on demand, since lifting and disassembling are only needed by some of the users
+			std::optional<bool> isCall;
+			std::optional<std::vector<BinaryNinja::InstructionTextToken>> tokens;
+		};
+
+	private:
+		using Key = std::tuple<uint64_t, BNArchitecture*, uint64_t>;
+
+		std::mutex m_mutex;
+		std::map<Key, DecodedInstruction> m_entries;
+		size_t m_capacity;
+
+		static uint64_t HashBytes(const uint8_t* data, size_t size)
+		{
+			// FNV-1a
+			uint64_t hash = 0xcbf29ce484222325;
+			for (size_t i = 0; i < size; i++)
+			{
+				hash ^= data[i];
+				hash *= 0x100000001b3;
+			}
+			return hash ^ size;
+		}
+
+		// Must be called with m_mutex held
+		DecodedInstruction& Lookup(BinaryNinja::Architecture* arch, uint64_t address, const uint8_t* data, size_t& size)
+		{
+			size = std::min(size, arch->GetMaxInstructionLength());
+			Key key(address, arch->GetObject(), HashBytes(data, size));
+			auto it = m_entries.find(key);
+			if (it != m_entries.end())
+				return it->second;
+
+			if (m_entries.size() >= m_capacity)
+				m_entries.clear();
+
+			DecodedInstruction& entry = m_entries[key];
+			entry.valid = arch->GetInstructionInfo(data, address, size, entry.info) && (entry.info.length != 0);
+			if (entry.valid)
+			{
+				for (size_t i = 0; i < entry.info.branchCount; i++)
+				{
+					if (entry.info.branchType[i] == FunctionReturn)
+						entry.isReturn = true;
+				}
+			}
+			return entry;
+		}
+
+	public:
+		DecodedInstructionCache(size_t capacity = 0x10000) : m_capacity(capacity) {}
+
+		// `data` holds the bytes at `address`, and at least the length of the instruction is needed. Returns
+		// std::nullopt if the bytes cannot be decoded.
+		std::optional<BinaryNinja::InstructionInfo> GetInstructionInfo(
+			BinaryNinja::Architecture* arch, uint64_t address, const uint8_t* data, size_t size)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			DecodedInstruction& entry = Lookup(arch, address, data, size);
+			if (!entry.valid)
+				return std::nullopt;
+			return entry.info;
+		}
+
+		// Whether the instruction lifts to an LLIL_CALL
+		bool IsCall(BinaryNinja::Architecture* arch, uint64_t address, const uint8_t* data, size_t size)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			DecodedInstruction& entry = Lookup(arch, address, data, size);
+			if (!entry.valid)
+				return false;
+
+			if (!entry.isCall.has_value())
+			{
+				BinaryNinja::Ref<BinaryNinja::LowLevelILFunction> ilFunc =
+					new BinaryNinja::LowLevelILFunction(arch, nullptr);
+				ilFunc->SetCurrentAddress(arch, address);
+				arch->GetInstructionLowLevelIL(data, address, size, *ilFunc);
+				entry.isCall = (ilFunc->GetInstructionCount() > 0) && ((*ilFunc)[0].operation == LLIL_CALL);
+			}
+			return *entry.isCall;
+		}
+
+		bool IsReturn(BinaryNinja::Architecture* arch, uint64_t address, const uint8_t* data, size_t size)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			DecodedInstruction& entry = Lookup(arch, address, data, size);
+			return entry.valid && entry.isReturn;
+		}
+
+		// On success, `size` is set to the length of the instruction
+		bool GetInstructionText(BinaryNinja::Architecture* arch, uint64_t address, const uint8_t* data, size_t& size,
+			std::vector<BinaryNinja::InstructionTextToken>& tokens)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			DecodedInstruction& entry = Lookup(arch, address, data, size);
+			if (!entry.valid)
+				return false;
+
+			if (!entry.tokens.has_value())
+			{
+				size_t length = size;
+				std::vector<BinaryNinja::InstructionTextToken> result;
+				if (!arch->GetInstructionText(data, address, length, result))
+					return false;
+				entry.tokens = std::move(result);
+			}
+			tokens = *entry.tokens;
+			size = entry.info.length;
+			return true;
+		}
+
+		// Drops the instructions that may overlap [address, address + size)
+		void Invalidate(uint64_t address, size_t size)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			// No instruction is longer than this on any architecture we support
+			static constexpr uint64_t MaxInstructionLength = 16;
+			uint64_t start = address > MaxInstructionLength ? address - MaxInstructionLength : 0;
+			auto begin = m_entries.lower_bound(Key(start, nullptr, 0));
+			auto end = m_entries.lower_bound(Key(address + size, nullptr, 0));
+			m_entries.erase(begin, end);
+		}
+
+		void Clear()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_entries.clear();
+		}
+	};
+};  // namespace BinaryNinjaDebuggerAPI
@@ -83,6 +83,10 @@ extern "C"
 	{
 		uint32_t m_pid;
 		char* m_processName;
+		uint32_t m_parentPid;
+		char* m_user;
+		char* m_architecture;
+		char* m_commandLine;
 	} BNDebugProcess;
 
 	typedef struct BNDebugThread
@@ -131,9 +135,38 @@ extern "C"
 		uint64_t offset;
 		uint64_t address;
 		bool enabled;
+		char* condition;
+		char* logMessage;
+		uint64_t hitCount;
 	} BNDebugBreakpoint;
 
 
+	typedef enum BNDebugBreakpointType
+	{
+		SoftwareBreakpoint,
+		HardwareExecuteBreakpoint,
+		HardwareReadWatchpoint,
+		HardwareWriteWatchpoint,
+		HardwareAccessWatchpoint
+	} BNDebugBreakpointType;
+
+
+	typedef struct BNDebugHardwareBreakpoint
+	{
+		uint64_t address;
+		BNDebugBreakpointType type;
+		size_t size;
+	} BNDebugHardwareBreakpoint;
+
+
+	typedef struct BNDebugSoftwareWatchpoint
+	{
+		uint64_t address;
+		size_t size;
+		BNDebugBreakpointType type;
+	} BNDebugSoftwareWatchpoint;
+
+
 	typedef struct BNModuleNameAndOffset
 	{
 		char* module;
@@ -196,7 +229,9 @@ extern "C"
 
 		UserRequestedBreak,
 
-		OperationNotSupported
+		OperationNotSupported,
+
+		Watchpoint
 	} BNDebugStopReason;
 
 
@@ -264,9 +299,48 @@ extern "C"
 
 		ForceMemoryCacheUpdateEvent,
 		ModuleLoadedEvent,
+		// Output of log point breakpoints. Several hits are batched into one event, one line per hit.
+		BreakpointLogEventType,
 	} BNDebuggerEventType;
 
 
+	// Event callbacks can be limited to some of the event types, by passing a mask with the bit (1 << type) set for
+	// each type of interest. Callbacks registered with this mask receive every event.
+#define BN_DEBUGGER_ALL_EVENT_TYPES 0xffffffffffffffffULL
+
+
+	// The target control operations that can be queued with BNDebuggerSubmitCommand()
+	typedef enum BNDebuggerCommandType
+	{
+		LaunchCommand,
+		AttachCommand,
+		ConnectCommand,
+		RestartCommand,
+		GoCommand,
+		GoReverseCommand,
+		StepIntoCommand,
+		StepIntoReverseCommand,
+		StepOverCommand,
+		StepOverReverseCommand,
+		StepReturnCommand,
+		StepReturnReverseCommand,
+		StepInstructionsCommand,
+		RunToCommand,
+	} BNDebuggerCommandType;
+
+
+	// Where a debugger event callback is called
+	typedef enum BNDebuggerEventCallbackAffinity
+	{
+		// Right away, on the thread that posts the event. The adapter waits for the callback to return.
+		InlineEventCallbackAffinity,
+		// On the UI main thread, after the event is posted. Served by a worker thread when there is no UI.
+		MainThreadEventCallbackAffinity,
+		// On a thread dedicated to the callback, after the event is posted
+		WorkerThreadEventCallbackAffinity,
+	} BNDebuggerEventCallbackAffinity;
+
+
 	typedef struct BNTargetStoppedEventData
 	{
 		BNDebugStopReason reason;
@@ -290,9 +364,20 @@ extern "C"
 	} BNTargetExitedEventData;
 
 
+	// The output streams of the target
+	typedef enum BNTargetOutputChannel
+	{
+		TargetStdoutChannel,
+		TargetStderrChannel,
+	} BNTargetOutputChannel;
+
+
 	typedef struct BNStdoutMessageEventData
 	{
 		char* message;
+		BNTargetOutputChannel channel;
+		// The output that was overwritten in the buffer before it could be sent, right before the message
+		uint64_t droppedBytes;
 	} BNStdoutMessageEventData;
 
 
@@ -330,6 +415,7 @@ extern "C"
     	DebugAdapterStepOverReverse,
     	DebugAdapterGoReverse,
     	DebugAdapterStepReturnReverse,
+		DebugAdapterStepInstructions,
     } BNDebuggerAdapterOperation;
 
 
@@ -410,9 +496,25 @@ extern "C"
 	DEBUGGER_FFI_API bool BNDebuggerStepOverReverse(BNDebuggerController* controller, BNFunctionGraphType il);
 	DEBUGGER_FFI_API bool BNDebuggerStepReturn(BNDebuggerController* controller);
 	DEBUGGER_FFI_API bool BNDebuggerStepReturnReverse(BNDebuggerController* controller);
+	DEBUGGER_FFI_API bool BNDebuggerStepInstructions(BNDebuggerController* controller, uint64_t count);
 	DEBUGGER_FFI_API bool BNDebuggerRunTo(
 		BNDebuggerController* controller, const uint64_t* remoteAddresses, size_t count);
 	DEBUGGER_FFI_API void BNDebuggerPause(BNDebuggerController* controller);
+	DEBUGGER_FFI_API size_t BNDebuggerCancelPendingCommands(BNDebuggerController* controller);
+	DEBUGGER_FFI_API size_t BNDebuggerGetPendingCommandCount(BNDebuggerController* controller);
+	// Queues an operation the same way as BNDebuggerGo(), BNDebuggerStepInto(), etc. `il` is used by the step into and
+	// step over commands, `count` by StepInstructionsCommand, and `remoteAddresses` by RunToCommand. Returns the id of
+	// the command, or 0 if it is rejected. Unless it is rejected, `completion` is called exactly once with the stop
+	// reason, either on the thread that runs the commands, or on the thread that cancels the command, in which case
+	// the reason is InvalidStatusOrOperation.
+	DEBUGGER_FFI_API size_t BNDebuggerSubmitCommand(BNDebuggerController* controller, BNDebuggerCommandType type,
+		BNFunctionGraphType il, uint64_t count, const uint64_t* remoteAddresses, size_t addressCount,
+		void (*completion)(void* ctx, BNDebugStopReason reason), void* ctx);
+	// Cancels a command that has not started yet
+	DEBUGGER_FFI_API bool BNDebuggerCancelCommand(BNDebuggerController* controller, size_t id);
+
+	DEBUGGER_FFI_API bool BNDebuggerIsAutomationMode(BNDebuggerController* controller);
+	DEBUGGER_FFI_API void BNDebuggerSetAutomationMode(BNDebuggerController* controller, bool enabled);
 
 	DEBUGGER_FFI_API BNDebugStopReason BNDebuggerGoAndWait(BNDebuggerController* controller);
 	DEBUGGER_FFI_API BNDebugStopReason BNDebuggerGoReverseAndWait(BNDebuggerController* controller);
@@ -427,6 +529,8 @@ extern "C"
 		BNDebuggerController* controller, BNFunctionGraphType il);
 	DEBUGGER_FFI_API BNDebugStopReason BNDebuggerStepReturnAndWait(BNDebuggerController* controller);
 	DEBUGGER_FFI_API BNDebugStopReason BNDebuggerStepReturnReverseAndWait(BNDebuggerController* controller);
+	DEBUGGER_FFI_API BNDebugStopReason BNDebuggerStepInstructionsAndWait(
+		BNDebuggerController* controller, uint64_t count);
 	DEBUGGER_FFI_API BNDebugStopReason BNDebuggerRunToAndWait(
 		BNDebuggerController* controller, const uint64_t* remoteAddresses, size_t count);
 	DEBUGGER_FFI_API BNDebugStopReason BNDebuggerPauseAndWait(BNDebuggerController* controller);
@@ -468,9 +572,59 @@ extern "C"
 	DEBUGGER_FFI_API bool BNDebuggerContainsAbsoluteBreakpoint(BNDebuggerController* controller, uint64_t address);
 	DEBUGGER_FFI_API bool BNDebuggerContainsRelativeBreakpoint(
 		BNDebuggerController* controller, const char* module, uint64_t offset);
+	DEBUGGER_FFI_API void BNDebuggerFlushBreakpoints(BNDebuggerController* controller);
+	DEBUGGER_FFI_API bool BNDebuggerAddHardwareBreakpoint(
+		BNDebuggerController* controller, uint64_t address, BNDebugBreakpointType type, size_t size);
+	DEBUGGER_FFI_API bool BNDebuggerRemoveHardwareBreakpoint(
+		BNDebuggerController* controller, uint64_t address, BNDebugBreakpointType type, size_t size);
+	DEBUGGER_FFI_API BNDebugHardwareBreakpoint* BNDebuggerGetHardwareBreakpoints(
+		BNDebuggerController* controller, size_t* count);
+	DEBUGGER_FFI_API void BNDebuggerFreeHardwareBreakpoints(BNDebugHardwareBreakpoint* breakpoints);
+	DEBUGGER_FFI_API bool BNDebuggerAddSoftwareWatchpoint(
+		BNDebuggerController* controller, uint64_t address, size_t size, BNDebugBreakpointType type);
+	DEBUGGER_FFI_API bool BNDebuggerRemoveSoftwareWatchpoint(
+		BNDebuggerController* controller, uint64_t address, size_t size, BNDebugBreakpointType type);
+	DEBUGGER_FFI_API BNDebugSoftwareWatchpoint* BNDebuggerGetSoftwareWatchpoints(
+		BNDebuggerController* controller, size_t* count);
+	DEBUGGER_FFI_API void BNDebuggerFreeSoftwareWatchpoints(BNDebugSoftwareWatchpoint* watchpoints);
+
+	// Coverage
+	DEBUGGER_FFI_API bool BNDebuggerStartCoverage(BNDebuggerController* controller);
+	DEBUGGER_FFI_API void BNDebuggerStopCoverage(BNDebuggerController* controller);
+	DEBUGGER_FFI_API bool BNDebuggerIsCoverageActive(BNDebuggerController* controller);
+	DEBUGGER_FFI_API size_t BNDebuggerGetCoverageBlockCount(BNDebuggerController* controller);
+	DEBUGGER_FFI_API uint64_t* BNDebuggerGetCoveredBlocks(BNDebuggerController* controller, size_t* count);
+	DEBUGGER_FFI_API void BNDebuggerFreeCoveredBlocks(uint64_t* blocks);
+	DEBUGGER_FFI_API bool BNDebuggerExportCoverageDrcov(BNDebuggerController* controller, const char* path);
+	DEBUGGER_FFI_API bool BNDebuggerExportCoverageLcov(BNDebuggerController* controller, const char* path);
+	DEBUGGER_FFI_API void BNDebuggerApplyCoverageHighlights(BNDebuggerController* controller);
+	DEBUGGER_FFI_API bool BNDebuggerSetAbsoluteBreakpointCondition(
+		BNDebuggerController* controller, uint64_t address, const char* condition);
+	DEBUGGER_FFI_API bool BNDebuggerSetRelativeBreakpointCondition(
+		BNDebuggerController* controller, const char* module, uint64_t offset, const char* condition);
+	DEBUGGER_FFI_API char* BNDebuggerGetAbsoluteBreakpointCondition(BNDebuggerController* controller, uint64_t address);
+	DEBUGGER_FFI_API char* BNDebuggerGetRelativeBreakpointCondition(
+		BNDebuggerController* controller, const char* module, uint64_t offset);
+	DEBUGGER_FFI_API bool BNDebuggerSetAbsoluteBreakpointLogMessage(
+		BNDebuggerController* controller, uint64_t address, const char* message);
+	DEBUGGER_FFI_API bool BNDebuggerSetRelativeBreakpointLogMessage(
+		BNDebuggerController* controller, const char* module, uint64_t offset, const char* message);
+	DEBUGGER_FFI_API bool BNDebuggerSetAbsoluteBreakpointIgnoreCount(
+		BNDebuggerController* controller, uint64_t address, uint64_t count);
+	DEBUGGER_FFI_API bool BNDebuggerSetRelativeBreakpointIgnoreCount(
+		BNDebuggerController* controller, const char* module, uint64_t offset, uint64_t count);
+	DEBUGGER_FFI_API uint64_t BNDebuggerGetAbsoluteBreakpointHitCount(BNDebuggerController* controller, uint64_t address);
+	DEBUGGER_FFI_API uint64_t BNDebuggerGetRelativeBreakpointHitCount(
+		BNDebuggerController* controller, const char* module, uint64_t offset);
 
 	DEBUGGER_FFI_API uint64_t BNDebuggerGetIP(BNDebuggerController* controller);
 	DEBUGGER_FFI_API uint64_t BNDebuggerGetLastIP(BNDebuggerController* controller);
+
+	DEBUGGER_FFI_API uint64_t BNDebuggerGetStopEpoch(BNDebuggerController* controller);
+	DEBUGGER_FFI_API uint64_t BNDebuggerGetRegistersEpoch(BNDebuggerController* controller);
+	DEBUGGER_FFI_API uint64_t BNDebuggerGetMemoryEpoch(BNDebuggerController* controller);
+	DEBUGGER_FFI_API uint64_t BNDebuggerGetModulesEpoch(BNDebuggerController* controller);
+	DEBUGGER_FFI_API uint64_t BNDebuggerGetThreadsEpoch(BNDebuggerController* controller);
 	DEBUGGER_FFI_API bool BNDebuggerSetIP(BNDebuggerController* controller, uint64_t address);
 
 	DEBUGGER_FFI_API uint64_t BNDebuggerRelativeAddressToAbsolute(
@@ -481,6 +635,10 @@ extern "C"
 	DEBUGGER_FFI_API uint32_t BNDebuggerGetExitCode(BNDebuggerController* controller);
 
 	DEBUGGER_FFI_API void BNDebuggerWriteStdin(BNDebuggerController* controller, const char* data, size_t len);
+	DEBUGGER_FFI_API BNDataBuffer* BNDebuggerReadTargetOutput(BNDebuggerController* controller,
+		BNTargetOutputChannel channel, uint64_t* position, uint64_t* droppedBytes, size_t maxSize);
+	DEBUGGER_FFI_API uint64_t BNDebuggerGetTargetOutputPosition(
+		BNDebuggerController* controller, BNTargetOutputChannel channel);
 
 	DEBUGGER_FFI_API char* BNDebuggerInvokeBackendCommand(BNDebuggerController* controller, const char* cmd);
 
@@ -512,8 +670,11 @@ extern "C"
 
 
 	// Debugger events
+	// `release` is called with `ctx` once the callback is removed and can no longer be running, so the caller can free
+	// what `ctx` points to
 	DEBUGGER_FFI_API size_t BNDebuggerRegisterEventCallback(BNDebuggerController* controller,
-		void (*callback)(void* ctx, BNDebuggerEvent* event), const char* name, void* ctx);
+		void (*callback)(void* ctx, BNDebuggerEvent* event), void (*release)(void* ctx), const char* name, void* ctx,
+		BNDebuggerEventCallbackAffinity affinity, uint64_t eventTypes);
 	DEBUGGER_FFI_API void BNDebuggerRemoveEventCallback(BNDebuggerController* controller, size_t index);
 
 	DEBUGGER_FFI_API BNMetadata* BNDebuggerGetAdapterProperty(BNDebuggerController* controller, const char* name);
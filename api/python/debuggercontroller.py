@@ -13,14 +13,17 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 
+import concurrent.futures
 import ctypes
+import itertools
+import threading
 import traceback
 
 import binaryninja
 # import debugger
 from . import _debuggercore as dbgcore
 from .debugger_enums import *
-from typing import Callable, List, Union
+from typing import Callable, Iterable, List, Optional, Tuple, Union
 
 
 class DebugProcess:
@@ -29,12 +32,20 @@ class DebugProcess:
 
     * ``pid``: the ID of the process
     * ``name``: the name of the process
+    * ``parent_pid``: the ID of the parent process, or 0 if unknown
+    * ``user``: the user that owns the process, or an empty string if unknown
+    * ``arch``: the architecture of the process, or an empty string if unknown
+    * ``command_line``: the command line of the process, or an empty string if unknown
 
     """
 
-    def __init__(self, pid, name):
+    def __init__(self, pid, name, parent_pid=0, user='', arch='', command_line=''):
         self.pid = pid
         self.name = name
+        self.parent_pid = parent_pid
+        self.user = user
+        self.arch = arch
+        self.command_line = command_line
 
     def __eq__(self, other):
         if not isinstance(other, self.__class__):
@@ -226,19 +237,26 @@ class DebugBreakpoint:
     * ``offset``: the offset of the breakpoint to the start of the module
     * ``address``: the absolute address of the breakpoint
     * ``enabled``: not used
+    * ``condition``: the condition of the breakpoint, or an empty string if it is unconditional
+    * ``log_message``: the message of a log point, or an empty string if the breakpoint stops the target
+    * ``hit_count``: the number of times the breakpoint has been hit in the current session
 
     """
-    def __init__(self, module, offset, address, enabled):
+    def __init__(self, module, offset, address, enabled, condition='', log_message='', hit_count=0):
         self.module = module
         self.offset = offset
         self.address = address
         self.enabled = enabled
+        self.condition = condition
+        self.log_message = log_message
+        self.hit_count = hit_count
 
     def __eq__(self, other):
         if not isinstance(other, self.__class__):
             return NotImplemented
         return self.module == other.module and self.offset == other.offset and self.address == other.address \
-               and self.enabled == other.enabled
+               and self.enabled == other.enabled and self.condition == other.condition \
+               and self.log_message == other.log_message
 
     def __ne__(self, other):
         if not isinstance(other, self.__class__):
@@ -258,6 +276,68 @@ class DebugBreakpoint:
         return f"<DebugBreakpoint: {self.module}:{self.offset:#x}, {self.address:#x}>"
 
 
+class DebugHardwareBreakpoint:
+    """
+    DebugHardwareBreakpoint represents a hardware breakpoint or watchpoint. It has the following fields:
+
+    * ``address``: the absolute address of the breakpoint
+    * ``type``: the ``DebugBreakpointType`` of the breakpoint
+    * ``size``: the length of the watched range, in bytes
+
+    """
+    def __init__(self, address, type, size):
+        self.address = address
+        self.type = type
+        self.size = size
+
+    def __eq__(self, other):
+        if not isinstance(other, self.__class__):
+            return NotImplemented
+        return self.address == other.address and self.type == other.type and self.size == other.size
+
+    def __ne__(self, other):
+        if not isinstance(other, self.__class__):
+            return NotImplemented
+        return not (self == other)
+
+    def __hash__(self):
+        return hash((self.address, self.type, self.size))
+
+    def __repr__(self):
+        return f"<DebugHardwareBreakpoint: {self.type.name} {self.address:#x}, {self.size}>"
+
+
+class DebugSoftwareWatchpoint:
+    """
+    DebugSoftwareWatchpoint represents a watchpoint implemented with page protections. It has the following fields:
+
+    * ``address``: the start of the watched range
+    * ``size``: the length of the watched range, in bytes
+    * ``type``: the ``DebugBreakpointType`` of the watchpoint
+
+    """
+    def __init__(self, address, size, type):
+        self.address = address
+        self.size = size
+        self.type = type
+
+    def __eq__(self, other):
+        if not isinstance(other, self.__class__):
+            return NotImplemented
+        return self.address == other.address and self.size == other.size and self.type == other.type
+
+    def __ne__(self, other):
+        if not isinstance(other, self.__class__):
+            return NotImplemented
+        return not (self == other)
+
+    def __hash__(self):
+        return hash((self.address, self.size, self.type))
+
+    def __repr__(self):
+        return f"<DebugSoftwareWatchpoint: {self.type.name} {self.address:#x}, {self.size:#x}>"
+
+
 class ModuleNameAndOffset:
     """
     ModuleNameAndOffset represents an address that is relative to the start of module. It is useful when ASLR is on.
@@ -400,11 +480,17 @@ class StdOutMessageEventData:
     """
     StdOutMessageEventData is the data associated with a StdOutMessageEvent
 
-    * ``message``: the message that the target writes to the stdout
+    * ``message``: the message that the target writes to the stdout or stderr
+    * ``channel``: the ``TargetOutputChannel`` the message is written to
+    * ``dropped_bytes``: the number of bytes of output dropped right before the message, because the target wrote \
+        faster than it could be delivered
 
     """
-    def __init__(self, message: str):
+    def __init__(self, message: str, channel: TargetOutputChannel = TargetOutputChannel.TargetStdoutChannel,
+                 dropped_bytes: int = 0):
         self.message = message
+        self.channel = channel
+        self.dropped_bytes = dropped_bytes
 
 
 class DebuggerEventData:
@@ -451,23 +537,33 @@ DebuggerEventCallback = Callable[['DebuggerEvent'], None]
 
 class DebuggerEventWrapper:
 
-    # This has no functional purposes;
-    # we just need it to stop Python from prematurely freeing the object
+    # Keeps the ctypes objects alive, keyed by the context passed to the core. The core releases the context once the
+    # callback is removed and no longer running, and only then is the object freed.
     _debugger_events = {}
+    _contexts = itertools.count(1)
+    _release_callback = ctypes.CFUNCTYPE(None, ctypes.c_void_p)(
+        lambda ctxt: DebuggerEventWrapper._debugger_events.pop(ctxt, None))
 
     @classmethod
-    def register(cls, controller: 'DebuggerController', callback: DebuggerEventCallback, name: Union[str, bytes]) -> int:
+    def register(cls, controller: 'DebuggerController', callback: DebuggerEventCallback, name: Union[str, bytes],
+                 affinity: DebuggerEventCallbackAffinity,
+                 event_types: Optional[Iterable[DebuggerEventType]]) -> int:
         callback_obj = ctypes.CFUNCTYPE(None, ctypes.c_void_p, ctypes.POINTER(dbgcore.BNDebuggerEvent))\
                                         (lambda ctxt, event: cls._notify(event[0], callback))
-        handle = dbgcore.BNDebuggerRegisterEventCallback(controller.handle, callback_obj, name, None)
-        cls._debugger_events[handle] = callback_obj
-        return handle
+        mask = 0xffffffffffffffff
+        if event_types is not None:
+            mask = 0
+            for event_type in event_types:
+                mask |= 1 << int(event_type)
+        context = next(cls._contexts)
+        cls._debugger_events[context] = callback_obj
+        return dbgcore.BNDebuggerRegisterEventCallback(controller.handle, callback_obj, cls._release_callback, name,
+                                                       context, affinity, mask)
 
     @classmethod
     def remove(cls, controller: 'DebuggerController', index: int) -> None:
         try:
             dbgcore.BNDebuggerRemoveEventCallback(controller.handle, index)
-            del cls._debugger_events[index]
         except:
             binaryninja.log_error(f'invalid debugger event callback index {index}')
 
@@ -483,7 +579,9 @@ class DebuggerEventWrapper:
             absolute_addr = data.absoluteAddress
             relative_addr = ModuleNameAndOffset(data.relativeAddress.module, data.relativeAddress.offset)
             exit_data = TargetExitedEventData(data.exitData.exitCode)
-            message_data = StdOutMessageEventData(data.messageData.message)
+            message_data = StdOutMessageEventData(data.messageData.message,
+                                                  TargetOutputChannel(data.messageData.channel),
+                                                  data.messageData.droppedBytes)
             event_data = DebuggerEventData(target_stopped_data, error_data, absolute_addr, relative_addr, exit_data,
                                            message_data)
             event = DebuggerEvent(event.type, event_data)
@@ -492,6 +590,97 @@ class DebuggerEventWrapper:
             binaryninja.log_error(traceback.format_exc())
 
 
+class DebuggerCommand:
+    """
+    ``DebuggerCommand`` is a target control operation queued by ``DebuggerController.submit_command()``. It has the
+    following fields:
+
+    * ``id``: the ID of the command, which can be passed to ``DebuggerController.cancel_command()``
+    * ``future``: a ``concurrent.futures.Future`` that resolves with the ``DebugStopReason`` of the command
+
+    A cancelled command resolves with ``DebugStopReason.InvalidStatusOrOperation``.
+    """
+    def __init__(self, controller: 'DebuggerController', future: concurrent.futures.Future):
+        self.controller = controller
+        self.id = 0
+        self.future = future
+
+    def result(self, timeout: Optional[float] = None) -> DebugStopReason:
+        """
+        Wait for the command to finish, and return its stop reason
+
+        :param timeout: the number of seconds to wait for, or None to wait without a limit
+        """
+        return self.future.result(timeout)
+
+    def done(self) -> bool:
+        """Whether the command has finished, or is cancelled"""
+        return self.future.done()
+
+    def cancel(self) -> bool:
+        """
+        Cancel the command if it has not started yet
+
+        :return: whether the command is cancelled
+        """
+        return self.controller.cancel_command(self.id)
+
+    def __repr__(self):
+        return f"<DebuggerCommand: {self.id}>"
+
+
+class DebuggerCommandWrapper:
+
+    # The completion callback is shared by all the commands, and never freed. Each command is identified by a token,
+    # which is passed as the context of the callback, since the callback may run before the command ID is known.
+    _lock = threading.Lock()
+    _next_token = 1
+    _commands = {}
+    _callback = None
+
+    @classmethod
+    def submit(cls, controller: 'DebuggerController', command_type: DebuggerCommandType,
+               il: binaryninja.FunctionGraphType, count: int, addresses: List[int],
+               completion: Optional[Callable[[DebugStopReason], None]]) -> Optional[DebuggerCommand]:
+        future = concurrent.futures.Future()
+        if completion is not None:
+            future.add_done_callback(lambda f: cls._complete(f, completion))
+        command = DebuggerCommand(controller, future)
+
+        with cls._lock:
+            if cls._callback is None:
+                cls._callback = ctypes.CFUNCTYPE(None, ctypes.c_void_p, dbgcore.DebugStopReasonEnum)(cls._notify)
+            token = cls._next_token
+            cls._next_token += 1
+            cls._commands[token] = future
+
+        addr_list = (ctypes.c_uint64 * len(addresses))()
+        for i in range(len(addresses)):
+            addr_list[i] = addresses[i]
+
+        command.id = dbgcore.BNDebuggerSubmitCommand(controller.handle, command_type, il, count, addr_list,
+                                                     len(addresses), cls._callback, token)
+        if command.id == 0:
+            with cls._lock:
+                del cls._commands[token]
+            return None
+        return command
+
+    @classmethod
+    def _notify(cls, ctxt, reason) -> None:
+        with cls._lock:
+            future = cls._commands.pop(ctxt, None)
+        if future is not None:
+            future.set_result(DebugStopReason(reason))
+
+    @staticmethod
+    def _complete(future: concurrent.futures.Future, completion: Callable[[DebugStopReason], None]) -> None:
+        try:
+            completion(future.result())
+        except:
+            binaryninja.log_error(traceback.format_exc())
+
+
 class DebuggerController:
     """
     The ``DebuggerController`` object is the core of the debugger. Most debugger operations can be performed on it.
@@ -627,7 +816,9 @@ class DebuggerController:
         process_list = dbgcore.BNDebuggerGetProcessList(self.handle, count)
         result = []
         for i in range(0, count.value):
-            process = DebugProcess(process_list[i].m_pid, process_list[i].m_processName)
+            process = DebugProcess(process_list[i].m_pid, process_list[i].m_processName,
+                                   process_list[i].m_parentPid, process_list[i].m_user,
+                                   process_list[i].m_architecture, process_list[i].m_commandLine)
             result.append(process)
 
         dbgcore.BNDebuggerFreeProcessList(process_list, count.value)
@@ -795,6 +986,86 @@ class DebuggerController:
         """
         dbgcore.BNDebuggerPause(self.handle)
 
+    def cancel_pending_commands(self) -> int:
+        """
+        Cancel the resume and step operations that are queued but have not started yet.
+
+        The asynchronous operations, e.g., ``go()`` and ``step_into()``, are run one after another. One that is
+        requested while another is in flight waits for it to finish, rather than failing. ``pause()``, ``quit()`` and
+        ``detach()`` are never queued.
+
+        :return: the number of cancelled operations
+        """
+        return dbgcore.BNDebuggerCancelPendingCommands(self.handle)
+
+    @property
+    def pending_command_count(self) -> int:
+        """
+        The number of queued operations that have not started yet
+        """
+        return dbgcore.BNDebuggerGetPendingCommandCount(self.handle)
+
+    def submit_command(self, command_type: DebuggerCommandType,
+                       il: binaryninja.FunctionGraphType = binaryninja.FunctionGraphType.NormalFunctionGraph,
+                       count: int = 1, addresses: Optional[Union[int, List[int]]] = None,
+                       completion: Optional[Callable[[DebugStopReason], None]] = None) -> Optional[DebuggerCommand]:
+        """
+        Queue a target control operation, and get a handle to wait for it, or cancel it.
+
+        This does the same as the asynchronous operations, e.g., ``go()`` and ``step_into()``, which only tell whether
+        the operation is queued. The returned command has a future that resolves with the stop reason of the operation,
+        so several operations can be queued back to back, and their results collected later::
+
+            >>> steps = [dbg.submit_command(DebuggerCommandType.StepIntoCommand) for _ in range(3)]
+            >>> [step.result() for step in steps]
+
+        The completion callback, if given, is called with the stop reason once the operation finishes, on the thread
+        that runs the operations. Do not wait for another command from it.
+
+        :param command_type: the operation to queue
+        :param il: the IL level of ``StepIntoCommand``, ``StepIntoReverseCommand``, ``StepOverCommand`` and
+            ``StepOverReverseCommand``
+        :param count: the number of instructions of ``StepInstructionsCommand``
+        :param addresses: the address, or a list of addresses, of ``RunToCommand``
+        :param completion: optional callback to call with the stop reason
+        :return: the queued command, or None if the operation is rejected, e.g., the target is not running
+        """
+        if addresses is None:
+            addresses = []
+        elif isinstance(addresses, int):
+            addresses = [addresses]
+
+        return DebuggerCommandWrapper.submit(self, command_type, il, count, addresses, completion)
+
+    def cancel_command(self, command_id: int) -> bool:
+        """
+        Cancel a command queued by ``submit_command()`` that has not started yet. Its future resolves with
+        ``DebugStopReason.InvalidStatusOrOperation``.
+
+        :param command_id: the ID of the command
+        :return: whether the command is cancelled
+        """
+        return dbgcore.BNDebuggerCancelCommand(self.handle, command_id)
+
+    @property
+    def automation_mode(self) -> bool:
+        """
+        Whether the debugger skips the work that only serves the UI when the target stops. (read/write)
+
+        In automation mode, register hints, stack variable annotations, expression parser values and view refreshes
+        are skipped, and analysis updates are deferred until automation mode is turned off. Turn this on when a script
+        drives the target in a tight loop and nobody watches the UI. The default comes from the
+        ``debugger.automationMode`` setting.
+
+        :getter: returns whether automation mode is on
+        :setter: turns automation mode on or off
+        """
+        return dbgcore.BNDebuggerIsAutomationMode(self.handle)
+
+    @automation_mode.setter
+    def automation_mode(self, enabled: bool) -> None:
+        dbgcore.BNDebuggerSetAutomationMode(self.handle, enabled)
+
     def launch_or_connect(self) -> None:
         """
         Launch or connect to the target. Intended for internal use. Ordinary users do not need to call it.
@@ -962,6 +1233,21 @@ class DebuggerController:
         """
         return dbgcore.BNDebuggerStepReturnReverse(self.handle)
 
+    def step_instructions(self, count: int) -> bool:
+        """
+        Execute ``count`` instructions, following calls, and only stop once at the end.
+
+        This is much faster than calling ``step_into()`` in a loop, because the adapter does the steps on its own and
+        the intermediate stops are never reported. Stepping ends early when the target stops for any other reason,
+        e.g., an exception or a breakpoint that is hit. A step that merely lands on a breakpoint does not end it.
+
+        The call is asynchronous and returns before the target stops.
+
+        :param count: the number of instructions to execute
+        :return: whether the operation is successfully requested
+        """
+        return dbgcore.BNDebuggerStepInstructions(self.handle, count)
+
     def run_to(self, address) -> bool:
         """
         Resume the target, and wait for it to break at the given address(es).
@@ -1115,6 +1401,17 @@ class DebuggerController:
         """
         return DebugStopReason(dbgcore.BNDebuggerStepReturnAndWait(self.handle))
 
+    def step_instructions_and_wait(self, count: int) -> DebugStopReason:
+        """
+        Execute ``count`` instructions, following calls, and only stop once at the end. See ``step_instructions()``.
+
+        The call is blocking and only returns when the target stops.
+
+        :param count: the number of instructions to execute
+        :return: the reason for the stop
+        """
+        return DebugStopReason(dbgcore.BNDebuggerStepInstructionsAndWait(self.handle, count))
+
     def run_to_and_wait(self, address) -> DebugStopReason:
         """
         Resume the target, and wait for it to break at the given address(es).
@@ -1331,12 +1628,180 @@ class DebuggerController:
         breakpoints = dbgcore.BNDebuggerGetBreakpoints(self.handle, count)
         result = []
         for i in range(0, count.value):
-            bp = DebugBreakpoint(breakpoints[i].module, breakpoints[i].offset, breakpoints[i].address, breakpoints[i].enabled)
+            bp = DebugBreakpoint(breakpoints[i].module, breakpoints[i].offset, breakpoints[i].address,
+                                 breakpoints[i].enabled, breakpoints[i].condition, breakpoints[i].logMessage,
+                                 breakpoints[i].hitCount)
             result.append(bp)
 
         dbgcore.BNDebuggerFreeBreakpoints(breakpoints, count.value)
         return result
 
+    @property
+    def hardware_breakpoints(self) -> List[DebugHardwareBreakpoint]:
+        """
+        The list of hardware breakpoints and watchpoints
+        """
+        count = ctypes.c_ulonglong()
+        breakpoints = dbgcore.BNDebuggerGetHardwareBreakpoints(self.handle, count)
+        result = []
+        for i in range(0, count.value):
+            bp = DebugHardwareBreakpoint(breakpoints[i].address, DebugBreakpointType(breakpoints[i].type),
+                                         breakpoints[i].size)
+            result.append(bp)
+
+        dbgcore.BNDebuggerFreeHardwareBreakpoints(breakpoints)
+        return result
+
+    def add_hardware_breakpoint(self, address: int,
+                                type: DebugBreakpointType = DebugBreakpointType.HardwareExecuteBreakpoint,
+                                size: int = 1) -> bool:
+        """
+        Add a hardware breakpoint or watchpoint
+
+        Watchpoints stop the target right after an instruction reads and/or writes the watched range, which makes it
+        easy to find out who corrupts a value. The CPU only has a few debug registers (four on x86_64), so the call
+        fails when they are all in use. Hardware breakpoints are not saved along with the software breakpoints.
+
+        :param address: the absolute address to break on or to watch
+        :param type: ``HardwareExecuteBreakpoint``, ``HardwareReadWatchpoint``, ``HardwareWriteWatchpoint`` or
+            ``HardwareAccessWatchpoint``. x86_64 has no read-only watchpoints, use ``HardwareAccessWatchpoint`` instead.
+        :param size: the length of the watched range: 1, 2, 4 or 8. The address must be aligned to it.
+        :return: whether the breakpoint is added
+        """
+        return dbgcore.BNDebuggerAddHardwareBreakpoint(self.handle, address, type, size)
+
+    def remove_hardware_breakpoint(self, address: int,
+                                   type: DebugBreakpointType = DebugBreakpointType.HardwareExecuteBreakpoint,
+                                   size: int = 1) -> bool:
+        """
+        Remove a hardware breakpoint or watchpoint
+
+        :param address: the address of the breakpoint
+        :param type: the type of the breakpoint
+        :param size: the size of the breakpoint
+        :return: False if there is no such breakpoint
+        """
+        return dbgcore.BNDebuggerRemoveHardwareBreakpoint(self.handle, address, type, size)
+
+    @property
+    def software_watchpoints(self) -> List[DebugSoftwareWatchpoint]:
+        """
+        The list of software watchpoints
+        """
+        count = ctypes.c_ulonglong()
+        watchpoints = dbgcore.BNDebuggerGetSoftwareWatchpoints(self.handle, count)
+        result = []
+        for i in range(0, count.value):
+            wp = DebugSoftwareWatchpoint(watchpoints[i].address, watchpoints[i].size,
+                                         DebugBreakpointType(watchpoints[i].type))
+            result.append(wp)
+
+        dbgcore.BNDebuggerFreeSoftwareWatchpoints(watchpoints)
+        return result
+
+    def add_software_watchpoint(self, address: int, size: int,
+                                type: DebugBreakpointType = DebugBreakpointType.HardwareWriteWatchpoint) -> bool:
+        """
+        Add a software watchpoint. Only supported by the LLDB adapter on Linux.
+
+        Software watchpoints take away the write permission (or the read permission, for read and access
+        watchpoints) of the pages that hold the watched range. Unlike hardware watchpoints, there is no limit on their
+        number or size, so they can watch whole buffers. Accesses to the same pages that do not touch the watched
+        range are stepped over transparently, but they still slow the target down.
+
+        The target must be stopped, and the watchpoints are removed when it exits. Accesses made by the kernel, e.g.,
+        a ``read()`` into a watched buffer, fail with EFAULT instead of triggering the watchpoint.
+
+        :param address: the start of the watched range
+        :param size: the length of the watched range, in bytes
+        :param type: ``HardwareWriteWatchpoint``, ``HardwareReadWatchpoint`` or ``HardwareAccessWatchpoint``. Read
+            watchpoints also trigger on writes.
+        :return: whether the watchpoint is added
+        """
+        return dbgcore.BNDebuggerAddSoftwareWatchpoint(self.handle, address, size, type)
+
+    def remove_software_watchpoint(self, address: int, size: int,
+                                   type: DebugBreakpointType = DebugBreakpointType.HardwareWriteWatchpoint) -> bool:
+        """
+        Remove a software watchpoint
+
+        :param address: the start of the watched range
+        :param size: the length of the watched range
+        :param type: the type of the watchpoint
+        :return: False if there is no such watchpoint
+        """
+        return dbgcore.BNDebuggerRemoveSoftwareWatchpoint(self.handle, address, size, type)
+
+    def start_coverage(self) -> bool:
+        """
+        Start collecting basic block coverage of the input file. Only supported by the LLDB adapter.
+
+        A breakpoint is placed on every basic block found by the analysis. Each of them is removed on its first hit,
+        without stopping the target, so the overhead goes away once the hot code is covered. The target must be
+        stopped, and starting again discards the previous results.
+
+        :return: whether the coverage collection is started
+        """
+        return dbgcore.BNDebuggerStartCoverage(self.handle)
+
+    def stop_coverage(self) -> None:
+        """
+        Stop collecting coverage and remove the remaining breakpoints. The results are kept until the next
+        ``start_coverage()``. This happens automatically when the target exits.
+        """
+        dbgcore.BNDebuggerStopCoverage(self.handle)
+
+    @property
+    def coverage_active(self) -> bool:
+        """
+        Whether coverage is being collected
+        """
+        return dbgcore.BNDebuggerIsCoverageActive(self.handle)
+
+    @property
+    def coverage_block_count(self) -> int:
+        """
+        The number of basic blocks coverage is collected for
+        """
+        return dbgcore.BNDebuggerGetCoverageBlockCount(self.handle)
+
+    @property
+    def covered_blocks(self) -> List[int]:
+        """
+        The start addresses of the basic blocks that have been executed
+        """
+        count = ctypes.c_ulonglong()
+        blocks = dbgcore.BNDebuggerGetCoveredBlocks(self.handle, count)
+        result = []
+        for i in range(0, count.value):
+            result.append(blocks[i])
+
+        dbgcore.BNDebuggerFreeCoveredBlocks(blocks)
+        return result
+
+    def export_coverage_drcov(self, path: str) -> bool:
+        """
+        Write the coverage in the drcov format, which is understood by most coverage visualization tools
+
+        :param path: the output file
+        """
+        return dbgcore.BNDebuggerExportCoverageDrcov(self.handle, path)
+
+    def export_coverage_lcov(self, path: str) -> bool:
+        """
+        Write the coverage in the lcov format. There is no source information, so the offsets of the basic blocks and
+        functions from the start of the module are used as line numbers.
+
+        :param path: the output file
+        """
+        return dbgcore.BNDebuggerExportCoverageLcov(self.handle, path)
+
+    def highlight_coverage(self) -> None:
+        """
+        Highlight the executed basic blocks in the view
+        """
+        dbgcore.BNDebuggerApplyCoverageHighlights(self.handle)
+
     def delete_breakpoint(self, address):
         """
         Delete a breakpoint
@@ -1385,6 +1850,105 @@ class DebuggerController:
         else:
             raise NotImplementedError
 
+    def set_breakpoint_condition(self, address, condition: Union[str, bytes]) -> bool:
+        """
+        Set the condition of an existing breakpoint. An empty condition makes the breakpoint unconditional again.
+
+        The condition is an integer expression over registers and memory, e.g., ``rdi == 0x10 && u32[rsp + 8] != 0``.
+        Registers can be written with or without a ``$`` prefix. ``[expr]`` reads a pointer-sized value from memory,
+        and ``u8[expr]``, ``u16[expr]``, ``u32[expr]``, ``u64[expr]`` read a value of the given width. The C arithmetic,
+        bitwise, comparison and logical operators are supported.
+
+        The condition is evaluated by the debug adapter when the breakpoint is hit. If it is false, the target is
+        resumed right away and no stop is reported.
+
+        :param address: the address of the breakpoint, either an absolute address or a ModuleNameAndOffset
+        :param condition: the condition
+        :return: False if there is no breakpoint at the address or the condition is invalid
+        """
+        if isinstance(address, int):
+            return dbgcore.BNDebuggerSetAbsoluteBreakpointCondition(self.handle, address, condition)
+        elif isinstance(address, ModuleNameAndOffset):
+            return dbgcore.BNDebuggerSetRelativeBreakpointCondition(self.handle, address.module, address.offset,
+                                                                    condition)
+        else:
+            raise NotImplementedError
+
+    def get_breakpoint_condition(self, address) -> str:
+        """
+        Get the condition of a breakpoint, or an empty string if it has none
+
+        :param address: the address of the breakpoint, either an absolute address or a ModuleNameAndOffset
+        """
+        if isinstance(address, int):
+            return dbgcore.BNDebuggerGetAbsoluteBreakpointCondition(self.handle, address)
+        elif isinstance(address, ModuleNameAndOffset):
+            return dbgcore.BNDebuggerGetRelativeBreakpointCondition(self.handle, address.module, address.offset)
+        else:
+            raise NotImplementedError
+
+    def set_breakpoint_log_message(self, address, message: Union[str, bytes]) -> bool:
+        """
+        Turn an existing breakpoint into a log point. An empty message makes it a normal breakpoint again.
+
+        When a log point is hit (and its condition, if any, is true), the message is formatted and the target is
+        resumed right away. ``{expr}`` in the message is replaced with the value of the expression, which uses the
+        same syntax as breakpoint conditions. Values are printed in hex by default; use ``{expr:d}`` for decimal. Use
+        ``{{`` and ``}}`` for literal braces, e.g., ``open({rdi:x}, flags={rsi:d})``.
+
+        The messages are printed in the debugger console in batches, so a hot log point does not flood the UI.
+
+        :param address: the address of the breakpoint, either an absolute address or a ModuleNameAndOffset
+        :param message: the message
+        :return: False if there is no breakpoint at the address or the message is invalid
+        """
+        if isinstance(address, int):
+            return dbgcore.BNDebuggerSetAbsoluteBreakpointLogMessage(self.handle, address, message)
+        elif isinstance(address, ModuleNameAndOffset):
+            return dbgcore.BNDebuggerSetRelativeBreakpointLogMessage(self.handle, address.module, address.offset,
+                                                                     message)
+        else:
+            raise NotImplementedError
+
+    def set_breakpoint_ignore_count(self, address, count: int) -> bool:
+        """
+        Ignore the next ``count`` hits of a breakpoint. Ignored hits still count towards the hit count.
+
+        :param address: the address of the breakpoint, either an absolute address or a ModuleNameAndOffset
+        :param count: the number of hits to ignore
+        :return: False if there is no breakpoint at the address
+        """
+        if isinstance(address, int):
+            return dbgcore.BNDebuggerSetAbsoluteBreakpointIgnoreCount(self.handle, address, count)
+        elif isinstance(address, ModuleNameAndOffset):
+            return dbgcore.BNDebuggerSetRelativeBreakpointIgnoreCount(self.handle, address.module, address.offset,
+                                                                      count)
+        else:
+            raise NotImplementedError
+
+    def get_breakpoint_hit_count(self, address) -> int:
+        """
+        Get the number of times a breakpoint has been hit since the target was launched or attached
+
+        :param address: the address of the breakpoint, either an absolute address or a ModuleNameAndOffset
+        """
+        if isinstance(address, int):
+            return dbgcore.BNDebuggerGetAbsoluteBreakpointHitCount(self.handle, address)
+        elif isinstance(address, ModuleNameAndOffset):
+            return dbgcore.BNDebuggerGetRelativeBreakpointHitCount(self.handle, address.module, address.offset)
+        else:
+            raise NotImplementedError
+
+    def flush_breakpoints(self) -> None:
+        """
+        Write pending breakpoint changes into the metadata of the BinaryView
+
+        Breakpoints are persisted lazily to avoid rewriting the metadata on every change, and changes are written out
+        at most a second after they are made. Call this before saving the database from a script right after changing
+        the breakpoints, so the latest ones are included.
+        """
+        dbgcore.BNDebuggerFlushBreakpoints(self.handle)
+
     @property
     def ip(self) -> int:
         """
@@ -1421,6 +1985,46 @@ class DebuggerController:
         """
         return dbgcore.BNDebuggerGetLastIP(self.handle)
 
+    @property
+    def stop_epoch(self) -> int:
+        """
+        A counter that changes every time the target runs, i.e., once per stop or exit (read-only)
+
+        Data derived from the target can be cached along with the epoch it was computed in, and is still current as
+        long as the epoch has not changed. The ``registers_epoch``, ``memory_epoch``, ``modules_epoch`` and
+        ``threads_epoch`` counters are finer-grained: they also change when the data is modified while the target is
+        stopped, e.g., when a register is written or the active thread is switched.
+        """
+        return dbgcore.BNDebuggerGetStopEpoch(self.handle)
+
+    @property
+    def registers_epoch(self) -> int:
+        """
+        A counter that changes whenever the register values may have changed (read-only). See ``stop_epoch``.
+        """
+        return dbgcore.BNDebuggerGetRegistersEpoch(self.handle)
+
+    @property
+    def memory_epoch(self) -> int:
+        """
+        A counter that changes whenever the target memory may have changed (read-only). See ``stop_epoch``.
+        """
+        return dbgcore.BNDebuggerGetMemoryEpoch(self.handle)
+
+    @property
+    def modules_epoch(self) -> int:
+        """
+        A counter that changes whenever the module list may have changed (read-only). See ``stop_epoch``.
+        """
+        return dbgcore.BNDebuggerGetModulesEpoch(self.handle)
+
+    @property
+    def threads_epoch(self) -> int:
+        """
+        A counter that changes whenever the threads or their frames may have changed (read-only). See ``stop_epoch``.
+        """
+        return dbgcore.BNDebuggerGetThreadsEpoch(self.handle)
+
     @property
     def exit_code(self) -> int:
         """
@@ -1430,17 +2034,31 @@ class DebuggerController:
         """
         return dbgcore.BNDebuggerGetExitCode(self.handle)
 
-    def register_event_callback(self, callback: DebuggerEventCallback, name: Union[str, bytes] = '') -> int:
+    def register_event_callback(self, callback: DebuggerEventCallback, name: Union[str, bytes] = '',
+                                affinity: DebuggerEventCallbackAffinity =
+                                DebuggerEventCallbackAffinity.MainThreadEventCallbackAffinity,
+                                event_types: Optional[Iterable[DebuggerEventType]] = None) -> int:
         """
         Register a debugger event callback to receive notification when various events happen.
 
         The callback receives DebuggerEvent object that contains the type of the event and associated data.
 
+        Events are queued for each callback and delivered in order, so a slow callback does not hold up the target or
+        the other callbacks. ``affinity`` selects the thread the callback runs on: the UI main thread (the default,
+        or a worker thread when running headless), a worker thread of its own, or inline on the thread that posts the
+        event. Inline callbacks block the target until they return, so they must be quick.
+
+        ``event_types`` limits the callback to the given event types, e.g.,
+        ``[DebuggerEventType.TargetStoppedEventType]``. Other events are dropped before they reach Python, which
+        saves a lot of work when the target prints heavily. By default, the callback receives every event.
+
         :param callback: the callback to register
         :param name: name of the callback
+        :param affinity: the thread the callback runs on
+        :param event_types: the event types the callback receives, or None for all of them
         :return: an integer handle to the registered event callback
         """
-        return DebuggerEventWrapper.register(self, callback, name)
+        return DebuggerEventWrapper.register(self, callback, name, affinity, event_types)
 
     def remove_event_callback(self, index: int):
         """
@@ -1489,6 +2107,34 @@ class DebuggerController:
         """
         dbgcore.BNDebuggerWriteStdin(self.handle, data, len(data))
 
+    def read_target_output(self, channel: TargetOutputChannel, position: int = 0,
+                           max_size: int = 0x10000) -> Tuple[bytes, int, int]:
+        """
+        Read the output of the target, independently of the ``StdoutMessageEventType`` events.
+
+        Every byte written to a channel has a position, which only grows. Pass the position returned by the previous
+        call to stream the output, or ``target_output_position(channel)`` to skip what was written so far. Only the
+        latest output is kept (see the ``debugger.targetOutputBufferSize`` setting).
+
+        :param channel: ``TargetOutputChannel.TargetStdoutChannel`` or ``TargetOutputChannel.TargetStderrChannel``
+        :param position: the position to read from
+        :param max_size: the maximum number of bytes to read
+        :return: the output, the position to read from next time, and the number of bytes that were dropped before \
+            they could be read
+        """
+        position = ctypes.c_uint64(position)
+        dropped = ctypes.c_uint64()
+        result = dbgcore.BNDebuggerReadTargetOutput(self.handle, channel, position, dropped, max_size)
+        buffer = ctypes.cast(result, ctypes.POINTER(binaryninja.core.BNDataBuffer))
+        data = bytes(binaryninja.DataBuffer(handle=buffer))
+        return data, position.value, dropped.value
+
+    def target_output_position(self, channel: TargetOutputChannel) -> int:
+        """
+        The position after the last byte the target wrote to ``channel``, see ``read_target_output()``
+        """
+        return dbgcore.BNDebuggerGetTargetOutputPosition(self.handle, channel)
+
     def execute_backend_command(self, command: Union[str, bytes]) -> str:
         """
         Execute a backend command and get the output
@@ -28,6 +28,7 @@ limitations under the License.
 #include "mediumlevelilinstruction.h"
 #include "highlevelilinstruction.h"
 #include "debuggerapi.h"
+#include "decodedinstructioncache.h"
 #include "log.h"
 #include "fmt/format.h"
 
@@ -123,6 +124,10 @@ void RegisterDisplay(DbgRef<DebuggerController> debugger)
 }
 
 
+// Every stop disassembles the instructions following the IP, most of which have been seen before
+static DecodedInstructionCache g_instructionCache;
+
+
 void DisasmDisplay(DbgRef<DebuggerController> debugger, const std::uint32_t count)
 {
 	using namespace BinaryNinja;
@@ -149,8 +154,8 @@ void DisasmDisplay(DbgRef<DebuggerController> debugger, const std::uint32_t coun
 
 		size_t size = data.GetLength();
 		std::vector<InstructionTextToken> instruction_tokens {};
-		if (!architecture->GetInstructionText(
-				(const uint8_t*)data.GetData(), instruction_offset, size, instruction_tokens))
+		if (!g_instructionCache.GetInstructionText(
+				architecture, instruction_offset, (const uint8_t*)data.GetData(), size, instruction_tokens))
 		{
 			printf("failed to disassemble\n");
 			return;
@@ -1533,6 +1533,8 @@ bool DbgEngAdapter::SupportFeature(DebugAdapterCapacity feature)
 		return true;
 	case DebugAdapterSupportThreads:
 		return true;
+	case DebugAdapterSupportStepReturn:
+		return true;
 	default:
 		return false;
 	}
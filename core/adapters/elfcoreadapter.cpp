@@ -0,0 +1,1045 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include "elfcoreadapter.h"
+
+#ifdef WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+using namespace BinaryNinja;
+using namespace BinaryNinjaDebugger;
+
+
+// The ELF constants are spelled out, rather than taken from <elf.h>, so cores can be opened on every platform
+static constexpr uint16_t ElfTypeCore = 4;
+static constexpr uint16_t ElfMachine386 = 3;
+static constexpr uint16_t ElfMachineX86_64 = 62;
+static constexpr uint16_t ElfMachineAArch64 = 183;
+static constexpr uint32_t ProgramHeaderLoad = 1;
+static constexpr uint32_t ProgramHeaderNote = 4;
+static constexpr uint32_t NotePrStatus = 1;
+static constexpr uint32_t NotePrPsInfo = 3;
+static constexpr uint32_t NoteFile = 0x46494c45;
+
+namespace {
+	struct CoreRegister
+	{
+		const char* name;
+		// Index of the register in the pr_reg array of NT_PRSTATUS
+		size_t index;
+		size_t width;
+	};
+
+	struct CoreLayout
+	{
+		const char* architecture;
+		uint16_t machine;
+		// Offsets in struct elf_prstatus
+		size_t pidOffset;
+		size_t registersOffset;
+		// Number of words in pr_reg
+		size_t registerCount;
+		std::vector<CoreRegister> registers;
+		const char* programCounter;
+		const char* stackPointer;
+		const char* framePointer;
+	};
+}  // namespace
+
+
+// The register names are the ones the other adapters use. pr_reg follows the layout of user_regs_struct.
+static const CoreLayout* GetCoreLayout(uint16_t machine)
+{
+	static const CoreLayout layouts[] = {
+		{"x86_64", ElfMachineX86_64, 32, 112, 27,
+			{{"rax", 10, 64}, {"rbx", 5, 64}, {"rcx", 11, 64}, {"rdx", 12, 64}, {"rsi", 13, 64}, {"rdi", 14, 64},
+				{"rbp", 4, 64}, {"rsp", 19, 64}, {"r8", 9, 64}, {"r9", 8, 64}, {"r10", 7, 64}, {"r11", 6, 64},
+				{"r12", 3, 64}, {"r13", 2, 64}, {"r14", 1, 64}, {"r15", 0, 64}, {"rip", 16, 64}, {"rflags", 18, 64},
+				{"cs", 17, 64}, {"fs", 25, 64}, {"gs", 26, 64}, {"ss", 20, 64}, {"ds", 23, 64}, {"es", 24, 64},
+				{"fs_base", 21, 64}, {"gs_base", 22, 64}},
+			"rip", "rsp", "rbp"},
+		{"x86", ElfMachine386, 24, 72, 17,
+			{{"eax", 6, 32}, {"ebx", 0, 32}, {"ecx", 1, 32}, {"edx", 2, 32}, {"esi", 3, 32}, {"edi", 4, 32},
+				{"ebp", 5, 32}, {"esp", 15, 32}, {"eip", 12, 32}, {"eflags", 14, 32}, {"cs", 13, 32}, {"ss", 16, 32},
+				{"ds", 7, 32}, {"es", 8, 32}, {"fs", 9, 32}, {"gs", 10, 32}},
+			"eip", "esp", "ebp"},
+		{"aarch64", ElfMachineAArch64, 32, 112, 34,
+			{{"x0", 0, 64}, {"x1", 1, 64}, {"x2", 2, 64}, {"x3", 3, 64}, {"x4", 4, 64}, {"x5", 5, 64},
+				{"x6", 6, 64}, {"x7", 7, 64}, {"x8", 8, 64}, {"x9", 9, 64}, {"x10", 10, 64}, {"x11", 11, 64},
+				{"x12", 12, 64}, {"x13", 13, 64}, {"x14", 14, 64}, {"x15", 15, 64}, {"x16", 16, 64},
+				{"x17", 17, 64}, {"x18", 18, 64}, {"x19", 19, 64}, {"x20", 20, 64}, {"x21", 21, 64},
+				{"x22", 22, 64}, {"x23", 23, 64}, {"x24", 24, 64}, {"x25", 25, 64}, {"x26", 26, 64},
+				{"x27", 27, 64}, {"x28", 28, 64}, {"fp", 29, 64}, {"lr", 30, 64}, {"sp", 31, 64}, {"pc", 32, 64},
+				{"cpsr", 33, 32}},
+			"pc", "sp", "fp"},
+	};
+
+	for (const auto& layout : layouts)
+	{
+		if (layout.machine == machine)
+			return &layout;
+	}
+	return nullptr;
+}
+
+
+static const CoreLayout* GetCoreLayout(const std::string& architecture)
+{
+	for (uint16_t machine : {ElfMachineX86_64, ElfMachine386, ElfMachineAArch64})
+	{
+		auto layout = GetCoreLayout(machine);
+		if (layout->architecture == architecture)
+			return layout;
+	}
+	return nullptr;
+}
+
+
+// The signal numbers of Linux on x86 and arm, which the core was written on
+static DebugStopReason GetStopReasonFromLinuxSignal(int signal)
+{
+	static const std::unordered_map<int, DebugStopReason> signalLookup = {
+		{1, DebugStopReason::SignalHup},
+		{2, DebugStopReason::SignalInt},
+		{3, DebugStopReason::SignalQuit},
+		{4, DebugStopReason::IllegalInstruction},
+		{5, DebugStopReason::Breakpoint},
+		{6, DebugStopReason::SignalAbrt},
+		{7, DebugStopReason::SignalBus},
+		{8, DebugStopReason::SignalFpe},
+		{9, DebugStopReason::SignalKill},
+		{10, DebugStopReason::SignalUsr1},
+		{11, DebugStopReason::SignalSegv},
+		{12, DebugStopReason::SignalUsr2},
+		{13, DebugStopReason::SignalPipe},
+		{14, DebugStopReason::SignalAlrm},
+		{15, DebugStopReason::SignalTerm},
+		{16, DebugStopReason::SignalStkflt},
+		{17, DebugStopReason::SignalChld},
+		{18, DebugStopReason::SignalCont},
+		{19, DebugStopReason::SignalStop},
+		{20, DebugStopReason::SignalTstp},
+		{21, DebugStopReason::SignalTtin},
+		{22, DebugStopReason::SignalTtou},
+		{23, DebugStopReason::SignalUrg},
+		{24, DebugStopReason::SignalXcpu},
+		{25, DebugStopReason::SignalXfsz},
+		{26, DebugStopReason::SignalVtalrm},
+		{27, DebugStopReason::SignalProf},
+		{28, DebugStopReason::SignalWinch},
+		{29, DebugStopReason::SignalIo},
+		{31, DebugStopReason::SignalSys},
+	};
+
+	auto it = signalLookup.find(signal);
+	if (it != signalLookup.end())
+		return it->second;
+
+	return DebugStopReason::UnknownReason;
+}
+
+
+ElfCoreAdapter::ElfCoreAdapter(BinaryView* data) : DebugAdapter(data) {}
+
+
+ElfCoreAdapter::~ElfCoreAdapter()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	Close();
+}
+
+
+bool ElfCoreAdapter::MapFile(const std::string& path, std::string& error)
+{
+#ifdef WIN32
+	HANDLE file = CreateFileA(
+		path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		error = fmt::format("Failed to open {}: error {}", path, GetLastError());
+		return false;
+	}
+	m_fileHandle = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || (size.QuadPart == 0))
+	{
+		error = fmt::format("{} is empty", path);
+		return false;
+	}
+
+	m_mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_mappingHandle)
+	{
+		error = fmt::format("Failed to map {}: error {}", path, GetLastError());
+		return false;
+	}
+
+	m_mapping = (const uint8_t*)MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (!m_mapping)
+	{
+		error = fmt::format("Failed to map {}: error {}", path, GetLastError());
+		return false;
+	}
+	m_mappingSize = size.QuadPart;
+#else
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		error = fmt::format("Failed to open {}: {}", path, strerror(errno));
+		return false;
+	}
+
+	struct stat info {};
+	if ((fstat(fd, &info) != 0) || (info.st_size == 0))
+	{
+		close(fd);
+		error = fmt::format("{} is empty", path);
+		return false;
+	}
+
+	// Nothing is read here. The kernel loads the pages of the core as they are accessed.
+	void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		error = fmt::format("Failed to map {}: {}", path, strerror(errno));
+		return false;
+	}
+	m_mapping = (const uint8_t*)mapping;
+	m_mappingSize = info.st_size;
+#endif
+	return true;
+}
+
+
+void ElfCoreAdapter::UnmapFile()
+{
+#ifdef WIN32
+	if (m_mapping)
+		UnmapViewOfFile(m_mapping);
+	if (m_mappingHandle)
+		CloseHandle(m_mappingHandle);
+	if (m_fileHandle)
+		CloseHandle(m_fileHandle);
+	m_mappingHandle = nullptr;
+	m_fileHandle = nullptr;
+#else
+	if (m_mapping)
+		munmap((void*)m_mapping, m_mappingSize);
+#endif
+	m_mapping = nullptr;
+	m_mappingSize = 0;
+}
+
+
+void ElfCoreAdapter::Close()
+{
+	UnmapFile();
+	m_segments.clear();
+	m_fileMappings.clear();
+	m_mappedFiles.clear();
+	m_threads.clear();
+	m_modules.clear();
+	m_activeThread = 0;
+	m_pid = 0;
+	m_processName.clear();
+}
+
+
+uint64_t ElfCoreAdapter::ReadField(const uint8_t* data, size_t size) const
+{
+	uint64_t value = 0;
+	for (size_t i = 0; i < size; i++)
+		value |= (uint64_t)data[m_bigEndian ? size - 1 - i : i] << (i * 8);
+	return value;
+}
+
+
+bool ElfCoreAdapter::ParseCore(std::string& error)
+{
+	if ((m_mappingSize < 0x34) || (memcmp(m_mapping, "\x7f" "ELF", 4) != 0))
+	{
+		error = "The file is not an ELF file";
+		return false;
+	}
+
+	m_is64Bit = (m_mapping[4] == 2);
+	m_bigEndian = (m_mapping[5] == 2);
+	if (m_is64Bit && (m_mappingSize < 0x40))
+	{
+		error = "The ELF header is truncated";
+		return false;
+	}
+
+	if (ReadField(m_mapping + 16, 2) != ElfTypeCore)
+	{
+		error = "The file is an ELF file, but not a core file";
+		return false;
+	}
+
+	uint16_t machine = ReadField(m_mapping + 18, 2);
+	auto layout = GetCoreLayout(machine);
+	if (!layout)
+	{
+		error = fmt::format("Core files of ELF machine {} are not supported", machine);
+		return false;
+	}
+	m_architecture = layout->architecture;
+
+	uint64_t phoff = m_is64Bit ? ReadField(m_mapping + 0x20, 8) : ReadField(m_mapping + 0x1c, 4);
+	size_t phentsize = ReadField(m_mapping + (m_is64Bit ? 0x36 : 0x2a), 2);
+	size_t phnum = ReadField(m_mapping + (m_is64Bit ? 0x38 : 0x2c), 2);
+	if ((phentsize < (m_is64Bit ? 0x38u : 0x20u)) || (phoff > m_mappingSize)
+		|| (phnum > (m_mappingSize - phoff) / phentsize))
+	{
+		error = "The program headers are truncated";
+		return false;
+	}
+
+	for (size_t i = 0; i < phnum; i++)
+	{
+		const uint8_t* header = m_mapping + phoff + i * phentsize;
+		uint32_t type = ReadField(header, 4);
+		Segment segment;
+		if (m_is64Bit)
+		{
+			segment.fileOffset = ReadField(header + 0x08, 8);
+			segment.address = ReadField(header + 0x10, 8);
+			segment.fileSize = ReadField(header + 0x20, 8);
+			segment.memorySize = ReadField(header + 0x28, 8);
+		}
+		else
+		{
+			segment.fileOffset = ReadField(header + 0x04, 4);
+			segment.address = ReadField(header + 0x08, 4);
+			segment.fileSize = ReadField(header + 0x10, 4);
+			segment.memorySize = ReadField(header + 0x14, 4);
+		}
+
+		// A core that was cut short, e.g., by a core size limit, still has the data up to where it ends
+		if (segment.fileOffset > m_mappingSize)
+			segment.fileSize = 0;
+		else
+			segment.fileSize = std::min(segment.fileSize, m_mappingSize - segment.fileOffset);
+
+		if (type == ProgramHeaderLoad)
+		{
+			if (segment.memorySize != 0)
+				m_segments.push_back(segment);
+		}
+		else if (type == ProgramHeaderNote)
+		{
+			// The notes are 4-byte aligned in cores of either class
+			const uint8_t* note = m_mapping + segment.fileOffset;
+			const uint8_t* end = note + segment.fileSize;
+			while (end - note >= 12)
+			{
+				uint32_t nameSize = ReadField(note, 4);
+				uint32_t descSize = ReadField(note + 4, 4);
+				uint32_t noteType = ReadField(note + 8, 4);
+				uint64_t descOffset = 12 + (((uint64_t)nameSize + 3) & ~3ull);
+				uint64_t next = descOffset + (((uint64_t)descSize + 3) & ~3ull);
+				if ((uint64_t)(end - note) < descOffset + descSize)
+					break;
+
+				if ((nameSize >= 4) && (memcmp(note + 12, "CORE", 4) == 0))
+					ParseNote(noteType, note + descOffset, descSize);
+
+				if ((uint64_t)(end - note) < next)
+					break;
+				note += next;
+			}
+		}
+	}
+
+	if (m_threads.empty())
+	{
+		error = "The core file has no threads";
+		return false;
+	}
+
+	std::sort(m_segments.begin(), m_segments.end(),
+		[](const Segment& a, const Segment& b) { return a.address < b.address; });
+	std::sort(m_fileMappings.begin(), m_fileMappings.end(),
+		[](const FileMapping& a, const FileMapping& b) { return a.start < b.start; });
+
+	// The kernel writes the thread that caused the dump first
+	m_activeThread = 0;
+	m_stopReason = GetStopReasonFromLinuxSignal(m_threads[0].signal);
+	return true;
+}
+
+
+void ElfCoreAdapter::ParseNote(uint32_t type, const uint8_t* desc, size_t size)
+{
+	auto layout = GetCoreLayout(m_architecture);
+	size_t wordSize = m_is64Bit ? 8 : 4;
+	if (type == NotePrStatus)
+	{
+		if (size < layout->registersOffset + layout->registerCount * wordSize)
+			return;
+
+		ThreadState thread;
+		thread.signal = ReadField(desc + 12, 2);
+		thread.tid = ReadField(desc + layout->pidOffset, 4);
+		for (size_t i = 0; i < layout->registerCount; i++)
+			thread.registers.push_back(ReadField(desc + layout->registersOffset + i * wordSize, wordSize));
+		m_threads.push_back(std::move(thread));
+		if (m_pid == 0)
+			m_pid = m_threads.back().tid;
+	}
+	else if (type == NotePrPsInfo)
+	{
+		// pr_fname, the name of the executable, truncated to 15 characters
+		size_t offset = m_is64Bit ? 40 : 28;
+		if (size < offset + 16)
+			return;
+		m_processName = std::string((const char*)desc + offset, strnlen((const char*)desc + offset, 16));
+	}
+	else if (type == NoteFile)
+	{
+		ParseFileNote(desc, size);
+	}
+}
+
+
+void ElfCoreAdapter::ParseFileNote(const uint8_t* desc, size_t size)
+{
+	// The count and the page size, then {start, end, file offset in pages} for each mapping, then their paths
+	size_t wordSize = m_is64Bit ? 8 : 4;
+	if (size < 2 * wordSize)
+		return;
+
+	uint64_t count = ReadField(desc, wordSize);
+	uint64_t pageSize = ReadField(desc + wordSize, wordSize);
+	if (count > (size - 2 * wordSize) / (3 * wordSize))
+		return;
+
+	const char* names = (const char*)desc + (2 + 3 * count) * wordSize;
+	const char* end = (const char*)desc + size;
+	// By path, in the order the modules appear in memory
+	std::vector<std::string> order;
+	std::unordered_map<std::string, std::pair<uint64_t, uint64_t>> ranges;
+	for (uint64_t i = 0; (i < count) && (names < end); i++)
+	{
+		const uint8_t* entry = desc + (2 + 3 * i) * wordSize;
+		uint64_t start = ReadField(entry, wordSize);
+		uint64_t stop = ReadField(entry + wordSize, wordSize);
+		uint64_t fileOffset = ReadField(entry + 2 * wordSize, wordSize) * pageSize;
+		std::string path(names, strnlen(names, end - names));
+		names += path.size() + 1;
+		if (stop > start)
+			m_fileMappings.push_back({start, stop, fileOffset, path});
+
+		auto it = ranges.find(path);
+		if (it == ranges.end())
+		{
+			order.push_back(path);
+			ranges[path] = {start, stop};
+		}
+		else
+		{
+			it->second.first = std::min(it->second.first, start);
+			it->second.second = std::max(it->second.second, stop);
+		}
+	}
+
+	for (const auto& path : order)
+	{
+		auto [start, stop] = ranges[path];
+		m_modules.emplace_back(path, DebugModule::GetPathBaseName(path), start, stop - start, true);
+	}
+}
+
+
+size_t ElfCoreAdapter::ReadCoreMemory(uint64_t address, uint8_t* buffer, size_t size) const
+{
+	size_t done = 0;
+	while (done < size)
+	{
+		uint64_t current = address + done;
+		// The last segment that starts at or below the address
+		auto it = std::upper_bound(m_segments.begin(), m_segments.end(), current,
+			[](uint64_t value, const Segment& segment) { return value < segment.address; });
+		if (it == m_segments.begin())
+			break;
+		--it;
+
+		uint64_t offset = current - it->address;
+		if (offset >= it->memorySize)
+			break;
+
+		if (offset < it->fileSize)
+		{
+			size_t count = std::min<uint64_t>(size - done, it->fileSize - offset);
+			memcpy(buffer + done, m_mapping + it->fileOffset + offset, count);
+			done += count;
+		}
+		else
+		{
+			size_t count = std::min<uint64_t>(size - done, it->memorySize - offset);
+			ReadOmittedMemory(current, buffer + done, count);
+			done += count;
+		}
+	}
+	return done;
+}
+
+
+void ElfCoreAdapter::ReadOmittedMemory(uint64_t address, uint8_t* buffer, size_t size) const
+{
+	memset(buffer, 0, size);
+
+	size_t done = 0;
+	while (done < size)
+	{
+		uint64_t current = address + done;
+		// The first mapping that ends above the address
+		auto it = std::upper_bound(m_fileMappings.begin(), m_fileMappings.end(), current,
+			[](uint64_t value, const FileMapping& mapping) { return value < mapping.end; });
+		if ((it == m_fileMappings.end()) || (current < it->start))
+		{
+			// Anonymous memory, which the core leaves out when it is all zeros
+			if (it == m_fileMappings.end())
+				break;
+			done += std::min<uint64_t>(size - done, it->start - current);
+			continue;
+		}
+
+		size_t count = std::min<uint64_t>(size - done, it->end - current);
+		auto file = m_mappedFiles.find(it->path);
+		if (file == m_mappedFiles.end())
+		{
+			auto stream = std::make_unique<std::ifstream>(it->path, std::ios::binary);
+			if (!stream->is_open())
+			{
+				LogWarn("%s is not available, the memory that maps it and is not in the core reads as zeros",
+					it->path.c_str());
+				stream = nullptr;
+			}
+			file = m_mappedFiles.emplace(it->path, std::move(stream)).first;
+		}
+
+		if (file->second)
+		{
+			// Past the end of the file, the mapping is zeros
+			std::ifstream& stream = *file->second;
+			stream.clear();
+			stream.seekg(it->fileOffset + (current - it->start));
+			stream.read((char*)buffer + done, count);
+		}
+		done += count;
+	}
+}
+
+
+std::optional<size_t> ElfCoreAdapter::FindRegister(const std::string& name) const
+{
+	auto layout = GetCoreLayout(m_architecture);
+	if (!layout)
+		return std::nullopt;
+
+	for (size_t i = 0; i < layout->registers.size(); i++)
+	{
+		if (layout->registers[i].name == name)
+			return i;
+	}
+	return std::nullopt;
+}
+
+
+std::optional<uint64_t> ElfCoreAdapter::GetRegisterValue(size_t thread, const std::string& name) const
+{
+	auto index = FindRegister(name);
+	if (!index.has_value() || (thread >= m_threads.size()))
+		return std::nullopt;
+
+	const CoreRegister& reg = GetCoreLayout(m_architecture)->registers[*index];
+	uint64_t value = m_threads[thread].registers[reg.index];
+	if (reg.width < 64)
+		value &= (1ull << reg.width) - 1;
+	return value;
+}
+
+
+bool ElfCoreAdapter::Execute(const std::string& path, const LaunchConfigurations& configs)
+{
+	return ExecuteWithArgs(path, "", "", configs);
+}
+
+
+bool ElfCoreAdapter::ExecuteWithArgs(const std::string& path, const std::string& args, const std::string& workingDir,
+	const LaunchConfigurations& configs)
+{
+	DebuggerEvent event;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		Close();
+
+		std::string error;
+		if (!MapFile(path, error) || !ParseCore(error))
+		{
+			Close();
+			lock.unlock();
+
+			event.type = LaunchFailureEventType;
+			event.data.errorData.shortError = "Failed to open the core file.";
+			event.data.errorData.error = fmt::format("Failed to open the core file {}: {}", path, error);
+			PostDebuggerEvent(event);
+			return false;
+		}
+
+		// The state of the process when it crashed is the only stop there is
+		event.type = AdapterStoppedEventType;
+		event.data.targetStoppedData.reason = m_stopReason;
+		event.data.targetStoppedData.lastActiveThread = m_threads[m_activeThread].tid;
+	}
+
+	PostDebuggerEvent(event);
+	return true;
+}
+
+
+bool ElfCoreAdapter::Attach(std::uint32_t pid)
+{
+	return false;
+}
+
+
+bool ElfCoreAdapter::Connect(const std::string& server, std::uint32_t port)
+{
+	return false;
+}
+
+
+bool ElfCoreAdapter::Detach()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		Close();
+	}
+
+	DebuggerEvent event;
+	event.type = DetachedEventType;
+	PostDebuggerEvent(event);
+	return true;
+}
+
+
+bool ElfCoreAdapter::Quit()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		Close();
+	}
+
+	DebuggerEvent event;
+	event.type = TargetExitedEventType;
+	event.data.exitData.exitCode = 0;
+	PostDebuggerEvent(event);
+	return true;
+}
+
+
+std::vector<DebugProcess> ElfCoreAdapter::GetProcessList()
+{
+	return {};
+}
+
+
+std::vector<DebugThread> ElfCoreAdapter::GetThreadList()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto layout = GetCoreLayout(m_architecture);
+	std::vector<DebugThread> result;
+	for (size_t i = 0; i < m_threads.size(); i++)
+		result.emplace_back(m_threads[i].tid, GetRegisterValue(i, layout->programCounter).value_or(0));
+	return result;
+}
+
+
+DebugThread ElfCoreAdapter::GetActiveThread() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_activeThread >= m_threads.size())
+		return DebugThread {};
+
+	auto layout = GetCoreLayout(m_architecture);
+	return DebugThread(
+		m_threads[m_activeThread].tid, GetRegisterValue(m_activeThread, layout->programCounter).value_or(0));
+}
+
+
+std::uint32_t ElfCoreAdapter::GetActiveThreadId() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_activeThread >= m_threads.size())
+		return 0;
+	return m_threads[m_activeThread].tid;
+}
+
+
+bool ElfCoreAdapter::SetActiveThread(const DebugThread& thread)
+{
+	return SetActiveThreadId(thread.m_tid);
+}
+
+
+bool ElfCoreAdapter::SetActiveThreadId(std::uint32_t tid)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (size_t i = 0; i < m_threads.size(); i++)
+	{
+		if (m_threads[i].tid == tid)
+		{
+			m_activeThread = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+bool ElfCoreAdapter::SuspendThread(std::uint32_t tid)
+{
+	return false;
+}
+
+
+bool ElfCoreAdapter::ResumeThread(std::uint32_t tid)
+{
+	return false;
+}
+
+
+std::vector<DebugFrame> ElfCoreAdapter::GetFramesOfThread(std::uint32_t tid)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	std::vector<DebugFrame> frames;
+	auto thread = std::find_if(
+		m_threads.begin(), m_threads.end(), [&](const ThreadState& state) { return state.tid == tid; });
+	if (thread == m_threads.end())
+		return frames;
+
+	auto moduleName = [&](uint64_t address) -> std::string {
+		for (const auto& module : m_modules)
+		{
+			if ((address >= module.m_address) && (address < module.m_address + module.m_size))
+				return module.m_short_name;
+		}
+		return "<unknown>";
+	};
+
+	size_t index = thread - m_threads.begin();
+	auto layout = GetCoreLayout(m_architecture);
+	uint64_t pc = GetRegisterValue(index, layout->programCounter).value_or(0);
+	uint64_t sp = GetRegisterValue(index, layout->stackPointer).value_or(0);
+	uint64_t fp = GetRegisterValue(index, layout->framePointer).value_or(0);
+	frames.emplace_back(0, pc, sp, fp, "", 0, moduleName(pc));
+
+	// Walk the chain of frame records, which hold the caller's frame pointer followed by the return address on all
+	// the supported architectures. Code built without frame pointers gives a partial stack.
+	size_t wordSize = m_is64Bit ? 8 : 4;
+	static constexpr size_t MaxFrames = 256;
+	while ((fp != 0) && (frames.size() < MaxFrames))
+	{
+		uint8_t record[16];
+		if (ReadCoreMemory(fp, record, 2 * wordSize) != 2 * wordSize)
+			break;
+
+		uint64_t callerFp = ReadField(record, wordSize);
+		uint64_t returnAddress = ReadField(record + wordSize, wordSize);
+		if (returnAddress == 0)
+			break;
+
+		frames.emplace_back(frames.size(), returnAddress, fp + 2 * wordSize, callerFp, "", 0, moduleName(returnAddress));
+		// The stack grows down, so anything else is not a frame record
+		if (callerFp <= fp)
+			break;
+		fp = callerFp;
+	}
+	return frames;
+}
+
+
+DebugBreakpoint ElfCoreAdapter::AddBreakpoint(const std::uintptr_t address, unsigned long breakpoint_type)
+{
+	// The target never runs again, so breakpoints are only remembered
+	std::unique_lock<std::mutex> lock(m_mutex);
+	DebugBreakpoint breakpoint(address, m_breakpoints.size() + 1, false);
+	if (std::find(m_breakpoints.begin(), m_breakpoints.end(), breakpoint) == m_breakpoints.end())
+		m_breakpoints.push_back(breakpoint);
+	return breakpoint;
+}
+
+
+DebugBreakpoint ElfCoreAdapter::AddBreakpoint(const ModuleNameAndOffset& address, unsigned long breakpoint_type)
+{
+	uint64_t resolved = 0;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (const auto& module : m_modules)
+		{
+			if (module.IsSameBaseModule(address.module))
+			{
+				resolved = module.m_address + address.offset;
+				break;
+			}
+		}
+	}
+
+	if (resolved == 0)
+		return DebugBreakpoint {};
+	return AddBreakpoint(resolved, breakpoint_type);
+}
+
+
+bool ElfCoreAdapter::RemoveBreakpoint(const DebugBreakpoint& breakpoint)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto it = std::find(m_breakpoints.begin(), m_breakpoints.end(), breakpoint);
+	if (it == m_breakpoints.end())
+		return false;
+
+	m_breakpoints.erase(it);
+	return true;
+}
+
+
+std::vector<DebugBreakpoint> ElfCoreAdapter::GetBreakpointList() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_breakpoints;
+}
+
+
+std::unordered_map<std::string, DebugRegister> ElfCoreAdapter::ReadAllRegisters()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	std::unordered_map<std::string, DebugRegister> result;
+	auto layout = GetCoreLayout(m_architecture);
+	if (!layout || (m_activeThread >= m_threads.size()))
+		return result;
+
+	for (size_t i = 0; i < layout->registers.size(); i++)
+	{
+		const CoreRegister& reg = layout->registers[i];
+		result[reg.name] =
+			DebugRegister(reg.name, GetRegisterValue(m_activeThread, reg.name).value_or(0), reg.width, i);
+	}
+	return result;
+}
+
+
+DebugRegister ElfCoreAdapter::ReadRegister(const std::string& reg)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto index = FindRegister(reg);
+	auto value = GetRegisterValue(m_activeThread, reg);
+	if (!index.has_value() || !value.has_value())
+		return DebugRegister {};
+
+	return DebugRegister(reg, *value, GetCoreLayout(m_architecture)->registers[*index].width, *index);
+}
+
+
+bool ElfCoreAdapter::WriteRegister(const std::string& reg, std::uintptr_t value)
+{
+	return false;
+}
+
+
+DataBuffer ElfCoreAdapter::ReadMemory(std::uintptr_t address, std::size_t size)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (!m_mapping || (size == 0))
+		return DataBuffer {};
+
+	// Most reads lie within one segment, and are copied straight out of the mapping
+	auto it = std::upper_bound(m_segments.begin(), m_segments.end(), (uint64_t)address,
+		[](uint64_t value, const Segment& segment) { return value < segment.address; });
+	if (it != m_segments.begin())
+	{
+		--it;
+		uint64_t offset = address - it->address;
+		if ((offset < it->fileSize) && (size <= it->fileSize - offset))
+			return DataBuffer(m_mapping + it->fileOffset + offset, size);
+	}
+
+	std::vector<uint8_t> buffer(size);
+	size_t bytesRead = ReadCoreMemory(address, buffer.data(), size);
+	return DataBuffer(buffer.data(), bytesRead);
+}
+
+
+bool ElfCoreAdapter::WriteMemory(std::uintptr_t address, const DataBuffer& buffer)
+{
+	return false;
+}
+
+
+std::vector<DebugModule> ElfCoreAdapter::GetModuleList()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_modules;
+}
+
+
+std::string ElfCoreAdapter::GetTargetArchitecture()
+{
+	if (!m_architecture.empty())
+		return m_architecture;
+	return m_defaultArchitecture;
+}
+
+
+DebugStopReason ElfCoreAdapter::StopReason()
+{
+	return m_stopReason;
+}
+
+
+uint64_t ElfCoreAdapter::ExitCode()
+{
+	return 0;
+}
+
+
+bool ElfCoreAdapter::BreakInto()
+{
+	return false;
+}
+
+
+bool ElfCoreAdapter::Go()
+{
+	return false;
+}
+
+
+bool ElfCoreAdapter::StepInto()
+{
+	return false;
+}
+
+
+bool ElfCoreAdapter::StepOver()
+{
+	return false;
+}
+
+
+std::string ElfCoreAdapter::InvokeBackendCommand(const std::string& command)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (!m_mapping)
+		return "error: no core file is open\n";
+
+	// There is no backend, so the only command describes the core
+	if (command != "info")
+		return "error: the only command is \"info\"\n";
+
+	std::string result = fmt::format("process {} ({}), {} threads, {} modules, {} memory regions\n", m_pid,
+		m_processName.empty() ? "<unknown>" : m_processName, m_threads.size(), m_modules.size(), m_segments.size());
+	for (const auto& segment : m_segments)
+	{
+		result += fmt::format("0x{:x}-0x{:x}{}\n", segment.address, segment.address + segment.memorySize,
+			(segment.fileSize < segment.memorySize) ? fmt::format(" (0x{:x} bytes in the core)", segment.fileSize) :
+													 "");
+	}
+	return result;
+}
+
+
+uint64_t ElfCoreAdapter::GetInstructionOffset()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto layout = GetCoreLayout(m_architecture);
+	if (!layout)
+		return 0;
+	return GetRegisterValue(m_activeThread, layout->programCounter).value_or(0);
+}
+
+
+uint64_t ElfCoreAdapter::GetStackPointer()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto layout = GetCoreLayout(m_architecture);
+	if (!layout)
+		return 0;
+	return GetRegisterValue(m_activeThread, layout->stackPointer).value_or(0);
+}
+
+
+bool ElfCoreAdapter::SupportFeature(DebugAdapterCapacity feature)
+{
+	switch (feature)
+	{
+	case DebugAdapterSupportThreads:
+	case DebugAdapterSupportModules:
+		return true;
+	default:
+		return false;
+	}
+}
+
+
+ElfCoreAdapterType::ElfCoreAdapterType() : DebugAdapterType("ELF_CORE_FILE") {}
+
+
+DebugAdapter* ElfCoreAdapterType::Create(BinaryNinja::BinaryView* data)
+{
+	// TODO: someone should free this.
+	return new ElfCoreAdapter(data);
+}
+
+
+bool ElfCoreAdapterType::IsValidForData(BinaryNinja::BinaryView* data)
+{
+	return data->GetTypeName() == "ELF" || data->GetTypeName() == "Raw" || data->GetTypeName() == "Mapped";
+}
+
+
+bool ElfCoreAdapterType::CanConnect(BinaryNinja::BinaryView* data)
+{
+	return false;
+}
+
+
+bool ElfCoreAdapterType::CanExecute(BinaryNinja::BinaryView* data)
+{
+	// The core file is opened in place of the executable
+	return true;
+}
+
+
+void BinaryNinjaDebugger::InitElfCoreAdapterType()
+{
+	static ElfCoreAdapterType localType;
+	DebugAdapterType::Register(&localType);
+}
@@ -0,0 +1,172 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "../debugadapter.h"
+#include "../debugadaptertype.h"
+
+namespace BinaryNinjaDebugger {
+	// Opens a Linux ELF core file for post-mortem analysis. The file is mapped rather than read, so opening a core
+	// only touches its headers and notes, and the pages of a memory region are only loaded once they are read.
+	//
+	// The threads and their registers come from the NT_PRSTATUS notes, the modules from the NT_FILE note, and the
+	// memory from the PT_LOAD segments. The parts of a segment the kernel leaves out of the core are read from the file
+	// it maps, when there is one, and are zeros otherwise. x86_64, x86 and aarch64 cores are supported.
+	class ElfCoreAdapter : public DebugAdapter
+	{
+	private:
+		struct Segment
+		{
+			uint64_t address = 0;
+			// The size in memory. Only the first `fileSize` bytes are in the core, the kernel leaves out the rest,
+			// e.g., unmodified file mappings.
+			uint64_t memorySize = 0;
+			uint64_t fileSize = 0;
+			uint64_t fileOffset = 0;
+		};
+
+		// A mapping of the NT_FILE note
+		struct FileMapping
+		{
+			uint64_t start = 0;
+			uint64_t end = 0;
+			// In bytes
+			uint64_t fileOffset = 0;
+			std::string path;
+		};
+
+		struct ThreadState
+		{
+			uint32_t tid = 0;
+			int signal = 0;
+			// Indexed like the register table of the architecture
+			std::vector<uint64_t> registers;
+		};
+
+		mutable std::mutex m_mutex;
+
+		const uint8_t* m_mapping = nullptr;
+		uint64_t m_mappingSize = 0;
+#ifdef WIN32
+		void* m_fileHandle = nullptr;
+		void* m_mappingHandle = nullptr;
+#endif
+
+		std::string m_architecture;
+		bool m_is64Bit = true;
+		bool m_bigEndian = false;
+		// Sorted by address
+		std::vector<Segment> m_segments;
+		// Sorted by address
+		std::vector<FileMapping> m_fileMappings;
+		// Path -> the mapped file, or nullptr if it cannot be opened. Opened on the first read from it.
+		mutable std::unordered_map<std::string, std::unique_ptr<std::ifstream>> m_mappedFiles;
+		std::vector<ThreadState> m_threads;
+		size_t m_activeThread = 0;
+		std::vector<DebugModule> m_modules;
+		uint32_t m_pid = 0;
+		std::string m_processName;
+		DebugStopReason m_stopReason = UnknownReason;
+		std::vector<DebugBreakpoint> m_breakpoints;
+
+		bool MapFile(const std::string& path, std::string& error);
+		void UnmapFile();
+		bool ParseCore(std::string& error);
+		void ParseNote(uint32_t type, const uint8_t* desc, size_t size);
+		void ParseFileNote(const uint8_t* desc, size_t size);
+
+		uint64_t ReadField(const uint8_t* data, size_t size) const;
+		// With m_mutex held
+		size_t ReadCoreMemory(uint64_t address, uint8_t* buffer, size_t size) const;
+		// With m_mutex held. Fills `buffer` with memory that is not in the core, from the mapped file if there is one.
+		// Whatever the file does not have is zeros.
+		void ReadOmittedMemory(uint64_t address, uint8_t* buffer, size_t size) const;
+		std::optional<size_t> FindRegister(const std::string& name) const;
+		std::optional<uint64_t> GetRegisterValue(size_t thread, const std::string& name) const;
+		void Close();
+
+	public:
+		ElfCoreAdapter(BinaryView* data);
+		~ElfCoreAdapter();
+
+		bool Execute(const std::string& path, const LaunchConfigurations& configs) override;
+		bool ExecuteWithArgs(const std::string& path, const std::string& args, const std::string& workingDir,
+			const LaunchConfigurations& configs) override;
+		bool Attach(std::uint32_t pid) override;
+		bool Connect(const std::string& server, std::uint32_t port) override;
+
+		bool Detach() override;
+		bool Quit() override;
+
+		std::vector<DebugProcess> GetProcessList() override;
+		std::vector<DebugThread> GetThreadList() override;
+		DebugThread GetActiveThread() const override;
+		std::uint32_t GetActiveThreadId() const override;
+		bool SetActiveThread(const DebugThread& thread) override;
+		bool SetActiveThreadId(std::uint32_t tid) override;
+		bool SuspendThread(std::uint32_t tid) override;
+		bool ResumeThread(std::uint32_t tid) override;
+		std::vector<DebugFrame> GetFramesOfThread(std::uint32_t tid) override;
+
+		DebugBreakpoint AddBreakpoint(const std::uintptr_t address, unsigned long breakpoint_type = 0) override;
+		DebugBreakpoint AddBreakpoint(const ModuleNameAndOffset& address, unsigned long breakpoint_type = 0) override;
+		bool RemoveBreakpoint(const DebugBreakpoint& breakpoint) override;
+		std::vector<DebugBreakpoint> GetBreakpointList() const override;
+
+		std::unordered_map<std::string, DebugRegister> ReadAllRegisters() override;
+		DebugRegister ReadRegister(const std::string& reg) override;
+		bool WriteRegister(const std::string& reg, std::uintptr_t value) override;
+
+		DataBuffer ReadMemory(std::uintptr_t address, std::size_t size) override;
+		bool WriteMemory(std::uintptr_t address, const DataBuffer& buffer) override;
+
+		std::vector<DebugModule> GetModuleList() override;
+		std::string GetTargetArchitecture() override;
+
+		DebugStopReason StopReason() override;
+		uint64_t ExitCode() override;
+
+		bool BreakInto() override;
+		bool Go() override;
+		bool StepInto() override;
+		bool StepOver() override;
+
+		std::string InvokeBackendCommand(const std::string& command) override;
+		uint64_t GetInstructionOffset() override;
+		uint64_t GetStackPointer() override;
+
+		bool SupportFeature(DebugAdapterCapacity feature) override;
+	};
+
+
+	class ElfCoreAdapterType : public DebugAdapterType
+	{
+	public:
+		ElfCoreAdapterType();
+		virtual DebugAdapter* Create(BinaryNinja::BinaryView* data);
+		virtual bool IsValidForData(BinaryNinja::BinaryView* data);
+		virtual bool CanExecute(BinaryNinja::BinaryView* data);
+		virtual bool CanConnect(BinaryNinja::BinaryView* data);
+	};
+
+
+	void InitElfCoreAdapterType();
+};  // namespace BinaryNinjaDebugger
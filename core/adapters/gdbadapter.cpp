@@ -0,0 +1,2409 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <functional>
+#include "gdbadapter.h"
+
+using namespace BinaryNinja;
+using namespace BinaryNinjaDebugger;
+
+
+// Signal numbers of the protocol. They are GDB's own, not the ones of the target.
+enum GdbSignal
+{
+	GdbSignal0 = 0,
+	GdbSignalHup = 1,
+	GdbSignalInt = 2,
+	GdbSignalQuit = 3,
+	GdbSignalIll = 4,
+	GdbSignalTrap = 5,
+	GdbSignalAbrt = 6,
+	GdbSignalEmt = 7,
+	GdbSignalFpe = 8,
+	GdbSignalKill = 9,
+	GdbSignalBus = 10,
+	GdbSignalSegv = 11,
+	GdbSignalSys = 12,
+	GdbSignalPipe = 13,
+	GdbSignalAlrm = 14,
+	GdbSignalTerm = 15,
+	GdbSignalUrg = 16,
+	GdbSignalStop = 17,
+	GdbSignalTstp = 18,
+	GdbSignalCont = 19,
+	GdbSignalChld = 20,
+	GdbSignalTtin = 21,
+	GdbSignalTtou = 22,
+	GdbSignalIo = 23,
+	GdbSignalXcpu = 24,
+	GdbSignalXfsz = 25,
+	GdbSignalVtalrm = 26,
+	GdbSignalProf = 27,
+	GdbSignalWinch = 28,
+	GdbSignalLost = 29,
+	GdbSignalUsr1 = 30,
+	GdbSignalUsr2 = 31,
+	// The real-time signals 33 to 63, then SIGCANCEL and real-time signal 32, which glibc uses internally
+	GdbSignalRealtimeFirst = 45,
+	GdbSignalRealtimeLast = 78,
+};
+
+
+static DebugStopReason GetStopReasonFromGdbSignal(int signal)
+{
+	static const std::unordered_map<int, DebugStopReason> signalLookup = {
+		{GdbSignalHup, DebugStopReason::SignalHup},
+		{GdbSignalInt, DebugStopReason::SignalInt},
+		{GdbSignalQuit, DebugStopReason::SignalQuit},
+		{GdbSignalIll, DebugStopReason::IllegalInstruction},
+		{GdbSignalTrap, DebugStopReason::SingleStep},
+		{GdbSignalAbrt, DebugStopReason::SignalAbrt},
+		{GdbSignalEmt, DebugStopReason::SignalEmt},
+		{GdbSignalFpe, DebugStopReason::SignalFpe},
+		{GdbSignalKill, DebugStopReason::SignalKill},
+		{GdbSignalBus, DebugStopReason::SignalBus},
+		{GdbSignalSegv, DebugStopReason::SignalSegv},
+		{GdbSignalSys, DebugStopReason::SignalSys},
+		{GdbSignalPipe, DebugStopReason::SignalPipe},
+		{GdbSignalAlrm, DebugStopReason::SignalAlrm},
+		{GdbSignalTerm, DebugStopReason::SignalTerm},
+		{GdbSignalUrg, DebugStopReason::SignalUrg},
+		{GdbSignalStop, DebugStopReason::SignalStop},
+		{GdbSignalTstp, DebugStopReason::SignalTstp},
+		{GdbSignalCont, DebugStopReason::SignalCont},
+		{GdbSignalChld, DebugStopReason::SignalChld},
+		{GdbSignalTtin, DebugStopReason::SignalTtin},
+		{GdbSignalTtou, DebugStopReason::SignalTtou},
+		{GdbSignalIo, DebugStopReason::SignalIo},
+		{GdbSignalXcpu, DebugStopReason::SignalXcpu},
+		{GdbSignalXfsz, DebugStopReason::SignalXfsz},
+		{GdbSignalVtalrm, DebugStopReason::SignalVtalrm},
+		{GdbSignalProf, DebugStopReason::SignalProf},
+		{GdbSignalWinch, DebugStopReason::SignalWinch},
+		{GdbSignalUsr1, DebugStopReason::SignalUsr1},
+		{GdbSignalUsr2, DebugStopReason::SignalUsr2},
+	};
+
+	auto it = signalLookup.find(signal);
+	if (it != signalLookup.end())
+		return it->second;
+
+	return DebugStopReason::UnknownReason;
+}
+
+
+// Signals that programs commonly use for their normal operation. They are passed to the target without a stop.
+static bool IsPassedSilently(int signal)
+{
+	switch (signal)
+	{
+	case GdbSignalAlrm:
+	case GdbSignalUrg:
+	case GdbSignalCont:
+	case GdbSignalChld:
+	case GdbSignalIo:
+	case GdbSignalVtalrm:
+	case GdbSignalProf:
+	case GdbSignalWinch:
+		return true;
+	default:
+		return (signal >= GdbSignalRealtimeFirst) && (signal <= GdbSignalRealtimeLast);
+	}
+}
+
+
+static uint64_t ParseHex(const std::string& text)
+{
+	return strtoull(text.c_str(), nullptr, 16);
+}
+
+
+static std::vector<std::string> Split(const std::string& text, char separator)
+{
+	std::vector<std::string> result;
+	size_t start = 0;
+	while (start <= text.size())
+	{
+		size_t end = text.find(separator, start);
+		if (end == std::string::npos)
+			end = text.size();
+		result.push_back(text.substr(start, end - start));
+		start = end + 1;
+	}
+	return result;
+}
+
+
+static std::string DecodeXmlEntities(const std::string& text)
+{
+	static const std::pair<const char*, char> entities[] = {
+		{"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'}, {"&apos;", '\''}};
+
+	std::string result;
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		bool replaced = false;
+		if (text[i] == '&')
+		{
+			for (const auto& [entity, c] : entities)
+			{
+				if (text.compare(i, strlen(entity), entity) == 0)
+				{
+					result += c;
+					i += strlen(entity) - 1;
+					replaced = true;
+					break;
+				}
+			}
+		}
+		if (!replaced)
+			result += text[i];
+	}
+	return result;
+}
+
+
+// Calls `callback` with the name, the attributes and the text of each element, in document order. The documents of
+// the protocol (target descriptions, library and thread lists) are simple enough for this.
+static void ForEachXmlElement(const std::string& xml,
+	const std::function<void(const std::string&, const std::map<std::string, std::string>&, const std::string&)>&
+		callback)
+{
+	size_t position = 0;
+	while ((position = xml.find('<', position)) != std::string::npos)
+	{
+		size_t end = xml.find('>', position);
+		if (end == std::string::npos)
+			return;
+
+		std::string tag = xml.substr(position + 1, end - position - 1);
+		position = end + 1;
+		// Closing tags, comments, declarations and processing instructions
+		if (tag.empty() || (tag[0] == '/') || (tag[0] == '!') || (tag[0] == '?'))
+			continue;
+
+		bool selfClosing = (tag.back() == '/');
+		if (selfClosing)
+			tag.pop_back();
+
+		size_t nameEnd = tag.find_first_of(" \t\r\n");
+		std::string name = tag.substr(0, nameEnd);
+		std::map<std::string, std::string> attributes;
+		size_t cursor = (nameEnd == std::string::npos) ? tag.size() : nameEnd;
+		while (cursor < tag.size())
+		{
+			size_t equal = tag.find('=', cursor);
+			if ((equal == std::string::npos) || (equal + 1 >= tag.size()))
+				break;
+
+			char quote = tag[equal + 1];
+			size_t valueEnd = tag.find(quote, equal + 2);
+			if (((quote != '"') && (quote != '\'')) || (valueEnd == std::string::npos))
+				break;
+
+			size_t keyStart = tag.find_first_not_of(" \t\r\n", cursor);
+			attributes[tag.substr(keyStart, equal - keyStart)] =
+				DecodeXmlEntities(tag.substr(equal + 2, valueEnd - equal - 2));
+			cursor = valueEnd + 1;
+		}
+
+		std::string text;
+		if (!selfClosing)
+		{
+			size_t textEnd = xml.find('<', position);
+			if (textEnd != std::string::npos)
+				text = DecodeXmlEntities(xml.substr(position, textEnd - position));
+		}
+		callback(name, attributes, text);
+	}
+}
+
+
+static std::string GetArchitectureFromGdbName(const std::string& name)
+{
+	static const std::unordered_map<std::string, std::string> architectures = {
+		{"i386:x86-64", "x86_64"},
+		{"i386:x64-32", "x86_64"},
+		{"i386", "x86"},
+		{"aarch64", "aarch64"},
+		{"arm", "armv7"},
+		{"mips", "mips32"},
+		{"mips:isa64", "mips64"},
+		{"powerpc:common", "ppc"},
+		{"powerpc:common64", "ppc64"},
+		{"riscv:rv32", "rv32gc"},
+		{"riscv:rv64", "rv64gc"},
+	};
+
+	auto it = architectures.find(name);
+	if (it != architectures.end())
+		return it->second;
+	return "";
+}
+
+
+GdbAdapter::GdbAdapter(BinaryView* data) : DebugAdapter(data)
+{
+	m_imageSize = data->GetEnd() - data->GetStart();
+}
+
+
+GdbAdapter::~GdbAdapter()
+{
+	{
+		std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+		m_connected = false;
+	}
+	m_runningCv.notify_all();
+	if (m_stopThread.joinable())
+	{
+		if (std::this_thread::get_id() == m_stopThread.get_id())
+			m_stopThread.detach();
+		else
+			m_stopThread.join();
+	}
+	// The stub decides what happens to the target when the connection goes away
+	m_rsp.Disconnect();
+}
+
+
+bool GdbAdapter::Execute(const std::string& path, const LaunchConfigurations& configs)
+{
+	return ExecuteWithArgs(path, "", "", configs);
+}
+
+
+bool GdbAdapter::ExecuteWithArgs(const std::string& path, const std::string& args, const std::string& workingDir,
+	const LaunchConfigurations& configs)
+{
+	DebuggerEvent event;
+	event.type = LaunchFailureEventType;
+	event.data.errorData.shortError = "The GDB RSP adapter cannot launch programs.";
+	event.data.errorData.error =
+		"The GDB RSP adapter cannot launch programs. Start the program under gdbserver or qemu, and connect to it.";
+	PostDebuggerEvent(event);
+	return false;
+}
+
+
+bool GdbAdapter::Attach(std::uint32_t pid)
+{
+	DebuggerEvent event;
+	event.type = LaunchFailureEventType;
+	event.data.errorData.shortError = "The GDB RSP adapter cannot attach to processes.";
+	event.data.errorData.error = fmt::format(
+		"The GDB RSP adapter cannot attach to processes. Run \"gdbserver --attach :<port> {}\", and connect to it.",
+		pid);
+	PostDebuggerEvent(event);
+	return false;
+}
+
+
+bool GdbAdapter::Connect(const std::string& server, std::uint32_t port)
+{
+	if (m_connected)
+	{
+		LogWarn("The GDB RSP adapter is already connected to a target");
+		return false;
+	}
+
+	// The stop thread of the last connection has returned once it was gone
+	if (m_stopThread.joinable())
+		m_stopThread.join();
+
+	std::vector<DebuggerEvent> events;
+	{
+		std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+		std::string error;
+		if (!m_rsp.Connect(server, port, error) || !NegotiateFeatures(error))
+		{
+			m_rsp.Disconnect();
+			lock.unlock();
+
+			DebuggerEvent event;
+			event.type = LaunchFailureEventType;
+			event.data.errorData.shortError = "Failed to connect to the GDB stub.";
+			event.data.errorData.error = error;
+			PostDebuggerEvent(event);
+			return false;
+		}
+
+		m_connected = true;
+		m_running = false;
+		m_exitCode = 0;
+		m_lastStopReason = UnknownReason;
+		m_pendingSignal = 0;
+		m_breakRequested = false;
+		m_detachRequested = false;
+		m_quitRequested = false;
+		m_instructionStepsLeft = 0;
+		m_stepOverAddress = 0;
+		m_suspendedThreads.clear();
+		m_mainModuleBase.reset();
+		m_lastModules.clear();
+		m_librarySizes.clear();
+		InvalidateCaches();
+		m_stopAtEntry = Settings::Instance()->Get<bool>("debugger.stopAtEntryPoint") && m_hasEntryFunction;
+		m_stopThread = std::thread([this]() { StopThreadLoop(); });
+
+		// The breakpoints added before the connection are inserted now
+		{
+			std::unique_lock<std::mutex> breakpointsLock(m_breakpointsMutex);
+			AddEntryBreakpoint();
+			SyncBreakpoints();
+		}
+
+		// The reason the target is stopped. The controller reports the first stop as the initial breakpoint.
+		auto reply = m_rsp.Transact("?");
+		if (!reply.has_value())
+			HandleTargetGone(0, events);
+		else
+			HandleStopReply(*reply, events);
+	}
+
+	PostEvents(events);
+	return true;
+}
+
+
+bool GdbAdapter::NegotiateFeatures(std::string& error)
+{
+	auto reply = m_rsp.Transact("qSupported:multiprocess+;swbreak+;hwbreak+;vContSupported+;xmlRegisters=i386");
+	if (!reply.has_value())
+	{
+		error = "The stub closed the connection";
+		return false;
+	}
+
+	std::set<std::string> features;
+	for (const auto& feature : Split(*reply, ';'))
+	{
+		if (feature.rfind("PacketSize=", 0) == 0)
+			m_packetSize = std::clamp<size_t>(ParseHex(feature.substr(11)), 0x100, 0x100000);
+		else if (!feature.empty() && (feature.back() == '+'))
+			features.insert(feature.substr(0, feature.size() - 1));
+	}
+
+	m_multiprocess = features.count("multiprocess") != 0;
+	m_swbreak = features.count("swbreak") != 0;
+	m_hasFeaturesXfer = features.count("qXfer:features:read") != 0;
+	m_hasLibrariesXfer = features.count("qXfer:libraries:read") != 0;
+	m_hasLibrariesSvr4Xfer = features.count("qXfer:libraries-svr4:read") != 0;
+	m_hasThreadsXfer = features.count("qXfer:threads:read") != 0;
+	m_hasAuxvXfer = features.count("qXfer:auxv:read") != 0;
+	m_hasExecFileXfer = features.count("qXfer:exec-file:read") != 0;
+	m_hasPassSignals = features.count("QPassSignals") != 0;
+	m_hasBinaryUpload = features.count("binary-upload") != 0;
+
+	// Acknowledgements cost nothing on TCP, but they prevent pipelining
+	m_rsp.SetAckMode(true);
+	if (features.count("QStartNoAckMode"))
+	{
+		reply = m_rsp.Transact("QStartNoAckMode");
+		if (reply.has_value() && (*reply == "OK"))
+			m_rsp.SetAckMode(false);
+	}
+
+	reply = m_rsp.Transact("vCont?");
+	m_hasVCont = reply.has_value() && (reply->find(";c") != std::string::npos) && (reply->find(";s") != std::string::npos);
+
+	LoadTargetDescription();
+	if (m_registers.empty() || !m_pcRegister.has_value())
+	{
+		error = fmt::format("The registers of the target are unknown. The stub does not describe them, and there is no "
+							"default layout for \"{}\".",
+			m_defaultArchitecture);
+		return false;
+	}
+
+	ProbeMemoryPackets();
+	SendPassSignals();
+
+	m_pid = 0;
+	m_activeThread = 0;
+	m_selectedThread.reset();
+	reply = m_rsp.Transact("qC");
+	if (reply.has_value() && (reply->rfind("QC", 0) == 0))
+		m_activeThread = ParseThreadId(reply->substr(2));
+
+	m_mainModulePath.clear();
+	if (m_hasExecFileXfer)
+	{
+		auto path = ReadXfer("exec-file", m_pid ? fmt::format("{:x}", m_pid) : "");
+		if (path.has_value())
+			m_mainModulePath = *path;
+	}
+	return true;
+}
+
+
+std::optional<std::string> GdbAdapter::ReadXfer(const std::string& object, const std::string& annex)
+{
+	std::string result;
+	size_t length = m_packetSize - 16;
+	while (true)
+	{
+		auto reply = m_rsp.Transact(fmt::format("qXfer:{}:read:{}:{:x},{:x}", object, annex, result.size(), length));
+		if (!reply.has_value() || reply->empty() || ((*reply)[0] == 'E'))
+			return std::nullopt;
+
+		result += reply->substr(1);
+		// 'm' means there is more, but an empty chunk would loop forever
+		if (((*reply)[0] != 'm') || (reply->size() == 1))
+			return result;
+	}
+}
+
+
+void GdbAdapter::LoadTargetDescription()
+{
+	m_registers.clear();
+	m_architecture.clear();
+
+	size_t nextNumber = 0;
+	if (!m_hasFeaturesXfer || !ParseTargetDescription("target.xml", nextNumber, 0) || m_registers.empty())
+	{
+		m_registers.clear();
+		UseDefaultRegisters();
+	}
+
+	std::string archName = GetTargetArchitecture();
+	Ref<Architecture> arch = Architecture::GetByName(archName);
+	if (arch)
+	{
+		m_bigEndian = (arch->GetEndianness() == BigEndian);
+		m_addressSize = arch->GetAddressSize();
+	}
+
+	// The g packet has the registers in the order of their numbers, with no padding
+	std::vector<size_t> order(m_registers.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(),
+		[this](size_t a, size_t b) { return m_registers[a].number < m_registers[b].number; });
+	size_t offset = 0;
+	for (size_t index : order)
+	{
+		m_registers[index].offset = offset;
+		offset += (m_registers[index].bitSize + 7) / 8;
+	}
+
+	// Use the register names of the other adapters where GDB differs
+	if (archName == "x86_64")
+	{
+		for (auto& reg : m_registers)
+		{
+			if (reg.name == "eflags")
+				reg.name = "rflags";
+		}
+	}
+
+	auto findFirst = [this](std::initializer_list<const char*> names) -> std::optional<size_t> {
+		for (const char* name : names)
+		{
+			auto index = FindRegister(name);
+			if (index.has_value())
+				return index;
+		}
+		return std::nullopt;
+	};
+
+	m_pcRegister = findFirst({"rip", "eip", "pc"});
+	m_spRegister = findFirst({"rsp", "esp", "sp"});
+	m_fpRegister = findFirst({"rbp", "ebp", "x29", "fp"});
+}
+
+
+bool GdbAdapter::ParseTargetDescription(const std::string& annex, size_t& nextNumber, int depth)
+{
+	auto xml = ReadXfer("features", annex);
+	if (!xml.has_value())
+		return false;
+
+	ForEachXmlElement(*xml, [&](const std::string& name, const std::map<std::string, std::string>& attributes,
+								const std::string& text) {
+		if (name == "architecture")
+		{
+			m_architecture = text;
+		}
+		else if ((name == "xi:include") && (depth < 4))
+		{
+			auto href = attributes.find("href");
+			if (href != attributes.end())
+				ParseTargetDescription(href->second, nextNumber, depth + 1);
+		}
+		else if (name == "reg")
+		{
+			auto regName = attributes.find("name");
+			auto bitSize = attributes.find("bitsize");
+			if ((regName == attributes.end()) || (bitSize == attributes.end()))
+				return;
+
+			RegisterInfo info;
+			info.name = regName->second;
+			info.bitSize = strtoul(bitSize->second.c_str(), nullptr, 10);
+			auto number = attributes.find("regnum");
+			info.number = (number != attributes.end()) ? strtoul(number->second.c_str(), nullptr, 10) : nextNumber;
+			nextNumber = info.number + 1;
+			m_registers.push_back(info);
+		}
+	});
+	return true;
+}
+
+
+void GdbAdapter::UseDefaultRegisters()
+{
+	// The layouts GDB assumes for stubs that do not send a target description
+	std::vector<std::pair<const char*, size_t>> layout;
+	if (m_defaultArchitecture == "x86_64")
+	{
+		for (const char* name : {"rax", "rbx", "rcx", "rdx", "rsi", "rdi", "rbp", "rsp", "r8", "r9", "r10", "r11",
+				 "r12", "r13", "r14", "r15", "rip"})
+			layout.emplace_back(name, 64);
+		for (const char* name : {"eflags", "cs", "ss", "ds", "es", "fs", "gs"})
+			layout.emplace_back(name, 32);
+	}
+	else if (m_defaultArchitecture == "x86")
+	{
+		for (const char* name : {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi", "eip", "eflags", "cs", "ss",
+				 "ds", "es", "fs", "gs"})
+			layout.emplace_back(name, 32);
+	}
+	else if (m_defaultArchitecture == "aarch64")
+	{
+		static const char* names[] = {"x0", "x1", "x2", "x3", "x4", "x5", "x6", "x7", "x8", "x9", "x10", "x11",
+			"x12", "x13", "x14", "x15", "x16", "x17", "x18", "x19", "x20", "x21", "x22", "x23", "x24", "x25", "x26",
+			"x27", "x28", "x29", "x30", "sp", "pc"};
+		for (const char* name : names)
+			layout.emplace_back(name, 64);
+		layout.emplace_back("cpsr", 32);
+	}
+
+	for (size_t i = 0; i < layout.size(); i++)
+	{
+		RegisterInfo info;
+		info.name = layout[i].first;
+		info.bitSize = layout[i].second;
+		info.number = i;
+		m_registers.push_back(info);
+	}
+}
+
+
+void GdbAdapter::ProbeMemoryPackets()
+{
+	// Binary transfers halve the size of the data, compared to hex
+	if (m_hasBinaryUpload)
+	{
+		m_readMode = BinaryPrefixedRead;
+	}
+	else
+	{
+		// lldb-server answers an empty x packet with OK, and stubs that do not know it with an empty reply
+		auto reply = m_rsp.Transact("x0,0");
+		m_readMode = (reply.has_value() && (*reply == "OK")) ? BinaryRawRead : HexRead;
+	}
+
+	auto reply = m_rsp.Transact("X0,0:");
+	m_binaryWrite = reply.has_value() && (*reply == "OK");
+}
+
+
+void GdbAdapter::SendPassSignals()
+{
+	if (!m_hasPassSignals)
+		return;
+
+	// The stub delivers these right away, without stopping the target and waking us up
+	std::string packet = "QPassSignals:";
+	bool first = true;
+	for (int signal = 1; signal <= GdbSignalRealtimeLast; signal++)
+	{
+		if (!IsPassedSilently(signal))
+			continue;
+		if (!first)
+			packet += ';';
+		packet += fmt::format("{:02x}", signal);
+		first = false;
+	}
+	m_rsp.Transact(packet);
+}
+
+
+std::string GdbAdapter::FormatThreadId(uint32_t tid) const
+{
+	if (m_multiprocess && (m_pid != 0))
+		return fmt::format("p{:x}.{:x}", m_pid, tid);
+	return fmt::format("{:x}", tid);
+}
+
+
+uint32_t GdbAdapter::ParseThreadId(const std::string& text)
+{
+	// Either "<tid>", or "p<pid>.<tid>" with the multiprocess extension
+	if (!text.empty() && (text[0] == 'p'))
+	{
+		size_t dot = text.find('.');
+		uint32_t pid = (uint32_t)ParseHex(text.substr(1, dot == std::string::npos ? std::string::npos : dot - 1));
+		if (m_pid == 0)
+			m_pid = pid;
+		if (dot == std::string::npos)
+			return pid;
+		return (uint32_t)ParseHex(text.substr(dot + 1));
+	}
+	return (uint32_t)ParseHex(text);
+}
+
+
+bool GdbAdapter::SelectThread(uint32_t tid)
+{
+	if (m_selectedThread.has_value() && (*m_selectedThread == tid))
+		return true;
+
+	auto reply = m_rsp.Transact("Hg" + FormatThreadId(tid));
+	if (!reply.has_value())
+		return false;
+
+	if (*reply == "OK")
+	{
+		m_selectedThread = tid;
+		return true;
+	}
+	// Single-threaded stubs may not know the packet at all
+	return reply->empty();
+}
+
+
+std::optional<size_t> GdbAdapter::FindRegister(const std::string& name) const
+{
+	for (size_t i = 0; i < m_registers.size(); i++)
+	{
+		if (m_registers[i].name == name)
+			return i;
+	}
+	return std::nullopt;
+}
+
+
+uint64_t GdbAdapter::DecodeRegister(const std::vector<uint8_t>& bytes) const
+{
+	uint64_t value = 0;
+	size_t count = std::min<size_t>(bytes.size(), 8);
+	if (m_bigEndian)
+	{
+		for (size_t i = bytes.size() - count; i < bytes.size(); i++)
+			value = (value << 8) | bytes[i];
+	}
+	else
+	{
+		for (size_t i = 0; i < count; i++)
+			value |= (uint64_t)bytes[i] << (i * 8);
+	}
+	return value;
+}
+
+
+bool GdbAdapter::FetchRegisters(uint32_t tid, bool all)
+{
+	if (!SelectThread(tid))
+		return false;
+
+	auto& cache = m_registerCache[tid];
+	auto reply = m_rsp.Transact("g");
+	std::vector<uint8_t> bytes;
+	if (reply.has_value() && !reply->empty() && !RspConnection::IsErrorReply(*reply)
+		&& RspConnection::FromHex(*reply, bytes))
+	{
+		for (const auto& reg : m_registers)
+		{
+			size_t size = (reg.bitSize + 7) / 8;
+			if (reg.offset.has_value() && (*reg.offset + size <= bytes.size()))
+				cache[reg.number].assign(bytes.begin() + *reg.offset, bytes.begin() + *reg.offset + size);
+		}
+	}
+
+	if (!all)
+		return true;
+
+	// The registers that are not in the g packet, in one batch
+	std::vector<std::string> requests;
+	std::vector<size_t> numbers;
+	for (const auto& reg : m_registers)
+	{
+		if ((reg.bitSize <= 64) && (cache.find(reg.number) == cache.end()))
+		{
+			requests.push_back(fmt::format("p{:x}", reg.number));
+			numbers.push_back(reg.number);
+		}
+	}
+
+	auto replies = m_rsp.TransactPipelined(requests);
+	for (size_t i = 0; i < replies.size(); i++)
+	{
+		if (replies[i].has_value() && !replies[i]->empty() && !RspConnection::IsErrorReply(*replies[i])
+			&& RspConnection::FromHex(*replies[i], bytes))
+			cache[numbers[i]] = bytes;
+	}
+	return true;
+}
+
+
+std::optional<uint64_t> GdbAdapter::GetRegisterValue(uint32_t tid, size_t index)
+{
+	size_t number = m_registers[index].number;
+	auto& cache = m_registerCache[tid];
+	auto it = cache.find(number);
+	if (it == cache.end())
+	{
+		FetchRegisters(tid, false);
+		it = cache.find(number);
+	}
+
+	if ((it == cache.end()) && SelectThread(tid))
+	{
+		auto reply = m_rsp.Transact(fmt::format("p{:x}", number));
+		std::vector<uint8_t> bytes;
+		if (reply.has_value() && !reply->empty() && !RspConnection::IsErrorReply(*reply)
+			&& RspConnection::FromHex(*reply, bytes))
+			cache[number] = bytes;
+		it = cache.find(number);
+	}
+
+	if (it == cache.end())
+		return std::nullopt;
+	return DecodeRegister(it->second);
+}
+
+
+bool GdbAdapter::SetRegisterValue(uint32_t tid, size_t index, uint64_t value)
+{
+	const RegisterInfo& reg = m_registers[index];
+	size_t size = (reg.bitSize + 7) / 8;
+	std::vector<uint8_t> bytes(size);
+	for (size_t i = 0; (i < size) && (i < 8); i++)
+	{
+		uint8_t byte = (uint8_t)(value >> (i * 8));
+		bytes[m_bigEndian ? size - 1 - i : i] = byte;
+	}
+
+	if (!SelectThread(tid))
+		return false;
+
+	auto& cache = m_registerCache[tid];
+	if (m_registerWrite)
+	{
+		auto reply = m_rsp.Transact(fmt::format("P{:x}={}", reg.number, RspConnection::ToHex(bytes.data(), size)));
+		if (!reply.has_value())
+			return false;
+		if (*reply == "OK")
+		{
+			cache[reg.number] = bytes;
+			return true;
+		}
+		if (!reply->empty())
+			return false;
+
+		// The stub does not know the P packet, so all the registers are written at once from now on
+		m_registerWrite = false;
+	}
+
+	if (!reg.offset.has_value() || !FetchRegisters(tid, false))
+		return false;
+
+	cache[reg.number] = bytes;
+	std::vector<uint8_t> image;
+	for (const auto& other : m_registers)
+	{
+		auto it = cache.find(other.number);
+		if (!other.offset.has_value() || (it == cache.end()))
+			continue;
+
+		if (image.size() < *other.offset + it->second.size())
+			image.resize(*other.offset + it->second.size());
+		std::copy(it->second.begin(), it->second.end(), image.begin() + *other.offset);
+	}
+
+	auto reply = m_rsp.Transact("G" + RspConnection::ToHex(image.data(), image.size()));
+	if (reply.has_value() && (*reply == "OK"))
+		return true;
+
+	cache.erase(reg.number);
+	return false;
+}
+
+
+size_t GdbAdapter::ReadRemoteMemory(uint64_t address, uint8_t* buffer, size_t size)
+{
+	// As much as the stub can send back in one packet. A binary reply can still be cut short by escaping, in which
+	// case the rest is read right after.
+	size_t chunkSize = (m_readMode == HexRead) ? (m_packetSize - 16) / 2 : m_packetSize - 16;
+	auto request = [&](uint64_t start, size_t length) {
+		return fmt::format("{}{:x},{:x}", (m_readMode == HexRead) ? 'm' : 'x', start, length);
+	};
+	// Returns the number of bytes decoded into `out`, or nothing on error
+	auto decode = [&](const std::string& reply, size_t length, uint8_t* out) -> std::optional<size_t> {
+		if (reply.empty())
+			return std::nullopt;
+
+		if (m_readMode == HexRead)
+		{
+			std::vector<uint8_t> bytes;
+			if (RspConnection::IsErrorReply(reply) || !RspConnection::FromHex(reply, bytes))
+				return std::nullopt;
+			size_t count = std::min(bytes.size(), length);
+			memcpy(out, bytes.data(), count);
+			return count;
+		}
+
+		size_t skip = 0;
+		if (m_readMode == BinaryPrefixedRead)
+		{
+			if (reply[0] != 'b')
+				return std::nullopt;
+			skip = 1;
+		}
+		else if (RspConnection::IsErrorReply(reply) && (length != 3))
+		{
+			return std::nullopt;
+		}
+		size_t count = std::min(reply.size() - skip, length);
+		memcpy(out, reply.data() + skip, count);
+		return count;
+	};
+
+	std::vector<std::string> requests;
+	for (size_t offset = 0; offset < size; offset += chunkSize)
+		requests.push_back(request(address + offset, std::min(chunkSize, size - offset)));
+
+	auto replies = m_rsp.TransactPipelined(requests);
+	size_t done = 0;
+	for (size_t i = 0; i < replies.size(); i++)
+	{
+		size_t offset = i * chunkSize;
+		size_t length = std::min(chunkSize, size - offset);
+		if (!replies[i].has_value())
+			return done;
+
+		auto count = decode(*replies[i], length, buffer + offset);
+		if (!count.has_value() || (*count == 0))
+			return done;
+
+		// The rest of a short chunk, one request at a time
+		size_t got = *count;
+		while (got < length)
+		{
+			auto reply = m_rsp.Transact(request(address + offset + got, length - got));
+			if (!reply.has_value())
+				return offset + got;
+			count = decode(*reply, length - got, buffer + offset + got);
+			if (!count.has_value() || (*count == 0))
+				return offset + got;
+			got += *count;
+		}
+		done = offset + length;
+	}
+	return done;
+}
+
+
+bool GdbAdapter::WriteRemoteMemory(uint64_t address, const uint8_t* buffer, size_t size)
+{
+	// Leave room for the command and the address
+	size_t maxPayload = m_packetSize - 64;
+	std::vector<std::string> requests;
+	size_t done = 0;
+	while (done < size)
+	{
+		if (m_binaryWrite)
+		{
+			std::string payload;
+			size_t count = 0;
+			while (done + count < size)
+			{
+				std::string escaped = RspConnection::EscapeBinary(buffer + done + count, 1);
+				if (payload.size() + escaped.size() > maxPayload)
+					break;
+				payload += escaped;
+				count++;
+			}
+			requests.push_back(fmt::format("X{:x},{:x}:", address + done, count) + payload);
+			done += count;
+		}
+		else
+		{
+			size_t count = std::min(size - done, maxPayload / 2);
+			requests.push_back(
+				fmt::format("M{:x},{:x}:{}", address + done, count, RspConnection::ToHex(buffer + done, count)));
+			done += count;
+		}
+	}
+
+	for (const auto& reply : m_rsp.TransactPipelined(requests))
+	{
+		if (!reply.has_value() || (*reply != "OK"))
+			return false;
+	}
+	return true;
+}
+
+
+std::optional<uint64_t> GdbAdapter::ReadPointer(uint64_t address)
+{
+	std::vector<uint8_t> bytes(m_addressSize);
+	if (ReadRemoteMemory(address, bytes.data(), bytes.size()) != bytes.size())
+		return std::nullopt;
+	return DecodeRegister(bytes);
+}
+
+
+std::vector<uint32_t> GdbAdapter::FetchThreads()
+{
+	if (m_threadCache.has_value())
+		return *m_threadCache;
+
+	std::vector<uint32_t> threads;
+	std::optional<std::string> xml;
+	if (m_hasThreadsXfer)
+		xml = ReadXfer("threads", "");
+
+	if (xml.has_value())
+	{
+		ForEachXmlElement(*xml, [&](const std::string& name, const std::map<std::string, std::string>& attributes,
+									const std::string&) {
+			auto id = attributes.find("id");
+			if ((name == "thread") && (id != attributes.end()))
+				threads.push_back(ParseThreadId(id->second));
+		});
+	}
+	else
+	{
+		auto reply = m_rsp.Transact("qfThreadInfo");
+		while (reply.has_value() && !reply->empty() && ((*reply)[0] == 'm'))
+		{
+			for (const auto& id : Split(reply->substr(1), ','))
+			{
+				if (!id.empty())
+					threads.push_back(ParseThreadId(id));
+			}
+			reply = m_rsp.Transact("qsThreadInfo");
+		}
+	}
+
+	// Stubs without any way to list the threads have only one
+	if (threads.empty())
+		threads.push_back(m_activeThread);
+
+	m_threadCache = threads;
+	return threads;
+}
+
+
+uint64_t GdbAdapter::GetLibrarySize(const std::string& path, uint64_t base)
+{
+	auto key = std::make_pair(path, base);
+	auto it = m_librarySizes.find(key);
+	if (it != m_librarySizes.end())
+		return it->second;
+
+	// The span of the loadable segments, from the program headers in the mapped ELF header
+	uint64_t size = 0;
+	uint8_t header[64] {};
+	if ((ReadRemoteMemory(base, header, sizeof(header)) == sizeof(header)) && (memcmp(header, "\x7f" "ELF", 4) == 0))
+	{
+		bool is64 = (header[4] == 2);
+		bool bigEndian = (header[5] == 2);
+		auto read = [&](const uint8_t* data, size_t count) {
+			uint64_t value = 0;
+			for (size_t i = 0; i < count; i++)
+				value |= (uint64_t)data[bigEndian ? count - 1 - i : i] << (i * 8);
+			return value;
+		};
+
+		uint64_t phoff = is64 ? read(header + 0x20, 8) : read(header + 0x1c, 4);
+		size_t phentsize = read(header + (is64 ? 0x36 : 0x2a), 2);
+		size_t phnum = read(header + (is64 ? 0x38 : 0x2c), 2);
+		if ((phentsize >= (is64 ? 0x38u : 0x20u)) && (phnum > 0) && (phnum < 0x100))
+		{
+			std::vector<uint8_t> headers(phentsize * phnum);
+			if (ReadRemoteMemory(base + phoff, headers.data(), headers.size()) == headers.size())
+			{
+				uint64_t start = UINT64_MAX, end = 0;
+				for (size_t i = 0; i < phnum; i++)
+				{
+					const uint8_t* entry = headers.data() + i * phentsize;
+					// PT_LOAD
+					if (read(entry, 4) != 1)
+						continue;
+
+					uint64_t vaddr = is64 ? read(entry + 0x10, 8) : read(entry + 0x08, 4);
+					uint64_t memsz = is64 ? read(entry + 0x28, 8) : read(entry + 0x14, 4);
+					start = std::min(start, vaddr);
+					end = std::max(end, vaddr + memsz);
+				}
+				if (end > start)
+					size = end - start;
+			}
+		}
+	}
+
+	m_librarySizes[key] = size;
+	return size;
+}
+
+
+std::optional<uint64_t> GdbAdapter::GetMainModuleBase()
+{
+	if (m_mainModuleBase.has_value())
+		return m_mainModuleBase;
+
+	// The runtime entry point, from the auxiliary vector, tells where the program was loaded
+	if (m_hasAuxvXfer && (m_entryPoint != 0))
+	{
+		auto auxv = ReadXfer("auxv", "");
+		if (auxv.has_value())
+		{
+			for (size_t offset = 0; offset + 2 * m_addressSize <= auxv->size(); offset += 2 * m_addressSize)
+			{
+				std::vector<uint8_t> key(auxv->begin() + offset, auxv->begin() + offset + m_addressSize);
+				std::vector<uint8_t> value(
+					auxv->begin() + offset + m_addressSize, auxv->begin() + offset + 2 * m_addressSize);
+				// AT_ENTRY
+				if (DecodeRegister(key) == 9)
+				{
+					m_mainModuleBase = DecodeRegister(value) - (m_entryPoint - m_start);
+					return m_mainModuleBase;
+				}
+			}
+		}
+	}
+
+	// Bare-metal and embedded stubs may report a relocation instead
+	auto reply = m_rsp.Transact("qOffsets");
+	if (reply.has_value() && !reply->empty())
+	{
+		for (const auto& field : Split(*reply, ';'))
+		{
+			if (field.rfind("Text=", 0) == 0)
+				m_mainModuleBase = m_start + ParseHex(field.substr(5));
+			else if (field.rfind("TextSeg=", 0) == 0)
+				m_mainModuleBase = ParseHex(field.substr(8));
+		}
+		if (m_mainModuleBase.has_value())
+			return m_mainModuleBase;
+	}
+
+	m_mainModuleBase = m_start;
+	return m_mainModuleBase;
+}
+
+
+std::vector<DebugModule> GdbAdapter::FetchModules()
+{
+	if (m_moduleCache.has_value())
+		return *m_moduleCache;
+
+	std::vector<DebugModule> modules;
+	std::string mainPath = m_mainModulePath.empty() ? m_originalFileName : m_mainModulePath;
+	auto base = GetMainModuleBase();
+	if (base.has_value())
+		modules.emplace_back(mainPath, DebugModule::GetPathBaseName(mainPath), *base, m_imageSize, true);
+
+	if (m_hasLibrariesSvr4Xfer)
+	{
+		auto xml = ReadXfer("libraries-svr4", "");
+		if (xml.has_value())
+		{
+			std::vector<std::pair<std::string, uint64_t>> libraries;
+			ForEachXmlElement(*xml, [&](const std::string& name, const std::map<std::string, std::string>& attributes,
+										const std::string&) {
+				auto path = attributes.find("name");
+				auto address = attributes.find("l_addr");
+				// The main program has no name in the list
+				if ((name == "library") && (path != attributes.end()) && !path->second.empty()
+					&& (address != attributes.end()))
+					libraries.emplace_back(path->second, ParseHex(address->second));
+			});
+
+			for (const auto& [path, address] : libraries)
+				modules.emplace_back(
+					path, DebugModule::GetPathBaseName(path), address, GetLibrarySize(path, address), true);
+		}
+	}
+	else if (m_hasLibrariesXfer)
+	{
+		auto xml = ReadXfer("libraries", "");
+		if (xml.has_value())
+		{
+			// <library name="..."><segment address="..."/></library>
+			std::string current;
+			ForEachXmlElement(*xml, [&](const std::string& name, const std::map<std::string, std::string>& attributes,
+										const std::string&) {
+				if (name == "library")
+				{
+					auto path = attributes.find("name");
+					current = (path != attributes.end()) ? path->second : "";
+					return;
+				}
+
+				auto address = attributes.find("address");
+				if (((name != "segment") && (name != "section")) || current.empty() || (address == attributes.end()))
+					return;
+
+				if (!DebugModule::IsSameBaseModule(current, mainPath))
+					modules.emplace_back(current, DebugModule::GetPathBaseName(current), ParseHex(address->second), 0,
+						true);
+				current.clear();
+			});
+		}
+	}
+
+	bool changed = (modules.size() != m_lastModules.size());
+	for (size_t i = 0; !changed && (i < modules.size()); i++)
+		changed = (modules[i].m_name != m_lastModules[i].m_name) || (modules[i].m_address != m_lastModules[i].m_address);
+	if (changed)
+	{
+		m_lastModules = modules;
+		InvalidateBreakpointConditionAddresses();
+	}
+
+	m_moduleCache = modules;
+	return modules;
+}
+
+
+size_t GdbAdapter::GetBreakpointKind() const
+{
+	// The kind of a software breakpoint is the size of the instruction the stub writes
+	std::string arch = const_cast<GdbAdapter*>(this)->GetTargetArchitecture();
+	if (arch.rfind("x86", 0) == 0)
+		return 1;
+	if (arch.find("thumb") != std::string::npos)
+		return 2;
+	return 4;
+}
+
+
+GdbAdapter::Breakpoint& GdbAdapter::GetOrCreateBreakpoint(uint64_t address)
+{
+	Breakpoint& breakpoint = m_breakpoints[address];
+	if (breakpoint.id == 0)
+		breakpoint.id = m_nextBreakpointId++;
+	return breakpoint;
+}
+
+
+void GdbAdapter::AddEntryBreakpoint()
+{
+	if (!m_hasEntryFunction || (m_entryPoint == 0))
+		return;
+
+	// Shared libraries are loaded once the program reaches its entry point, so pending breakpoints in them are
+	// resolved there
+	auto base = GetMainModuleBase();
+	if (!base.has_value())
+		return;
+
+	GetOrCreateBreakpoint(*base + m_entryPoint - m_start).entry = true;
+}
+
+
+void GdbAdapter::SyncBreakpoints()
+{
+	if (!m_connected || m_running)
+		return;
+
+	bool unresolved = false;
+	for (const auto& [location, address] : m_relativeBreakpoints)
+	{
+		if (address == 0)
+			unresolved = true;
+	}
+
+	if (unresolved)
+	{
+		auto modules = FetchModules();
+		for (auto& [location, address] : m_relativeBreakpoints)
+		{
+			if (address != 0)
+				continue;
+
+			for (const auto& module : modules)
+			{
+				if (module.IsSameBaseModule(location.module))
+				{
+					address = module.m_address + location.offset;
+					GetOrCreateBreakpoint(address).relative = true;
+					break;
+				}
+			}
+		}
+	}
+
+	// Every change in one batch
+	std::vector<std::string> requests;
+	std::vector<uint64_t> addresses;
+	size_t kind = GetBreakpointKind();
+	for (const auto& [address, breakpoint] : m_breakpoints)
+	{
+		if (breakpoint.IsWanted() == breakpoint.inserted)
+			continue;
+
+		requests.push_back(fmt::format("{}0,{:x},{:x}", breakpoint.inserted ? 'z' : 'Z', address, kind));
+		addresses.push_back(address);
+	}
+
+	auto replies = m_rsp.TransactPipelined(requests);
+	for (size_t i = 0; i < replies.size(); i++)
+	{
+		Breakpoint& breakpoint = m_breakpoints[addresses[i]];
+		if (replies[i].has_value() && (*replies[i] == "OK"))
+			breakpoint.inserted = !breakpoint.inserted;
+		else if (!breakpoint.inserted)
+			LogWarn("Failed to insert the breakpoint at 0x%" PRIx64, addresses[i]);
+	}
+
+	for (auto it = m_breakpoints.begin(); it != m_breakpoints.end();)
+	{
+		if (!it->second.IsWanted() && !it->second.inserted)
+			it = m_breakpoints.erase(it);
+		else
+			it++;
+	}
+}
+
+
+bool GdbAdapter::SendHardwareBreakpoint(const DebugHardwareBreakpoint& breakpoint, bool insert)
+{
+	int type = 1;
+	size_t kind = GetBreakpointKind();
+	switch (breakpoint.m_type)
+	{
+	case HardwareWriteWatchpoint:
+		type = 2;
+		kind = breakpoint.m_size;
+		break;
+	case HardwareReadWatchpoint:
+		type = 3;
+		kind = breakpoint.m_size;
+		break;
+	case HardwareAccessWatchpoint:
+		type = 4;
+		kind = breakpoint.m_size;
+		break;
+	default:
+		break;
+	}
+
+	auto reply =
+		m_rsp.Transact(fmt::format("{}{},{:x},{:x}", insert ? 'Z' : 'z', type, breakpoint.m_address, kind));
+	return reply.has_value() && (*reply == "OK");
+}
+
+
+void GdbAdapter::InvalidateCaches()
+{
+	m_registerCache.clear();
+	m_threadCache.reset();
+	m_moduleCache.reset();
+	// The stub selects the thread that stops
+	m_selectedThread.reset();
+}
+
+
+bool GdbAdapter::Resume(bool step, bool report)
+{
+	uint32_t tid = m_activeThread;
+	std::string packet;
+	bool signalDelivered = false;
+	if (m_hasVCont)
+	{
+		if (step)
+		{
+			signalDelivered = (m_pendingSignal != 0) && (m_signalThread == tid);
+			packet = signalDelivered ? fmt::format("vCont;S{:02x}:{}", m_pendingSignal, FormatThreadId(tid)) :
+									   "vCont;s:" + FormatThreadId(tid);
+		}
+		else
+		{
+			packet = "vCont";
+			if ((m_pendingSignal != 0) && (m_suspendedThreads.count(m_signalThread) == 0))
+			{
+				packet += fmt::format(";C{:02x}:{}", m_pendingSignal, FormatThreadId(m_signalThread));
+				signalDelivered = true;
+			}
+
+			if (m_suspendedThreads.empty())
+			{
+				packet += ";c";
+			}
+			else
+			{
+				for (uint32_t thread : FetchThreads())
+				{
+					if ((m_suspendedThreads.count(thread) == 0) && !(signalDelivered && (thread == m_signalThread)))
+						packet += ";c:" + FormatThreadId(thread);
+				}
+			}
+		}
+	}
+	else
+	{
+		// Hc selects the thread to step, and 0 lets the stub pick for a continue
+		auto reply = m_rsp.Transact("Hc" + (step ? FormatThreadId(tid) : std::string("0")));
+		if (!reply.has_value())
+			return false;
+
+		signalDelivered = (m_pendingSignal != 0);
+		if (signalDelivered)
+			packet = fmt::format("{}{:02x}", step ? 'S' : 'C', m_pendingSignal);
+		else
+			packet = step ? "s" : "c";
+	}
+
+	if (report)
+	{
+		DebuggerEvent event;
+		event.type = ResumeEventType;
+		PostDebuggerEvent(event);
+	}
+
+	InvalidateCaches();
+	if (signalDelivered)
+		m_pendingSignal = 0;
+
+	// The reply is the stop reply, which the stop thread waits for
+	if (!m_rsp.SendPacket(packet))
+		return false;
+
+	m_running = true;
+	m_runningCv.notify_all();
+	return true;
+}
+
+
+void GdbAdapter::HandleStopReply(const std::string& reply, std::vector<DebuggerEvent>& events)
+{
+	if (reply.empty())
+		return;
+
+	char kind = reply[0];
+	if ((kind == 'O') && (reply != "OK"))
+	{
+		// Output of the target, which does not end the run
+		std::vector<uint8_t> bytes;
+		if (RspConnection::FromHex(reply.substr(1), bytes))
+			PostTargetOutput(TargetStdoutChannel, (const char*)bytes.data(), bytes.size());
+		return;
+	}
+
+	if ((kind == 'W') || (kind == 'X'))
+	{
+		// Exited with a code, or terminated by a signal
+		HandleTargetGone(ParseHex(reply.substr(1, reply.find(';') - 1)), events);
+		return;
+	}
+
+	// From here on, the target is stopped, and breakpoint conditions can read from it
+	m_running = false;
+	if ((kind != 'T') && (kind != 'S'))
+	{
+		LogWarn("Unexpected stop reply from the stub: %s", reply.c_str());
+		ReportStop(m_activeThread, UnknownReason, events);
+		return;
+	}
+
+	int signal = (int)ParseHex(reply.substr(1, 2));
+	uint32_t tid = m_activeThread;
+	bool swbreak = false, hwbreak = false, watch = false, library = false;
+	std::map<size_t, std::vector<uint8_t>> expedited;
+	if (kind == 'T')
+	{
+		for (const auto& field : Split(reply.substr(3), ';'))
+		{
+			size_t colon = field.find(':');
+			if (colon == std::string::npos)
+				continue;
+
+			std::string key = field.substr(0, colon);
+			std::string value = field.substr(colon + 1);
+			if (key == "thread")
+				tid = ParseThreadId(value);
+			else if (key == "swbreak")
+				swbreak = true;
+			else if (key == "hwbreak")
+				hwbreak = true;
+			else if ((key == "watch") || (key == "rwatch") || (key == "awatch"))
+				watch = true;
+			else if (key == "library")
+				library = true;
+			else if (!key.empty() && (key.find_first_not_of("0123456789abcdefABCDEF") == std::string::npos))
+			{
+				// Registers the stub sends along, usually the pc and the stack pointers
+				std::vector<uint8_t> bytes;
+				if (RspConnection::FromHex(value, bytes))
+					expedited[ParseHex(key)] = bytes;
+			}
+		}
+	}
+
+	m_activeThread = tid;
+	m_selectedThread.reset();
+	for (auto& [number, bytes] : expedited)
+		m_registerCache[tid][number] = std::move(bytes);
+
+	if (m_quitRequested)
+	{
+		KillTarget(events);
+		return;
+	}
+
+	if (m_detachRequested)
+	{
+		DetachFromTarget(events);
+		return;
+	}
+
+	if (library)
+	{
+		// Breakpoints in the new libraries can be inserted now
+		m_moduleCache.reset();
+		{
+			std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+			SyncBreakpoints();
+		}
+		FetchModules();
+		if ((signal == GdbSignalTrap) && !swbreak && !hwbreak && !watch && (m_instructionStepsLeft == 0))
+		{
+			Resume(false, false);
+			return;
+		}
+	}
+
+	if (signal == GdbSignalTrap)
+	{
+		if (watch)
+		{
+			ReportStop(tid, Watchpoint, events);
+			return;
+		}
+
+		std::optional<uint64_t> pc = GetRegisterValue(tid, *m_pcRegister);
+		bool atBreakpoint = false;
+		if (pc.has_value())
+		{
+			std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+			auto it = m_breakpoints.find(*pc);
+			atBreakpoint = (it != m_breakpoints.end()) && it->second.inserted;
+		}
+
+		// A step can end on a breakpoint without hitting it. Stubs that support swbreak tell them apart.
+		if (atBreakpoint && (swbreak || (!m_swbreak && (m_instructionStepsLeft == 0))))
+		{
+			HandleBreakpointHit(tid, *pc, events);
+			return;
+		}
+
+		if (m_instructionStepsLeft > 0)
+		{
+			HandleStepDone(tid, events);
+			return;
+		}
+
+		ReportStop(tid, (hwbreak || atBreakpoint) ? Breakpoint : UnknownReason, events);
+		return;
+	}
+
+	if ((signal == GdbSignalInt) || (signal == GdbSignal0))
+	{
+		if (m_breakRequested.exchange(false))
+		{
+			ReportStop(tid, UserRequestedBreak, events);
+			return;
+		}
+		if (signal == GdbSignal0)
+		{
+			ReportStop(tid, UnknownReason, events);
+			return;
+		}
+	}
+
+	m_pendingSignal = signal;
+	m_signalThread = tid;
+	if (IsPassedSilently(signal))
+	{
+		Resume(m_instructionStepsLeft > 0, false);
+		return;
+	}
+
+	ReportStop(tid, GetStopReasonFromGdbSignal(signal), events);
+}
+
+
+void GdbAdapter::HandleBreakpointHit(uint32_t tid, uint64_t address, std::vector<DebuggerEvent>& events)
+{
+	bool user = false, temporary = false, entry = false;
+	{
+		std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+		auto it = m_breakpoints.find(address);
+		if (it != m_breakpoints.end())
+		{
+			user = it->second.user || it->second.relative;
+			temporary = it->second.temporary;
+			entry = it->second.entry;
+			it->second.entry = false;
+		}
+
+		if (entry)
+		{
+			// The shared libraries are mapped by now
+			m_moduleCache.reset();
+			SyncBreakpoints();
+		}
+	}
+
+	if (temporary && (address == m_stepOverAddress))
+	{
+		// Returning from a recursive call to the same function does not end the step over
+		uint64_t sp = m_spRegister.has_value() ? GetRegisterValue(tid, *m_spRegister).value_or(0) : 0;
+		if (sp >= m_stepOverStackPointer)
+		{
+			ReportStop(tid, SingleStep, events);
+			return;
+		}
+		temporary = false;
+	}
+
+	if (temporary || (entry && m_stopAtEntry))
+	{
+		ReportStop(tid, Breakpoint, events);
+		return;
+	}
+
+	// Breakpoint conditions, ignore counts and log points are handled right here, without a round-trip to the
+	// controller
+	if (!user || !ShouldStopAtBreakpoint(address))
+	{
+		Resume(false, false);
+		return;
+	}
+
+	ReportStop(tid, Breakpoint, events);
+}
+
+
+void GdbAdapter::HandleStepDone(uint32_t tid, std::vector<DebuggerEvent>& events)
+{
+	if (m_instructionStepsLeft > 1)
+	{
+		m_instructionStepsLeft--;
+		auto pc = GetRegisterValue(tid, *m_pcRegister);
+		if (!m_stepPredicate || !pc.has_value() || !m_stepPredicate(*pc))
+		{
+			Resume(true, false);
+			return;
+		}
+	}
+
+	ReportStop(tid, SingleStep, events);
+}
+
+
+void GdbAdapter::ReportStop(uint32_t tid, DebugStopReason reason, std::vector<DebuggerEvent>& events)
+{
+	m_running = false;
+	m_instructionStepsLeft = 0;
+	m_stepPredicate = nullptr;
+	m_stepOverAddress = 0;
+	m_breakRequested = false;
+	m_activeThread = tid;
+	m_lastStopReason = reason;
+	RemoveTemporaryBreakpoints();
+
+	DebuggerEvent event;
+	event.type = AdapterStoppedEventType;
+	event.data.targetStoppedData.reason = reason;
+	event.data.targetStoppedData.lastActiveThread = tid;
+	events.push_back(event);
+}
+
+
+void GdbAdapter::HandleTargetGone(uint64_t exitCode, std::vector<DebuggerEvent>& events)
+{
+	m_running = false;
+	m_connected = false;
+	m_exitCode = exitCode;
+	m_lastStopReason = ProcessExited;
+	m_instructionStepsLeft = 0;
+	m_stepPredicate = nullptr;
+	InvalidateCaches();
+	{
+		// Addresses are no longer meaningful once the process is gone
+		std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+		m_breakpoints.clear();
+		m_relativeBreakpoints.clear();
+		m_hardwareBreakpoints.clear();
+	}
+	m_rsp.Disconnect();
+	m_runningCv.notify_all();
+
+	DebuggerEvent event;
+	event.type = TargetExitedEventType;
+	event.data.exitData.exitCode = exitCode;
+	events.push_back(event);
+}
+
+
+void GdbAdapter::DetachFromTarget(std::vector<DebuggerEvent>& events)
+{
+	m_running = false;
+	{
+		// The stub removes its breakpoints on detach, but not every stub does
+		std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+		for (auto& [address, breakpoint] : m_breakpoints)
+		{
+			breakpoint.user = breakpoint.relative = breakpoint.temporary = breakpoint.entry = false;
+		}
+		SyncBreakpoints();
+		m_breakpoints.clear();
+		m_relativeBreakpoints.clear();
+		for (const auto& breakpoint : m_hardwareBreakpoints)
+			SendHardwareBreakpoint(breakpoint, false);
+		m_hardwareBreakpoints.clear();
+	}
+
+	m_rsp.Transact((m_multiprocess && m_pid) ? fmt::format("D;{:x}", m_pid) : "D");
+	m_connected = false;
+	InvalidateCaches();
+	m_rsp.Disconnect();
+	m_runningCv.notify_all();
+
+	DebuggerEvent event;
+	event.type = DetachedEventType;
+	events.push_back(event);
+}
+
+
+void GdbAdapter::KillTarget(std::vector<DebuggerEvent>& events)
+{
+	m_running = false;
+	uint64_t exitCode = 0;
+	if (m_multiprocess && m_pid)
+	{
+		m_rsp.Transact(fmt::format("vKill;{:x}", m_pid));
+	}
+	else
+	{
+		// Stubs may or may not reply to k, and usually close the connection afterwards
+		m_rsp.SendPacket("k");
+		std::string reply;
+		if (m_rsp.ReceivePacket(reply, 1000) && !reply.empty() && ((reply[0] == 'X') || (reply[0] == 'W')))
+			exitCode = ParseHex(reply.substr(1, reply.find(';') - 1));
+	}
+	HandleTargetGone(exitCode, events);
+}
+
+
+void GdbAdapter::StopThreadLoop()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+			m_runningCv.wait(lock, [this]() { return m_running || !m_connected; });
+			if (!m_connected)
+				return;
+		}
+
+		// Nobody else uses the connection while the target runs, so this does not need the lock. The timeout lets
+		// the log points flush while the target runs, and this thread notice a disconnection.
+		std::string reply;
+		bool timedOut = false;
+		bool received = m_rsp.ReceivePacket(reply, 100, &timedOut);
+		if (!received && timedOut)
+		{
+			FlushBreakpointLog();
+			continue;
+		}
+
+		std::vector<DebuggerEvent> events;
+		{
+			std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+			if (!received)
+			{
+				if (m_connected)
+				{
+					LogWarn("The connection to the GDB stub was lost");
+					HandleTargetGone(0, events);
+				}
+			}
+			else if (m_running)
+			{
+				HandleStopReply(reply, events);
+			}
+		}
+		PostEvents(events);
+	}
+}
+
+
+void GdbAdapter::PostEvents(const std::vector<DebuggerEvent>& events)
+{
+	for (const auto& event : events)
+	{
+		if ((event.type == AdapterStoppedEventType) || (event.type == TargetExitedEventType)
+			|| (event.type == DetachedEventType))
+			FlushBreakpointLog(true);
+
+		PostDebuggerEvent(event);
+	}
+}
+
+
+bool GdbAdapter::Detach()
+{
+	if (!m_connected)
+		return false;
+
+	if (m_running)
+	{
+		// The target is detached from once it stops
+		m_detachRequested = true;
+		return m_rsp.SendInterrupt();
+	}
+
+	std::vector<DebuggerEvent> events;
+	{
+		std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+		if (!m_connected)
+			return false;
+		DetachFromTarget(events);
+	}
+	PostEvents(events);
+	return true;
+}
+
+
+bool GdbAdapter::Quit()
+{
+	if (!m_connected)
+		return false;
+
+	if (m_running)
+	{
+		m_quitRequested = true;
+		return m_rsp.SendInterrupt();
+	}
+
+	std::vector<DebuggerEvent> events;
+	{
+		std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+		if (!m_connected)
+			return false;
+		KillTarget(events);
+	}
+	PostEvents(events);
+	return true;
+}
+
+
+std::vector<DebugProcess> GdbAdapter::GetProcessList()
+{
+	return {};
+}
+
+
+std::vector<DebugThread> GdbAdapter::GetThreadList()
+{
+	std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+	if (!m_connected || m_running)
+		return {};
+
+	auto threads = FetchThreads();
+	size_t pcNumber = m_registers[*m_pcRegister].number;
+
+	// The pc of every thread in one batch, rather than two round-trips per thread
+	std::vector<std::string> requests;
+	std::vector<uint32_t> pending;
+	for (uint32_t tid : threads)
+	{
+		auto& cache = m_registerCache[tid];
+		if (cache.find(pcNumber) != cache.end())
+			continue;
+
+		requests.push_back("Hg" + FormatThreadId(tid));
+		requests.push_back(fmt::format("p{:x}", pcNumber));
+		pending.push_back(tid);
+	}
+
+	auto replies = m_rsp.TransactPipelined(requests);
+	m_selectedThread.reset();
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		if ((2 * i + 1 >= replies.size()) || !replies[2 * i].has_value() || (*replies[2 * i] != "OK")
+			|| !replies[2 * i + 1].has_value())
+			continue;
+
+		std::vector<uint8_t> bytes;
+		if (!replies[2 * i + 1]->empty() && !RspConnection::IsErrorReply(*replies[2 * i + 1])
+			&& RspConnection::FromHex(*replies[2 * i + 1], bytes))
+			m_registerCache[pending[i]][pcNumber] = bytes;
+		m_selectedThread = pending[i];
+	}
+
+	std::vector<DebugThread> result;
+	for (uint32_t tid : threads)
+	{
+		DebugThread thread(tid, GetRegisterValue(tid, *m_pcRegister).value_or(0));
+		thread.m_isFrozen = (m_suspendedThreads.count(tid) != 0);
+		result.push_back(thread);
+	}
+	return result;
+}
+
+
+DebugThread GdbAdapter::GetActiveThread() const
+{
+	auto self = const_cast<GdbAdapter*>(this);
+	std::unique_lock<std::recursive_mutex> lock(self->m_rspMutex);
+	uint32_t tid = m_activeThread;
+	if (!m_connected || m_running)
+		return DebugThread(tid);
+	return DebugThread(tid, self->GetRegisterValue(tid, *m_pcRegister).value_or(0));
+}
+
+
+uint32_t GdbAdapter::GetActiveThreadId() const
+{
+	return m_activeThread;
+}
+
+
+bool GdbAdapter::SetActiveThread(const DebugThread& thread)
+{
+	return SetActiveThreadId(thread.m_tid);
+}
+
+
+bool GdbAdapter::SetActiveThreadId(std::uint32_t tid)
+{
+	std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+	if (!m_connected || m_running)
+		return false;
+
+	auto threads = FetchThreads();
+	if (std::find(threads.begin(), threads.end(), tid) == threads.end())
+		return false;
+
+	m_activeThread = tid;
+	return true;
+}
+
+
+bool GdbAdapter::SuspendThread(std::uint32_t tid)
+{
+	// Only vCont can leave some threads stopped
+	std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+	if (!m_hasVCont)
+		return false;
+
+	m_suspendedThreads.insert(tid);
+	return true;
+}
+
+
+bool GdbAdapter::ResumeThread(std::uint32_t tid)
+{
+	std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+	return m_suspendedThreads.erase(tid) != 0;
+}
+
+
+std::vector<DebugFrame> GdbAdapter::GetFramesOfThread(std::uint32_t tid)
+{
+	std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+	if (!m_connected || m_running)
+		return {};
+
+	auto pc = GetRegisterValue(tid, *m_pcRegister);
+	if (!pc.has_value())
+		return {};
+
+	uint64_t sp = m_spRegister.has_value() ? GetRegisterValue(tid, *m_spRegister).value_or(0) : 0;
+	uint64_t fp = m_fpRegister.has_value() ? GetRegisterValue(tid, *m_fpRegister).value_or(0) : 0;
+
+	auto modules = FetchModules();
+	auto moduleName = [&](uint64_t address) -> std::string {
+		for (const auto& module : modules)
+		{
+			if ((address >= module.m_address) && (address < module.m_address + module.m_size))
+				return module.m_short_name;
+		}
+		return "<unknown>";
+	};
+
+	std::vector<DebugFrame> frames;
+	frames.emplace_back(0, *pc, sp, fp, "", 0, moduleName(*pc));
+
+	// The frame records of x86 and aarch64 hold the caller's frame pointer followed by the return address. Code
+	// built without frame pointers gives a partial stack.
+	std::string arch = GetTargetArchitecture();
+	if ((arch != "x86_64") && (arch != "x86") && (arch != "aarch64"))
+		return frames;
+
+	static constexpr size_t MaxFrames = 256;
+	while ((fp != 0) && (frames.size() < MaxFrames))
+	{
+		auto callerFp = ReadPointer(fp);
+		auto returnAddress = ReadPointer(fp + m_addressSize);
+		if (!callerFp.has_value() || !returnAddress.has_value() || (*returnAddress == 0))
+			break;
+
+		frames.emplace_back(
+			frames.size(), *returnAddress, fp + 2 * m_addressSize, *callerFp, "", 0, moduleName(*returnAddress));
+		// The stack grows down, so anything else is not a frame record
+		if (*callerFp <= fp)
+			break;
+		fp = *callerFp;
+	}
+	return frames;
+}
+
+
+DebugBreakpoint GdbAdapter::AddBreakpoint(const std::uintptr_t address, unsigned long breakpoint_type)
+{
+	std::unique_lock<std::recursive_mutex> rspLock(m_rspMutex);
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	Breakpoint& breakpoint = GetOrCreateBreakpoint(address);
+	breakpoint.user = true;
+	unsigned long id = breakpoint.id;
+	// While the target runs, or before it is connected, this waits for the next stop
+	SyncBreakpoints();
+	return DebugBreakpoint(address, id, true);
+}
+
+
+DebugBreakpoint GdbAdapter::AddBreakpoint(const ModuleNameAndOffset& address, unsigned long breakpoint_type)
+{
+	std::unique_lock<std::recursive_mutex> rspLock(m_rspMutex);
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	for (const auto& [location, resolved] : m_relativeBreakpoints)
+	{
+		if (location == address)
+			return DebugBreakpoint(resolved, 0, true);
+	}
+
+	m_relativeBreakpoints.emplace_back(address, 0);
+	SyncBreakpoints();
+	uint64_t resolved = m_relativeBreakpoints.back().second;
+	if (resolved == 0)
+		return DebugBreakpoint(0, 0, true);
+	return DebugBreakpoint(resolved, m_breakpoints[resolved].id, true);
+}
+
+
+bool GdbAdapter::RemoveBreakpoint(const DebugBreakpoint& breakpoint)
+{
+	std::unique_lock<std::recursive_mutex> rspLock(m_rspMutex);
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	auto it = m_breakpoints.find(breakpoint.m_address);
+	if (it == m_breakpoints.end())
+		return false;
+
+	m_relativeBreakpoints.erase(std::remove_if(m_relativeBreakpoints.begin(), m_relativeBreakpoints.end(),
+									[&](const auto& entry) { return entry.second == breakpoint.m_address; }),
+		m_relativeBreakpoints.end());
+	it->second.user = false;
+	it->second.relative = false;
+	SyncBreakpoints();
+	return true;
+}
+
+
+bool GdbAdapter::RemoveBreakpoint(const ModuleNameAndOffset& address)
+{
+	std::unique_lock<std::recursive_mutex> rspLock(m_rspMutex);
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	for (auto entry = m_relativeBreakpoints.begin(); entry != m_relativeBreakpoints.end(); entry++)
+	{
+		if (!(entry->first == address))
+			continue;
+
+		uint64_t resolved = entry->second;
+		m_relativeBreakpoints.erase(entry);
+		auto it = m_breakpoints.find(resolved);
+		if (it != m_breakpoints.end())
+			it->second.relative = false;
+		SyncBreakpoints();
+		return true;
+	}
+	return false;
+}
+
+
+std::vector<DebugBreakpoint> GdbAdapter::GetBreakpointList() const
+{
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	std::vector<DebugBreakpoint> result;
+	for (const auto& [address, breakpoint] : m_breakpoints)
+	{
+		if (breakpoint.user || breakpoint.relative)
+			result.emplace_back(address, breakpoint.id, breakpoint.inserted);
+	}
+	return result;
+}
+
+
+bool GdbAdapter::AddTemporaryBreakpoint(std::uintptr_t address)
+{
+	std::unique_lock<std::recursive_mutex> rspLock(m_rspMutex);
+	if (!m_connected || m_running)
+		return false;
+
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	GetOrCreateBreakpoint(address).temporary = true;
+	SyncBreakpoints();
+	auto it = m_breakpoints.find(address);
+	return (it != m_breakpoints.end()) && it->second.inserted;
+}
+
+
+void GdbAdapter::RemoveTemporaryBreakpoints()
+{
+	std::unique_lock<std::recursive_mutex> rspLock(m_rspMutex);
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	for (auto& [address, breakpoint] : m_breakpoints)
+		breakpoint.temporary = false;
+	SyncBreakpoints();
+}
+
+
+bool GdbAdapter::AddHardwareBreakpoint(const DebugHardwareBreakpoint& breakpoint)
+{
+	std::unique_lock<std::recursive_mutex> rspLock(m_rspMutex);
+	if (!m_connected || m_running)
+		return false;
+
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	if (std::find(m_hardwareBreakpoints.begin(), m_hardwareBreakpoints.end(), breakpoint)
+		!= m_hardwareBreakpoints.end())
+		return true;
+
+	if (!SendHardwareBreakpoint(breakpoint, true))
+		return false;
+
+	m_hardwareBreakpoints.push_back(breakpoint);
+	return true;
+}
+
+
+bool GdbAdapter::RemoveHardwareBreakpoint(const DebugHardwareBreakpoint& breakpoint)
+{
+	std::unique_lock<std::recursive_mutex> rspLock(m_rspMutex);
+	if (!m_connected || m_running)
+		return false;
+
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	auto it = std::find(m_hardwareBreakpoints.begin(), m_hardwareBreakpoints.end(), breakpoint);
+	if (it == m_hardwareBreakpoints.end())
+		return false;
+
+	m_hardwareBreakpoints.erase(it);
+	return SendHardwareBreakpoint(breakpoint, false);
+}
+
+
+std::unordered_map<std::string, DebugRegister> GdbAdapter::ReadAllRegisters()
+{
+	std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+	std::unordered_map<std::string, DebugRegister> result;
+	if (!m_connected || m_running)
+		return result;
+
+	uint32_t tid = m_activeThread;
+	FetchRegisters(tid, true);
+	const auto& cache = m_registerCache[tid];
+	for (size_t i = 0; i < m_registers.size(); i++)
+	{
+		// Vector and floating point registers do not fit in a DebugRegister
+		const RegisterInfo& reg = m_registers[i];
+		auto it = cache.find(reg.number);
+		if ((reg.bitSize > 64) || (it == cache.end()))
+			continue;
+
+		result[reg.name] = DebugRegister(reg.name, DecodeRegister(it->second), reg.bitSize, i);
+	}
+	return result;
+}
+
+
+DebugRegister GdbAdapter::ReadRegister(const std::string& reg)
+{
+	std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+	auto index = FindRegister(reg);
+	if (!m_connected || m_running || !index.has_value())
+		return DebugRegister {};
+
+	auto value = GetRegisterValue(m_activeThread, *index);
+	if (!value.has_value())
+		return DebugRegister {};
+
+	return DebugRegister(reg, *value, m_registers[*index].bitSize, *index);
+}
+
+
+bool GdbAdapter::WriteRegister(const std::string& reg, std::uintptr_t value)
+{
+	std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+	auto index = FindRegister(reg);
+	if (!m_connected || m_running || !index.has_value())
+		return false;
+
+	return SetRegisterValue(m_activeThread, *index, value);
+}
+
+
+DataBuffer GdbAdapter::ReadMemory(std::uintptr_t address, std::size_t size)
+{
+	std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+	if (!m_connected || m_running || (size == 0))
+		return DataBuffer {};
+
+	std::vector<uint8_t> buffer(size);
+	size_t bytesRead = ReadRemoteMemory(address, buffer.data(), size);
+	return DataBuffer(buffer.data(), bytesRead);
+}
+
+
+bool GdbAdapter::WriteMemory(std::uintptr_t address, const DataBuffer& buffer)
+{
+	std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+	if (!m_connected || m_running)
+		return false;
+
+	return WriteRemoteMemory(address, (const uint8_t*)buffer.GetData(), buffer.GetLength());
+}
+
+
+std::vector<DebugModule> GdbAdapter::GetModuleList()
+{
+	std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+	if (!m_connected || m_running)
+		return {};
+
+	return FetchModules();
+}
+
+
+std::string GdbAdapter::GetTargetArchitecture()
+{
+	// The architecture of the binary view is more specific, e.g., about thumb
+	if (!m_defaultArchitecture.empty())
+		return m_defaultArchitecture;
+	return GetArchitectureFromGdbName(m_architecture);
+}
+
+
+DebugStopReason GdbAdapter::StopReason()
+{
+	return m_lastStopReason;
+}
+
+
+uint64_t GdbAdapter::ExitCode()
+{
+	return m_exitCode;
+}
+
+
+bool GdbAdapter::BreakInto()
+{
+	if (!m_connected || !m_running)
+		return false;
+
+	m_breakRequested = true;
+	return m_rsp.SendInterrupt();
+}
+
+
+bool GdbAdapter::Go()
+{
+	std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+	if (!m_connected || m_running)
+		return false;
+
+	return Resume(false, true);
+}
+
+
+bool GdbAdapter::StepInto()
+{
+	return StepInstructions(1, nullptr);
+}
+
+
+bool GdbAdapter::StepInstructions(uint64_t count, const std::function<bool(uint64_t)>& stopPredicate)
+{
+	std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+	if (!m_connected || m_running || (count == 0))
+		return false;
+
+	m_instructionStepsLeft = count;
+	m_stepPredicate = stopPredicate;
+	return Resume(true, true);
+}
+
+
+bool GdbAdapter::StepOver()
+{
+	std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+	if (!m_connected || m_running)
+		return false;
+
+	uint32_t tid = m_activeThread;
+	auto pc = GetRegisterValue(tid, *m_pcRegister);
+	Ref<Architecture> arch = Architecture::GetByName(GetTargetArchitecture());
+	if (!pc.has_value() || !arch)
+		return false;
+
+	DataBuffer buffer = ReadMemory(*pc, arch->GetMaxInstructionLength());
+	auto data = (const uint8_t*)buffer.GetData();
+	auto info = m_instructionCache.GetInstructionInfo(arch, *pc, data, buffer.GetLength());
+	if (!info.has_value() || !m_instructionCache.IsCall(arch, *pc, data, buffer.GetLength()))
+	{
+		m_instructionStepsLeft = 1;
+		return Resume(true, true);
+	}
+
+	// Run the call until it returns
+	uint64_t returnAddress = *pc + info->length;
+	if (!AddTemporaryBreakpoint(returnAddress))
+		return false;
+	m_stepOverAddress = returnAddress;
+	m_stepOverStackPointer = m_spRegister.has_value() ? GetRegisterValue(tid, *m_spRegister).value_or(0) : 0;
+	return Resume(false, true);
+}
+
+
+std::string GdbAdapter::InvokeBackendCommand(const std::string& command)
+{
+	std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+	if (!m_connected || m_running)
+		return "error: the target must be stopped\n";
+
+	// Sent as a monitor command, whose output comes back in O packets before the final reply
+	if (!m_rsp.SendPacket("qRcmd," + RspConnection::ToHex(command)))
+		return "error: the connection to the stub was lost\n";
+
+	std::string output;
+	std::string reply;
+	while (m_rsp.ReceivePacket(reply))
+	{
+		if (!reply.empty() && (reply[0] == 'O') && (reply != "OK"))
+		{
+			std::vector<uint8_t> bytes;
+			if (RspConnection::FromHex(reply.substr(1), bytes))
+				output.append(bytes.begin(), bytes.end());
+			continue;
+		}
+
+		if (reply.empty())
+			return "error: the stub does not support monitor commands\n";
+		if (RspConnection::IsErrorReply(reply))
+			return output + fmt::format("error: the stub replied {}\n", reply);
+		if (reply != "OK")
+		{
+			// Some stubs reply with the hex encoded output directly
+			std::vector<uint8_t> bytes;
+			if (RspConnection::FromHex(reply, bytes))
+				output.append(bytes.begin(), bytes.end());
+		}
+		return output;
+	}
+	return output + "error: the connection to the stub was lost\n";
+}
+
+
+uint64_t GdbAdapter::GetInstructionOffset()
+{
+	std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+	if (!m_connected || m_running)
+		return 0;
+	return GetRegisterValue(m_activeThread, *m_pcRegister).value_or(0);
+}
+
+
+uint64_t GdbAdapter::GetStackPointer()
+{
+	std::unique_lock<std::recursive_mutex> lock(m_rspMutex);
+	if (!m_connected || m_running || !m_spRegister.has_value())
+		return 0;
+	return GetRegisterValue(m_activeThread, *m_spRegister).value_or(0);
+}
+
+
+bool GdbAdapter::SupportFeature(DebugAdapterCapacity feature)
+{
+	switch (feature)
+	{
+	case DebugAdapterSupportStepOver:
+	case DebugAdapterSupportThreads:
+	case DebugAdapterSupportModules:
+	case DebugAdapterSupportStepInstructions:
+		return true;
+	default:
+		return false;
+	}
+}
+
+
+GdbAdapterType::GdbAdapterType() : DebugAdapterType("GDB RSP") {}
+
+
+DebugAdapter* GdbAdapterType::Create(BinaryNinja::BinaryView* data)
+{
+	// TODO: someone should free this.
+	return new GdbAdapter(data);
+}
+
+
+bool GdbAdapterType::IsValidForData(BinaryNinja::BinaryView* data)
+{
+	// Stubs exist for targets of every kind, including bare-metal ones
+	return true;
+}
+
+
+bool GdbAdapterType::CanConnect(BinaryNinja::BinaryView* data)
+{
+	return true;
+}
+
+
+bool GdbAdapterType::CanExecute(BinaryNinja::BinaryView* data)
+{
+	return false;
+}
+
+
+void BinaryNinjaDebugger::InitGdbAdapterType()
+{
+	static GdbAdapterType gdbType;
+	DebugAdapterType::Register(&gdbType);
+}
@@ -0,0 +1,279 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <thread>
+#include "rspconnection.h"
+#include "../debugadapter.h"
+#include "../debugadaptertype.h"
+#include "../../api/decodedinstructioncache.h"
+
+namespace BinaryNinjaDebugger {
+	// An adapter that talks the GDB remote serial protocol directly to a stub, e.g., gdbserver, qemu-user/system, or
+	// lldb-server in gdbserver mode. It only connects to a target the stub already has, in all-stop mode.
+	//
+	// Remote sessions are dominated by round-trips, so the adapter keeps their number down: memory moves in binary
+	// x/X packets as large as the stub accepts, acknowledgements are turned off, independent requests (memory chunks,
+	// per-thread registers, breakpoints) are pipelined, and the registers and modules are cached until the target
+	// resumes.
+	class GdbAdapter : public DebugAdapter
+	{
+	private:
+		struct RegisterInfo
+		{
+			std::string name;
+			size_t bitSize = 0;
+			// The register number of the stub, used by the p/P packets
+			size_t number = 0;
+			// The offset in the reply of the g packet, if the register is in it
+			std::optional<size_t> offset;
+		};
+
+		struct Breakpoint
+		{
+			unsigned long id = 0;
+			bool inserted = false;
+			// A breakpoint can be wanted for several reasons at once. It is removed when none of them is left.
+			bool user = false;
+			// Resolved from one of m_relativeBreakpoints
+			bool relative = false;
+			bool temporary = false;
+			// At the entry point of the program, see debugger.stopAtEntryPoint
+			bool entry = false;
+
+			bool IsWanted() const { return user || relative || temporary || entry; }
+		};
+
+		enum MemoryReadMode
+		{
+			// x packets, with the data prefixed by a 'b', as GDB 16 and later do
+			BinaryPrefixedRead,
+			// x packets, with the raw data, as lldb-server does
+			BinaryRawRead,
+			HexRead
+		};
+
+		RspConnection m_rsp;
+		// Serializes the use of the connection. While the target runs, the stop thread is the only one to read from
+		// it, and every request is rejected. Recursive, since breakpoint conditions read registers and memory through
+		// the public methods while a stop is handled.
+		std::recursive_mutex m_rspMutex;
+		std::atomic_bool m_connected = false;
+		std::atomic_bool m_running = false;
+		std::thread m_stopThread;
+		std::condition_variable_any m_runningCv;
+
+		// Features of the stub, see qSupported
+		size_t m_packetSize = 0x400;
+		bool m_multiprocess = false;
+		bool m_swbreak = false;
+		bool m_hasVCont = false;
+		bool m_hasFeaturesXfer = false;
+		bool m_hasLibrariesXfer = false;
+		bool m_hasLibrariesSvr4Xfer = false;
+		bool m_hasThreadsXfer = false;
+		bool m_hasAuxvXfer = false;
+		bool m_hasExecFileXfer = false;
+		bool m_hasPassSignals = false;
+		bool m_hasBinaryUpload = false;
+		MemoryReadMode m_readMode = HexRead;
+		bool m_binaryWrite = false;
+		bool m_registerWrite = true;
+
+		std::string m_architecture;
+		bool m_bigEndian = false;
+		size_t m_addressSize = 8;
+		std::vector<RegisterInfo> m_registers;
+		// Indices in m_registers
+		std::optional<size_t> m_pcRegister;
+		std::optional<size_t> m_spRegister;
+		std::optional<size_t> m_fpRegister;
+
+		uint32_t m_pid = 0;
+		std::atomic<uint32_t> m_activeThread = 0;
+		// The thread selected by the last Hg packet
+		std::optional<uint32_t> m_selectedThread;
+		std::set<uint32_t> m_suspendedThreads;
+
+		// Valid until the target resumes
+		std::map<uint32_t, std::map<size_t, std::vector<uint8_t>>> m_registerCache;
+		std::optional<std::vector<uint32_t>> m_threadCache;
+		std::optional<std::vector<DebugModule>> m_moduleCache;
+		std::vector<DebugModule> m_lastModules;
+		// Sizes of the shared libraries, read from their program headers, by path and base
+		std::map<std::pair<std::string, uint64_t>, uint64_t> m_librarySizes;
+		std::optional<uint64_t> m_mainModuleBase;
+		std::string m_mainModulePath;
+		uint64_t m_imageSize = 0;
+
+		std::atomic<DebugStopReason> m_lastStopReason = UnknownReason;
+		std::atomic<uint64_t> m_exitCode = 0;
+		// Signal to deliver to m_signalThread when the target resumes
+		int m_pendingSignal = 0;
+		uint32_t m_signalThread = 0;
+
+		uint64_t m_instructionStepsLeft = 0;
+		std::function<bool(uint64_t)> m_stepPredicate;
+		// StepOver() runs a call until it returns here, with the stack pointer back to where it was
+		uint64_t m_stepOverAddress = 0;
+		uint64_t m_stepOverStackPointer = 0;
+		bool m_stopAtEntry = false;
+		BinaryNinjaDebuggerAPI::DecodedInstructionCache m_instructionCache;
+
+		std::atomic_bool m_breakRequested = false;
+		std::atomic_bool m_detachRequested = false;
+		std::atomic_bool m_quitRequested = false;
+
+		mutable std::mutex m_breakpointsMutex;
+		std::map<uint64_t, Breakpoint> m_breakpoints;
+		// Relative breakpoints, with the address they are resolved to, or 0 while the module is not loaded. Guarded by
+		// m_breakpointsMutex.
+		std::vector<std::pair<ModuleNameAndOffset, uint64_t>> m_relativeBreakpoints;
+		std::vector<DebugHardwareBreakpoint> m_hardwareBreakpoints;
+		unsigned long m_nextBreakpointId = 1;
+
+		// Handshake, with m_rspMutex held
+		bool NegotiateFeatures(std::string& error);
+		std::optional<std::string> ReadXfer(const std::string& object, const std::string& annex);
+		void LoadTargetDescription();
+		bool ParseTargetDescription(const std::string& annex, size_t& nextNumber, int depth);
+		void UseDefaultRegisters();
+		void ProbeMemoryPackets();
+		void SendPassSignals();
+
+		std::string FormatThreadId(uint32_t tid) const;
+		uint32_t ParseThreadId(const std::string& text);
+		bool SelectThread(uint32_t tid);
+
+		// Registers, with m_rspMutex held
+		bool FetchRegisters(uint32_t tid, bool all);
+		std::optional<uint64_t> GetRegisterValue(uint32_t tid, size_t index);
+		bool SetRegisterValue(uint32_t tid, size_t index, uint64_t value);
+		uint64_t DecodeRegister(const std::vector<uint8_t>& bytes) const;
+		std::optional<size_t> FindRegister(const std::string& name) const;
+
+		// Memory, with m_rspMutex held
+		size_t ReadRemoteMemory(uint64_t address, uint8_t* buffer, size_t size);
+		bool WriteRemoteMemory(uint64_t address, const uint8_t* buffer, size_t size);
+		std::optional<uint64_t> ReadPointer(uint64_t address);
+
+		// Threads and modules, with m_rspMutex held
+		std::vector<uint32_t> FetchThreads();
+		std::vector<DebugModule> FetchModules();
+		uint64_t GetLibrarySize(const std::string& path, uint64_t base);
+		std::optional<uint64_t> GetMainModuleBase();
+
+		// Breakpoints, with m_rspMutex and m_breakpointsMutex held
+		size_t GetBreakpointKind() const;
+		void SyncBreakpoints();
+		Breakpoint& GetOrCreateBreakpoint(uint64_t address);
+		void AddEntryBreakpoint();
+		bool SendHardwareBreakpoint(const DebugHardwareBreakpoint& breakpoint, bool insert);
+
+		// Execution control, with m_rspMutex held
+		bool Resume(bool step, bool report);
+		void InvalidateCaches();
+		void HandleStopReply(const std::string& reply, std::vector<DebuggerEvent>& events);
+		void HandleStepDone(uint32_t tid, std::vector<DebuggerEvent>& events);
+		void HandleBreakpointHit(uint32_t tid, uint64_t address, std::vector<DebuggerEvent>& events);
+		void ReportStop(uint32_t tid, DebugStopReason reason, std::vector<DebuggerEvent>& events);
+		void HandleTargetGone(uint64_t exitCode, std::vector<DebuggerEvent>& events);
+		void DetachFromTarget(std::vector<DebuggerEvent>& events);
+		void KillTarget(std::vector<DebuggerEvent>& events);
+
+		void StopThreadLoop();
+		void PostEvents(const std::vector<DebuggerEvent>& events);
+
+	public:
+		GdbAdapter(BinaryView* data);
+		~GdbAdapter();
+
+		bool Execute(const std::string& path, const LaunchConfigurations& configs) override;
+		bool ExecuteWithArgs(const std::string& path, const std::string& args, const std::string& workingDir,
+			const LaunchConfigurations& configs) override;
+		bool Attach(std::uint32_t pid) override;
+		bool Connect(const std::string& server, std::uint32_t port) override;
+
+		bool Detach() override;
+		bool Quit() override;
+
+		std::vector<DebugProcess> GetProcessList() override;
+		std::vector<DebugThread> GetThreadList() override;
+		DebugThread GetActiveThread() const override;
+		std::uint32_t GetActiveThreadId() const override;
+		bool SetActiveThread(const DebugThread& thread) override;
+		bool SetActiveThreadId(std::uint32_t tid) override;
+		bool SuspendThread(std::uint32_t tid) override;
+		bool ResumeThread(std::uint32_t tid) override;
+		std::vector<DebugFrame> GetFramesOfThread(std::uint32_t tid) override;
+
+		DebugBreakpoint AddBreakpoint(const std::uintptr_t address, unsigned long breakpoint_type = 0) override;
+		DebugBreakpoint AddBreakpoint(const ModuleNameAndOffset& address, unsigned long breakpoint_type = 0) override;
+		bool RemoveBreakpoint(const DebugBreakpoint& breakpoint) override;
+		bool RemoveBreakpoint(const ModuleNameAndOffset& address) override;
+		std::vector<DebugBreakpoint> GetBreakpointList() const override;
+		bool AddTemporaryBreakpoint(std::uintptr_t address) override;
+		void RemoveTemporaryBreakpoints() override;
+		bool AddHardwareBreakpoint(const DebugHardwareBreakpoint& breakpoint) override;
+		bool RemoveHardwareBreakpoint(const DebugHardwareBreakpoint& breakpoint) override;
+
+		std::unordered_map<std::string, DebugRegister> ReadAllRegisters() override;
+		DebugRegister ReadRegister(const std::string& reg) override;
+		bool WriteRegister(const std::string& reg, std::uintptr_t value) override;
+
+		DataBuffer ReadMemory(std::uintptr_t address, std::size_t size) override;
+		bool WriteMemory(std::uintptr_t address, const DataBuffer& buffer) override;
+
+		std::vector<DebugModule> GetModuleList() override;
+		std::string GetTargetArchitecture() override;
+
+		DebugStopReason StopReason() override;
+		uint64_t ExitCode() override;
+
+		bool BreakInto() override;
+		bool Go() override;
+		bool StepInto() override;
+		bool StepInstructions(uint64_t count, const std::function<bool(uint64_t)>& stopPredicate) override;
+		bool StepOver() override;
+
+		std::string InvokeBackendCommand(const std::string& command) override;
+		uint64_t GetInstructionOffset() override;
+		uint64_t GetStackPointer() override;
+
+		bool SupportFeature(DebugAdapterCapacity feature) override;
+	};
+
+
+	class GdbAdapterType : public DebugAdapterType
+	{
+	public:
+		GdbAdapterType();
+		virtual DebugAdapter* Create(BinaryNinja::BinaryView* data);
+		virtual bool IsValidForData(BinaryNinja::BinaryView* data);
+		virtual bool CanExecute(BinaryNinja::BinaryView* data);
+		virtual bool CanConnect(BinaryNinja::BinaryView* data);
+	};
+
+
+	void InitGdbAdapterType();
+};  // namespace BinaryNinjaDebugger
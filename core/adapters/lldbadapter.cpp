@@ -16,11 +16,15 @@ limitations under the License.
 
 #include <inttypes.h>
 #include "lldbadapter.h"
+#include "../processlist.h"
 #include "thread"
 
 using namespace lldb;
 using namespace BinaryNinjaDebugger;
 
+// Sent on LldbAdapter::m_listenerControl to make the event listener return
+static constexpr uint32_t ListenerStopBit = 1 << 0;
+
 std::string lldbArchNameForBinaryNinjaArchName(std::string name)
 {
 	if (name == "x86_64")
@@ -51,12 +55,14 @@ LldbAdapter::LldbAdapter(BinaryView* data) : DebugAdapter(data)
 	// Otherwise, the confirmation prompt will be sent to the terminal that BN is launched from, which is a very
 	// confusing behavior.
 	InvokeBackendCommand("settings set auto-confirm true");
-	m_debugger.SetAsync(false);
+	// Process control returns right away, and the event listener reports the state changes as they happen
+	m_debugger.SetAsync(true);
 }
 
 
 LldbAdapter::~LldbAdapter()
 {
+	StopEventListener();
 	m_process.Destroy();
 	SBDebugger::Destroy(m_debugger);
 }
@@ -136,6 +142,17 @@ void LldbAdapter::ApplyBreakpoints()
 }
 
 
+void LldbAdapter::ApplyFollowForkMode()
+{
+	// LLDB follows one side of a fork only, so "both" stays with the parent, like the default
+	std::string mode = Settings::Instance()->Get<std::string>("debugger.followForkMode");
+	if (mode == "both")
+		LogWarn("The LLDB adapter cannot debug both sides of a fork, only the parent is followed");
+	InvokeBackendCommand(
+		fmt::format("settings set target.process.follow-fork-mode {}", mode == "child" ? "child" : "parent"));
+}
+
+
 bool LldbAdapter::IsELFWithoutDynamicLoader(BinaryView* data)
 {
 	if (!data)
@@ -159,12 +176,9 @@ bool LldbAdapter::Execute(const std::string& path, const LaunchConfigurations& c
 bool LldbAdapter::ExecuteWithArgs(const std::string& path, const std::string& args, const std::string& workingDir,
 	const LaunchConfigurations& configs)
 {
-	m_debugger.SetAsync(true);
-
 	// We must start the event listener before calling CreateTarget, since CreateTarget will send out the initial
 	// batch of module load events.
-	std::thread thread([&]() { EventListener(); });
-	thread.detach();
+	StartEventListener();
 
 	SBError err;
 
@@ -204,6 +218,7 @@ bool LldbAdapter::ExecuteWithArgs(const std::string& path, const std::string& ar
 	// stores all the breakpoints in m_pendingBreakpoints, and applies them when launching/connecting/attaching to the
 	// target.
 	ApplyBreakpoints();
+	ApplyFollowForkMode();
 
 	if (Settings::Instance()->Get<bool>("debugger.stopAtEntryPoint") && m_hasEntryFunction)
 		AddBreakpoint(ModuleNameAndOffset(configs.inputFile, m_entryPoint - m_start));
@@ -254,10 +269,7 @@ bool LldbAdapter::ExecuteWithArgs(const std::string& path, const std::string& ar
 
 bool LldbAdapter::Attach(std::uint32_t pid)
 {
-	m_debugger.SetAsync(true);
-
-	std::thread thread([&]() { EventListener(); });
-	thread.detach();
+	StartEventListener();
 
 	SBError err;
 
@@ -293,6 +305,7 @@ bool LldbAdapter::Attach(std::uint32_t pid)
 
 	m_targetActive = true;
 	ApplyBreakpoints();
+	ApplyFollowForkMode();
 
 	SBAttachInfo info(pid);
 	m_process = m_target.Attach(info, err);
@@ -319,10 +332,7 @@ bool LldbAdapter::Attach(std::uint32_t pid)
 
 bool LldbAdapter::Connect(const std::string& server, std::uint32_t port)
 {
-	m_debugger.SetAsync(true);
-
-	std::thread thread([&]() { EventListener(); });
-	thread.detach();
+	StartEventListener();
 
 	SBError err;
 
@@ -358,6 +368,7 @@ bool LldbAdapter::Connect(const std::string& server, std::uint32_t port)
 
 	m_targetActive = true;
 	ApplyBreakpoints();
+	ApplyFollowForkMode();
 
 	if (Settings::Instance()->Get<bool>("debugger.stopAtEntryPoint") && m_hasEntryFunction)
 		AddBreakpoint(ModuleNameAndOffset(m_originalFileName, m_entryPoint - m_start));
@@ -384,6 +395,13 @@ bool LldbAdapter::Connect(const std::string& server, std::uint32_t port)
 
 bool LldbAdapter::Detach()
 {
+	// Give the pages their protection back, otherwise the target crashes on the next access to a watched page
+	if (m_process.GetState() == lldb::eStateStopped)
+	{
+		for (const SoftwareWatchpoint& watchpoint : GetSoftwareWatchpoints())
+			RemoveSoftwareWatchpoint(watchpoint);
+	}
+
 	std::unique_lock<std::mutex> lock(m_quitingMutex);
 	SBError error = m_process.Detach();
 	return error.Success();
@@ -400,40 +418,42 @@ bool LldbAdapter::Quit()
 
 std::vector<DebugProcess> LldbAdapter::GetProcessList()
 {
-	std::vector<DebugProcess> debug_processes {};
+	std::vector<DebugProcess> result;
 
-	std::istringstream processList(InvokeBackendCommand("platform process list"));
-	std::string line;
+	// Processes of the host are read straight from the OS, which is much faster than the host platform of LLDB when
+	// there are thousands of them. This is only implemented on Linux, elsewhere it returns false.
+	auto platform = m_debugger.GetSelectedPlatform();
+	if (platform.IsValid() && (std::string(platform.GetName()) == "host") && GetLocalProcessList(result))
+		return result;
 
-	while (getline(processList, line, '\n'))
+	// SBPlatform has no way to enumerate processes in the LLDB we ship (SBPlatform::GetAllProcesses() is new in 17),
+	// so parse the output of the command, column by column. The arguments replace the name with --show-args, and the
+	// name cannot be told from them when the path has spaces in it, so both listings are needed.
+	std::unordered_map<uint32_t, size_t> indices;
+	std::istringstream nameRows(InvokeBackendCommand("platform process list"));
+	std::string line;
+	while (getline(nameRows, line, '\n'))
 	{
-		uint32_t pid{};
-
-		// skip header lines and lines that have len <= 56
-		if (line.rfind("matching processes were found on") != std::string::npos
-			|| line.rfind("PID    PARENT USER") != std::string::npos
-			|| line.rfind("====== ======") != std::string::npos
-			|| line.size() <= 56)
-		{
+		DebugProcess process;
+		if (!ParseProcessListRow(line, process, process.m_processName))
 			continue;
-		}
+		indices[process.m_pid] = result.size();
+		result.push_back(process);
+	}
 
-		if (sscanf(line.c_str(), "%d", &pid) == 0)
+	std::istringstream argumentRows(InvokeBackendCommand("platform process list --show-args"));
+	while (getline(argumentRows, line, '\n'))
+	{
+		DebugProcess process;
+		std::string arguments;
+		if (!ParseProcessListRow(line, process, arguments))
 			continue;
-
-		// example output lines:
-		//	1268   944                                              csrss.exe
-		//  37635  9677   xusheng    arm64-apple-*                  Code Helper (Renderer)
-		//
-		// we've 56 bytes until process name which is calculated like this:
-		// (6 + 1) + (6 + 1) + (10 + 1) + (30 + 1)
-
-		std::string processName(std::next(line.begin(), 56), line.end());
-
-		debug_processes.emplace_back(pid, processName);
+		auto it = indices.find(process.m_pid);
+		if (it != indices.end())
+			result[it->second].m_commandLine = arguments;
 	}
 
-	return debug_processes;
+	return result;
 }
 
 
@@ -593,14 +613,79 @@ std::vector<DebugFrame> LldbAdapter::GetFramesOfThread(uint32_t tid)
 
 DebugBreakpoint LldbAdapter::AddBreakpoint(const std::uintptr_t address, unsigned long breakpoint_type)
 {
+	if (breakpoint_type != SoftwareBreakpoint)
+	{
+		if (!AddHardwareBreakpoint(DebugHardwareBreakpoint(address, (DebugBreakpointType)breakpoint_type, 1)))
+			return DebugBreakpoint {};
+		return DebugBreakpoint(address);
+	}
+
 	SBBreakpoint bp = m_target.BreakpointCreateByAddress(address);
 	if (!bp.IsValid())
 		return DebugBreakpoint {};
 
+	// Record it right away rather than waiting for the breakpoint-added event, so an immediate removal (e.g., the
+	// temporary breakpoints used by run-to) can find it.
+	AddBreakpointLocations(bp);
 	return DebugBreakpoint(address, bp.GetID(), bp.IsEnabled());
 }
 
 
+void LldbAdapter::AddBreakpointLocations(SBBreakpoint& bp)
+{
+	// Hardware breakpoints are tracked in m_hardwareBreakpoints, so removing a software breakpoint at the same address
+	// does not remove them
+	if (bp.IsHardware())
+		return;
+
+	std::unique_lock<std::mutex> lock(m_breakpointIdsMutex);
+	for (size_t i = 0; i < bp.GetNumLocations(); i++)
+	{
+		uint64_t address = bp.GetLocationAtIndex(i).GetAddress().GetLoadAddress(m_target);
+		if (address == LLDB_INVALID_ADDRESS)
+			continue;
+
+		bool found = false;
+		auto range = m_breakpointIds.equal_range(address);
+		for (auto it = range.first; it != range.second; it++)
+		{
+			if (it->second == bp.GetID())
+			{
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+		{
+			m_breakpointIds.emplace(address, bp.GetID());
+			m_breakpointAddresses[bp.GetID()].push_back(address);
+		}
+	}
+}
+
+
+void LldbAdapter::RemoveBreakpointLocations(lldb::break_id_t id)
+{
+	std::unique_lock<std::mutex> lock(m_breakpointIdsMutex);
+	auto addresses = m_breakpointAddresses.find(id);
+	if (addresses == m_breakpointAddresses.end())
+		return;
+
+	for (uint64_t address : addresses->second)
+	{
+		auto range = m_breakpointIds.equal_range(address);
+		for (auto it = range.first; it != range.second;)
+		{
+			if (it->second == id)
+				it = m_breakpointIds.erase(it);
+			else
+				it++;
+		}
+	}
+	m_breakpointAddresses.erase(addresses);
+}
+
+
 DebugBreakpoint LldbAdapter::AddBreakpoint(const ModuleNameAndOffset& address, unsigned long breakpoint_type)
 {
 	if (!m_targetActive)
@@ -632,9 +717,34 @@ bool LldbAdapter::RemoveBreakpoint(const DebugBreakpoint& breakpoint)
 	// Only the address is valid. We cannot use the .m_id info.
 	bool ok = false;
 	uint64_t address = breakpoint.m_address;
+
+	std::vector<lldb::break_id_t> ids;
+	{
+		std::unique_lock<std::mutex> lock(m_breakpointIdsMutex);
+		auto range = m_breakpointIds.equal_range(address);
+		for (auto it = range.first; it != range.second; it++)
+			ids.push_back(it->second);
+	}
+
+	if (!ids.empty())
+	{
+		for (auto id : ids)
+		{
+			ok |= m_target.BreakpointDelete(id);
+			// A breakpoint can have more than one location, this drops all of them
+			RemoveBreakpointLocations(id);
+		}
+		return ok;
+	}
+
+	// The map is populated from the breakpoint events, which may not have been processed yet. Fall back to searching
+	// all breakpoint locations.
 	for (size_t i = 0; i < m_target.GetNumBreakpoints(); i++)
 	{
 		auto bp = m_target.GetBreakpointAtIndex(i);
+		if (bp.IsHardware() || IsTemporaryBreakpoint(bp.GetID()) || IsCoverageBreakpoint(bp.GetID()))
+			continue;
+
 		for (size_t j = 0; j < bp.GetNumLocations(); j++)
 		{
 			auto location = bp.GetLocationAtIndex(j);
@@ -669,6 +779,446 @@ std::vector<DebugBreakpoint> LldbAdapter::GetBreakpointList() const
 }
 
 
+bool LldbAdapter::AddTemporaryBreakpoint(std::uintptr_t address)
+{
+	// Hold the lock while creating the breakpoint, so the listener cannot see its added event before it is known to
+	// be temporary
+	std::unique_lock<std::mutex> lock(m_breakpointIdsMutex);
+	SBBreakpoint bp = m_target.BreakpointCreateByAddress(address);
+	if (!bp.IsValid())
+		return false;
+
+	// LLDB deletes a one-shot breakpoint when it is hit, the rest are deleted by RemoveTemporaryBreakpoints()
+	bp.SetOneShot(true);
+	m_temporaryBreakpoints[bp.GetID()] = address;
+	return true;
+}
+
+
+void LldbAdapter::RemoveTemporaryBreakpoints()
+{
+	std::unordered_map<lldb::break_id_t, uint64_t> breakpoints;
+	{
+		std::unique_lock<std::mutex> lock(m_breakpointIdsMutex);
+		if (m_temporaryBreakpoints.empty())
+			return;
+		breakpoints.swap(m_temporaryBreakpoints);
+	}
+
+	for (const auto& [id, address] : breakpoints)
+		m_target.BreakpointDelete(id);
+}
+
+
+bool LldbAdapter::StartCoverage(const std::vector<uint64_t>& addresses)
+{
+	if (m_process.GetState() != lldb::eStateStopped)
+		return false;
+
+	StopCoverage();
+
+	// The target is stopped, so no callback can run before all breakpoints are created. Holding the lock keeps the
+	// listener from reporting the added events.
+	std::unique_lock<std::mutex> lock(m_coverageMutex);
+	m_coverageAddresses = addresses;
+	m_coverageHits.assign(addresses.size(), false);
+	m_coverageBreakpointIds.reserve(addresses.size());
+	for (uint64_t address : addresses)
+	{
+		SBBreakpoint bp = m_target.BreakpointCreateByAddress(address);
+		if (!bp.IsValid())
+			continue;
+
+		bp.SetCallback(CoverageBreakpointHit, this);
+		m_coverageBreakpointIds.insert(bp.GetID());
+	}
+	return true;
+}
+
+
+bool LldbAdapter::CoverageBreakpointHit(
+	void* baton, SBProcess& process, SBThread& thread, SBBreakpointLocation& location)
+{
+	auto adapter = static_cast<LldbAdapter*>(baton);
+	uint64_t address = location.GetLoadAddress();
+	{
+		std::unique_lock<std::mutex> lock(adapter->m_coverageMutex);
+		auto it = std::lower_bound(adapter->m_coverageAddresses.begin(), adapter->m_coverageAddresses.end(), address);
+		if ((it != adapter->m_coverageAddresses.end()) && (*it == address))
+			adapter->m_coverageHits[it - adapter->m_coverageAddresses.begin()] = true;
+	}
+
+	// Only the first hit matters. Disabling the location takes the trap out of the target, so the block runs at full
+	// speed from now on.
+	location.SetEnabled(false);
+	// Never stop the target
+	return false;
+}
+
+
+std::vector<bool> LldbAdapter::GetCoverage()
+{
+	std::unique_lock<std::mutex> lock(m_coverageMutex);
+	return m_coverageHits;
+}
+
+
+void LldbAdapter::StopCoverage()
+{
+	std::unordered_set<lldb::break_id_t> ids;
+	{
+		std::unique_lock<std::mutex> lock(m_coverageMutex);
+		ids.swap(m_coverageBreakpointIds);
+		m_coverageAddresses.clear();
+		m_coverageHits.clear();
+	}
+
+	for (lldb::break_id_t id : ids)
+		m_target.BreakpointDelete(id);
+}
+
+
+bool LldbAdapter::IsCoverageBreakpoint(lldb::break_id_t id)
+{
+	std::unique_lock<std::mutex> lock(m_coverageMutex);
+	return m_coverageBreakpointIds.find(id) != m_coverageBreakpointIds.end();
+}
+
+
+bool LldbAdapter::IsTemporaryBreakpoint(lldb::break_id_t id)
+{
+	std::unique_lock<std::mutex> lock(m_breakpointIdsMutex);
+	return m_temporaryBreakpoints.find(id) != m_temporaryBreakpoints.end();
+}
+
+
+bool LldbAdapter::IsAtTemporaryBreakpoint(uint64_t address)
+{
+	std::unique_lock<std::mutex> lock(m_breakpointIdsMutex);
+	for (const auto& [id, bpAddress] : m_temporaryBreakpoints)
+	{
+		if (bpAddress == address)
+			return true;
+	}
+	return false;
+}
+
+
+bool LldbAdapter::AddHardwareBreakpoint(const DebugHardwareBreakpoint& breakpoint)
+{
+	int32_t id = 0;
+	if (breakpoint.IsWatchpoint())
+	{
+		bool read = (breakpoint.m_type == HardwareReadWatchpoint) || (breakpoint.m_type == HardwareAccessWatchpoint);
+		bool write = (breakpoint.m_type == HardwareWriteWatchpoint) || (breakpoint.m_type == HardwareAccessWatchpoint);
+		SBError error;
+		SBWatchpoint wp = m_target.WatchAddress(breakpoint.m_address, breakpoint.m_size, read, write, error);
+		if (!wp.IsValid() || error.Fail())
+		{
+			LogWarn("Failed to add watchpoint at 0x%" PRIx64 ": %s", (uint64_t)breakpoint.m_address,
+				error.GetCString() ? error.GetCString() : "unknown error");
+			return false;
+		}
+		id = wp.GetID();
+	}
+	else
+	{
+		// The SB API has no way to request a hardware breakpoint, so go through the command that does. The new
+		// breakpoint gets the largest ID, i.e., it is the last one in the target.
+		SBCommandInterpreter interpreter = m_debugger.GetCommandInterpreter();
+		SBCommandReturnObject commandResult;
+		{
+			std::unique_lock<std::mutex> lock(m_quitingMutex);
+			interpreter.HandleCommand(
+				fmt::format("breakpoint set -H -a 0x{:x}", breakpoint.m_address).c_str(), commandResult);
+		}
+		size_t count = m_target.GetNumBreakpoints();
+		if (!commandResult.Succeeded() || (count == 0))
+		{
+			LogWarn("Failed to add hardware breakpoint at 0x%" PRIx64 ": %s", (uint64_t)breakpoint.m_address,
+				commandResult.GetError() ? commandResult.GetError() : "unknown error");
+			return false;
+		}
+		SBBreakpoint bp = m_target.GetBreakpointAtIndex(count - 1);
+		if (!bp.IsValid() || !bp.IsHardware())
+			return false;
+		id = bp.GetID();
+	}
+
+	std::unique_lock<std::mutex> lock(m_breakpointIdsMutex);
+	m_hardwareBreakpoints.emplace_back(breakpoint, id);
+	return true;
+}
+
+
+bool LldbAdapter::RemoveHardwareBreakpoint(const DebugHardwareBreakpoint& breakpoint)
+{
+	int32_t id = 0;
+	{
+		std::unique_lock<std::mutex> lock(m_breakpointIdsMutex);
+		auto it = std::find_if(m_hardwareBreakpoints.begin(), m_hardwareBreakpoints.end(),
+			[&](const std::pair<DebugHardwareBreakpoint, int32_t>& entry) { return entry.first == breakpoint; });
+		if (it == m_hardwareBreakpoints.end())
+			return false;
+
+		id = it->second;
+		m_hardwareBreakpoints.erase(it);
+	}
+
+	if (breakpoint.IsWatchpoint())
+		return m_target.DeleteWatchpoint(id);
+	return m_target.BreakpointDelete(id);
+}
+
+
+std::optional<uint32_t> LldbAdapter::GetPageProtection(uint64_t page)
+{
+	SBMemoryRegionInfo region;
+	SBError error = m_process.GetMemoryRegionInfo(page, region);
+	if (error.Fail() || !region.IsMapped())
+		return std::nullopt;
+
+	uint32_t protection = 0;
+	if (region.IsReadable())
+		protection |= SoftwareWatchpoints::ProtectionRead;
+	if (region.IsWritable())
+		protection |= SoftwareWatchpoints::ProtectionWrite;
+	if (region.IsExecutable())
+		protection |= SoftwareWatchpoints::ProtectionExecute;
+	return protection;
+}
+
+
+// How to make a system call on each architecture software watchpoints support, see SetPageProtection()
+struct SyscallStub
+{
+	std::vector<uint8_t> code;
+	const char* numberRegister;
+	std::vector<const char*> argumentRegisters;
+	const char* resultRegister;
+	// Registers the instruction changes, other than the result register
+	std::vector<const char*> clobberedRegisters;
+	uint64_t mprotect;
+};
+
+
+static const SyscallStub* GetSyscallStub(const std::string& triple)
+{
+	static const SyscallStub x86_64 = {{0x0f, 0x05}, "rax", {"rdi", "rsi", "rdx"}, "rax", {"rcx", "r11"}, 10};
+	static const SyscallStub x86 = {{0xcd, 0x80}, "eax", {"ebx", "ecx", "edx"}, "eax", {}, 125};
+	static const SyscallStub aarch64 = {{0x01, 0x00, 0x00, 0xd4}, "x8", {"x0", "x1", "x2"}, "x0", {}, 226};
+
+	if (triple.rfind("x86_64", 0) == 0)
+		return &x86_64;
+	if ((triple.rfind("i386", 0) == 0) || (triple.rfind("i686", 0) == 0))
+		return &x86;
+	if ((triple.rfind("aarch64", 0) == 0) || (triple.rfind("arm64", 0) == 0))
+		return &aarch64;
+	return nullptr;
+}
+
+
+// Calls mprotect() in the target by writing a system call instruction over the current one, and stepping it. This
+// needs no expression to be compiled, so it is cheap enough to do on every access to a watched page.
+bool LldbAdapter::SetPageProtection(uint64_t page, uint64_t size, uint32_t protection)
+{
+	const char* triple = m_target.GetTriple();
+	const SyscallStub* stub = GetSyscallStub(triple ? triple : "");
+	SBThread thread = m_process.GetSelectedThread();
+	SBFrame frame = thread.GetFrameAtIndex(0);
+	if (!stub || !frame.IsValid())
+		return false;
+
+	uint64_t pc = frame.GetPC();
+	std::vector<uint8_t> original(stub->code.size());
+	SBError error;
+	if (m_process.ReadMemory(pc, original.data(), original.size(), error) != original.size())
+		return false;
+
+	std::vector<const char*> saved = stub->clobberedRegisters;
+	saved.push_back(stub->numberRegister);
+	saved.insert(saved.end(), stub->argumentRegisters.begin(), stub->argumentRegisters.end());
+	std::vector<std::pair<const char*, uint64_t>> registers;
+	for (const char* name : saved)
+	{
+		SBValue value = frame.FindRegister(name);
+		if (!value.IsValid())
+			return false;
+		registers.emplace_back(name, value.GetValueAsUnsigned());
+	}
+
+	bool ok = m_process.WriteMemory(pc, stub->code.data(), stub->code.size(), error) == stub->code.size();
+	uint64_t arguments[] = {page, size, protection};
+	ok = ok && WriteRegister(stub->numberRegister, stub->mprotect);
+	for (size_t i = 0; ok && (i < stub->argumentRegisters.size()); i++)
+		ok = WriteRegister(stub->argumentRegisters[i], arguments[i]);
+
+	if (ok)
+	{
+		// In synchronous mode, LLDB hijacks the process events until the step is done, so the event listener never
+		// sees this step
+		m_debugger.SetAsync(false);
+		thread.StepInstruction(false, error);
+		m_debugger.SetAsync(true);
+
+		SBFrame after = thread.GetFrameAtIndex(0);
+		ok = error.Success() && after.IsValid() && (after.GetPC() == pc + stub->code.size())
+			&& (after.FindRegister(stub->resultRegister).GetValueAsUnsigned(1) == 0);
+	}
+
+	m_process.WriteMemory(pc, original.data(), original.size(), error);
+	for (const auto& [name, value] : registers)
+		WriteRegister(name, value);
+	WriteRegister("pc", pc);
+
+	if (!ok)
+		LogWarn("Failed to change the protection of page 0x%" PRIx64 " to %u", page, protection);
+	return ok;
+}
+
+
+bool LldbAdapter::AddSoftwareWatchpoint(const SoftwareWatchpoint& watchpoint)
+{
+	const char* triple = m_target.GetTriple();
+	if (!triple || (std::string(triple).find("linux") == std::string::npos))
+	{
+		LogWarn("Software watchpoints are only supported on Linux");
+		return false;
+	}
+
+	if (!GetSyscallStub(triple))
+	{
+		LogWarn("Software watchpoints are not supported on %s", triple);
+		return false;
+	}
+
+	if (m_process.GetState() != lldb::eStateStopped)
+	{
+		LogWarn("Software watchpoints can only be changed while the target is stopped");
+		return false;
+	}
+
+	std::unique_lock<std::mutex> lock(m_softwareWatchpointsMutex);
+	if (!m_pageSizeKnown)
+	{
+		SBFrame frame = m_process.GetSelectedThread().GetFrameAtIndex(0);
+		SBValue result = frame.EvaluateExpression("((int (*)(void))getpagesize)()");
+		if (result.IsValid() && result.GetError().Success())
+			m_softwareWatchpoints.SetPageSize(result.GetValueAsUnsigned(0x1000));
+		m_pageSizeKnown = true;
+	}
+
+	return m_softwareWatchpoints.Add(
+		watchpoint, [&](uint64_t page) { return GetPageProtection(page); },
+		[&](uint64_t page, uint64_t size, uint32_t protection) { return SetPageProtection(page, size, protection); });
+}
+
+
+bool LldbAdapter::RemoveSoftwareWatchpoint(const SoftwareWatchpoint& watchpoint)
+{
+	if (m_process.GetState() != lldb::eStateStopped)
+	{
+		LogWarn("Software watchpoints can only be changed while the target is stopped");
+		return false;
+	}
+
+	std::unique_lock<std::mutex> lock(m_softwareWatchpointsMutex);
+	return m_softwareWatchpoints.Remove(watchpoint,
+		[&](uint64_t page, uint64_t size, uint32_t protection) { return SetPageProtection(page, size, protection); });
+}
+
+
+std::vector<SoftwareWatchpoint> LldbAdapter::GetSoftwareWatchpoints()
+{
+	std::unique_lock<std::mutex> lock(m_softwareWatchpointsMutex);
+	return m_softwareWatchpoints.GetWatchpoints();
+}
+
+
+bool LldbAdapter::HandleSoftwareWatchpointStop(DebugStopReason& reason)
+{
+	std::unique_lock<std::mutex> lock(m_softwareWatchpointsMutex);
+	if (m_softwareWatchpoints.IsEmpty() && !m_softwareWatchpoints.IsStepping())
+		return false;
+
+	auto setProtection = [&](uint64_t page, uint64_t size, uint32_t protection) {
+		return SetPageProtection(page, size, protection);
+	};
+	SBUnixSignals signals = m_process.GetUnixSignals();
+	int32_t segv = signals.GetSignalNumberFromName("SIGSEGV");
+
+	if (m_softwareWatchpoints.IsStepping())
+	{
+		// We just stepped over an access to a protected page
+		signals.SetShouldSuppress(segv, m_segvWasSuppressed);
+		if (m_softwareWatchpoints.FinishStep(setProtection))
+		{
+			reason = DebugStopReason::Watchpoint;
+			return false;
+		}
+
+		// The access missed the watched ranges. Resume, unless the user was stepping or something else (e.g., a
+		// breakpoint on the next instruction) stopped the target.
+		if ((reason == DebugStopReason::SingleStep) && (m_userStep == UserStep::None))
+		{
+			// The stop was never reported, so neither is the resume
+			m_suppressResumeEvent = true;
+			if (m_process.Continue().Success())
+				return true;
+			m_suppressResumeEvent = false;
+		}
+		return false;
+	}
+
+	if (reason != DebugStopReason::SignalSegv)
+		return false;
+
+	// Only a fault on a page that is mapped, but lacks the permission (SEGV_ACCERR), can come from a watchpoint
+	static constexpr uint64_t SegvAccessError = 2;
+	SBThread thread = m_process.GetSelectedThread();
+	SBValue siginfo = thread.GetSiginfo();
+	if (!siginfo.IsValid() || (siginfo.GetChildMemberWithName("si_code").GetValueAsUnsigned() != SegvAccessError))
+		return false;
+
+	SBValue fault = siginfo.GetChildMemberWithName("_sifields").GetChildMemberWithName("_sigfault");
+	SBValue faultAddress = fault.GetChildMemberWithName("si_addr");
+	if (!faultAddress.IsValid())
+		return false;
+
+	// Re-execute the faulting instruction with the page unprotected. The SIGSEGV must not reach the target, and
+	// changing the protection already resumes the thread, so it is suppressed first.
+	m_segvWasSuppressed = signals.GetShouldSuppress(segv);
+	signals.SetShouldSuppress(segv, true);
+	if (!m_softwareWatchpoints.BeginStep(faultAddress.GetValueAsUnsigned(), setProtection))
+	{
+		signals.SetShouldSuppress(segv, m_segvWasSuppressed);
+		return false;
+	}
+
+	SBError error;
+	thread.StepInstruction(false, error);
+	if (error.Fail())
+	{
+		signals.SetShouldSuppress(segv, m_segvWasSuppressed);
+		m_softwareWatchpoints.FinishStep(setProtection);
+		return false;
+	}
+	return true;
+}
+
+
+void LldbAdapter::ForgetHardwareBreakpoint(int32_t id, bool watchpoint)
+{
+	std::unique_lock<std::mutex> lock(m_breakpointIdsMutex);
+	auto it = std::find_if(m_hardwareBreakpoints.begin(), m_hardwareBreakpoints.end(),
+		[&](const std::pair<DebugHardwareBreakpoint, int32_t>& entry) {
+			return (entry.second == id) && (entry.first.IsWatchpoint() == watchpoint);
+		});
+	if (it != m_hardwareBreakpoints.end())
+		m_hardwareBreakpoints.erase(it);
+}
+
+
 std::unordered_map<std::string, DebugRegister> LldbAdapter::ReadAllRegisters()
 {
 	std::unordered_map<std::string, DebugRegister> result;
@@ -1028,6 +1578,10 @@ DebugStopReason LldbAdapter::StopReason()
 			{
 				reason = DebugStopReason::Breakpoint;
 			}
+			else if (threadReason == lldb::eStopReasonWatchpoint)
+			{
+				reason = DebugStopReason::Watchpoint;
+			}
 			else if (threadReason == lldb::eStopReasonSignal)
 			{
 				size_t dataCount = thread.GetStopReasonDataCount();
@@ -1089,9 +1643,9 @@ bool LldbAdapter::BreakInto()
 		return false;
 	}
 
-	//	Since we are in Sync mode, if we call m_process.Stop(), it will hang
-	m_process.SendAsyncInterrupt();
-	return true;
+	// In async mode, this returns once the interrupt is sent, and the event listener reports the stop
+	SBError error = m_process.Stop();
+	return error.Success();
 }
 
 
@@ -1107,6 +1661,8 @@ bool LldbAdapter::Go()
 		return false;
 	}
 
+	m_userStep = UserStep::None;
+
 #ifndef WIN32
 	SBError error = m_process.Continue();
 	if (!error.Success())
@@ -1130,6 +1686,8 @@ bool LldbAdapter::StepInto()
 		return false;
 	}
 
+	BeginUserStep(UserStep::Into);
+
 #ifndef WIN32
 	SBThread thread = m_process.GetSelectedThread();
 	if (!thread.IsValid())
@@ -1161,6 +1719,120 @@ bool LldbAdapter::StepInto()
 }
 
 
+bool LldbAdapter::StepInstructions(uint64_t count, const std::function<bool(uint64_t)>& stopPredicate)
+{
+#ifndef WIN32
+	if (count == 0)
+		return false;
+
+	SBThread thread = m_process.GetSelectedThread();
+	SBFrame frame = thread.GetFrameAtIndex(0);
+	if (!frame.IsValid())
+		return false;
+
+	// StepInto() records the stepping thread and the address
+	m_instructionStepPredicate = stopPredicate;
+	m_instructionStepsLeft = count;
+	if (!StepInto())
+	{
+		m_instructionStepsLeft = 0;
+		m_instructionStepPredicate = nullptr;
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+bool LldbAdapter::IsInstructionStepComplete(SBThread& thread)
+{
+	if (!thread.IsValid())
+		return false;
+
+	switch (thread.GetStopReason())
+	{
+	case lldb::eStopReasonPlanComplete:
+	case lldb::eStopReasonTrace:
+		return true;
+	// On macOS, the end of a step is reported as a breakpoint. A step has moved the thread, while a breakpoint that is
+	// hit before the instruction runs has not.
+	case lldb::eStopReasonBreakpoint:
+		return thread.GetFrameAtIndex(0).GetPC() != m_instructionStepAddress;
+	// A signal, an exception, a watchpoint, or another thread that stopped
+	default:
+		return false;
+	}
+}
+
+
+void LldbAdapter::BeginUserStep(UserStep step)
+{
+	SBThread thread = m_process.GetSelectedThread();
+	SBFrame frame = thread.GetFrameAtIndex(0);
+	m_instructionStepThread = thread.GetThreadID();
+	m_instructionStepAddress = frame.IsValid() ? frame.GetPC() : 0;
+	m_userStepFrame = frame.IsValid() ? frame.GetCFA() : 0;
+	m_userStep = step;
+}
+
+
+bool LldbAdapter::IsUserStepComplete()
+{
+	UserStep step = m_userStep;
+	if (step == UserStep::None)
+		return false;
+
+	SBThread thread = m_process.GetThreadByID(m_instructionStepThread);
+	if (!IsInstructionStepComplete(thread))
+		return false;
+
+	// A breakpoint inside a call that is stepped over or out of has moved the thread as well, but it stops in a deeper
+	// frame. A step over ends in the frame it started in, and a step return in the caller, whose frame is higher up.
+	if ((thread.GetStopReason() != lldb::eStopReasonBreakpoint) || (step == UserStep::Into))
+		return true;
+
+	uint64_t frame = thread.GetFrameAtIndex(0).GetCFA();
+	if (step == UserStep::Over)
+		return frame == m_userStepFrame;
+	return frame > m_userStepFrame;
+}
+
+
+bool LldbAdapter::ContinueInstructionSteps(DebugStopReason& reason)
+{
+	if (m_instructionStepsLeft == 0)
+		return false;
+
+	// The stop reason alone cannot tell the end of a step from a breakpoint, so the stepping thread is checked. A step
+	// that ends on a breakpoint has not hit it yet, so the sequence goes on.
+	SBThread thread = m_process.GetThreadByID(m_instructionStepThread);
+	bool complete = IsInstructionStepComplete(thread);
+	if (complete)
+		reason = DebugStopReason::SingleStep;
+
+	bool done = !complete || (--m_instructionStepsLeft == 0)
+		|| (m_instructionStepPredicate && m_instructionStepPredicate(thread.GetFrameAtIndex(0).GetPC()));
+	if (!done)
+	{
+		SBError error;
+		m_suppressResumeEvent = true;
+		m_instructionStepAddress = thread.GetFrameAtIndex(0).GetPC();
+		thread.StepInstruction(false, error);
+		if (error.Success())
+			return true;
+
+		m_suppressResumeEvent = false;
+		LogWarn("Failed to step the target: %s", error.GetCString() ? error.GetCString() : "");
+	}
+
+	m_instructionStepsLeft = 0;
+	m_instructionStepPredicate = nullptr;
+	return false;
+}
+
+
 bool LldbAdapter::StepOver()
 {
 	if (m_process.GetState() != lldb::eStateStopped)
@@ -1173,6 +1845,8 @@ bool LldbAdapter::StepOver()
 		return false;
 	}
 
+	BeginUserStep(UserStep::Over);
+
 #ifndef WIN32
 	SBThread thread = m_process.GetSelectedThread();
 	if (!thread.IsValid())
@@ -1216,6 +1890,8 @@ bool LldbAdapter::StepReturn()
 		return false;
 	}
 
+	BeginUserStep(UserStep::Return);
+
 	//	The following method, calling StepOutOfFrame(), will receive an unexpected lldb::eStateRunning event when the
 	//	operation failed, e.g., due to inability to place the breakpoint at the return address. This seems to be a LLDB
 	//	bug. For now, we just run the `finish` command instead.
@@ -1311,7 +1987,17 @@ uint64_t LldbAdapter::GetStackPointer()
 
 bool LldbAdapter::SupportFeature(DebugAdapterCapacity feature)
 {
-	return false;
+	switch (feature)
+	{
+#ifndef WIN32
+	case DebugAdapterSupportStepInstructions:
+		return true;
+#endif
+	case DebugAdapterSupportStepReturn:
+		return true;
+	default:
+		return false;
+	}
 }
 
 
@@ -1357,6 +2043,38 @@ void LldbAdapter::FixActiveThread()
 }
 
 
+void LldbAdapter::StartEventListener()
+{
+	// The listener of the last session has returned once its process exited or detached
+	StopEventListener();
+	m_debugger.GetListener().StartListeningForEvents(m_listenerControl, ListenerStopBit);
+	m_eventListenerThread = std::thread([this]() { EventListener(); });
+}
+
+
+void LldbAdapter::StopEventListener()
+{
+	if (!m_eventListenerThread.joinable())
+		return;
+
+	// The adapter is torn down from one of its own event callbacks
+	if (std::this_thread::get_id() == m_eventListenerThread.get_id())
+	{
+		m_eventListenerThread.detach();
+		return;
+	}
+
+	m_listenerControl.BroadcastEventByType(ListenerStopBit);
+	m_eventListenerThread.join();
+
+	// The listener may have returned before it got to the stop event, which must not end the next one
+	auto listener = m_debugger.GetListener();
+	SBEvent event;
+	while (listener.GetNextEventForBroadcaster(m_listenerControl, event))
+		;
+}
+
+
 void LldbAdapter::EventListener()
 {
 	auto listener = m_debugger.GetListener();
@@ -1364,9 +2082,20 @@ void LldbAdapter::EventListener()
 	bool done = false;
 	while (!done)
 	{
+		// Block until the next event. Only pending log point output needs a timeout, so it gets flushed while the
+		// target runs.
 		SBEvent event;
-		if (!listener.WaitForEvent(1, event))
+		uint32_t timeout = HasPendingBreakpointLog() ? 1 : UINT32_MAX;
+		if (!listener.WaitForEvent(timeout, event))
+		{
+			FlushBreakpointLog();
 			continue;
+		}
+
+		if (event.BroadcasterMatchesRef(m_listenerControl))
+			break;
+
+		FlushBreakpointLog();
 
 		uint32_t event_type = event.GetType();
 		if (lldb::SBProcess::EventIsProcessEvent(event))
@@ -1374,15 +2103,17 @@ void LldbAdapter::EventListener()
 			SBProcess process = lldb::SBProcess::GetProcessFromEvent(event);
 			if (event_type & lldb::SBProcess::eBroadcastBitStateChanged)
 			{
-				// This can solve the problem that if the user resumes/steps the target from the console,
-				// the UI is not updated. However, in order to receive the eBroadcastBitStateChanged notification,
-				// We need to turn on async mode, which requires other changes as well.
-
+				// This also covers the target being resumed or stepped from the console, so the UI follows along
 				StateType state = SBProcess::GetStateFromEvent(event);
 				switch (state)
 				{
 				case lldb::eStateRunning:
 				{
+					// The intermediate steps of StepInstructions(), and the resumes after stops that are handled right
+					// here, are not reported
+					if (m_suppressResumeEvent.exchange(false))
+						break;
+
 					DebuggerEvent dbgevt;
 					dbgevt.type = ResumeEventType;
 					PostDebuggerEvent(dbgevt);
@@ -1398,14 +2129,46 @@ void LldbAdapter::EventListener()
 				}
 				case lldb::eStateStopped:
 				{
+					// LLDB already resumed the target, e.g., because every breakpoint callback (such as those of
+					// coverage breakpoints) declined to stop. This is not a stop, so it must neither be reported, nor
+					// count as a breakpoint hit.
+					if (SBProcess::GetRestartedFromEvent(event))
+						break;
+
 					FixActiveThread();
-					DebuggerEvent dbgevt;
-					dbgevt.type = AdapterStoppedEventType;
 					// LLDB sometimes fails to update the process status when it is already sending eStateStopped event.
 					// When we restart the process, the target will appear to have exited
 					auto reason = StopReason();
 					if (reason == ProcessExited)
 						reason = UnknownReason;
+
+					// Faults on pages protected for software watchpoints are handled right here as well. Accesses
+					// that miss the watched ranges resume the target.
+					if (HandleSoftwareWatchpointStop(reason))
+						break;
+
+					// Breakpoint conditions, ignore counts and log points are handled right here, so these hits resume
+					// the target without the stop ever reaching the controller. A temporary breakpoint always stops.
+					// So does the end of a step: a step that lands on a breakpoint is reported as a breakpoint on some
+					// systems, and resuming the target would turn the step into a go.
+					if ((reason == DebugStopReason::Breakpoint) && (m_instructionStepsLeft == 0) && !IsUserStepComplete()
+						&& !IsAtTemporaryBreakpoint(GetInstructionOffset())
+						&& !ShouldStopAtBreakpoint(GetInstructionOffset()))
+					{
+						m_suppressResumeEvent = true;
+						if (m_process.Continue().Success())
+							break;
+						m_suppressResumeEvent = false;
+					}
+
+					if (ContinueInstructionSteps(reason))
+						break;
+
+					m_userStep = UserStep::None;
+					RemoveTemporaryBreakpoints();
+					FlushBreakpointLog(true);
+					DebuggerEvent dbgevt;
+					dbgevt.type = AdapterStoppedEventType;
 					dbgevt.data.targetStoppedData.reason = reason;
 					PostDebuggerEvent(dbgevt);
 					break;
@@ -1414,6 +2177,21 @@ void LldbAdapter::EventListener()
 				{
 					done = true;
 					m_targetActive = false;
+					m_instructionStepsLeft = 0;
+					m_userStep = UserStep::None;
+					FlushBreakpointLog(true);
+					{
+						// Load addresses are no longer meaningful once the process is gone
+						std::unique_lock<std::mutex> lock(m_breakpointIdsMutex);
+						m_breakpointIds.clear();
+						m_breakpointAddresses.clear();
+						m_hardwareBreakpoints.clear();
+						m_temporaryBreakpoints.clear();
+					}
+					{
+						std::unique_lock<std::mutex> lock(m_softwareWatchpointsMutex);
+						m_softwareWatchpoints.Clear();
+					}
 					DebuggerEvent dbgevt;
 					dbgevt.type = TargetExitedEventType;
 					dbgevt.data.exitData.exitCode = ExitCode();
@@ -1424,6 +2202,9 @@ void LldbAdapter::EventListener()
 				{
 					done = true;
 					m_targetActive = false;
+					m_instructionStepsLeft = 0;
+					m_userStep = UserStep::None;
+					FlushBreakpointLog(true);
 					DebuggerEvent dbgevt;
 					dbgevt.type = DetachedEventType;
 					PostDebuggerEvent(dbgevt);
@@ -1436,25 +2217,13 @@ void LldbAdapter::EventListener()
 			else if ((event_type & lldb::SBProcess::eBroadcastBitSTDOUT)
 				|| (event_type & lldb::SBProcess::eBroadcastBitSTDERR))
 			{
-				char buffer[1024];
+				// Straight into the output buffer of the controller, which batches the notifications
+				char buffer[0x10000];
 				size_t count = 0;
-				std::string output {};
-				// TODO: we should differentiate stdout and stderr
-				while ((count = process.GetSTDOUT(buffer, 1024)) > 0)
-					output += std::string(buffer, count);
-
-				DebuggerEvent event;
-				event.type = StdoutMessageEventType;
-				event.data.messageData.message = output;
-				PostDebuggerEvent(event);
-
-				output.clear();
-				while ((count = process.GetSTDERR(buffer, 1024)) > 0)
-					output += std::string(buffer, count);
-
-				event.type = StdoutMessageEventType;
-				event.data.messageData.message = output;
-				PostDebuggerEvent(event);
+				while ((count = process.GetSTDOUT(buffer, sizeof(buffer))) > 0)
+					PostTargetOutput(TargetStdoutChannel, buffer, count);
+				while ((count = process.GetSTDERR(buffer, sizeof(buffer))) > 0)
+					PostTargetOutput(TargetStderrChannel, buffer, count);
 			}
 		}
 		else if (lldb::SBTarget::EventIsTargetEvent(event))
@@ -1463,6 +2232,11 @@ void LldbAdapter::EventListener()
 			if (event_type & lldb::SBTarget::eBroadcastBitModulesLoaded)
 			{
 				[[maybe_unused]] size_t numModules = SBTarget::GetNumModulesFromEvent(event);
+				InvalidateBreakpointConditionAddresses();
+			}
+			else if (event_type & lldb::SBTarget::eBroadcastBitModulesUnloaded)
+			{
+				InvalidateBreakpointConditionAddresses();
 			}
 		}
 		else if (lldb::SBBreakpoint::EventIsBreakpointEvent(event))
@@ -1471,6 +2245,25 @@ void LldbAdapter::EventListener()
 			{
 				auto bpEventType = lldb::SBBreakpoint::GetBreakpointEventTypeFromEvent(event);
 				auto bp = lldb::SBBreakpoint::GetBreakpointFromEvent(event);
+				// Hardware breakpoints are not part of the software breakpoint list, so do not report them
+				if (bp.IsHardware())
+				{
+					if (bpEventType == lldb::eBreakpointEventTypeRemoved)
+						ForgetHardwareBreakpoint(bp.GetID(), false);
+					continue;
+				}
+
+				// Neither are temporary and coverage breakpoints
+				if (IsTemporaryBreakpoint(bp.GetID()) || IsCoverageBreakpoint(bp.GetID()))
+					continue;
+
+				if ((bpEventType == lldb::eBreakpointEventTypeAdded)
+					|| (bpEventType == lldb::eBreakpointEventTypeLocationsAdded)
+					|| (bpEventType == lldb::eBreakpointEventTypeLocationsResolved))
+					AddBreakpointLocations(bp);
+				else if (bpEventType == lldb::eBreakpointEventTypeRemoved)
+					RemoveBreakpointLocations(bp.GetID());
+
 				for (size_t i = 0; i < bp.GetNumLocations(); i++)
 				{
 					if (bpEventType == lldb::eBreakpointEventTypeAdded)
@@ -1540,7 +2333,13 @@ void LldbAdapter::EventListener()
 		}
 		else if (lldb::SBWatchpoint::EventIsWatchpointEvent(event))
 		{
-			LogDebug("watchpoint event");
+			// Keep track of watchpoints deleted from the console, so they can be added again
+			auto wpEventType = lldb::SBWatchpoint::GetWatchpointEventTypeFromEvent(event);
+			if (wpEventType == lldb::eWatchpointEventTypeRemoved)
+			{
+				auto wp = lldb::SBWatchpoint::GetWatchpointFromEvent(event);
+				ForgetHardwareBreakpoint(wp.GetID(), true);
+			}
 		}
 		else if (lldb::SBProcess::EventIsStructuredDataEvent(event))
 		{
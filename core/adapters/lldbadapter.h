@@ -14,8 +14,12 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <atomic>
+#include <thread>
+#include <unordered_set>
 #include "../debugadapter.h"
 #include "../debugadaptertype.h"
+#include "../softwarewatchpoints.h"
 #ifdef WIN32
 	#pragma warning(push)
 	#pragma warning(disable : 4251)
@@ -36,6 +40,84 @@ namespace BinaryNinjaDebugger {
 		bool m_targetActive;
 		std::vector<ModuleNameAndOffset> m_pendingBreakpoints {};
 
+		// Load address of every breakpoint location -> ID of the owning breakpoint. This is kept in sync from
+		// AddBreakpoint() and the breakpoint-changed events, so removing a breakpoint by address does not have to walk
+		// every location of every breakpoint in the target. It is accessed from both the event listener thread and
+		// the controller, hence the mutex.
+		std::unordered_multimap<uint64_t, lldb::break_id_t> m_breakpointIds;
+		// The reverse of m_breakpointIds, so the locations of a breakpoint can be dropped without a scan
+		std::unordered_map<lldb::break_id_t, std::vector<uint64_t>> m_breakpointAddresses;
+		std::mutex m_breakpointIdsMutex;
+		void AddBreakpointLocations(lldb::SBBreakpoint& bp);
+		void RemoveBreakpointLocations(lldb::break_id_t id);
+		// Hardware breakpoints and watchpoints added through AddHardwareBreakpoint(), along with the LLDB breakpoint
+		// or watchpoint ID. Guarded by m_breakpointIdsMutex.
+		std::vector<std::pair<DebugHardwareBreakpoint, int32_t>> m_hardwareBreakpoints;
+		void ForgetHardwareBreakpoint(int32_t id, bool watchpoint);
+		// ID -> address of the temporary breakpoints. Entries stay until RemoveTemporaryBreakpoints(), even after
+		// LLDB deletes a one-shot breakpoint that is hit, so the stop can still be attributed to it. Guarded by
+		// m_breakpointIdsMutex.
+		std::unordered_map<lldb::break_id_t, uint64_t> m_temporaryBreakpoints;
+		bool IsTemporaryBreakpoint(lldb::break_id_t id);
+		bool IsAtTemporaryBreakpoint(uint64_t address);
+
+		// Coverage mode, see StartCoverage(). The hits are recorded by a breakpoint callback, which runs on the LLDB
+		// private state thread. Guarded by m_coverageMutex.
+		std::vector<uint64_t> m_coverageAddresses;
+		std::vector<bool> m_coverageHits;
+		std::unordered_set<lldb::break_id_t> m_coverageBreakpointIds;
+		std::mutex m_coverageMutex;
+		static bool CoverageBreakpointHit(void* baton, lldb::SBProcess& process, lldb::SBThread& thread,
+			lldb::SBBreakpointLocation& location);
+		bool IsCoverageBreakpoint(lldb::break_id_t id);
+
+		// Page-protection based watchpoints, Linux only. The page protection is changed by making an mprotect system
+		// call in the target. Accessed from both the event listener thread and the controller, hence the mutex.
+		SoftwareWatchpoints m_softwareWatchpoints;
+		std::mutex m_softwareWatchpointsMutex;
+		bool m_pageSizeKnown = false;
+		// Whether SIGSEGV was suppressed before we started stepping over a fault on a watched page
+		bool m_segvWasSuppressed = false;
+		std::optional<uint32_t> GetPageProtection(uint64_t page);
+		bool SetPageProtection(uint64_t page, uint64_t size, uint32_t protection);
+		bool HandleSoftwareWatchpointStop(DebugStopReason& reason);
+
+		// Multi-instruction stepping, see StepInstructions(). The listener starts the next step on its own until the
+		// count runs out or the predicate accepts the new address, and only the last stop is reported.
+		std::atomic<uint64_t> m_instructionStepsLeft = 0;
+		std::function<bool(uint64_t)> m_instructionStepPredicate;
+		// The thread being stepped, and the address of the instruction it steps
+		lldb::tid_t m_instructionStepThread = LLDB_INVALID_THREAD_ID;
+		uint64_t m_instructionStepAddress = 0;
+		bool IsInstructionStepComplete(lldb::SBThread& thread);
+
+		// The step the user started, until a stop is reported. Only a stop of the stepping thread that completes the
+		// step is the end of it; a breakpoint hit on the way, e.g., inside a call that is stepped over, is handled like
+		// any other, and a fault that misses the watched ranges is reported rather than resuming the target.
+		enum class UserStep
+		{
+			None,
+			Into,
+			Over,
+			Return
+		};
+		std::atomic<UserStep> m_userStep = UserStep::None;
+		// The canonical frame address of the stepping thread when the step started
+		uint64_t m_userStepFrame = 0;
+		void BeginUserStep(UserStep step);
+		bool IsUserStepComplete();
+		// Set when the listener resumes the target on its own, e.g., for the next step, so that resume is not reported
+		// either
+		std::atomic_bool m_suppressResumeEvent = false;
+		bool ContinueInstructionSteps(DebugStopReason& reason);
+
+		// The thread that runs EventListener(). It blocks on the debugger's listener, and StopEventListener() wakes it
+		// up with an event on m_listenerControl, so it neither polls nor outlives the adapter.
+		std::thread m_eventListenerThread;
+		lldb::SBBroadcaster m_listenerControl {"binaryninja.debugger.listener-control"};
+		void StartEventListener();
+		void StopEventListener();
+
 		// Since when SBProcess::Kill() and SBProcess::ReadMemory() are called at the same time, LLDB will hang,
 		// we must use this mutex to prevent the quit operation and read memory operation to happen at the same time.
 		std::mutex m_quitingMutex;
@@ -90,6 +172,26 @@ namespace BinaryNinjaDebugger {
 
 		std::vector<DebugBreakpoint> GetBreakpointList() const override;
 
+		bool AddTemporaryBreakpoint(std::uintptr_t address) override;
+
+		void RemoveTemporaryBreakpoints() override;
+
+		bool StartCoverage(const std::vector<uint64_t>& addresses) override;
+
+		std::vector<bool> GetCoverage() override;
+
+		void StopCoverage() override;
+
+		bool AddHardwareBreakpoint(const DebugHardwareBreakpoint& breakpoint) override;
+
+		bool RemoveHardwareBreakpoint(const DebugHardwareBreakpoint& breakpoint) override;
+
+		bool AddSoftwareWatchpoint(const SoftwareWatchpoint& watchpoint) override;
+
+		bool RemoveSoftwareWatchpoint(const SoftwareWatchpoint& watchpoint) override;
+
+		std::vector<SoftwareWatchpoint> GetSoftwareWatchpoints() override;
+
 		std::unordered_map<std::string, DebugRegister> ReadAllRegisters() override;
 
 		DebugRegister ReadRegister(const std::string& reg) override;
@@ -114,6 +216,8 @@ namespace BinaryNinjaDebugger {
 
 		bool StepInto() override;
 
+		bool StepInstructions(uint64_t count, const std::function<bool(uint64_t)>& stopPredicate) override;
+
 		bool StepOver() override;
 
 		bool StepReturn() override;
@@ -143,6 +247,8 @@ namespace BinaryNinjaDebugger {
 		std::string m_processPlugin;
 
 		void ApplyBreakpoints();
+		// Applies debugger.followForkMode to the target.process.follow-fork-mode setting of LLDB
+		void ApplyFollowForkMode();
 	};
 
 	class LldbAdapterType : public DebugAdapterType
@@ -0,0 +1,3022 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <unordered_map>
+#include <dirent.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/personality.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+#if defined(__aarch64__)
+	// user_hwdebug_state. Must come after sys/ptrace.h, whose enum it would otherwise clash with.
+	#include <asm/ptrace.h>
+#endif
+#include "ptraceadapter.h"
+#include "../processlist.h"
+
+using namespace BinaryNinja;
+using namespace BinaryNinjaDebugger;
+
+namespace {
+	struct RegisterInfo
+	{
+		const char* name;
+		size_t offset;
+		size_t width;
+	};
+}  // namespace
+
+#if defined(__x86_64__)
+	#define GPR(name, field) {name, offsetof(user_regs_struct, field), 64}
+
+static const RegisterInfo TargetRegisters[] = {
+	GPR("rax", rax),
+	GPR("rbx", rbx),
+	GPR("rcx", rcx),
+	GPR("rdx", rdx),
+	GPR("rsi", rsi),
+	GPR("rdi", rdi),
+	GPR("rbp", rbp),
+	GPR("rsp", rsp),
+	GPR("r8", r8),
+	GPR("r9", r9),
+	GPR("r10", r10),
+	GPR("r11", r11),
+	GPR("r12", r12),
+	GPR("r13", r13),
+	GPR("r14", r14),
+	GPR("r15", r15),
+	GPR("rip", rip),
+	GPR("rflags", eflags),
+	GPR("cs", cs),
+	GPR("fs", fs),
+	GPR("gs", gs),
+	GPR("ss", ss),
+	GPR("ds", ds),
+	GPR("es", es),
+	GPR("fs_base", fs_base),
+	GPR("gs_base", gs_base),
+};
+
+static constexpr const char* ProgramCounterName = "rip";
+static constexpr const char* StackPointerName = "rsp";
+static constexpr const char* FramePointerName = "rbp";
+static constexpr const char* TargetArchitectureName = "x86_64";
+// int3
+static const uint8_t BreakpointInstruction[] = {0xcc};
+// The trap is reported with the pc right after the int3
+static constexpr uint64_t BreakpointPCOffset = 1;
+// A watchpoint stops the thread after the access
+static constexpr bool WatchpointStopsBeforeAccess = false;
+
+
+static bool WriteDebugRegister(pid_t tid, size_t index, uint64_t value)
+{
+	size_t offset = offsetof(struct user, u_debugreg) + index * sizeof(uint64_t);
+	return ptrace(PTRACE_POKEUSER, tid, (void*)offset, (void*)value) == 0;
+}
+
+
+// DR0-3 take the breakpoints in order, and DR7 enables them. x86 cannot watch reads alone, so a read watchpoint also
+// stops on writes.
+static bool SetDebugRegisters(pid_t tid, const std::vector<DebugHardwareBreakpoint>& breakpoints)
+{
+	if (breakpoints.size() > 4)
+		return false;
+
+	// Disabled first, since the kernel validates every change to an enabled breakpoint
+	if (!WriteDebugRegister(tid, 7, 0))
+		return false;
+
+	uint64_t dr7 = 0;
+	for (size_t i = 0; i < breakpoints.size(); i++)
+	{
+		const DebugHardwareBreakpoint& breakpoint = breakpoints[i];
+		if (!WriteDebugRegister(tid, i, breakpoint.m_address))
+			return false;
+
+		// R/W: 00 execution, 01 write, 11 read or write. LEN: 00 1 byte, 01 2 bytes, 11 4 bytes, 10 8 bytes.
+		uint64_t type = 0, length = 0;
+		if (breakpoint.m_type == HardwareWriteWatchpoint)
+			type = 1;
+		else if (breakpoint.IsWatchpoint())
+			type = 3;
+		if (breakpoint.IsWatchpoint())
+			length = (breakpoint.m_size == 8) ? 2 : (breakpoint.m_size == 4) ? 3 : (breakpoint.m_size == 2) ? 1 : 0;
+		dr7 |= (1ULL << (i * 2)) | (type << (16 + i * 4)) | (length << (18 + i * 4));
+	}
+	return (dr7 == 0) || WriteDebugRegister(tid, 7, dr7);
+}
+
+
+// DR6 tells which of DR0-3 triggered, whatever the code of the SIGTRAP, e.g., at the end of a step that also hit a
+// watchpoint
+static std::optional<size_t> GetTriggeredDebugRegister(
+	pid_t tid, const siginfo_t& info, const std::vector<DebugHardwareBreakpoint>& breakpoints)
+{
+	errno = 0;
+	size_t offset = offsetof(struct user, u_debugreg) + 6 * sizeof(uint64_t);
+	uint64_t dr6 = ptrace(PTRACE_PEEKUSER, tid, (void*)offset, nullptr);
+	if (errno != 0)
+		return std::nullopt;
+
+	for (size_t i = 0; i < breakpoints.size(); i++)
+	{
+		if (dr6 & (1ULL << i))
+		{
+			// The bits stay set until cleared
+			WriteDebugRegister(tid, 6, 0);
+			return i;
+		}
+	}
+	return std::nullopt;
+}
+#elif defined(__aarch64__)
+	#define GPR(name, field) {name, offsetof(user_regs_struct, field), 64}
+	#define XREG(n) {"x" #n, offsetof(user_regs_struct, regs) + (n) * 8, 64}
+
+static const RegisterInfo TargetRegisters[] = {
+	XREG(0),
+	XREG(1),
+	XREG(2),
+	XREG(3),
+	XREG(4),
+	XREG(5),
+	XREG(6),
+	XREG(7),
+	XREG(8),
+	XREG(9),
+	XREG(10),
+	XREG(11),
+	XREG(12),
+	XREG(13),
+	XREG(14),
+	XREG(15),
+	XREG(16),
+	XREG(17),
+	XREG(18),
+	XREG(19),
+	XREG(20),
+	XREG(21),
+	XREG(22),
+	XREG(23),
+	XREG(24),
+	XREG(25),
+	XREG(26),
+	XREG(27),
+	XREG(28),
+	{"fp", offsetof(user_regs_struct, regs) + 29 * 8, 64},
+	{"lr", offsetof(user_regs_struct, regs) + 30 * 8, 64},
+	GPR("sp", sp),
+	GPR("pc", pc),
+	{"cpsr", offsetof(user_regs_struct, pstate), 32},
+};
+
+static constexpr const char* ProgramCounterName = "pc";
+static constexpr const char* StackPointerName = "sp";
+static constexpr const char* FramePointerName = "fp";
+static constexpr const char* TargetArchitectureName = "aarch64";
+// brk #0
+static const uint8_t BreakpointInstruction[] = {0x00, 0x00, 0x20, 0xd4};
+// The trap is reported with the pc still on the brk
+static constexpr uint64_t BreakpointPCOffset = 0;
+// A watchpoint stops the thread before the access, on the instruction that makes it
+static constexpr bool WatchpointStopsBeforeAccess = true;
+
+
+// Writes one of the register sets, with the given address and control value for each slot in order. Fails when there
+// are more of them than the CPU has slots.
+static bool SetDebugRegisterSet(pid_t tid, int regset, const std::vector<std::pair<uint64_t, uint32_t>>& slots)
+{
+	user_hwdebug_state state {};
+	iovec iov {&state, sizeof(state)};
+	if (ptrace(PTRACE_GETREGSET, tid, (void*)(uintptr_t)regset, &iov) != 0)
+		return false;
+
+	// The low byte of dbg_info is the number of slots
+	size_t count = std::min<size_t>(state.dbg_info & 0xff, sizeof(state.dbg_regs) / sizeof(state.dbg_regs[0]));
+	if (slots.size() > count)
+		return false;
+
+	memset(state.dbg_regs, 0, sizeof(state.dbg_regs));
+	for (size_t i = 0; i < slots.size(); i++)
+	{
+		state.dbg_regs[i].addr = slots[i].first;
+		state.dbg_regs[i].ctrl = slots[i].second;
+	}
+	iov.iov_len = offsetof(user_hwdebug_state, dbg_regs) + count * sizeof(state.dbg_regs[0]);
+	return ptrace(PTRACE_SETREGSET, tid, (void*)(uintptr_t)regset, &iov) == 0;
+}
+
+
+// Breakpoints and watchpoints have their own slots, which take them in order. The control value enables the slot for
+// EL0, i.e., user mode (privilege 0b10), with the byte address select (BAS) marking the bytes to watch within an
+// aligned doubleword, or the whole instruction. Watchpoints also select loads (0b01), stores (0b10) or both.
+static bool SetDebugRegisters(pid_t tid, const std::vector<DebugHardwareBreakpoint>& breakpoints)
+{
+	std::vector<std::pair<uint64_t, uint32_t>> breakSlots, watchSlots;
+	for (const DebugHardwareBreakpoint& breakpoint : breakpoints)
+	{
+		if (!breakpoint.IsWatchpoint())
+		{
+			breakSlots.emplace_back(breakpoint.m_address, 1 | (2 << 1) | (0xf << 5));
+			continue;
+		}
+
+		uint32_t access = 3;
+		if (breakpoint.m_type == HardwareReadWatchpoint)
+			access = 1;
+		else if (breakpoint.m_type == HardwareWriteWatchpoint)
+			access = 2;
+		uint64_t address = breakpoint.m_address & ~(uint64_t)7;
+		uint32_t bytes = ((1 << breakpoint.m_size) - 1) << (breakpoint.m_address & 7);
+		watchSlots.emplace_back(address, 1 | (2 << 1) | (access << 3) | (bytes << 5));
+	}
+
+	return SetDebugRegisterSet(tid, NT_ARM_HW_BREAK, breakSlots)
+		&& SetDebugRegisterSet(tid, NT_ARM_HW_WATCH, watchSlots);
+}
+
+
+// The kernel puts the slot in si_errno: (slot << 1) + 1 for a breakpoint, and the negation of that for a watchpoint
+static std::optional<size_t> GetTriggeredDebugRegister(
+	pid_t tid, const siginfo_t& info, const std::vector<DebugHardwareBreakpoint>& breakpoints)
+{
+	if ((info.si_code != TRAP_HWBKPT) || (info.si_errno == 0))
+		return std::nullopt;
+
+	bool watchpoint = info.si_errno < 0;
+	size_t slot = ((watchpoint ? -info.si_errno : info.si_errno) - 1) >> 1;
+	for (size_t i = 0; i < breakpoints.size(); i++)
+	{
+		if (breakpoints[i].IsWatchpoint() != watchpoint)
+			continue;
+		if (slot == 0)
+			return i;
+		slot--;
+	}
+	return std::nullopt;
+}
+#else
+	#error "The ptrace adapter only supports x86_64 and aarch64"
+#endif
+
+static constexpr size_t BreakpointSize = sizeof(BreakpointInstruction);
+
+
+static const RegisterInfo* FindRegister(const std::string& name)
+{
+	for (const auto& info : TargetRegisters)
+	{
+		if (name == info.name)
+			return &info;
+	}
+	return nullptr;
+}
+
+
+static uint64_t GetRegisterValue(const user_regs_struct& regs, const RegisterInfo& info)
+{
+	uint64_t value = 0;
+	memcpy(&value, (const uint8_t*)&regs + info.offset, info.width / 8);
+	return value;
+}
+
+
+static void SetRegisterValue(user_regs_struct& regs, const RegisterInfo& info, uint64_t value)
+{
+	memcpy((uint8_t*)&regs + info.offset, &value, info.width / 8);
+}
+
+
+static DebugStopReason GetStopReasonFromSignal(int signal)
+{
+	static const std::unordered_map<int, DebugStopReason> signalLookup = {
+		{SIGHUP, DebugStopReason::SignalHup},
+		{SIGINT, DebugStopReason::SignalInt},
+		{SIGQUIT, DebugStopReason::SignalQuit},
+		{SIGILL, DebugStopReason::IllegalInstruction},
+		{SIGTRAP, DebugStopReason::SingleStep},
+		{SIGABRT, DebugStopReason::SignalAbrt},
+		{SIGFPE, DebugStopReason::SignalFpe},
+		{SIGKILL, DebugStopReason::SignalKill},
+		{SIGBUS, DebugStopReason::SignalBus},
+		{SIGSEGV, DebugStopReason::SignalSegv},
+		{SIGSYS, DebugStopReason::SignalSys},
+		{SIGPIPE, DebugStopReason::SignalPipe},
+		{SIGALRM, DebugStopReason::SignalAlrm},
+		{SIGTERM, DebugStopReason::SignalTerm},
+		{SIGURG, DebugStopReason::SignalUrg},
+		{SIGSTOP, DebugStopReason::SignalStop},
+		{SIGTSTP, DebugStopReason::SignalTstp},
+		{SIGCONT, DebugStopReason::SignalCont},
+		{SIGCHLD, DebugStopReason::SignalChld},
+		{SIGTTIN, DebugStopReason::SignalTtin},
+		{SIGTTOU, DebugStopReason::SignalTtou},
+		{SIGIO, DebugStopReason::SignalIo},
+		{SIGXCPU, DebugStopReason::SignalXcpu},
+		{SIGXFSZ, DebugStopReason::SignalXfsz},
+		{SIGVTALRM, DebugStopReason::SignalVtalrm},
+		{SIGPROF, DebugStopReason::SignalProf},
+		{SIGWINCH, DebugStopReason::SignalWinch},
+		{SIGUSR1, DebugStopReason::SignalUsr1},
+		{SIGUSR2, DebugStopReason::SignalUsr2},
+	};
+
+	auto it = signalLookup.find(signal);
+	if (it != signalLookup.end())
+		return it->second;
+
+	return DebugStopReason::UnknownReason;
+}
+
+
+// Signals that programs commonly use for their normal operation. They are passed to the target without a stop.
+static bool IsPassedSilently(int signal)
+{
+	switch (signal)
+	{
+	case SIGCHLD:
+	case SIGWINCH:
+	case SIGALRM:
+	case SIGVTALRM:
+	case SIGPROF:
+	case SIGURG:
+	case SIGIO:
+	case SIGCONT:
+		return true;
+	default:
+		// Real-time signals, including the ones glibc uses internally for threads
+		return signal >= 32;
+	}
+}
+
+
+// Splits a command line the way a shell would, minus the expansions
+static std::vector<std::string> SplitArguments(const std::string& args)
+{
+	std::vector<std::string> result;
+	std::string current;
+	bool inArgument = false;
+	char quote = 0;
+	for (size_t i = 0; i < args.size(); i++)
+	{
+		char c = args[i];
+		if (quote)
+		{
+			if (c == quote)
+				quote = 0;
+			else if ((c == '\\') && (quote == '"') && (i + 1 < args.size()))
+				current += args[++i];
+			else
+				current += c;
+		}
+		else if ((c == '"') || (c == '\''))
+		{
+			quote = c;
+			inArgument = true;
+		}
+		else if ((c == '\\') && (i + 1 < args.size()))
+		{
+			current += args[++i];
+			inArgument = true;
+		}
+		else if (isspace((unsigned char)c))
+		{
+			if (inArgument)
+				result.push_back(current);
+			current.clear();
+			inArgument = false;
+		}
+		else
+		{
+			current += c;
+			inArgument = true;
+		}
+	}
+	if (inArgument)
+		result.push_back(current);
+	return result;
+}
+
+
+static std::vector<pid_t> ListThreads(pid_t pid)
+{
+	std::vector<pid_t> result;
+	DIR* dir = opendir(fmt::format("/proc/{}/task", pid).c_str());
+	if (!dir)
+		return result;
+
+	while (dirent* entry = readdir(dir))
+	{
+		char* end = nullptr;
+		unsigned long tid = strtoul(entry->d_name, &end, 10);
+		if ((tid != 0) && end && (*end == '\0'))
+			result.push_back((pid_t)tid);
+	}
+	closedir(dir);
+	return result;
+}
+
+
+// Reads a field of /proc/<pid>/task/<tid>/status
+static std::string ReadThreadStatus(pid_t pid, pid_t tid, const std::string& field)
+{
+	std::ifstream status(fmt::format("/proc/{}/task/{}/status", pid, tid));
+	std::string line;
+	while (std::getline(status, line))
+	{
+		if (line.rfind(field + ":", 0) == 0)
+			return line.substr(field.size() + 1);
+	}
+	return "";
+}
+
+
+static bool IsSignalPending(pid_t pid, pid_t tid, int signal)
+{
+	uint64_t mask = 1ULL << (signal - 1);
+	for (const char* field : {"SigPnd", "ShdPnd"})
+	{
+		std::string value = ReadThreadStatus(pid, tid, field);
+		if (!value.empty() && (strtoull(value.c_str(), nullptr, 16) & mask))
+			return true;
+	}
+	return false;
+}
+
+
+static int WaitForThread(pid_t tid)
+{
+	int status = 0;
+	while (waitpid(tid, &status, __WALL) < 0)
+	{
+		if (errno != EINTR)
+			return -1;
+	}
+	return status;
+}
+
+
+PtraceAdapterType::PtraceAdapterType() : DebugAdapterType("PTRACE") {}
+
+
+DebugAdapter* PtraceAdapterType::Create(BinaryNinja::BinaryView* data)
+{
+	// TODO: someone should free this.
+	return new PtraceAdapter(data);
+}
+
+
+bool PtraceAdapterType::IsValidForData(BinaryNinja::BinaryView* data)
+{
+	auto name = data->GetTypeName();
+	return (name == "ELF") || (name == "Mapped") || (name == "Raw");
+}
+
+
+bool PtraceAdapterType::CanConnect(BinaryNinja::BinaryView* data)
+{
+	return false;
+}
+
+
+bool PtraceAdapterType::CanExecute(BinaryNinja::BinaryView* data)
+{
+	if (data->GetTypeName() != "ELF")
+		return false;
+
+	// The target runs natively, so it must be built for the host
+	auto arch = data->GetDefaultArchitecture();
+	return arch && (arch->GetName() == TargetArchitectureName);
+}
+
+
+void BinaryNinjaDebugger::InitPtraceAdapterType()
+{
+	static PtraceAdapterType ptraceType;
+	DebugAdapterType::Register(&ptraceType);
+}
+
+
+PtraceAdapter::PtraceAdapter(BinaryView* data) : DebugAdapter(data) {}
+
+
+PtraceAdapter::~PtraceAdapter()
+{
+	if (m_targetActive)
+		Quit();
+
+	if (m_tracer.joinable())
+	{
+		if (std::this_thread::get_id() == m_tracer.get_id())
+			m_tracer.detach();
+		else
+			m_tracer.join();
+	}
+
+	StopOutputThread();
+
+	{
+		std::unique_lock<std::mutex> lock(m_eventMutex);
+		m_eventThreadStopping = true;
+	}
+	m_eventCv.notify_all();
+	if (m_eventThread.joinable())
+	{
+		if (std::this_thread::get_id() == m_eventThread.get_id())
+			m_eventThread.detach();
+		else
+			m_eventThread.join();
+	}
+}
+
+
+bool PtraceAdapter::RunOnTracer(const std::function<void()>& work)
+{
+	if (std::this_thread::get_id() == m_tracerId.load())
+	{
+		work();
+		return true;
+	}
+
+	auto request = std::make_shared<TracerRequest>();
+	request->work = work;
+
+	std::unique_lock<std::mutex> lock(m_requestMutex);
+	if (!m_targetActive || m_running)
+		return false;
+
+	m_requests.push_back(request);
+	m_requestCv.notify_all();
+	m_requestCv.wait(lock, [&]() { return request->done || request->rejected; });
+	return request->done;
+}
+
+
+void PtraceAdapter::SetRunning(bool running)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_requestMutex);
+		m_running = running;
+		if (running)
+		{
+			// The requests that are still waiting cannot be served until the target stops again
+			for (auto& request : m_requests)
+				request->rejected = true;
+			m_requests.clear();
+		}
+	}
+	m_requestCv.notify_all();
+}
+
+
+void PtraceAdapter::SetTargetInactive()
+{
+	if (m_memoryFd >= 0)
+	{
+		close(m_memoryFd);
+		m_memoryFd = -1;
+	}
+	{
+		std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+		for (const auto& [pid, inferior] : m_otherInferiors)
+		{
+			if (inferior.memoryFd >= 0)
+				close(inferior.memoryFd);
+		}
+		m_otherInferiors.clear();
+	}
+	if (m_stdinFd >= 0)
+	{
+		close(m_stdinFd);
+		m_stdinFd = -1;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(m_requestMutex);
+		m_targetActive = false;
+		m_running = false;
+		for (auto& request : m_requests)
+			request->rejected = true;
+		m_requests.clear();
+	}
+	m_requestCv.notify_all();
+}
+
+
+void PtraceAdapter::TracerLoop()
+{
+	while (m_targetActive)
+	{
+		if (m_running)
+		{
+			WaitForTargetEvent();
+			continue;
+		}
+
+		std::shared_ptr<TracerRequest> request;
+		{
+			std::unique_lock<std::mutex> lock(m_requestMutex);
+			m_requestCv.wait(lock, [this]() { return !m_requests.empty() || m_running || !m_targetActive; });
+			if (m_requests.empty())
+				continue;
+
+			request = m_requests.front();
+			m_requests.pop_front();
+		}
+
+		request->work();
+		{
+			std::unique_lock<std::mutex> lock(m_requestMutex);
+			request->done = true;
+		}
+		m_requestCv.notify_all();
+	}
+}
+
+
+void PtraceAdapter::QueueEvent(const DebuggerEvent& event)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_eventMutex);
+		m_events.push_back(event);
+	}
+	m_eventCv.notify_one();
+}
+
+
+void PtraceAdapter::StartEventThread()
+{
+	if (m_eventThread.joinable())
+		return;
+
+	m_eventThread = std::thread([this]() { EventLoop(); });
+}
+
+
+void PtraceAdapter::EventLoop()
+{
+	while (true)
+	{
+		DebuggerEvent event;
+		{
+			std::unique_lock<std::mutex> lock(m_eventMutex);
+			// Wake up regularly to send the output of log points
+			m_eventCv.wait_for(lock, std::chrono::milliseconds(100),
+				[this]() { return m_eventThreadStopping || !m_events.empty(); });
+			if (m_events.empty())
+			{
+				if (m_eventThreadStopping)
+					return;
+
+				lock.unlock();
+				FlushBreakpointLog();
+				continue;
+			}
+
+			event = std::move(m_events.front());
+			m_events.pop_front();
+		}
+
+		if ((event.type == AdapterStoppedEventType) || (event.type == TargetExitedEventType)
+			|| (event.type == DetachedEventType))
+			FlushBreakpointLog(true);
+
+		PostDebuggerEvent(event);
+	}
+}
+
+
+void PtraceAdapter::StartOutputThread(int outputFd, int stderrFd)
+{
+	m_outputThreadStopping = false;
+	m_outputThread = std::thread([this, outputFd, stderrFd]() {
+		char buffer[0x10000];
+		pollfd pfds[2] = {{outputFd, POLLIN, 0}, {stderrFd, POLLIN, 0}};
+		const TargetOutputChannel channels[2] = {TargetStdoutChannel, TargetStderrChannel};
+		while (!m_outputThreadStopping && ((pfds[0].fd >= 0) || (pfds[1].fd >= 0)))
+		{
+			// The pipes stay open as long as any process inherited them, so we cannot count on the end of file to stop
+			int ready = poll(pfds, 2, 100);
+			if ((ready < 0) && (errno != EINTR))
+				break;
+			if (ready <= 0)
+				continue;
+
+			for (size_t i = 0; i < 2; i++)
+			{
+				if ((pfds[i].fd < 0) || (pfds[i].revents == 0))
+					continue;
+
+				ssize_t size = read(pfds[i].fd, buffer, sizeof(buffer));
+				if ((size < 0) && (errno == EINTR))
+					continue;
+				if (size <= 0)
+				{
+					// A negative fd is skipped by poll()
+					close(pfds[i].fd);
+					pfds[i].fd = -1;
+					continue;
+				}
+
+				PostTargetOutput(channels[i], buffer, size);
+			}
+		}
+		for (const auto& pfd : pfds)
+		{
+			if (pfd.fd >= 0)
+				close(pfd.fd);
+		}
+	});
+}
+
+
+void PtraceAdapter::StopOutputThread()
+{
+	m_outputThreadStopping = true;
+	if (m_outputThread.joinable())
+		m_outputThread.join();
+}
+
+
+bool PtraceAdapter::Execute(const std::string& path, const LaunchConfigurations& configs)
+{
+	return ExecuteWithArgs(path, "", "", configs);
+}
+
+
+bool PtraceAdapter::ExecuteWithArgs(const std::string& path, const std::string& args, const std::string& workingDir,
+	const LaunchConfigurations& configs)
+{
+	if (m_targetActive)
+	{
+		LogWarn("The ptrace adapter is already debugging a process");
+		return false;
+	}
+
+	// The tracer of the last target has returned once the target was gone
+	if (m_tracer.joinable())
+		m_tracer.join();
+	StopOutputThread();
+	StartEventThread();
+
+	std::vector<std::string> arguments = SplitArguments(args);
+	arguments.insert(arguments.begin(), path);
+
+	m_stopAtEntry = Settings::Instance()->Get<bool>("debugger.stopAtEntryPoint") && m_hasEntryFunction;
+	bool stopAtSystemEntry = Settings::Instance()->Get<bool>("debugger.stopAtSystemEntryPoint");
+
+	std::promise<bool> launched;
+	std::string error;
+	m_tracer = std::thread([&, stopAtSystemEntry, this]() {
+		m_tracerId = std::this_thread::get_id();
+		bool ok = Launch(path, arguments, workingDir, error);
+		// The locals of ExecuteWithArgs() are gone after this
+		launched.set_value(ok);
+		if (!ok)
+			return;
+
+		pid_t pid = m_pid;
+		if (stopAtSystemEntry)
+			ReportStop(pid, UnknownReason);
+		else
+			ResumeTarget(false, true);
+		TracerLoop();
+	});
+
+	if (!launched.get_future().get())
+	{
+		m_tracer.join();
+		DebuggerEvent event;
+		event.type = LaunchFailureEventType;
+		event.data.errorData.shortError = "Failed to launch the target.";
+		event.data.errorData.error = error;
+		PostDebuggerEvent(event);
+		return false;
+	}
+	return true;
+}
+
+
+bool PtraceAdapter::Launch(const std::string& path, const std::vector<std::string>& args,
+	const std::string& workingDir, std::string& error)
+{
+	std::vector<char*> argv;
+	for (const auto& arg : args)
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	argv.push_back(nullptr);
+
+	int stdinPipe[2] = {-1, -1};
+	int outputPipe[2] = {-1, -1};
+	int stderrPipe[2] = {-1, -1};
+	// The child writes errno here when it fails to start the program
+	int errorPipe[2] = {-1, -1};
+	auto closePipes = [&]() {
+		for (int fd : {stdinPipe[0], stdinPipe[1], outputPipe[0], outputPipe[1], stderrPipe[0], stderrPipe[1],
+				 errorPipe[0], errorPipe[1]})
+		{
+			if (fd >= 0)
+				close(fd);
+		}
+	};
+
+	if ((pipe2(stdinPipe, O_CLOEXEC) != 0) || (pipe2(outputPipe, O_CLOEXEC) != 0)
+		|| (pipe2(stderrPipe, O_CLOEXEC) != 0) || (pipe2(errorPipe, O_CLOEXEC) != 0))
+	{
+		error = fmt::format("Failed to create the pipes for the target: {}", strerror(errno));
+		closePipes();
+		return false;
+	}
+
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		// Only async-signal-safe calls from here on
+		dup2(stdinPipe[0], STDIN_FILENO);
+		dup2(outputPipe[1], STDOUT_FILENO);
+		dup2(stderrPipe[1], STDERR_FILENO);
+		// Keep Ctrl+C in the terminal Binary Ninja runs in from reaching the target
+		setpgid(0, 0);
+		// ASLR is disabled like LLDB does, so the addresses are the same across runs
+		if ((workingDir.empty() || (chdir(workingDir.c_str()) == 0))
+			&& (personality(personality(0xffffffff) | ADDR_NO_RANDOMIZE) != -1)
+			&& (ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) == 0))
+			execv(path.c_str(), argv.data());
+
+		int err = errno;
+		if (write(errorPipe[1], &err, sizeof(err)) < 0)
+			_exit(127);
+		_exit(127);
+	}
+
+	if (pid < 0)
+	{
+		error = fmt::format("Failed to fork: {}", strerror(errno));
+		closePipes();
+		return false;
+	}
+
+	close(stdinPipe[0]);
+	close(outputPipe[1]);
+	close(stderrPipe[1]);
+	close(errorPipe[1]);
+	stdinPipe[0] = outputPipe[1] = stderrPipe[1] = errorPipe[1] = -1;
+
+	// The child stops with a SIGTRAP once execv() succeeds
+	int status = WaitForThread(pid);
+	if ((status < 0) || !WIFSTOPPED(status))
+	{
+		int childErrno = 0;
+		if (read(errorPipe[0], &childErrno, sizeof(childErrno)) == sizeof(childErrno))
+			error = fmt::format("Failed to execute \"{}\": {}", path, strerror(childErrno));
+		else
+			error = fmt::format("\"{}\" exited before it started", path);
+		closePipes();
+		return false;
+	}
+	close(errorPipe[0]);
+
+	// The target is killed if Binary Ninja exits without detaching from it. Forks are traced whatever the follow fork
+	// mode is, since a child that is let go must not keep our breakpoints.
+	ptrace(PTRACE_SETOPTIONS, pid, nullptr,
+		(void*)(uintptr_t)(PTRACE_O_TRACECLONE | PTRACE_O_TRACEEXEC | PTRACE_O_TRACEFORK | PTRACE_O_TRACEVFORK
+			| PTRACE_O_TRACEVFORKDONE | PTRACE_O_EXITKILL));
+
+	m_pid = pid;
+	m_threads.clear();
+	m_threads[pid].stopped = true;
+	m_stdinFd = stdinPipe[1];
+	StartOutputThread(outputPipe[0], stderrPipe[0]);
+	PrepareTarget();
+	AddEntryBreakpoint();
+	return true;
+}
+
+
+bool PtraceAdapter::Attach(std::uint32_t pid)
+{
+	if (m_targetActive)
+	{
+		LogWarn("The ptrace adapter is already debugging a process");
+		return false;
+	}
+
+	if (m_tracer.joinable())
+		m_tracer.join();
+	StopOutputThread();
+	StartEventThread();
+	m_stopAtEntry = false;
+
+	std::promise<bool> attached;
+	std::string error;
+	m_tracer = std::thread([&, this]() {
+		m_tracerId = std::this_thread::get_id();
+		bool ok = AttachToProcess(pid, error);
+		attached.set_value(ok);
+		if (!ok)
+			return;
+
+		ReportStop(m_pid, SignalStop);
+		TracerLoop();
+	});
+
+	if (!attached.get_future().get())
+	{
+		m_tracer.join();
+		DebuggerEvent event;
+		event.type = LaunchFailureEventType;
+		event.data.errorData.shortError = "Failed to attach to the process.";
+		event.data.errorData.error = error;
+		PostDebuggerEvent(event);
+		return false;
+	}
+	return true;
+}
+
+
+bool PtraceAdapter::AttachToProcess(pid_t pid, std::string& error)
+{
+	m_threads.clear();
+	if (ptrace(PTRACE_ATTACH, pid, nullptr, nullptr) != 0)
+	{
+		error = fmt::format("Failed to attach to process {}: {}", pid, strerror(errno));
+		if (errno == EPERM)
+			error += ". Check /proc/sys/kernel/yama/ptrace_scope, or run Binary Ninja with the CAP_SYS_PTRACE capability.";
+		return false;
+	}
+
+	// Threads can be created while we attach, so look again until there are no new ones
+	std::vector<pid_t> attaching = {pid};
+	while (!attaching.empty())
+	{
+		for (pid_t tid : attaching)
+		{
+			if ((tid != pid) && (ptrace(PTRACE_ATTACH, tid, nullptr, nullptr) != 0))
+				// The thread has exited
+				continue;
+
+			int status = WaitForThread(tid);
+			if ((status < 0) || !WIFSTOPPED(status))
+				continue;
+
+			ThreadState& thread = m_threads[tid];
+			thread.stopped = true;
+			if (WSTOPSIG(status) != SIGSTOP)
+			{
+				// It stopped for another reason first, and our SIGSTOP is still pending
+				thread.expectingStop = true;
+				if (WSTOPSIG(status) != SIGTRAP)
+					thread.pendingSignal = WSTOPSIG(status);
+			}
+			ptrace(PTRACE_SETOPTIONS, tid, nullptr,
+				(void*)(uintptr_t)(PTRACE_O_TRACECLONE | PTRACE_O_TRACEEXEC | PTRACE_O_TRACEFORK | PTRACE_O_TRACEVFORK
+					| PTRACE_O_TRACEVFORKDONE));
+		}
+
+		attaching.clear();
+		for (pid_t tid : ListThreads(pid))
+		{
+			if (m_threads.find(tid) == m_threads.end())
+				attaching.push_back(tid);
+		}
+	}
+
+	if (m_threads.find(pid) == m_threads.end())
+	{
+		error = fmt::format("Process {} exited while we attached to it", pid);
+		return false;
+	}
+
+	m_pid = pid;
+	PrepareTarget();
+	return true;
+}
+
+
+void PtraceAdapter::PrepareTarget()
+{
+	m_memoryFd = open(fmt::format("/proc/{}/mem", m_pid).c_str(), O_RDWR | O_CLOEXEC);
+	m_activeThread = m_pid;
+	m_steppingThread = 0;
+	m_instructionStepsLeft = 0;
+	m_stepOverAddress = 0;
+	m_exitCode = 0;
+	m_lastStopReason = UnknownReason;
+	m_breakRequested = false;
+	m_detachRequested = false;
+
+	std::string followForkMode = Settings::Instance()->Get<std::string>("debugger.followForkMode");
+	if (followForkMode == "child")
+		m_followForkMode = FollowChild;
+	else if (followForkMode == "both")
+		m_followForkMode = FollowBoth;
+	else
+		m_followForkMode = FollowParent;
+
+	{
+		std::unique_lock<std::mutex> lock(m_requestMutex);
+		m_targetActive = true;
+		m_running = false;
+	}
+
+	// The breakpoints added before the target is created are inserted now
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	m_vforkChildren = 0;
+	InsertPendingBreakpoints();
+}
+
+
+void PtraceAdapter::AddEntryBreakpoint()
+{
+	// The entry point of the program, as opposed to the one of the dynamic loader
+	std::ifstream auxv(fmt::format("/proc/{}/auxv", m_pid), std::ios::binary);
+	uint64_t entry[2];
+	while (auxv.read((char*)entry, sizeof(entry)))
+	{
+		if (entry[0] == AT_NULL)
+			break;
+
+		if (entry[0] == AT_ENTRY)
+		{
+			std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+			SoftwareBreakpoint& breakpoint = GetOrCreateBreakpoint(entry[1]);
+			breakpoint.entry = true;
+			InsertBreakpoint(entry[1], breakpoint);
+			return;
+		}
+	}
+}
+
+
+bool PtraceAdapter::Connect(const std::string& server, std::uint32_t port)
+{
+	LogWarn("The ptrace adapter can only debug local processes");
+	return false;
+}
+
+
+bool PtraceAdapter::Detach()
+{
+	if (!m_targetActive)
+		return false;
+
+	if (m_running)
+	{
+		// The target is detached from once it stops
+		m_detachRequested = true;
+		if (BreakInto())
+			return true;
+	}
+
+	return RunOnTracer([this]() { DetachFromTarget(); }) || !m_targetActive;
+}
+
+
+bool PtraceAdapter::Quit()
+{
+	if (!m_targetActive)
+		return false;
+
+	if (m_running)
+		return KillAllInferiors();
+
+	// The exit is reported once the tracer waits for the target again
+	return RunOnTracer([this]() {
+		KillAllInferiors();
+		SetRunning(true);
+	}) || !m_targetActive;
+}
+
+
+void PtraceAdapter::WaitForTargetEvent()
+{
+	// Peek first, the event is only consumed once we know whose it is. __WNOTHREAD limits the wait to the children and
+	// tracees of the tracer thread, so the other children of this process are neither seen nor reaped.
+	siginfo_t info {};
+	if (waitid(P_ALL, 0, &info, WEXITED | WSTOPPED | __WALL | __WNOTHREAD | WNOWAIT) != 0)
+	{
+		if (errno == EINTR)
+			return;
+
+		// No traced thread is left, in any of the processes, so the session is over
+		SetTargetInactive();
+		HandleProcessExit(m_exitCode);
+		return;
+	}
+
+	pid_t tid = info.si_pid;
+	pid_t owner = GetInferiorOf(tid);
+	if (owner == 0)
+	{
+		// A forked child can report its first stop before the fork event of its parent. Its stop is left pending for
+		// HandleFork(), and our threads are checked one by one until the parent reports the fork, which follows
+		// right away.
+		std::vector<pid_t> threads;
+		for (const auto& [threadId, thread] : m_threads)
+			threads.push_back(threadId);
+		for (const auto& [pid, inferior] : m_otherInferiors)
+		{
+			for (const auto& [threadId, thread] : inferior.threads)
+				threads.push_back(threadId);
+		}
+
+		for (pid_t threadId : threads)
+		{
+			info = {};
+			if ((waitid(P_PID, threadId, &info, WEXITED | WSTOPPED | __WALL | __WNOTHREAD | WNOHANG) == 0)
+				&& (info.si_pid != 0))
+			{
+				tid = threadId;
+				owner = GetInferiorOf(tid);
+				break;
+			}
+		}
+		if (owner == 0)
+		{
+			usleep(1000);
+			return;
+		}
+	}
+	else if (waitid(P_PID, tid, &info, WEXITED | WSTOPPED | __WALL | __WNOTHREAD) != 0)
+	{
+		return;
+	}
+
+	if (owner != m_pid)
+	{
+		if (m_otherInferiors[owner].detachAfterVfork)
+		{
+			FinishVforkParent(owner, tid, info);
+			return;
+		}
+
+		// The event is handled, and possibly reported, on the process it happened in
+		SwitchToInferior(owner, true);
+	}
+
+	switch (info.si_code)
+	{
+	case CLD_EXITED:
+	case CLD_KILLED:
+	case CLD_DUMPED:
+		HandleThreadExit(tid, info.si_status);
+		break;
+	case CLD_TRAPPED:
+	case CLD_STOPPED:
+		// For ptrace stops, the event is in the bits above the signal
+		HandleThreadStop(tid, info.si_status & 0xff, (info.si_status >> 8) & 0xff);
+		break;
+	default:
+		break;
+	}
+}
+
+
+void PtraceAdapter::DispatchWaitStatus(pid_t tid, int status)
+{
+	if (status < 0)
+		HandleThreadExit(tid, 0);
+	else if (WIFEXITED(status))
+		HandleThreadExit(tid, WEXITSTATUS(status));
+	else if (WIFSIGNALED(status))
+		HandleThreadExit(tid, WTERMSIG(status));
+	else if (WIFSTOPPED(status))
+		HandleThreadStop(tid, WSTOPSIG(status), (status >> 16) & 0xff);
+}
+
+
+void PtraceAdapter::HandleThreadExit(pid_t tid, uint64_t exitCode)
+{
+	auto it = m_threads.find(tid);
+	if ((it != m_threads.end()) && it->second.vforkChildRunning)
+	{
+		// No PTRACE_EVENT_VFORK_DONE is coming for it
+		std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+		if (m_vforkChildren > 0)
+			m_vforkChildren--;
+	}
+	m_threads.erase(tid);
+	if (tid == m_pid)
+	{
+		// The thread group leader is only reported once all the other threads are gone
+		HandleProcessExit(exitCode);
+		return;
+	}
+
+	if (m_activeThread == (uint32_t)tid)
+		m_activeThread = m_pid;
+
+	if (tid == m_steppingThread)
+	{
+		// The thread exited in the middle of a step, and the others are still stopped
+		m_steppingThread = 0;
+		ReportStop(m_pid, UnknownReason);
+	}
+}
+
+
+void PtraceAdapter::HandleProcessExit(uint64_t exitCode)
+{
+	if (!m_otherInferiors.empty())
+	{
+		// The session goes on with the other processes
+		pid_t exited = m_pid;
+		bool stepping = (m_steppingThread != 0) || (m_stepOverAddress != 0);
+		m_threads.clear();
+		SwitchToInferior(m_otherInferiors.begin()->first, false);
+		m_steppingThread = 0;
+		m_instructionStepsLeft = 0;
+		m_stepPredicate = nullptr;
+		PostBackendMessage(
+			fmt::format("Process {} exited with code {}, switched to process {}\n", exited, exitCode, m_pid));
+
+		// A step in the process that is gone cannot end, so the process we are left with stops instead
+		if (stepping)
+		{
+			StopOtherThreads(0);
+			ReportStop(m_pid, UnknownReason);
+		}
+		return;
+	}
+
+	m_exitCode = exitCode;
+	m_lastStopReason = ProcessExited;
+	m_threads.clear();
+	m_hardwareBreakpoints.clear();
+	m_steppingThread = 0;
+	m_instructionStepsLeft = 0;
+	m_stepPredicate = nullptr;
+	{
+		// Addresses are no longer meaningful once the process is gone
+		std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+		m_breakpoints.clear();
+		m_relativeBreakpoints.clear();
+	}
+	SetTargetInactive();
+
+	DebuggerEvent event;
+	event.type = TargetExitedEventType;
+	event.data.exitData.exitCode = exitCode;
+	QueueEvent(event);
+}
+
+
+void PtraceAdapter::HandleThreadStop(pid_t tid, int signal, int event)
+{
+	auto it = m_threads.find(tid);
+	if (it == m_threads.end())
+	{
+		// A new thread, whose first stop arrived before the clone event of its parent
+		m_threads[tid];
+		if (signal == SIGSTOP)
+		{
+			ContinueThread(tid, 0);
+			return;
+		}
+		it = m_threads.find(tid);
+	}
+
+	ThreadState& thread = it->second;
+	thread.stopped = true;
+
+	switch (event)
+	{
+	case 0:
+		break;
+	case PTRACE_EVENT_CLONE:
+		HandleClone(tid);
+		ContinueThread(tid, 0);
+		return;
+	case PTRACE_EVENT_EXEC:
+		HandleExec();
+		return;
+	case PTRACE_EVENT_FORK:
+	case PTRACE_EVENT_VFORK:
+		HandleFork(tid, event == PTRACE_EVENT_VFORK, true);
+		return;
+	case PTRACE_EVENT_VFORK_DONE:
+		HandleVforkDone(tid);
+		ContinueThread(tid, 0);
+		return;
+	default:
+		ContinueThread(tid, 0);
+		return;
+	}
+
+	if (signal == SIGTRAP)
+	{
+		HandleTrap(tid);
+		return;
+	}
+
+	if (signal == SIGSTOP)
+	{
+		bool expected = thread.expectingStop;
+		thread.expectingStop = false;
+		if (m_breakRequested.exchange(false))
+		{
+			// Any SIGSTOP will do, since they are not queued
+			auto breakThread = m_threads.find(m_breakThread);
+			if ((breakThread != m_threads.end()) && (breakThread->first != tid))
+				breakThread->second.expectingStop = true;
+			ReportStop(tid, UserRequestedBreak);
+			return;
+		}
+
+		if (expected)
+		{
+			ContinueThread(tid, 0);
+			return;
+		}
+	}
+
+	if (IsPassedSilently(signal))
+	{
+		ContinueThread(tid, signal);
+		return;
+	}
+
+	// The signal is delivered when the target resumes
+	thread.pendingSignal = signal;
+	ReportStop(tid, GetStopReasonFromSignal(signal));
+}
+
+
+void PtraceAdapter::HandleClone(pid_t tid)
+{
+	unsigned long newThread = 0;
+	if (ptrace(PTRACE_GETEVENTMSG, tid, nullptr, &newThread) != 0)
+		return;
+
+	// Unless its first stop is already seen, the new thread starts with a SIGSTOP that must be discarded
+	if (m_threads.find((pid_t)newThread) == m_threads.end())
+		m_threads[(pid_t)newThread].expectingStop = true;
+}
+
+
+void PtraceAdapter::HandleExec()
+{
+	// The new program replaced the old one along with its breakpoints, and the other threads are gone. The thread
+	// that called execve() now has the id of the process.
+	for (auto it = m_threads.begin(); it != m_threads.end();)
+	{
+		if (it->first == m_pid)
+			it++;
+		else
+			it = m_threads.erase(it);
+	}
+	m_threads[m_pid].stopped = true;
+	// exec() clears the debug registers
+	m_threads[m_pid].debugRegistersSet = false;
+	m_activeThread = m_pid;
+	m_steppingThread = 0;
+	m_instructionStepsLeft = 0;
+	m_stepOverAddress = 0;
+
+	// The file refers to the memory of the old program
+	if (m_memoryFd >= 0)
+		close(m_memoryFd);
+	m_memoryFd = open(fmt::format("/proc/{}/mem", m_pid).c_str(), O_RDWR | O_CLOEXEC);
+
+	{
+		std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+		for (auto it = m_breakpoints.begin(); it != m_breakpoints.end();)
+		{
+			SoftwareBreakpoint& breakpoint = it->second;
+			breakpoint.inserted = false;
+			breakpoint.relative = false;
+			breakpoint.temporary = false;
+			breakpoint.entry = false;
+			if (breakpoint.IsWanted())
+				it++;
+			else
+				it = m_breakpoints.erase(it);
+		}
+		for (auto& [location, address] : m_relativeBreakpoints)
+			address = 0;
+		// A thread waiting for a vfork() child is gone along with the others
+		m_vforkChildren = 0;
+		InsertPendingBreakpoints();
+	}
+	AddEntryBreakpoint();
+	InvalidateBreakpointConditionAddresses();
+
+	ResumeTarget(false, false);
+}
+
+
+void PtraceAdapter::HandleFork(pid_t tid, bool vfork, bool resume)
+{
+	unsigned long childId = 0;
+	int status = -1;
+	if (ptrace(PTRACE_GETEVENTMSG, tid, nullptr, &childId) == 0)
+		// The child starts traced, with a SIGSTOP
+		status = WaitForThread((pid_t)childId);
+	if ((status < 0) || !WIFSTOPPED(status))
+	{
+		if (resume)
+			ContinueThread(tid, 0);
+		return;
+	}
+
+	pid_t child = (pid_t)childId;
+	// Following the child means leaving the parent, which cannot be done while the parent is being stopped
+	FollowForkMode mode = m_followForkMode;
+	if ((mode == FollowChild) && !resume)
+		mode = FollowParent;
+
+	if (mode == FollowParent)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+			if (vfork)
+			{
+				// The child runs in our memory until it calls exec() or exits, so it would hit our breakpoints. They
+				// are inserted again in HandleVforkDone().
+				for (auto& [address, breakpoint] : m_breakpoints)
+					RemoveBreakpointFromMemory(address, breakpoint);
+				m_threads[tid].vforkChildRunning = true;
+				m_vforkChildren++;
+			}
+			else
+			{
+				// The child got a copy of our memory, with the breakpoints in it
+				int memoryFd = open(fmt::format("/proc/{}/mem", child).c_str(), O_RDWR | O_CLOEXEC);
+				if (memoryFd >= 0)
+				{
+					for (const auto& [address, breakpoint] : m_breakpoints)
+					{
+						if (breakpoint.inserted && !RestoreOriginalBytes(memoryFd, address, breakpoint))
+							LogWarn("Failed to remove the breakpoint at 0x%" PRIx64 " from process %d", address, child);
+					}
+					close(memoryFd);
+				}
+			}
+		}
+		ptrace(PTRACE_DETACH, child, nullptr, nullptr);
+		if (resume)
+			ContinueThread(tid, 0);
+		return;
+	}
+
+	Inferior inferior;
+	inferior.pid = child;
+	inferior.memoryFd = open(fmt::format("/proc/{}/mem", child).c_str(), O_RDWR | O_CLOEXEC);
+	inferior.threads[child].stopped = (mode == FollowChild);
+	{
+		std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+		inferior.breakpoints = m_breakpoints;
+		inferior.relativeBreakpoints = m_relativeBreakpoints;
+		if ((mode == FollowBoth) && !vfork)
+		{
+			// The temporary and entry breakpoints are for what the parent is doing, so the child goes without them
+			for (auto it = inferior.breakpoints.begin(); it != inferior.breakpoints.end();)
+			{
+				auto current = it++;
+				current->second.temporary = false;
+				current->second.entry = false;
+				ReleaseBreakpoint(inferior, current);
+			}
+		}
+		m_otherInferiors[child] = std::move(inferior);
+	}
+
+	if (mode == FollowBoth)
+	{
+		ptrace(PTRACE_CONT, child, nullptr, nullptr);
+		PostBackendMessage(fmt::format("Process {} forked process {}, which is debugged as well\n", m_pid, child));
+		if (resume)
+			ContinueThread(tid, 0);
+		return;
+	}
+
+	// Follow the child, and let the parent go
+	pid_t parent = m_pid;
+	StopOtherThreads(tid);
+	if (vfork)
+	{
+		// The parent is blocked until the child calls exec() or exits, and our breakpoints stay in the memory they
+		// share until then
+		ContinueThread(tid, 0);
+		SwitchToInferior(child, true);
+		std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+		m_otherInferiors[parent].detachAfterVfork = true;
+	}
+	else
+	{
+		DetachFromInferior();
+		SwitchToInferior(child, false);
+	}
+	PostBackendMessage(fmt::format("Process {} forked, following the child process {}\n", parent, child));
+
+	// A single step over the system call ends in the child
+	if (m_steppingThread != 0)
+	{
+		ReportStop(child, SingleStep);
+		return;
+	}
+	ResumeTarget(false, false);
+}
+
+
+void PtraceAdapter::HandleVforkDone(pid_t tid)
+{
+	ThreadState& thread = m_threads[tid];
+	if (!thread.vforkChildRunning)
+		return;
+
+	// The child has called exec() or exited, so the memory is ours alone again
+	thread.vforkChildRunning = false;
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	if (m_vforkChildren > 0)
+		m_vforkChildren--;
+	InsertPendingBreakpoints();
+}
+
+
+void PtraceAdapter::FinishVforkParent(pid_t pid, pid_t tid, const siginfo_t& info)
+{
+	pid_t current = m_pid;
+	uint32_t activeThread = m_activeThread;
+	SwitchToInferior(pid, true);
+
+	// Usually PTRACE_EVENT_VFORK_DONE, but whatever the event is, the vfork() is over
+	if ((info.si_code == CLD_TRAPPED) || (info.si_code == CLD_STOPPED))
+	{
+		ThreadState& thread = m_threads[tid];
+		thread.stopped = true;
+		int signal = info.si_status & 0xff;
+		if ((signal == SIGSTOP) && thread.expectingStop)
+			thread.expectingStop = false;
+		else if (((info.si_status >> 8) & 0xff) == 0)
+			thread.pendingSignal = signal;
+	}
+	else
+	{
+		m_threads.erase(tid);
+	}
+
+	DetachFromInferior();
+	SwitchToInferior(current, false);
+	m_activeThread = activeThread;
+}
+
+
+void PtraceAdapter::HandleTrap(pid_t tid)
+{
+	siginfo_t info {};
+	ptrace(PTRACE_GETSIGINFO, tid, nullptr, &info);
+	bool stepping = (tid == m_steppingThread);
+	if (stepping)
+		m_steppingThread = 0;
+
+	// Checked first, since a step can end on a watchpoint as well
+	if (!m_hardwareBreakpoints.empty())
+	{
+		auto index = GetTriggeredHardwareBreakpoint(tid, info);
+		if (index.has_value())
+		{
+			bool watchpoint = m_hardwareBreakpoints[*index].IsWatchpoint();
+			m_threads[tid].stoppedByWatchpoint = watchpoint && WatchpointStopsBeforeAccess;
+			ReportStop(tid, watchpoint ? Watchpoint : Breakpoint);
+			return;
+		}
+	}
+
+	if ((info.si_code == SI_KERNEL) || (info.si_code == TRAP_BRKPT))
+	{
+		uint64_t address = GetThreadPC(tid) - BreakpointPCOffset;
+		if (IsAtBreakpoint(address))
+		{
+			if (BreakpointPCOffset != 0)
+				SetThreadPC(tid, address);
+			HandleBreakpointHit(tid, address);
+			return;
+		}
+
+		// A trap instruction that is part of the program
+		ReportStop(tid, Breakpoint);
+		return;
+	}
+
+	if (stepping || (info.si_code == TRAP_TRACE))
+	{
+		HandleStepDone(tid);
+		return;
+	}
+
+	// A SIGTRAP sent by another process
+	m_threads[tid].pendingSignal = SIGTRAP;
+	ReportStop(tid, UnknownReason);
+}
+
+
+void PtraceAdapter::HandleBreakpointHit(pid_t tid, uint64_t address)
+{
+	m_activeThread = tid;
+
+	bool user = false, temporary = false, entry = false;
+	{
+		std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+		auto it = m_breakpoints.find(address);
+		if (it != m_breakpoints.end())
+		{
+			user = it->second.user || it->second.relative;
+			temporary = it->second.temporary;
+			entry = it->second.entry;
+			if (entry)
+			{
+				it->second.entry = false;
+				ReleaseBreakpoint(it);
+				// Shared libraries are mapped by now
+				InsertPendingBreakpoints();
+			}
+		}
+	}
+	if (entry)
+		InvalidateBreakpointConditionAddresses();
+
+	if (temporary && (address == m_stepOverAddress))
+	{
+		// Returning from a recursive call to the same function does not end the step over
+		uint64_t sp = 0;
+		user_regs_struct regs {};
+		if (ReadRegisterSet(tid, &regs))
+			sp = GetRegisterValue(regs, *FindRegister(StackPointerName));
+		if (sp >= m_stepOverStackPointer)
+		{
+			ReportStop(tid, SingleStep);
+			return;
+		}
+		temporary = false;
+	}
+
+	if (temporary || (entry && m_stopAtEntry))
+	{
+		ReportStop(tid, Breakpoint);
+		return;
+	}
+
+	// Breakpoint conditions, ignore counts and log points are handled right here
+	if (!user || !ShouldStopAtBreakpoint(address))
+	{
+		ResumeTarget(false, false);
+		return;
+	}
+
+	ReportStop(tid, Breakpoint);
+}
+
+
+void PtraceAdapter::HandleStepDone(pid_t tid)
+{
+	if (m_instructionStepsLeft > 1)
+	{
+		m_instructionStepsLeft--;
+		if (!m_stepPredicate || !m_stepPredicate(GetThreadPC(tid)))
+		{
+			ResumeTarget(true, false);
+			return;
+		}
+	}
+
+	ReportStop(tid, SingleStep);
+}
+
+
+void PtraceAdapter::ReportStop(pid_t tid, DebugStopReason reason)
+{
+	m_steppingThread = 0;
+	m_instructionStepsLeft = 0;
+	m_stepPredicate = nullptr;
+	m_stepOverAddress = 0;
+	StopOtherThreads(tid);
+
+	if (m_breakRequested.exchange(false))
+	{
+		// The SIGSTOP sent by BreakInto() is still on its way
+		auto it = m_threads.find(m_breakThread);
+		if (it != m_threads.end())
+			it->second.expectingStop = true;
+	}
+
+	m_activeThread = tid;
+	m_lastStopReason = reason;
+	RemoveTemporaryBreakpoints();
+	{
+		std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+		InsertPendingBreakpoints();
+	}
+
+	if (m_detachRequested)
+	{
+		DetachFromTarget();
+		return;
+	}
+
+	SetRunning(false);
+	DebuggerEvent event;
+	event.type = AdapterStoppedEventType;
+	event.data.targetStoppedData.reason = reason;
+	event.data.targetStoppedData.lastActiveThread = tid;
+	QueueEvent(event);
+}
+
+
+void PtraceAdapter::StopOtherThreads(pid_t except)
+{
+	std::vector<pid_t> signalled;
+	for (const auto& [tid, thread] : m_threads)
+	{
+		if ((tid == except) || thread.stopped)
+			continue;
+
+		// If this fails, the thread is exiting, and its exit is handled later
+		if (syscall(SYS_tgkill, m_pid, tid, SIGSTOP) == 0)
+			signalled.push_back(tid);
+	}
+
+	for (pid_t tid : signalled)
+	{
+		int status = WaitForThread(tid);
+		if ((status < 0) || WIFEXITED(status) || WIFSIGNALED(status))
+		{
+			m_threads.erase(tid);
+			continue;
+		}
+
+		ThreadState& thread = m_threads[tid];
+		thread.stopped = true;
+		int signal = WSTOPSIG(status);
+		int event = (status >> 16) & 0xff;
+		if ((event == 0) && (signal == SIGSTOP))
+			continue;
+
+		// It stopped for another reason first, and our SIGSTOP is still pending
+		thread.expectingStop = true;
+		if (event == PTRACE_EVENT_CLONE)
+		{
+			HandleClone(tid);
+		}
+		else if ((event == PTRACE_EVENT_FORK) || (event == PTRACE_EVENT_VFORK))
+		{
+			HandleFork(tid, event == PTRACE_EVENT_VFORK, false);
+		}
+		else if (event == PTRACE_EVENT_VFORK_DONE)
+		{
+			HandleVforkDone(tid);
+		}
+		else if ((event == 0) && (signal == SIGTRAP))
+		{
+			// A breakpoint hit is discarded, but the thread is moved back onto the breakpoint, so it hits it again
+			// once it resumes
+			siginfo_t info {};
+			ptrace(PTRACE_GETSIGINFO, tid, nullptr, &info);
+			uint64_t address = GetThreadPC(tid) - BreakpointPCOffset;
+			if (((info.si_code == SI_KERNEL) || (info.si_code == TRAP_BRKPT)) && IsAtBreakpoint(address)
+				&& (BreakpointPCOffset != 0))
+				SetThreadPC(tid, address);
+		}
+		else if (event == 0)
+		{
+			thread.pendingSignal = signal;
+		}
+	}
+}
+
+
+void PtraceAdapter::DetachFromTarget()
+{
+	DetachFromInferior();
+	// The other processes of the session are running, so they are stopped first
+	while (!m_otherInferiors.empty())
+	{
+		SwitchToInferior(m_otherInferiors.begin()->first, false);
+		StopOtherThreads(0);
+		DetachFromInferior();
+	}
+	SetTargetInactive();
+
+	DebuggerEvent event;
+	event.type = DetachedEventType;
+	QueueEvent(event);
+}
+
+
+void PtraceAdapter::DetachFromInferior()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+		for (auto& [address, breakpoint] : m_breakpoints)
+			RemoveBreakpointFromMemory(address, breakpoint);
+		m_breakpoints.clear();
+		m_relativeBreakpoints.clear();
+	}
+
+	for (auto& [tid, thread] : m_threads)
+	{
+		// A SIGSTOP of ours that is still pending would stop the target once we are gone, so it is let through first
+		if (thread.expectingStop && IsSignalPending(m_pid, tid, SIGSTOP))
+		{
+			while (ptrace(PTRACE_CONT, tid, nullptr, nullptr) == 0)
+			{
+				int status = WaitForThread(tid);
+				if ((status < 0) || !WIFSTOPPED(status) || (WSTOPSIG(status) == SIGSTOP))
+					break;
+				if ((((status >> 16) & 0xff) == 0) && !IsPassedSilently(WSTOPSIG(status)))
+					thread.pendingSignal = WSTOPSIG(status);
+			}
+		}
+		// A hardware breakpoint left behind would kill the process with a SIGTRAP
+		if (!m_hardwareBreakpoints.empty())
+			WriteDebugRegisters(tid, false);
+		ptrace(PTRACE_DETACH, tid, nullptr, (void*)(uintptr_t)thread.pendingSignal);
+	}
+	m_threads.clear();
+
+	if (m_memoryFd >= 0)
+	{
+		close(m_memoryFd);
+		m_memoryFd = -1;
+	}
+}
+
+
+void PtraceAdapter::SwitchToInferior(pid_t pid, bool keepCurrent)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+		auto it = m_otherInferiors.find(pid);
+		if (it == m_otherInferiors.end())
+			return;
+
+		Inferior next = std::move(it->second);
+		m_otherInferiors.erase(it);
+		if (keepCurrent)
+		{
+			Inferior& current = m_otherInferiors[m_pid];
+			current.pid = m_pid;
+			current.memoryFd = m_memoryFd;
+			current.threads = std::move(m_threads);
+			current.breakpoints = std::move(m_breakpoints);
+			current.relativeBreakpoints = std::move(m_relativeBreakpoints);
+		}
+		else if (m_memoryFd >= 0)
+		{
+			close(m_memoryFd);
+		}
+
+		m_pid = next.pid;
+		m_memoryFd = next.memoryFd;
+		m_threads = std::move(next.threads);
+		m_breakpoints = std::move(next.breakpoints);
+		m_relativeBreakpoints = std::move(next.relativeBreakpoints);
+		m_activeThread = m_pid;
+	}
+	// The relative breakpoints can be somewhere else in this process
+	InvalidateBreakpointConditionAddresses();
+}
+
+
+pid_t PtraceAdapter::GetInferiorOf(pid_t tid)
+{
+	if (m_threads.find(tid) != m_threads.end())
+		return m_pid;
+	for (const auto& [pid, inferior] : m_otherInferiors)
+	{
+		if (inferior.threads.find(tid) != inferior.threads.end())
+			return pid;
+	}
+
+	// A new thread can report its first stop before the clone event of its parent
+	pid_t process = (pid_t)strtoul(ReadThreadStatus(tid, tid, "Tgid").c_str(), nullptr, 10);
+	if ((process != 0) && ((process == m_pid) || (m_otherInferiors.find(process) != m_otherInferiors.end())))
+		return process;
+	return 0;
+}
+
+
+bool PtraceAdapter::KillAllInferiors()
+{
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	bool ok = kill(m_pid, SIGKILL) == 0;
+	for (const auto& [pid, inferior] : m_otherInferiors)
+		kill(pid, SIGKILL);
+	return ok;
+}
+
+
+void PtraceAdapter::PostBackendMessage(const std::string& message)
+{
+	DebuggerEvent event;
+	event.type = BackendMessageEventType;
+	event.data.messageData.message = message;
+	QueueEvent(event);
+}
+
+
+bool PtraceAdapter::ResumeTarget(bool step, bool report)
+{
+	pid_t active = m_activeThread;
+	if (step && (m_threads.find(active) == m_threads.end()))
+		return false;
+
+	if (report)
+	{
+		DebuggerEvent event;
+		event.type = ResumeEventType;
+		QueueEvent(event);
+	}
+	SetRunning(true);
+
+	if (step)
+	{
+		m_steppingThread = active;
+		int status = 0;
+		if (StepOverBreakpoint(active, status))
+			DispatchWaitStatus(active, status);
+		else
+			ContinueThread(active, m_threads[active].pendingSignal);
+		return true;
+	}
+
+	// Threads that sit on a breakpoint step over it first, while the others are still stopped
+	std::vector<pid_t> threads;
+	for (const auto& [tid, thread] : m_threads)
+		threads.push_back(tid);
+
+	for (pid_t tid : threads)
+	{
+		auto it = m_threads.find(tid);
+		if ((it == m_threads.end()) || !it->second.stopped || it->second.suspended)
+			continue;
+
+		int status = 0;
+		if (!StepOverBreakpoint(tid, status))
+			continue;
+
+		if ((status >= 0) && WIFSTOPPED(status) && (WSTOPSIG(status) == SIGTRAP) && (((status >> 16) & 0xff) == 0))
+			continue;
+
+		// Something else happened during the step, which may end the resume
+		DispatchWaitStatus(tid, status);
+		if (!m_running || !m_targetActive)
+			return true;
+	}
+
+	for (auto& [tid, thread] : m_threads)
+	{
+		if (thread.stopped && !thread.suspended)
+			ContinueThread(tid, thread.pendingSignal);
+	}
+	return true;
+}
+
+
+void PtraceAdapter::ContinueThread(pid_t tid, int signal)
+{
+	auto it = m_threads.find(tid);
+	if (it != m_threads.end())
+	{
+		if (!it->second.debugRegistersSet)
+		{
+			if (!m_hardwareBreakpoints.empty())
+				WriteDebugRegisters(tid, true);
+			it->second.debugRegistersSet = true;
+		}
+		it->second.stopped = false;
+		it->second.pendingSignal = 0;
+		it->second.stoppedByWatchpoint = false;
+	}
+
+	auto request = (tid == m_steppingThread) ? PTRACE_SINGLESTEP : PTRACE_CONT;
+	ptrace(request, tid, nullptr, (void*)(uintptr_t)signal);
+}
+
+
+bool PtraceAdapter::StepOverBreakpoint(pid_t tid, int& status)
+{
+	uint64_t pc = GetThreadPC(tid);
+	bool software = false;
+	{
+		std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+		auto it = m_breakpoints.find(pc);
+		if ((it != m_breakpoints.end()) && it->second.inserted)
+		{
+			RemoveBreakpointFromMemory(pc, it->second);
+			software = true;
+		}
+	}
+
+	bool hardware = IsOnHardwareBreakpoint(tid, pc);
+	if (!software && !hardware)
+		return false;
+
+	ThreadState& thread = m_threads[tid];
+	if (hardware)
+		WriteDebugRegisters(tid, false);
+
+	int signal = thread.pendingSignal;
+	thread.pendingSignal = 0;
+	thread.stopped = false;
+	thread.stoppedByWatchpoint = false;
+	if (ptrace(PTRACE_SINGLESTEP, tid, nullptr, (void*)(uintptr_t)signal) == 0)
+		status = WaitForThread(tid);
+	else
+		status = -1;
+	if ((status >= 0) && WIFSTOPPED(status))
+		thread.stopped = true;
+
+	if (hardware && thread.stopped)
+		WriteDebugRegisters(tid, true);
+
+	if (software)
+	{
+		std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+		auto it = m_breakpoints.find(pc);
+		if (it != m_breakpoints.end())
+			InsertBreakpoint(pc, it->second);
+	}
+	return true;
+}
+
+
+bool PtraceAdapter::WriteDebugRegisters(pid_t tid, bool enabled)
+{
+	return SetDebugRegisters(tid, enabled ? m_hardwareBreakpoints : std::vector<DebugHardwareBreakpoint> {});
+}
+
+
+bool PtraceAdapter::ApplyHardwareBreakpoints()
+{
+	bool ok = true;
+	for (auto& [tid, thread] : m_threads)
+	{
+		// A thread whose first stop has not arrived yet gets them when it is resumed
+		thread.debugRegistersSet = thread.stopped && WriteDebugRegisters(tid, true);
+		if (thread.stopped && !thread.debugRegistersSet)
+			ok = false;
+	}
+
+	// The other processes are running, so their threads are updated the next time they are resumed
+	for (auto& [pid, inferior] : m_otherInferiors)
+	{
+		for (auto& [tid, thread] : inferior.threads)
+			thread.debugRegistersSet = false;
+	}
+	return ok;
+}
+
+
+std::optional<size_t> PtraceAdapter::GetTriggeredHardwareBreakpoint(pid_t tid, const siginfo_t& info)
+{
+	return GetTriggeredDebugRegister(tid, info, m_hardwareBreakpoints);
+}
+
+
+bool PtraceAdapter::IsOnHardwareBreakpoint(pid_t tid, uint64_t pc)
+{
+	auto it = m_threads.find(tid);
+	if ((it != m_threads.end()) && it->second.stoppedByWatchpoint)
+		return true;
+
+	// An execution breakpoint stops the thread before the instruction runs
+	for (const DebugHardwareBreakpoint& breakpoint : m_hardwareBreakpoints)
+	{
+		if (!breakpoint.IsWatchpoint() && (breakpoint.m_address == pc))
+			return true;
+	}
+	return false;
+}
+
+
+bool PtraceAdapter::ReadRegisterSet(pid_t tid, user_regs_struct* regs)
+{
+	iovec iov {regs, sizeof(*regs)};
+	return ptrace(PTRACE_GETREGSET, tid, (void*)(uintptr_t)NT_PRSTATUS, &iov) == 0;
+}
+
+
+bool PtraceAdapter::WriteRegisterSet(pid_t tid, user_regs_struct* regs)
+{
+	iovec iov {regs, sizeof(*regs)};
+	return ptrace(PTRACE_SETREGSET, tid, (void*)(uintptr_t)NT_PRSTATUS, &iov) == 0;
+}
+
+
+uint64_t PtraceAdapter::GetThreadPC(pid_t tid)
+{
+	user_regs_struct regs {};
+	if (!ReadRegisterSet(tid, &regs))
+		return 0;
+	return GetRegisterValue(regs, *FindRegister(ProgramCounterName));
+}
+
+
+bool PtraceAdapter::SetThreadPC(pid_t tid, uint64_t pc)
+{
+	user_regs_struct regs {};
+	if (!ReadRegisterSet(tid, &regs))
+		return false;
+	SetRegisterValue(regs, *FindRegister(ProgramCounterName), pc);
+	return WriteRegisterSet(tid, &regs);
+}
+
+
+size_t PtraceAdapter::ReadTargetMemory(uint64_t address, uint8_t* buffer, size_t size)
+{
+	static const uint64_t pageSize = sysconf(_SC_PAGESIZE);
+	size_t done = 0;
+	while (done < size)
+	{
+		// One page at a time, so an unreadable page does not fail the readable ones before it
+		uint64_t current = address + done;
+		size_t chunk = std::min<uint64_t>(size - done, pageSize - (current % pageSize));
+		iovec local {buffer + done, chunk};
+		iovec remote {(void*)current, chunk};
+		ssize_t result = process_vm_readv(m_pid, &local, 1, &remote, 1, 0);
+		// Pages mapped without read permission can still be read through /proc/<pid>/mem
+		if ((result <= 0) && (m_memoryFd >= 0))
+			result = pread(m_memoryFd, buffer + done, chunk, (off_t)current);
+		if (result <= 0)
+			break;
+
+		done += result;
+		if ((size_t)result < chunk)
+			break;
+	}
+	return done;
+}
+
+
+bool PtraceAdapter::WriteTargetMemory(uint64_t address, const uint8_t* buffer, size_t size)
+{
+	static const uint64_t pageSize = sysconf(_SC_PAGESIZE);
+	size_t done = 0;
+	while (done < size)
+	{
+		uint64_t current = address + done;
+		size_t chunk = std::min<uint64_t>(size - done, pageSize - (current % pageSize));
+		iovec local {(void*)(buffer + done), chunk};
+		iovec remote {(void*)current, chunk};
+		ssize_t result = process_vm_writev(m_pid, &local, 1, &remote, 1, 0);
+		// Code is mapped read-only, but /proc/<pid>/mem writes through the page protection
+		if ((result <= 0) && (m_memoryFd >= 0))
+			result = pwrite(m_memoryFd, buffer + done, chunk, (off_t)current);
+		if (result <= 0)
+			return false;
+
+		done += result;
+	}
+	return true;
+}
+
+
+bool PtraceAdapter::InsertBreakpoint(uint64_t address, SoftwareBreakpoint& breakpoint)
+{
+	if (breakpoint.inserted)
+		return true;
+	if (!m_targetActive)
+		return false;
+
+	std::vector<uint8_t> original(BreakpointSize);
+	if (ReadTargetMemory(address, original.data(), BreakpointSize) != BreakpointSize)
+		return false;
+	if (!WriteTargetMemory(address, BreakpointInstruction, BreakpointSize))
+		return false;
+
+	breakpoint.originalBytes = original;
+	breakpoint.inserted = true;
+	return true;
+}
+
+
+bool PtraceAdapter::RemoveBreakpointFromMemory(uint64_t address, SoftwareBreakpoint& breakpoint)
+{
+	if (!breakpoint.inserted)
+		return true;
+
+	breakpoint.inserted = false;
+	return WriteTargetMemory(address, breakpoint.originalBytes.data(), breakpoint.originalBytes.size());
+}
+
+
+PtraceAdapter::SoftwareBreakpoint& PtraceAdapter::GetOrCreateBreakpoint(uint64_t address)
+{
+	SoftwareBreakpoint& breakpoint = m_breakpoints[address];
+	if (breakpoint.id == 0)
+		breakpoint.id = m_nextBreakpointId++;
+	return breakpoint;
+}
+
+
+void PtraceAdapter::ReleaseBreakpoint(std::map<uint64_t, SoftwareBreakpoint>::iterator it)
+{
+	if (it->second.IsWanted())
+		return;
+
+	RemoveBreakpointFromMemory(it->first, it->second);
+	m_breakpoints.erase(it);
+}
+
+
+void PtraceAdapter::InsertPendingBreakpoints()
+{
+	if (!m_targetActive || (m_vforkChildren > 0))
+		return;
+
+	// Absolute breakpoints in memory that is not mapped yet
+	for (auto& [address, breakpoint] : m_breakpoints)
+	{
+		if (!breakpoint.inserted)
+			InsertBreakpoint(address, breakpoint);
+	}
+
+	bool unresolved = false;
+	for (const auto& [location, address] : m_relativeBreakpoints)
+	{
+		if (address == 0)
+			unresolved = true;
+	}
+	if (!unresolved)
+		return;
+
+	auto modules = GetModuleList();
+	for (auto& [location, address] : m_relativeBreakpoints)
+	{
+		if (address != 0)
+			continue;
+
+		for (const auto& module : modules)
+		{
+			if (!module.IsSameBaseModule(location.module))
+				continue;
+
+			address = module.m_address + location.offset;
+			SoftwareBreakpoint& breakpoint = GetOrCreateBreakpoint(address);
+			breakpoint.relative = true;
+			InsertBreakpoint(address, breakpoint);
+			break;
+		}
+	}
+}
+
+
+bool PtraceAdapter::RestoreOriginalBytes(int memoryFd, uint64_t address, const SoftwareBreakpoint& breakpoint)
+{
+	return pwrite(memoryFd, breakpoint.originalBytes.data(), breakpoint.originalBytes.size(), (off_t)address)
+		== (ssize_t)breakpoint.originalBytes.size();
+}
+
+
+void PtraceAdapter::InsertPendingBreakpoints(Inferior& inferior)
+{
+	// The parent of a vfork() shares its memory with the current inferior, so it is left alone
+	if ((inferior.memoryFd < 0) || inferior.detachAfterVfork)
+		return;
+
+	// The inferior may be running, so its memory is only accessed through its /proc/<pid>/mem
+	auto insert = [&](uint64_t address, SoftwareBreakpoint& breakpoint) {
+		if (breakpoint.inserted)
+			return;
+
+		std::vector<uint8_t> original(BreakpointSize);
+		if ((pread(inferior.memoryFd, original.data(), BreakpointSize, (off_t)address) != (ssize_t)BreakpointSize)
+			|| (pwrite(inferior.memoryFd, BreakpointInstruction, BreakpointSize, (off_t)address)
+				!= (ssize_t)BreakpointSize))
+			return;
+
+		breakpoint.originalBytes = original;
+		breakpoint.inserted = true;
+	};
+
+	for (auto& [address, breakpoint] : inferior.breakpoints)
+		insert(address, breakpoint);
+
+	std::vector<DebugModule> modules;
+	for (auto& [location, address] : inferior.relativeBreakpoints)
+	{
+		if (address != 0)
+			continue;
+
+		if (modules.empty())
+			modules = ReadModuleList(inferior.pid);
+		for (const auto& module : modules)
+		{
+			if (!module.IsSameBaseModule(location.module))
+				continue;
+
+			address = module.m_address + location.offset;
+			SoftwareBreakpoint& breakpoint = inferior.breakpoints[address];
+			if (breakpoint.id == 0)
+				breakpoint.id = m_nextBreakpointId++;
+			breakpoint.relative = true;
+			insert(address, breakpoint);
+			break;
+		}
+	}
+}
+
+
+void PtraceAdapter::ReleaseBreakpoint(Inferior& inferior, std::map<uint64_t, SoftwareBreakpoint>::iterator it)
+{
+	if (it->second.IsWanted())
+		return;
+
+	if (it->second.inserted && (inferior.memoryFd >= 0)
+		&& !RestoreOriginalBytes(inferior.memoryFd, it->first, it->second))
+		LogWarn("Failed to remove the breakpoint at 0x%" PRIx64 " from process %d", it->first, inferior.pid);
+	inferior.breakpoints.erase(it);
+}
+
+
+bool PtraceAdapter::IsAtBreakpoint(uint64_t address)
+{
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	auto it = m_breakpoints.find(address);
+	return (it != m_breakpoints.end()) && it->second.inserted;
+}
+
+
+std::vector<DebugProcess> PtraceAdapter::GetProcessList()
+{
+	std::vector<DebugProcess> result;
+	GetLocalProcessList(result);
+	return result;
+}
+
+
+std::vector<DebugThread> PtraceAdapter::GetThreadList()
+{
+	std::vector<DebugThread> result;
+	RunOnTracer([&]() {
+		for (const auto& [tid, thread] : m_threads)
+		{
+			DebugThread debugThread(tid, GetThreadPC(tid));
+			debugThread.m_isFrozen = thread.suspended;
+			result.push_back(debugThread);
+		}
+	});
+	return result;
+}
+
+
+DebugThread PtraceAdapter::GetActiveThread() const
+{
+	uint32_t tid = m_activeThread;
+	uint64_t pc = 0;
+	// Reading the registers needs the tracer thread, which has nothing const about it
+	auto self = const_cast<PtraceAdapter*>(this);
+	self->RunOnTracer([&]() { pc = self->GetThreadPC(tid); });
+	return DebugThread(tid, pc);
+}
+
+
+uint32_t PtraceAdapter::GetActiveThreadId() const
+{
+	return m_activeThread;
+}
+
+
+bool PtraceAdapter::SetActiveThread(const DebugThread& thread)
+{
+	return SetActiveThreadId(thread.m_tid);
+}
+
+
+bool PtraceAdapter::SetActiveThreadId(std::uint32_t tid)
+{
+	bool ok = false;
+	RunOnTracer([&]() {
+		if (m_threads.find(tid) == m_threads.end())
+			return;
+		m_activeThread = tid;
+		ok = true;
+	});
+	return ok;
+}
+
+
+bool PtraceAdapter::SuspendThread(std::uint32_t tid)
+{
+	bool ok = false;
+	RunOnTracer([&]() {
+		auto it = m_threads.find(tid);
+		if (it == m_threads.end())
+			return;
+		it->second.suspended = true;
+		ok = true;
+	});
+	return ok;
+}
+
+
+bool PtraceAdapter::ResumeThread(std::uint32_t tid)
+{
+	bool ok = false;
+	RunOnTracer([&]() {
+		auto it = m_threads.find(tid);
+		if (it == m_threads.end())
+			return;
+		it->second.suspended = false;
+		ok = true;
+	});
+	return ok;
+}
+
+
+std::vector<DebugFrame> PtraceAdapter::GetFramesOfThread(std::uint32_t tid)
+{
+	std::vector<DebugFrame> frames;
+	user_regs_struct regs {};
+	bool ok = false;
+	RunOnTracer([&]() { ok = (m_threads.find(tid) != m_threads.end()) && ReadRegisterSet(tid, &regs); });
+	if (!ok)
+		return frames;
+
+	auto modules = GetModuleList();
+	auto moduleName = [&](uint64_t address) -> std::string {
+		for (const auto& module : modules)
+		{
+			if ((address >= module.m_address) && (address < module.m_address + module.m_size))
+				return module.m_short_name;
+		}
+		return "<unknown>";
+	};
+
+	uint64_t pc = GetRegisterValue(regs, *FindRegister(ProgramCounterName));
+	uint64_t sp = GetRegisterValue(regs, *FindRegister(StackPointerName));
+	uint64_t fp = GetRegisterValue(regs, *FindRegister(FramePointerName));
+	frames.emplace_back(0, pc, sp, fp, "", 0, moduleName(pc));
+
+	// Walk the chain of frame records, which hold the caller's frame pointer followed by the return address on both
+	// architectures. Code built without frame pointers gives a partial stack.
+	static constexpr size_t MaxFrames = 256;
+	while ((fp != 0) && (frames.size() < MaxFrames))
+	{
+		uint64_t record[2];
+		if (ReadTargetMemory(fp, (uint8_t*)record, sizeof(record)) != sizeof(record))
+			break;
+
+		uint64_t callerFp = record[0];
+		uint64_t returnAddress = record[1];
+		if (returnAddress == 0)
+			break;
+
+		frames.emplace_back(frames.size(), returnAddress, fp + sizeof(record), callerFp, "", 0, moduleName(returnAddress));
+		// The stack grows down, so anything else is not a frame record
+		if (callerFp <= fp)
+			break;
+		fp = callerFp;
+	}
+	return frames;
+}
+
+
+DebugBreakpoint PtraceAdapter::AddBreakpoint(const std::uintptr_t address, unsigned long breakpoint_type)
+{
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	SoftwareBreakpoint& breakpoint = GetOrCreateBreakpoint(address);
+	breakpoint.user = true;
+	// Memory that is not mapped yet is tried again on every stop
+	InsertBreakpoint(address, breakpoint);
+
+	// Every process of the session gets the breakpoint
+	for (auto& [pid, inferior] : m_otherInferiors)
+	{
+		SoftwareBreakpoint& other = inferior.breakpoints[address];
+		if (other.id == 0)
+			other.id = breakpoint.id;
+		other.user = true;
+		InsertPendingBreakpoints(inferior);
+	}
+	return DebugBreakpoint(address, breakpoint.id, true);
+}
+
+
+DebugBreakpoint PtraceAdapter::AddBreakpoint(const ModuleNameAndOffset& address, unsigned long breakpoint_type)
+{
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	for (const auto& [location, resolved] : m_relativeBreakpoints)
+	{
+		if (location == address)
+			return DebugBreakpoint(resolved, 0, true);
+	}
+
+	m_relativeBreakpoints.emplace_back(address, 0);
+	InsertPendingBreakpoints();
+	// Each process of the session resolves it against its own modules
+	for (auto& [pid, inferior] : m_otherInferiors)
+	{
+		inferior.relativeBreakpoints.emplace_back(address, 0);
+		InsertPendingBreakpoints(inferior);
+	}
+	uint64_t resolved = m_relativeBreakpoints.back().second;
+	if (resolved == 0)
+		return DebugBreakpoint(0, 0, true);
+	return DebugBreakpoint(resolved, m_breakpoints[resolved].id, true);
+}
+
+
+bool PtraceAdapter::RemoveBreakpoint(const DebugBreakpoint& breakpoint)
+{
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	auto it = m_breakpoints.find(breakpoint.m_address);
+	if (it == m_breakpoints.end())
+		return false;
+
+	m_relativeBreakpoints.erase(std::remove_if(m_relativeBreakpoints.begin(), m_relativeBreakpoints.end(),
+									[&](const auto& entry) { return entry.second == breakpoint.m_address; }),
+		m_relativeBreakpoints.end());
+	it->second.user = false;
+	it->second.relative = false;
+	ReleaseBreakpoint(it);
+
+	for (auto& [pid, inferior] : m_otherInferiors)
+	{
+		// The parent of a vfork() takes its breakpoints out when it is detached from
+		auto other = inferior.breakpoints.find(breakpoint.m_address);
+		if (inferior.detachAfterVfork || (other == inferior.breakpoints.end()))
+			continue;
+
+		auto& relative = inferior.relativeBreakpoints;
+		relative.erase(std::remove_if(relative.begin(), relative.end(),
+						   [&](const auto& entry) { return entry.second == breakpoint.m_address; }),
+			relative.end());
+		other->second.user = false;
+		other->second.relative = false;
+		ReleaseBreakpoint(inferior, other);
+	}
+	return true;
+}
+
+
+bool PtraceAdapter::RemoveBreakpoint(const ModuleNameAndOffset& address)
+{
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	for (auto& [pid, inferior] : m_otherInferiors)
+	{
+		if (inferior.detachAfterVfork)
+			continue;
+
+		auto& relative = inferior.relativeBreakpoints;
+		for (auto entry = relative.begin(); entry != relative.end(); entry++)
+		{
+			if (!(entry->first == address))
+				continue;
+
+			uint64_t resolved = entry->second;
+			relative.erase(entry);
+			auto it = inferior.breakpoints.find(resolved);
+			if (it != inferior.breakpoints.end())
+			{
+				it->second.relative = false;
+				ReleaseBreakpoint(inferior, it);
+			}
+			break;
+		}
+	}
+
+	for (auto entry = m_relativeBreakpoints.begin(); entry != m_relativeBreakpoints.end(); entry++)
+	{
+		if (!(entry->first == address))
+			continue;
+
+		uint64_t resolved = entry->second;
+		m_relativeBreakpoints.erase(entry);
+		auto it = m_breakpoints.find(resolved);
+		if (it != m_breakpoints.end())
+		{
+			it->second.relative = false;
+			ReleaseBreakpoint(it);
+		}
+		return true;
+	}
+	return false;
+}
+
+
+std::vector<DebugBreakpoint> PtraceAdapter::GetBreakpointList() const
+{
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	std::vector<DebugBreakpoint> result;
+	for (const auto& [address, breakpoint] : m_breakpoints)
+	{
+		if (breakpoint.user || breakpoint.relative)
+			result.emplace_back(address, breakpoint.id, breakpoint.inserted);
+	}
+	return result;
+}
+
+
+bool PtraceAdapter::AddTemporaryBreakpoint(std::uintptr_t address)
+{
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	SoftwareBreakpoint& breakpoint = GetOrCreateBreakpoint(address);
+	breakpoint.temporary = true;
+	if (!InsertBreakpoint(address, breakpoint))
+	{
+		breakpoint.temporary = false;
+		ReleaseBreakpoint(m_breakpoints.find(address));
+		return false;
+	}
+	return true;
+}
+
+
+bool PtraceAdapter::AddHardwareBreakpoint(const DebugHardwareBreakpoint& breakpoint)
+{
+	bool ok = false;
+	RunOnTracer([&]() {
+		if (std::find(m_hardwareBreakpoints.begin(), m_hardwareBreakpoints.end(), breakpoint)
+			!= m_hardwareBreakpoints.end())
+		{
+			ok = true;
+			return;
+		}
+
+		m_hardwareBreakpoints.push_back(breakpoint);
+		ok = ApplyHardwareBreakpoints();
+		if (!ok)
+		{
+			// Out of debug registers
+			m_hardwareBreakpoints.pop_back();
+			ApplyHardwareBreakpoints();
+		}
+	});
+	return ok;
+}
+
+
+bool PtraceAdapter::RemoveHardwareBreakpoint(const DebugHardwareBreakpoint& breakpoint)
+{
+	bool ok = false;
+	RunOnTracer([&]() {
+		auto it = std::find(m_hardwareBreakpoints.begin(), m_hardwareBreakpoints.end(), breakpoint);
+		if (it == m_hardwareBreakpoints.end())
+			return;
+
+		// The ones after it move down a slot
+		m_hardwareBreakpoints.erase(it);
+		ok = ApplyHardwareBreakpoints();
+	});
+	return ok;
+}
+
+
+void PtraceAdapter::RemoveTemporaryBreakpoints()
+{
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	for (auto it = m_breakpoints.begin(); it != m_breakpoints.end();)
+	{
+		auto current = it++;
+		if (!current->second.temporary)
+			continue;
+
+		current->second.temporary = false;
+		ReleaseBreakpoint(current);
+	}
+}
+
+
+std::unordered_map<std::string, DebugRegister> PtraceAdapter::ReadAllRegisters()
+{
+	std::unordered_map<std::string, DebugRegister> result;
+	user_regs_struct regs {};
+	bool ok = false;
+	RunOnTracer([&]() { ok = ReadRegisterSet(m_activeThread, &regs); });
+	if (!ok)
+		return result;
+
+	size_t index = 0;
+	for (const auto& info : TargetRegisters)
+		result[info.name] = DebugRegister(info.name, GetRegisterValue(regs, info), info.width, index++);
+	return result;
+}
+
+
+DebugRegister PtraceAdapter::ReadRegister(const std::string& reg)
+{
+	const RegisterInfo* info = FindRegister(reg);
+	if (!info)
+		return DebugRegister {};
+
+	user_regs_struct regs {};
+	bool ok = false;
+	RunOnTracer([&]() { ok = ReadRegisterSet(m_activeThread, &regs); });
+	if (!ok)
+		return DebugRegister {};
+
+	return DebugRegister(reg, GetRegisterValue(regs, *info), info->width, info - TargetRegisters);
+}
+
+
+bool PtraceAdapter::WriteRegister(const std::string& reg, std::uintptr_t value)
+{
+	const RegisterInfo* info = FindRegister(reg);
+	if (!info)
+		return false;
+
+	bool ok = false;
+	RunOnTracer([&]() {
+		user_regs_struct regs {};
+		if (!ReadRegisterSet(m_activeThread, &regs))
+			return;
+		SetRegisterValue(regs, *info, value);
+		ok = WriteRegisterSet(m_activeThread, &regs);
+	});
+	return ok;
+}
+
+
+DataBuffer PtraceAdapter::ReadMemory(std::uintptr_t address, std::size_t size)
+{
+	if (!m_targetActive || (size == 0))
+		return {};
+
+	std::vector<uint8_t> buffer(size);
+	size_t bytesRead = ReadTargetMemory(address, buffer.data(), size);
+	if (bytesRead == 0)
+		return {};
+	buffer.resize(bytesRead);
+
+	{
+		// Show the original bytes rather than our breakpoint instructions
+		std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+		auto it = m_breakpoints.lower_bound(address >= BreakpointSize ? address - BreakpointSize + 1 : 0);
+		for (; (it != m_breakpoints.end()) && (it->first < address + bytesRead); it++)
+		{
+			if (!it->second.inserted)
+				continue;
+
+			for (size_t i = 0; i < BreakpointSize; i++)
+			{
+				uint64_t byte = it->first + i;
+				if ((byte >= address) && (byte < address + bytesRead))
+					buffer[byte - address] = it->second.originalBytes[i];
+			}
+		}
+	}
+	return DataBuffer(buffer.data(), buffer.size());
+}
+
+
+bool PtraceAdapter::WriteMemory(std::uintptr_t address, const DataBuffer& buffer)
+{
+	if (!m_targetActive)
+		return false;
+
+	std::vector<uint8_t> data((const uint8_t*)buffer.GetData(), (const uint8_t*)buffer.GetData() + buffer.GetLength());
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	// The new bytes under a breakpoint are the ones it restores when it is removed
+	auto it = m_breakpoints.lower_bound(address >= BreakpointSize ? address - BreakpointSize + 1 : 0);
+	for (; (it != m_breakpoints.end()) && (it->first < address + data.size()); it++)
+	{
+		if (!it->second.inserted)
+			continue;
+
+		for (size_t i = 0; i < BreakpointSize; i++)
+		{
+			uint64_t byte = it->first + i;
+			if ((byte >= address) && (byte < address + data.size()))
+			{
+				it->second.originalBytes[i] = data[byte - address];
+				data[byte - address] = BreakpointInstruction[i];
+			}
+		}
+	}
+	return WriteTargetMemory(address, data.data(), data.size());
+}
+
+
+std::vector<DebugModule> PtraceAdapter::GetModuleList()
+{
+	if (!m_targetActive)
+		return {};
+	return ReadModuleList(m_pid);
+}
+
+
+std::vector<DebugModule> PtraceAdapter::ReadModuleList(pid_t pid)
+{
+	// Every file mapped into the process is a module, which spans from its first mapping to the end of its last one
+	std::vector<DebugModule> modules;
+	std::unordered_map<std::string, size_t> indices;
+	std::ifstream maps(fmt::format("/proc/{}/maps", pid));
+	std::string line;
+	while (std::getline(maps, line))
+	{
+		//	example:
+		//	7ffff7dd3000-7ffff7dfc000 r-xp 00000000 08:01 1311198    /usr/lib/x86_64-linux-gnu/ld-2.31.so
+		uint64_t start = 0, end = 0, inode = 0;
+		int pathOffset = 0;
+		if (sscanf(line.c_str(), "%" SCNx64 "-%" SCNx64 " %*s %*s %*s %" SCNu64 " %n", &start, &end, &inode,
+				&pathOffset) < 3)
+			continue;
+
+		// Anonymous mappings, and pseudo-files like [stack] and [vdso]
+		if ((inode == 0) || (pathOffset <= 0) || ((size_t)pathOffset >= line.size()))
+			continue;
+
+		std::string path = line.substr(pathOffset);
+		auto it = indices.find(path);
+		if (it == indices.end())
+		{
+			indices[path] = modules.size();
+			modules.emplace_back(path, DebugModule::GetPathBaseName(path), start, end - start, true);
+		}
+		else
+		{
+			DebugModule& module = modules[it->second];
+			module.m_size = std::max<uint64_t>(module.m_size, end - module.m_address);
+		}
+	}
+	return modules;
+}
+
+
+std::string PtraceAdapter::GetTargetArchitecture()
+{
+	return TargetArchitectureName;
+}
+
+
+DebugStopReason PtraceAdapter::StopReason()
+{
+	return m_lastStopReason;
+}
+
+
+uint64_t PtraceAdapter::ExitCode()
+{
+	return m_exitCode;
+}
+
+
+bool PtraceAdapter::BreakInto()
+{
+	if (!m_targetActive || !m_running)
+		return false;
+
+	// The tracer can switch to another process of the session meanwhile
+	std::unique_lock<std::mutex> lock(m_breakpointsMutex);
+	pid_t tid = m_activeThread;
+	m_breakThread = tid;
+	m_breakRequested = true;
+	if (syscall(SYS_tgkill, m_pid, tid, SIGSTOP) == 0)
+		return true;
+
+	// The thread is gone, so stop whichever thread the kernel picks
+	m_breakThread = 0;
+	return kill(m_pid, SIGSTOP) == 0;
+}
+
+
+bool PtraceAdapter::Go()
+{
+	bool ok = false;
+	RunOnTracer([&]() { ok = ResumeTarget(false, true); });
+	return ok;
+}
+
+
+bool PtraceAdapter::StepInto()
+{
+	return StepInstructions(1, nullptr);
+}
+
+
+bool PtraceAdapter::StepInstructions(uint64_t count, const std::function<bool(uint64_t)>& stopPredicate)
+{
+	if (count == 0)
+		return false;
+
+	bool ok = false;
+	RunOnTracer([&]() {
+		m_instructionStepsLeft = count;
+		m_stepPredicate = stopPredicate;
+		ok = ResumeTarget(true, true);
+	});
+	return ok;
+}
+
+
+bool PtraceAdapter::StepOver()
+{
+	bool ok = false;
+	RunOnTracer([&]() {
+		pid_t tid = m_activeThread;
+		user_regs_struct regs {};
+		Ref<Architecture> arch = Architecture::GetByName(TargetArchitectureName);
+		if (!arch || !ReadRegisterSet(tid, &regs))
+			return;
+
+		uint64_t pc = GetRegisterValue(regs, *FindRegister(ProgramCounterName));
+		size_t size = arch->GetMaxInstructionLength();
+		DataBuffer buffer = ReadMemory(pc, size);
+		auto data = (const uint8_t*)buffer.GetData();
+		auto info = m_instructionCache.GetInstructionInfo(arch, pc, data, buffer.GetLength());
+		if (!info.has_value() || !m_instructionCache.IsCall(arch, pc, data, buffer.GetLength()))
+		{
+			m_instructionStepsLeft = 1;
+			ok = ResumeTarget(true, true);
+			return;
+		}
+
+		// Run the call until it returns
+		uint64_t returnAddress = pc + info->length;
+		if (!AddTemporaryBreakpoint(returnAddress))
+			return;
+		m_stepOverAddress = returnAddress;
+		m_stepOverStackPointer = GetRegisterValue(regs, *FindRegister(StackPointerName));
+		ok = ResumeTarget(false, true);
+	});
+	return ok;
+}
+
+
+std::string PtraceAdapter::InvokeBackendCommand(const std::string& command)
+{
+	return "error: the ptrace adapter has no backend command line\n";
+}
+
+
+uint64_t PtraceAdapter::GetInstructionOffset()
+{
+	uint64_t pc = 0;
+	RunOnTracer([&]() { pc = GetThreadPC(m_activeThread); });
+	return pc;
+}
+
+
+uint64_t PtraceAdapter::GetStackPointer()
+{
+	user_regs_struct regs {};
+	bool ok = false;
+	RunOnTracer([&]() { ok = ReadRegisterSet(m_activeThread, &regs); });
+	return ok ? GetRegisterValue(regs, *FindRegister(StackPointerName)) : 0;
+}
+
+
+bool PtraceAdapter::SupportFeature(DebugAdapterCapacity feature)
+{
+	switch (feature)
+	{
+	case DebugAdapterSupportStepOver:
+	case DebugAdapterSupportThreads:
+	case DebugAdapterSupportModules:
+	case DebugAdapterSupportStepInstructions:
+		return true;
+	default:
+		return false;
+	}
+}
+
+
+void PtraceAdapter::WriteStdin(const std::string& msg)
+{
+	if (m_stdinFd < 0)
+	{
+		LogWarn("The target has no input to write to");
+		return;
+	}
+
+	size_t done = 0;
+	while (done < msg.size())
+	{
+		ssize_t result = write(m_stdinFd, msg.data() + done, msg.size() - done);
+		if ((result < 0) && (errno == EINTR))
+			continue;
+		if (result <= 0)
+			break;
+		done += result;
+	}
+}
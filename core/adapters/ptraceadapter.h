@@ -0,0 +1,343 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/user.h>
+#include "../debugadapter.h"
+#include "../debugadaptertype.h"
+#include "../../api/decodedinstructioncache.h"
+
+namespace BinaryNinjaDebugger {
+	// A Linux adapter for x86_64 and aarch64 targets, built directly on ptrace. The kernel only accepts ptrace
+	// requests from the thread that attached to the target, so a single tracer thread does all of them: it waits for
+	// the target with waitid() while the target runs, and runs the requests of the other threads while it is stopped.
+	// Memory is accessed with process_vm_readv/writev, which works from any thread. Hardware breakpoints and watchpoints
+	// use the debug registers of each thread: DR0-3 and DR7 on x86_64, and the NT_ARM_HW_BREAK and NT_ARM_HW_WATCH
+	// register sets on aarch64.
+	//
+	// Events are posted from a separate thread, so the tracer never waits for the controller, which may itself be
+	// waiting for the tracer.
+	//
+	// Forked children are followed according to debugger.followForkMode. In the "both" mode, a session can have
+	// several processes (inferiors): the current one is in the members below, and the others are kept in
+	// m_otherInferiors, each with its own threads and breakpoints. The others keep running while the current one is
+	// stopped. When one of them reports an event, it becomes the current one, so the stop is reported on it.
+	class PtraceAdapter : public DebugAdapter
+	{
+	private:
+		struct ThreadState
+		{
+			bool stopped = false;
+			// Frozen by SuspendThread(), so it stays stopped when the target resumes
+			bool suspended = false;
+			// A SIGSTOP sent by us is still pending, and is discarded when it arrives
+			bool expectingStop = false;
+			// Signal to deliver when the thread resumes
+			int pendingSignal = 0;
+			// Called vfork(), and the child, which is not debugged, still runs in our memory. See m_vforkChildren.
+			bool vforkChildRunning = false;
+			// The debug registers hold m_hardwareBreakpoints. New threads, and the one that called exec(), start with
+			// them cleared, so they get them before they run.
+			bool debugRegistersSet = false;
+			// Stopped by a watchpoint that, on aarch64, stops the thread before the access. The watchpoints are off
+			// for one step when it resumes, or it would stop right away again.
+			bool stoppedByWatchpoint = false;
+		};
+
+		struct SoftwareBreakpoint
+		{
+			unsigned long id = 0;
+			std::vector<uint8_t> originalBytes;
+			bool inserted = false;
+			// A breakpoint can be wanted for several reasons at once. It is removed when none of them is left.
+			bool user = false;
+			// Resolved from one of m_relativeBreakpoints
+			bool relative = false;
+			bool temporary = false;
+			// At the entry point of the program. Shared libraries are mapped by then, so the pending breakpoints in
+			// them are resolved there.
+			bool entry = false;
+
+			bool IsWanted() const { return user || relative || temporary || entry; }
+		};
+
+		enum FollowForkMode
+		{
+			FollowParent,
+			FollowChild,
+			FollowBoth
+		};
+
+		// A process of the session other than the current one
+		struct Inferior
+		{
+			pid_t pid = 0;
+			int memoryFd = -1;
+			std::map<pid_t, ThreadState> threads;
+			std::map<uint64_t, SoftwareBreakpoint> breakpoints;
+			std::vector<std::pair<ModuleNameAndOffset, uint64_t>> relativeBreakpoints;
+			// The parent of a vfork() followed into the child. It shares its memory with the child, so it is only
+			// detached from once the child calls exec() or exits.
+			bool detachAfterVfork = false;
+		};
+
+		struct TracerRequest
+		{
+			std::function<void()> work;
+			bool done = false;
+			bool rejected = false;
+		};
+
+		pid_t m_pid = 0;
+		std::atomic_bool m_targetActive = false;
+		std::atomic_bool m_running = false;
+		std::atomic<uint32_t> m_activeThread = 0;
+		std::atomic<uint64_t> m_exitCode = 0;
+		std::atomic<DebugStopReason> m_lastStopReason = UnknownReason;
+		int m_memoryFd = -1;
+		int m_stdinFd = -1;
+
+		// Only accessed by the tracer thread
+		std::map<pid_t, ThreadState> m_threads;
+		pid_t m_steppingThread = 0;
+		uint64_t m_instructionStepsLeft = 0;
+		std::function<bool(uint64_t)> m_stepPredicate;
+		// Whether to report a stop at the entry breakpoint, see debugger.stopAtEntryPoint
+		bool m_stopAtEntry = false;
+		// See debugger.followForkMode
+		FollowForkMode m_followForkMode = FollowParent;
+		// StepOver() runs a call until it returns here, with the stack pointer back to where it was
+		uint64_t m_stepOverAddress = 0;
+		uint64_t m_stepOverStackPointer = 0;
+		BinaryNinjaDebuggerAPI::DecodedInstructionCache m_instructionCache;
+
+		// BreakInto() sends a SIGSTOP to m_breakThread, and the next stop is reported as UserRequestedBreak
+		std::atomic_bool m_breakRequested = false;
+		std::atomic<pid_t> m_breakThread = 0;
+		std::atomic_bool m_detachRequested = false;
+
+		std::thread m_tracer;
+		std::atomic<std::thread::id> m_tracerId;
+		std::mutex m_requestMutex;
+		std::condition_variable m_requestCv;
+		std::deque<std::shared_ptr<TracerRequest>> m_requests;
+
+		std::thread m_eventThread;
+		std::mutex m_eventMutex;
+		std::condition_variable m_eventCv;
+		std::deque<DebuggerEvent> m_events;
+		bool m_eventThreadStopping = false;
+
+		std::thread m_outputThread;
+		std::atomic_bool m_outputThreadStopping = false;
+
+		// Address -> breakpoint. Memory reads and writes go through it from any thread, hence the mutex.
+		mutable std::mutex m_breakpointsMutex;
+		std::map<uint64_t, SoftwareBreakpoint> m_breakpoints;
+		// Relative breakpoints, with the address they are resolved to, or 0 while the module is not loaded. Guarded by
+		// m_breakpointsMutex.
+		std::vector<std::pair<ModuleNameAndOffset, uint64_t>> m_relativeBreakpoints;
+		unsigned long m_nextBreakpointId = 1;
+		// Children of vfork() that run in the memory of the target without being debugged. The breakpoints are
+		// removed for them, and only inserted again once they are all gone. Guarded by m_breakpointsMutex.
+		size_t m_vforkChildren = 0;
+
+		// Pid -> the other processes of the session. Only modified by the tracer thread, with m_breakpointsMutex held.
+		std::map<pid_t, Inferior> m_otherInferiors;
+
+		// Hardware breakpoints and watchpoints, in the order they take the debug registers of every thread. Only
+		// accessed by the tracer thread.
+		std::vector<DebugHardwareBreakpoint> m_hardwareBreakpoints;
+		// Programs the debug registers of a stopped thread with m_hardwareBreakpoints, or clears them
+		bool WriteDebugRegisters(pid_t tid, bool enabled);
+		// Programs every thread of the current process. Fails when the breakpoints do not fit the debug registers.
+		bool ApplyHardwareBreakpoints();
+		// The index in m_hardwareBreakpoints of the breakpoint that stopped the thread, if any
+		std::optional<size_t> GetTriggeredHardwareBreakpoint(pid_t tid, const siginfo_t& info);
+		// Whether resuming the thread would stop it again on the same hardware breakpoint or watchpoint
+		bool IsOnHardwareBreakpoint(pid_t tid, uint64_t pc);
+
+		// Runs `work` on the tracer thread and waits for it. Fails without running it when the target is running or
+		// gone. Calls made on the tracer thread run right away.
+		bool RunOnTracer(const std::function<void()>& work);
+		void SetRunning(bool running);
+		void SetTargetInactive();
+		void TracerLoop();
+
+		void QueueEvent(const DebuggerEvent& event);
+		void StartEventThread();
+		void EventLoop();
+		// Forwards what the target writes to its stdout and stderr pipes, until StopOutputThread()
+		void StartOutputThread(int outputFd, int stderrFd);
+		void StopOutputThread();
+
+		bool Launch(const std::string& path, const std::vector<std::string>& args, const std::string& workingDir,
+			std::string& error);
+		bool AttachToProcess(pid_t pid, std::string& error);
+		void PrepareTarget();
+
+		// Handling of target events, on the tracer thread
+		void WaitForTargetEvent();
+		// Handles a status returned by waitpid() for a thread the tracer waited for directly
+		void DispatchWaitStatus(pid_t tid, int status);
+		void HandleThreadExit(pid_t tid, uint64_t exitCode);
+		void HandleProcessExit(uint64_t exitCode);
+		void HandleThreadStop(pid_t tid, int signal, int event);
+		void HandleTrap(pid_t tid);
+		void HandleBreakpointHit(pid_t tid, uint64_t address);
+		void HandleStepDone(pid_t tid);
+		void HandleClone(pid_t tid);
+		void HandleExec();
+		// `resume` is false when the fork is found while the target is being stopped
+		void HandleFork(pid_t tid, bool vfork, bool resume);
+		void HandleVforkDone(pid_t tid);
+		// The child of a vfork() is done with the memory of `pid`, so that parent is detached from
+		void FinishVforkParent(pid_t pid, pid_t tid, const siginfo_t& info);
+		void ReportStop(pid_t tid, DebugStopReason reason);
+		void StopOtherThreads(pid_t except);
+		void DetachFromTarget();
+		// Detaches from the current inferior only, and leaves the adapter without one
+		void DetachFromInferior();
+
+		// Makes another inferior the current one. The current one is kept as one of the others if `keepCurrent`, or
+		// dropped otherwise.
+		void SwitchToInferior(pid_t pid, bool keepCurrent);
+		// The process that the thread belongs to, if it is one of ours, or 0
+		pid_t GetInferiorOf(pid_t tid);
+		bool KillAllInferiors();
+		void PostBackendMessage(const std::string& message);
+
+		// Resuming, on the tracer thread
+		bool ResumeTarget(bool step, bool report);
+		void ContinueThread(pid_t tid, int signal);
+		// Single-steps the thread off the breakpoint it sits on, if any, and returns the status of the step. A hardware
+		// breakpoint or watchpoint is stepped off with the debug registers of the thread cleared.
+		bool StepOverBreakpoint(pid_t tid, int& status);
+
+		bool ReadRegisterSet(pid_t tid, user_regs_struct* regs);
+		bool WriteRegisterSet(pid_t tid, user_regs_struct* regs);
+		uint64_t GetThreadPC(pid_t tid);
+		bool SetThreadPC(pid_t tid, uint64_t pc);
+
+		size_t ReadTargetMemory(uint64_t address, uint8_t* buffer, size_t size);
+		bool WriteTargetMemory(uint64_t address, const uint8_t* buffer, size_t size);
+
+		// These must be called with m_breakpointsMutex held
+		bool InsertBreakpoint(uint64_t address, SoftwareBreakpoint& breakpoint);
+		bool RemoveBreakpointFromMemory(uint64_t address, SoftwareBreakpoint& breakpoint);
+		SoftwareBreakpoint& GetOrCreateBreakpoint(uint64_t address);
+		void ReleaseBreakpoint(std::map<uint64_t, SoftwareBreakpoint>::iterator it);
+		// Inserts the breakpoints in memory that was not mapped yet, and resolves the relative ones whose module is loaded
+		void InsertPendingBreakpoints();
+		// The same for another inferior, which may be running
+		void InsertPendingBreakpoints(Inferior& inferior);
+		void ReleaseBreakpoint(Inferior& inferior, std::map<uint64_t, SoftwareBreakpoint>::iterator it);
+		// Takes out a breakpoint that is in the memory of a forked child, as a copy of the one of its parent
+		static bool RestoreOriginalBytes(int memoryFd, uint64_t address, const SoftwareBreakpoint& breakpoint);
+
+		bool IsAtBreakpoint(uint64_t address);
+		static std::vector<DebugModule> ReadModuleList(pid_t pid);
+		void AddEntryBreakpoint();
+
+	public:
+		PtraceAdapter(BinaryView* data);
+		~PtraceAdapter();
+
+		bool Execute(const std::string& path, const LaunchConfigurations& configs) override;
+		bool ExecuteWithArgs(const std::string& path, const std::string& args, const std::string& workingDir,
+			const LaunchConfigurations& configs) override;
+		bool Attach(std::uint32_t pid) override;
+		bool Connect(const std::string& server, std::uint32_t port) override;
+
+		bool Detach() override;
+		bool Quit() override;
+
+		std::vector<DebugProcess> GetProcessList() override;
+		std::vector<DebugThread> GetThreadList() override;
+		DebugThread GetActiveThread() const override;
+		std::uint32_t GetActiveThreadId() const override;
+		bool SetActiveThread(const DebugThread& thread) override;
+		bool SetActiveThreadId(std::uint32_t tid) override;
+		bool SuspendThread(std::uint32_t tid) override;
+		bool ResumeThread(std::uint32_t tid) override;
+		std::vector<DebugFrame> GetFramesOfThread(std::uint32_t tid) override;
+
+		DebugBreakpoint AddBreakpoint(const std::uintptr_t address, unsigned long breakpoint_type = 0) override;
+		DebugBreakpoint AddBreakpoint(const ModuleNameAndOffset& address, unsigned long breakpoint_type = 0) override;
+		bool RemoveBreakpoint(const DebugBreakpoint& breakpoint) override;
+		bool RemoveBreakpoint(const ModuleNameAndOffset& address) override;
+		std::vector<DebugBreakpoint> GetBreakpointList() const override;
+		bool AddTemporaryBreakpoint(std::uintptr_t address) override;
+		void RemoveTemporaryBreakpoints() override;
+
+		bool AddHardwareBreakpoint(const DebugHardwareBreakpoint& breakpoint) override;
+		bool RemoveHardwareBreakpoint(const DebugHardwareBreakpoint& breakpoint) override;
+
+		std::unordered_map<std::string, DebugRegister> ReadAllRegisters() override;
+		DebugRegister ReadRegister(const std::string& reg) override;
+		bool WriteRegister(const std::string& reg, std::uintptr_t value) override;
+
+		DataBuffer ReadMemory(std::uintptr_t address, std::size_t size) override;
+		bool WriteMemory(std::uintptr_t address, const DataBuffer& buffer) override;
+
+		std::vector<DebugModule> GetModuleList() override;
+		std::string GetTargetArchitecture() override;
+
+		DebugStopReason StopReason() override;
+		uint64_t ExitCode() override;
+
+		bool BreakInto() override;
+		bool Go() override;
+		bool StepInto() override;
+		bool StepInstructions(uint64_t count, const std::function<bool(uint64_t)>& stopPredicate) override;
+		bool StepOver() override;
+
+		std::string InvokeBackendCommand(const std::string& command) override;
+		uint64_t GetInstructionOffset() override;
+		uint64_t GetStackPointer() override;
+
+		bool SupportFeature(DebugAdapterCapacity feature) override;
+
+		void WriteStdin(const std::string& msg) override;
+	};
+
+
+	class PtraceAdapterType : public DebugAdapterType
+	{
+	public:
+		PtraceAdapterType();
+		virtual DebugAdapter* Create(BinaryNinja::BinaryView* data);
+		virtual bool IsValidForData(BinaryNinja::BinaryView* data);
+		virtual bool CanExecute(BinaryNinja::BinaryView* data);
+		virtual bool CanConnect(BinaryNinja::BinaryView* data);
+	};
+
+
+	void InitPtraceAdapterType();
+};  // namespace BinaryNinjaDebugger
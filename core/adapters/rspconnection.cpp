@@ -0,0 +1,431 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "rspconnection.h"
+#include <cstring>
+#include <fmt/format.h>
+
+#ifdef WIN32
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+typedef SOCKET SocketHandle;
+#else
+	#include <netdb.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+	#include <poll.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+typedef int SocketHandle;
+#endif
+
+using namespace BinaryNinjaDebugger;
+
+
+static void CloseSocket(intptr_t socket)
+{
+#ifdef WIN32
+	closesocket((SOCKET)socket);
+#else
+	close((int)socket);
+#endif
+}
+
+
+RspConnection::RspConnection()
+{
+#ifdef WIN32
+	static bool initialized = false;
+	if (!initialized)
+	{
+		WSADATA data;
+		initialized = (WSAStartup(MAKEWORD(2, 2), &data) == 0);
+	}
+#endif
+}
+
+
+RspConnection::~RspConnection()
+{
+	Disconnect();
+}
+
+
+bool RspConnection::Connect(const std::string& host, uint32_t port, std::string& error)
+{
+	Disconnect();
+
+	addrinfo hints {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	addrinfo* addresses = nullptr;
+	int result = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses);
+	if (result != 0)
+	{
+		error = fmt::format("Failed to resolve {}: {}", host, gai_strerror(result));
+		return false;
+	}
+
+	for (addrinfo* address = addresses; address; address = address->ai_next)
+	{
+		auto fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+#ifdef WIN32
+		if (fd == INVALID_SOCKET)
+			continue;
+#else
+		if (fd < 0)
+			continue;
+#endif
+		if (connect(fd, address->ai_addr, (int)address->ai_addrlen) == 0)
+		{
+			m_socket = (intptr_t)fd;
+			break;
+		}
+		CloseSocket((intptr_t)fd);
+	}
+	freeaddrinfo(addresses);
+
+	if (m_socket == -1)
+	{
+		error = fmt::format("Failed to connect to {}:{}", host, port);
+		return false;
+	}
+
+	// Packets are small and each one waits for its reply, so Nagle's algorithm would only add latency
+	int noDelay = 1;
+	setsockopt((SocketHandle)m_socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+
+	m_ackMode = true;
+	m_input.clear();
+	m_lastPacket.clear();
+	return true;
+}
+
+
+void RspConnection::Disconnect()
+{
+	if (m_socket == -1)
+		return;
+
+	CloseSocket(m_socket);
+	m_socket = -1;
+}
+
+
+bool RspConnection::SendRaw(const std::string& data)
+{
+	std::unique_lock<std::mutex> lock(m_sendMutex);
+	size_t done = 0;
+	while (done < data.size())
+	{
+		if (m_socket == -1)
+			return false;
+
+		auto sent = send((SocketHandle)m_socket, data.data() + done, (int)(data.size() - done), 0);
+		if (sent <= 0)
+		{
+#ifndef WIN32
+			if (errno == EINTR)
+				continue;
+#endif
+			return false;
+		}
+		done += sent;
+	}
+	return true;
+}
+
+
+bool RspConnection::ReceiveMore(int timeoutMs, bool& timedOut)
+{
+	timedOut = false;
+	if (m_socket == -1)
+		return false;
+
+	if (timeoutMs >= 0)
+	{
+#ifdef WIN32
+		fd_set readSet;
+		FD_ZERO(&readSet);
+		FD_SET((SOCKET)m_socket, &readSet);
+		timeval timeout {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+		int ready = select(0, &readSet, nullptr, nullptr, &timeout);
+#else
+		pollfd pfd {(int)m_socket, POLLIN, 0};
+		int ready = poll(&pfd, 1, timeoutMs);
+		if ((ready < 0) && (errno == EINTR))
+			ready = 0;
+#endif
+		if (ready < 0)
+			return false;
+		if (ready == 0)
+		{
+			timedOut = true;
+			return false;
+		}
+	}
+
+	char buffer[0x10000];
+	while (true)
+	{
+		auto size = recv((SocketHandle)m_socket, buffer, sizeof(buffer), 0);
+		if (size > 0)
+		{
+			m_input.append(buffer, size);
+			return true;
+		}
+#ifndef WIN32
+		if ((size < 0) && (errno == EINTR))
+			continue;
+#endif
+		return false;
+	}
+}
+
+
+bool RspConnection::SendPacket(const std::string& payload)
+{
+	m_lastPacket = FramePacket(payload);
+	return SendRaw(m_lastPacket);
+}
+
+
+bool RspConnection::ReceivePacket(std::string& payload, int timeoutMs, bool* timedOut)
+{
+	bool didTimeOut = false;
+	while (true)
+	{
+		// Skip the acknowledgements, and anything else outside of a packet
+		size_t start = 0;
+		while (start < m_input.size())
+		{
+			char c = m_input[start];
+			if (c == '$')
+				break;
+			// A request for the last packet again. Notifications ('%') are for the non-stop mode, which we do not use.
+			if ((c == '-') && m_ackMode && !m_lastPacket.empty())
+				SendRaw(m_lastPacket);
+			start++;
+		}
+		m_input.erase(0, start);
+
+		size_t end = m_input.find('#');
+		if (!m_input.empty() && (end != std::string::npos) && (end + 2 < m_input.size()))
+		{
+			std::string raw = m_input.substr(1, end - 1);
+			uint8_t expected = (uint8_t)strtoul(m_input.substr(end + 1, 2).c_str(), nullptr, 16);
+			m_input.erase(0, end + 3);
+
+			if (m_ackMode)
+			{
+				if (Checksum(raw) != expected)
+				{
+					SendRaw("-");
+					continue;
+				}
+				SendRaw("+");
+			}
+
+			payload = DecodePayload(raw);
+			return true;
+		}
+
+		if (!ReceiveMore(timeoutMs, didTimeOut))
+		{
+			if (timedOut)
+				*timedOut = didTimeOut;
+			return false;
+		}
+	}
+}
+
+
+bool RspConnection::SendInterrupt()
+{
+	return SendRaw("\x03");
+}
+
+
+std::optional<std::string> RspConnection::Transact(const std::string& request)
+{
+	if (!SendPacket(request))
+		return std::nullopt;
+
+	std::string reply;
+	if (!ReceivePacket(reply))
+		return std::nullopt;
+	return reply;
+}
+
+
+std::vector<std::optional<std::string>> RspConnection::TransactPipelined(
+	const std::vector<std::string>& requests, size_t window)
+{
+	std::vector<std::optional<std::string>> replies(requests.size());
+	if (m_ackMode || (window < 2))
+	{
+		// A lost packet would have to be sent again, so only one can be in flight
+		for (size_t i = 0; i < requests.size(); i++)
+		{
+			replies[i] = Transact(requests[i]);
+			if (!replies[i].has_value())
+				break;
+		}
+		return replies;
+	}
+
+	size_t sent = 0;
+	size_t received = 0;
+	while (received < requests.size())
+	{
+		// Batch the writes that fit into the window, so they go out in as few segments as possible
+		std::string batch;
+		for (; (sent < requests.size()) && (sent - received < window); sent++)
+			batch += FramePacket(requests[sent]);
+		if (!batch.empty() && !SendRaw(batch))
+			return replies;
+
+		std::string reply;
+		if (!ReceivePacket(reply))
+			return replies;
+		replies[received++] = std::move(reply);
+	}
+	return replies;
+}
+
+
+uint8_t RspConnection::Checksum(const std::string& data)
+{
+	uint8_t checksum = 0;
+	for (char c : data)
+		checksum += (uint8_t)c;
+	return checksum;
+}
+
+
+std::string RspConnection::FramePacket(const std::string& payload)
+{
+	return fmt::format("${}#{:02x}", payload, Checksum(payload));
+}
+
+
+std::string RspConnection::DecodePayload(const std::string& raw)
+{
+	std::string payload;
+	payload.reserve(raw.size());
+	for (size_t i = 0; i < raw.size(); i++)
+	{
+		char c = raw[i];
+		if ((c == '}') && (i + 1 < raw.size()))
+		{
+			payload += (char)(raw[++i] ^ 0x20);
+		}
+		else if ((c == '*') && !payload.empty() && (i + 1 < raw.size()))
+		{
+			int count = (uint8_t)raw[++i] - 29;
+			if (count > 0)
+				payload.append(count, payload.back());
+		}
+		else
+		{
+			payload += c;
+		}
+	}
+	return payload;
+}
+
+
+std::string RspConnection::EscapeBinary(const uint8_t* data, size_t size)
+{
+	std::string result;
+	result.reserve(size);
+	for (size_t i = 0; i < size; i++)
+	{
+		char c = (char)data[i];
+		if ((c == '$') || (c == '#') || (c == '}') || (c == '*'))
+		{
+			result += '}';
+			result += (char)(c ^ 0x20);
+		}
+		else
+		{
+			result += c;
+		}
+	}
+	return result;
+}
+
+
+std::string RspConnection::ToHex(const uint8_t* data, size_t size)
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string result;
+	result.reserve(size * 2);
+	for (size_t i = 0; i < size; i++)
+	{
+		result += digits[data[i] >> 4];
+		result += digits[data[i] & 0xf];
+	}
+	return result;
+}
+
+
+std::string RspConnection::ToHex(const std::string& data)
+{
+	return ToHex((const uint8_t*)data.data(), data.size());
+}
+
+
+bool RspConnection::FromHex(const std::string& hex, std::vector<uint8_t>& data)
+{
+	auto digit = [](char c) -> int {
+		if ((c >= '0') && (c <= '9'))
+			return c - '0';
+		if ((c >= 'a') && (c <= 'f'))
+			return c - 'a' + 10;
+		if ((c >= 'A') && (c <= 'F'))
+			return c - 'A' + 10;
+		return -1;
+	};
+
+	data.clear();
+	data.reserve(hex.size() / 2);
+	for (size_t i = 0; i + 1 < hex.size(); i += 2)
+	{
+		int high = digit(hex[i]);
+		int low = digit(hex[i + 1]);
+		// Registers the stub cannot read are sent as "xx"
+		if ((high < 0) || (low < 0))
+		{
+			if ((hex[i] == 'x') && (hex[i + 1] == 'x'))
+			{
+				data.push_back(0);
+				continue;
+			}
+			return false;
+		}
+		data.push_back((uint8_t)((high << 4) | low));
+	}
+	return (hex.size() % 2) == 0;
+}
+
+
+bool RspConnection::IsErrorReply(const std::string& reply)
+{
+	return (reply.size() == 3) && (reply[0] == 'E') && isxdigit((unsigned char)reply[1])
+		&& isxdigit((unsigned char)reply[2]);
+}
@@ -0,0 +1,89 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace BinaryNinjaDebugger {
+	// A connection to a GDB remote serial protocol stub (gdbserver, qemu, lldb-server...) over TCP. It frames,
+	// checksums and decodes the packets, and handles the acknowledgements until no-ack mode is negotiated.
+	//
+	// Replies come back in the order of the requests, so once acknowledgements are off, independent requests can be
+	// sent back to back and their replies read afterwards. TransactPipelined() does that, so a batch of requests costs
+	// one round-trip instead of one per request.
+	//
+	// The connection is not thread-safe, except for SendInterrupt(), which can be called while another thread waits
+	// for a packet.
+	class RspConnection
+	{
+		intptr_t m_socket = -1;
+		bool m_ackMode = true;
+		// Bytes received but not consumed yet
+		std::string m_input;
+		// The last packet sent, in case the stub asks for it again
+		std::string m_lastPacket;
+		std::mutex m_sendMutex;
+
+		bool SendRaw(const std::string& data);
+		// Reads at least one byte into m_input. `timeoutMs` < 0 waits forever.
+		bool ReceiveMore(int timeoutMs, bool& timedOut);
+
+	public:
+		RspConnection();
+		~RspConnection();
+
+		bool Connect(const std::string& host, uint32_t port, std::string& error);
+		void Disconnect();
+		bool IsConnected() const { return m_socket != -1; }
+
+		// The stub stops acknowledging packets, and so do we
+		void SetAckMode(bool ackMode) { m_ackMode = ackMode; }
+		bool IsAckMode() const { return m_ackMode; }
+
+		bool SendPacket(const std::string& payload);
+		// Reads the next packet and returns its decoded payload. Returns false when the connection is lost, or when
+		// nothing arrives within `timeoutMs`, in which case `timedOut` is set.
+		bool ReceivePacket(std::string& payload, int timeoutMs = -1, bool* timedOut = nullptr);
+		// Sends the interrupt character (Ctrl+C), which stops a running target
+		bool SendInterrupt();
+
+		// Sends a request and waits for its reply. Returns nothing when the connection is lost.
+		std::optional<std::string> Transact(const std::string& request);
+		// Sends the requests with at most `window` of them in flight, and returns their replies in order. Without
+		// no-ack mode, the requests are sent one at a time. The replies after a lost connection are missing.
+		std::vector<std::optional<std::string>> TransactPipelined(
+			const std::vector<std::string>& requests, size_t window = 16);
+
+		// The modulo-256 sum of the bytes, which follows the '#' of a packet
+		static uint8_t Checksum(const std::string& data);
+		// "$<payload>#<checksum>"
+		static std::string FramePacket(const std::string& payload);
+		// Undoes the escaping and the run-length encoding of a received packet
+		static std::string DecodePayload(const std::string& raw);
+		// Escapes binary data for X packets
+		static std::string EscapeBinary(const uint8_t* data, size_t size);
+		static std::string ToHex(const uint8_t* data, size_t size);
+		static std::string ToHex(const std::string& data);
+		static bool FromHex(const std::string& hex, std::vector<uint8_t>& data);
+		// "E" followed by two hex digits
+		static bool IsErrorReply(const std::string& reply);
+	};
+};  // namespace BinaryNinjaDebugger
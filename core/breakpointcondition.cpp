@@ -0,0 +1,578 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <cctype>
+#include <cstring>
+#include "breakpointcondition.h"
+#include "debugadapter.h"
+
+using namespace BinaryNinjaDebugger;
+
+
+namespace {
+	// Recursive descent parser that emits BreakpointCondition bytecode directly, in C operator precedence order
+	class ConditionParser
+	{
+		const std::string& m_text;
+		size_t m_pos = 0;
+		size_t m_addressSize;
+		std::vector<BreakpointCondition::Instruction>& m_code;
+		std::vector<std::string>& m_registers;
+		std::string m_error;
+
+		void SkipSpaces()
+		{
+			while ((m_pos < m_text.size()) && isspace((unsigned char)m_text[m_pos]))
+				m_pos++;
+		}
+
+		bool Peek(const char* token)
+		{
+			SkipSpaces();
+			return m_text.compare(m_pos, strlen(token), token) == 0;
+		}
+
+		bool Accept(const char* token)
+		{
+			if (!Peek(token))
+				return false;
+			m_pos += strlen(token);
+			return true;
+		}
+
+		bool Fail(const std::string& message)
+		{
+			if (m_error.empty())
+				m_error = fmt::format("{} at offset {}", message, m_pos);
+			return false;
+		}
+
+		void Emit(BreakpointCondition::Opcode opcode, uint64_t operand = 0) { m_code.push_back({opcode, operand}); }
+
+		bool ParsePrimary()
+		{
+			SkipSpaces();
+			if (m_pos >= m_text.size())
+				return Fail("unexpected end of expression");
+
+			if (Accept("("))
+			{
+				if (!ParseLogicalOr())
+					return false;
+				if (!Accept(")"))
+					return Fail("expected ')'");
+				return true;
+			}
+
+			if (Accept("["))
+				return ParseMemoryRead(m_addressSize);
+
+			char c = m_text[m_pos];
+			if (isdigit((unsigned char)c))
+			{
+				size_t end = 0;
+				uint64_t value;
+				try
+				{
+					value = std::stoull(m_text.substr(m_pos), &end, 0);
+				}
+				catch (const std::exception&)
+				{
+					return Fail("invalid number");
+				}
+				m_pos += end;
+				Emit(BreakpointCondition::PushConstant, value);
+				return true;
+			}
+
+			if ((c == '$') || (c == '_') || isalpha((unsigned char)c))
+			{
+				if (c == '$')
+					m_pos++;
+				size_t start = m_pos;
+				while ((m_pos < m_text.size()) && (isalnum((unsigned char)m_text[m_pos]) || (m_text[m_pos] == '_')))
+					m_pos++;
+				std::string name = m_text.substr(start, m_pos - start);
+				if (name.empty())
+					return Fail("expected a register name");
+
+				// Sized memory reads, e.g., u32[rsp + 8]
+				static const std::pair<const char*, size_t> sizes[] = {{"u8", 1}, {"u16", 2}, {"u32", 4}, {"u64", 8}};
+				for (const auto& [prefix, size] : sizes)
+				{
+					if ((name == prefix) && Accept("["))
+						return ParseMemoryRead(size);
+				}
+
+				size_t index = 0;
+				while ((index < m_registers.size()) && (m_registers[index] != name))
+					index++;
+				if (index == m_registers.size())
+					m_registers.push_back(name);
+				Emit(BreakpointCondition::PushRegister, index);
+				return true;
+			}
+
+			return Fail(fmt::format("unexpected character '{}'", c));
+		}
+
+		bool ParseMemoryRead(size_t size)
+		{
+			if (!ParseLogicalOr())
+				return false;
+			if (!Accept("]"))
+				return Fail("expected ']'");
+			Emit(BreakpointCondition::ReadMemory, size);
+			return true;
+		}
+
+		bool ParseUnary()
+		{
+			if (Accept("-"))
+			{
+				if (!ParseUnary())
+					return false;
+				Emit(BreakpointCondition::Negate);
+				return true;
+			}
+			if (Accept("~"))
+			{
+				if (!ParseUnary())
+					return false;
+				Emit(BreakpointCondition::BitwiseNot);
+				return true;
+			}
+			if (Peek("!") && !Peek("!="))
+			{
+				m_pos++;
+				if (!ParseUnary())
+					return false;
+				Emit(BreakpointCondition::LogicalNot);
+				return true;
+			}
+			return ParsePrimary();
+		}
+
+		struct BinaryOperator
+		{
+			const char* token;
+			BreakpointCondition::Opcode opcode;
+			// Tokens that start with this one but denote a different operator, e.g., "<<" when looking for "<"
+			const char* exclude1;
+			const char* exclude2;
+		};
+
+		template <typename F>
+		bool ParseBinary(const std::vector<BinaryOperator>& operators, F next)
+		{
+			if (!(this->*next)())
+				return false;
+
+			while (true)
+			{
+				const BinaryOperator* match = nullptr;
+				for (const auto& op : operators)
+				{
+					if (!Peek(op.token))
+						continue;
+					if ((op.exclude1 && Peek(op.exclude1)) || (op.exclude2 && Peek(op.exclude2)))
+						continue;
+					match = &op;
+					break;
+				}
+				if (!match)
+					return true;
+
+				m_pos += strlen(match->token);
+				if (!(this->*next)())
+					return false;
+				Emit(match->opcode);
+			}
+		}
+
+		bool ParseMultiplicative()
+		{
+			return ParseBinary(
+				{
+					{"*", BreakpointCondition::Multiply, nullptr, nullptr},
+					{"/", BreakpointCondition::Divide, nullptr, nullptr},
+					{"%", BreakpointCondition::Modulo, nullptr, nullptr},
+				},
+				&ConditionParser::ParseUnary);
+		}
+
+		bool ParseAdditive()
+		{
+			return ParseBinary(
+				{
+					{"+", BreakpointCondition::Add, nullptr, nullptr},
+					{"-", BreakpointCondition::Subtract, nullptr, nullptr},
+				},
+				&ConditionParser::ParseMultiplicative);
+		}
+
+		bool ParseShift()
+		{
+			return ParseBinary(
+				{
+					{"<<", BreakpointCondition::ShiftLeft, nullptr, nullptr},
+					{">>", BreakpointCondition::ShiftRight, nullptr, nullptr},
+				},
+				&ConditionParser::ParseAdditive);
+		}
+
+		bool ParseRelational()
+		{
+			return ParseBinary(
+				{
+					{"<=", BreakpointCondition::LessEqual, nullptr, nullptr},
+					{">=", BreakpointCondition::GreaterEqual, nullptr, nullptr},
+					{"<", BreakpointCondition::Less, "<<", nullptr},
+					{">", BreakpointCondition::Greater, ">>", nullptr},
+				},
+				&ConditionParser::ParseShift);
+		}
+
+		bool ParseEquality()
+		{
+			return ParseBinary(
+				{
+					{"==", BreakpointCondition::Equal, nullptr, nullptr},
+					{"!=", BreakpointCondition::NotEqual, nullptr, nullptr},
+				},
+				&ConditionParser::ParseRelational);
+		}
+
+		bool ParseBitwiseAnd()
+		{
+			return ParseBinary({{"&", BreakpointCondition::BitwiseAnd, "&&", nullptr}}, &ConditionParser::ParseEquality);
+		}
+
+		bool ParseBitwiseXor()
+		{
+			return ParseBinary({{"^", BreakpointCondition::BitwiseXor, nullptr, nullptr}}, &ConditionParser::ParseBitwiseAnd);
+		}
+
+		bool ParseBitwiseOr()
+		{
+			return ParseBinary({{"|", BreakpointCondition::BitwiseOr, "||", nullptr}}, &ConditionParser::ParseBitwiseXor);
+		}
+
+		bool ParseShortCircuit(const char* token, BreakpointCondition::Opcode jump, bool (ConditionParser::*next)())
+		{
+			if (!(this->*next)())
+				return false;
+
+			std::vector<size_t> jumps;
+			while (Accept(token))
+			{
+				jumps.push_back(m_code.size());
+				Emit(jump);
+				if (!(this->*next)())
+					return false;
+			}
+
+			if (!jumps.empty())
+			{
+				Emit(BreakpointCondition::ToBool);
+				for (size_t jumpIndex : jumps)
+					m_code[jumpIndex].operand = m_code.size();
+			}
+			return true;
+		}
+
+		bool ParseLogicalAnd()
+		{
+			return ParseShortCircuit("&&", BreakpointCondition::JumpIfZero, &ConditionParser::ParseBitwiseOr);
+		}
+
+		bool ParseLogicalOr()
+		{
+			return ParseShortCircuit("||", BreakpointCondition::JumpIfNonZero, &ConditionParser::ParseLogicalAnd);
+		}
+
+	public:
+		ConditionParser(const std::string& text, size_t addressSize, std::vector<BreakpointCondition::Instruction>& code,
+			std::vector<std::string>& registers) :
+			m_text(text),
+			m_addressSize(addressSize), m_code(code), m_registers(registers)
+		{}
+
+		bool Parse()
+		{
+			if (!ParseLogicalOr())
+				return false;
+			SkipSpaces();
+			if (m_pos != m_text.size())
+				return Fail("unexpected trailing characters");
+			return true;
+		}
+
+		const std::string& GetError() const { return m_error; }
+	};
+}  // namespace
+
+
+bool BreakpointCondition::Compile(const std::string& text, size_t addressSize, std::string& error)
+{
+	std::vector<Instruction> code;
+	std::vector<std::string> registers;
+	ConditionParser parser(text, addressSize, code, registers);
+	if (!parser.Parse())
+	{
+		error = parser.GetError();
+		return false;
+	}
+
+	m_text = text;
+	m_code = std::move(code);
+	m_registers = std::move(registers);
+	return true;
+}
+
+
+bool BreakpointCondition::Evaluate(DebugAdapter* adapter, uint64_t& result) const
+{
+	if (m_code.empty())
+		return false;
+
+	std::vector<uint64_t> stack;
+	stack.reserve(16);
+
+	// Each register is read at most once per evaluation
+	std::vector<std::pair<bool, uint64_t>> registerValues(m_registers.size(), {false, 0});
+
+	size_t pc = 0;
+	while (pc < m_code.size())
+	{
+		const Instruction& instr = m_code[pc++];
+		switch (instr.opcode)
+		{
+		case PushConstant:
+			stack.push_back(instr.operand);
+			break;
+		case PushRegister:
+		{
+			auto& [valid, value] = registerValues[instr.operand];
+			if (!valid)
+			{
+				DebugRegister reg = adapter->ReadRegister(m_registers[instr.operand]);
+				if (reg.m_name.empty())
+					return false;
+				value = reg.m_value;
+				valid = true;
+			}
+			stack.push_back(value);
+			break;
+		}
+		case ReadMemory:
+		{
+			DataBuffer buffer = adapter->ReadMemory(stack.back(), instr.operand);
+			if (buffer.GetLength() != instr.operand)
+				return false;
+			uint64_t value = 0;
+			for (size_t i = 0; i < instr.operand; i++)
+				value |= ((uint64_t)buffer[i]) << (i * 8);
+			stack.back() = value;
+			break;
+		}
+		case Negate:
+			stack.back() = (uint64_t)(-(int64_t)stack.back());
+			break;
+		case BitwiseNot:
+			stack.back() = ~stack.back();
+			break;
+		case LogicalNot:
+			stack.back() = (stack.back() == 0);
+			break;
+		case ToBool:
+			stack.back() = (stack.back() != 0);
+			break;
+		case JumpIfZero:
+			if (stack.back() == 0)
+				pc = instr.operand;
+			else
+				stack.pop_back();
+			break;
+		case JumpIfNonZero:
+			if (stack.back() != 0)
+			{
+				stack.back() = 1;
+				pc = instr.operand;
+			}
+			else
+			{
+				stack.pop_back();
+			}
+			break;
+		default:
+		{
+			uint64_t right = stack.back();
+			stack.pop_back();
+			uint64_t& left = stack.back();
+			switch (instr.opcode)
+			{
+			case Add:
+				left += right;
+				break;
+			case Subtract:
+				left -= right;
+				break;
+			case Multiply:
+				left *= right;
+				break;
+			case Divide:
+				if (right == 0)
+					return false;
+				left /= right;
+				break;
+			case Modulo:
+				if (right == 0)
+					return false;
+				left %= right;
+				break;
+			case BitwiseAnd:
+				left &= right;
+				break;
+			case BitwiseOr:
+				left |= right;
+				break;
+			case BitwiseXor:
+				left ^= right;
+				break;
+			case ShiftLeft:
+				left = (right >= 64) ? 0 : (left << right);
+				break;
+			case ShiftRight:
+				left = (right >= 64) ? 0 : (left >> right);
+				break;
+			case Equal:
+				left = (left == right);
+				break;
+			case NotEqual:
+				left = (left != right);
+				break;
+			case Less:
+				left = (left < right);
+				break;
+			case LessEqual:
+				left = (left <= right);
+				break;
+			case Greater:
+				left = (left > right);
+				break;
+			case GreaterEqual:
+				left = (left >= right);
+				break;
+			default:
+				return false;
+			}
+			break;
+		}
+		}
+	}
+
+	if (stack.size() != 1)
+		return false;
+
+	result = stack.back();
+	return true;
+}
+
+
+bool BreakpointLogMessage::Compile(const std::string& text, size_t addressSize, std::string& error)
+{
+	std::vector<Segment> segments;
+	Segment current;
+	size_t pos = 0;
+	while (pos < text.size())
+	{
+		char c = text[pos];
+		if ((c == '{') && (pos + 1 < text.size()) && (text[pos + 1] == '{'))
+		{
+			current.literal += '{';
+			pos += 2;
+		}
+		else if ((c == '}') && (pos + 1 < text.size()) && (text[pos + 1] == '}'))
+		{
+			current.literal += '}';
+			pos += 2;
+		}
+		else if (c == '{')
+		{
+			size_t end = text.find('}', pos);
+			if (end == std::string::npos)
+			{
+				error = fmt::format("unterminated '{{' at offset {}", pos);
+				return false;
+			}
+
+			std::string expression = text.substr(pos + 1, end - pos - 1);
+			if (size_t colon = expression.rfind(':'); colon != std::string::npos)
+			{
+				std::string format = expression.substr(colon + 1);
+				if (format == "d")
+					current.decimal = true;
+				else if (format != "x")
+				{
+					error = fmt::format("unknown format specifier '{}'", format);
+					return false;
+				}
+				expression = expression.substr(0, colon);
+			}
+
+			if (!current.expression.Compile(expression, addressSize, error))
+				return false;
+
+			segments.push_back(std::move(current));
+			current = Segment();
+			pos = end + 1;
+		}
+		else
+		{
+			current.literal += c;
+			pos++;
+		}
+	}
+
+	if (!current.literal.empty())
+		segments.push_back(std::move(current));
+
+	m_text = text;
+	m_segments = std::move(segments);
+	return true;
+}
+
+
+std::string BreakpointLogMessage::Format(DebugAdapter* adapter) const
+{
+	std::string result;
+	for (const auto& segment : m_segments)
+	{
+		result += segment.literal;
+		if (segment.expression.IsEmpty())
+			continue;
+
+		uint64_t value;
+		if (!segment.expression.Evaluate(adapter, value))
+			result += "<error>";
+		else if (segment.decimal)
+			result += fmt::format("{}", value);
+		else
+			result += fmt::format("0x{:x}", value);
+	}
+	return result;
+}
@@ -0,0 +1,124 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace BinaryNinjaDebugger {
+	class DebugAdapter;
+
+	// A breakpoint condition is a small integer expression over registers and memory, e.g.,
+	//     rdi == 0x10 && u32[rsp + 8] != 0
+	// It is compiled once into a stack-based bytecode, so it can be evaluated by the adapter right when the breakpoint
+	// is hit, without sending a stop to the controller first.
+	//
+	// Supported syntax:
+	//   - integer literals, in decimal or hex (0x prefix)
+	//   - register names, optionally prefixed with `$` (e.g., `rax`, `$rax`)
+	//   - memory reads: `[expr]` reads a pointer-sized value; `u8[expr]`, `u16[expr]`, `u32[expr]` and `u64[expr]`
+	//     read the given width
+	//   - the C operators `+ - * / % & | ^ ~ << >> == != < <= > >= && || !` and parentheses, with C precedence
+	// All arithmetic is unsigned 64-bit.
+	class BreakpointCondition
+	{
+	public:
+		enum Opcode : uint8_t
+		{
+			PushConstant,
+			PushRegister,
+			ReadMemory,
+			Negate,
+			BitwiseNot,
+			LogicalNot,
+			Add,
+			Subtract,
+			Multiply,
+			Divide,
+			Modulo,
+			BitwiseAnd,
+			BitwiseOr,
+			BitwiseXor,
+			ShiftLeft,
+			ShiftRight,
+			Equal,
+			NotEqual,
+			Less,
+			LessEqual,
+			Greater,
+			GreaterEqual,
+			// Short-circuit for && and ||. If the top of the stack decides the result, it is normalized to 0/1 and
+			// execution jumps to `operand`; otherwise it is popped.
+			JumpIfZero,
+			JumpIfNonZero,
+			ToBool,
+		};
+
+		struct Instruction
+		{
+			Opcode opcode;
+			// The constant for PushConstant, the index into m_registers for PushRegister, the access size for
+			// ReadMemory, and the target for the jumps
+			uint64_t operand;
+		};
+
+	private:
+		std::string m_text;
+		std::vector<Instruction> m_code;
+		std::vector<std::string> m_registers;
+
+	public:
+		BreakpointCondition() = default;
+
+		// Returns false and sets `error` if the expression cannot be parsed. `addressSize` is the width of a `[expr]`
+		// memory read.
+		bool Compile(const std::string& text, size_t addressSize, std::string& error);
+
+		// Evaluates the condition against the current state of the target. Returns false if a register or memory read
+		// fails. `result` is only valid when the function returns true.
+		bool Evaluate(DebugAdapter* adapter, uint64_t& result) const;
+
+		const std::string& GetText() const { return m_text; }
+		bool IsEmpty() const { return m_code.empty(); }
+	};
+
+
+	// The message of a log point, e.g.,
+	//     "open({rdi:x}, flags={rsi:d}) len={u32[rsp + 8]}"
+	// Each {expr} is compiled like a BreakpointCondition and formatted in hex (the default, or with `:x`) or decimal
+	// (`:d`). Use {{ and }} for literal braces.
+	class BreakpointLogMessage
+	{
+		struct Segment
+		{
+			std::string literal;
+			BreakpointCondition expression;
+			bool decimal = false;
+		};
+
+		std::string m_text;
+		std::vector<Segment> m_segments;
+
+	public:
+		bool Compile(const std::string& text, size_t addressSize, std::string& error);
+		std::string Format(DebugAdapter* adapter) const;
+
+		const std::string& GetText() const { return m_text; }
+		bool IsEmpty() const { return m_segments.empty(); }
+	};
+};  // namespace BinaryNinjaDebugger
@@ -0,0 +1,179 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "breakpointmetadata.h"
+#include <algorithm>
+#include <unordered_map>
+
+using namespace BinaryNinjaDebugger;
+
+
+// Breakpoints are stored under "debugger.breakpoints" as a single raw blob rather than an array of key-value stores, so
+// that writing them out is a single allocation instead of three Metadata objects per breakpoint. The layout is
+// (all fields little-endian):
+//   uint32_t version
+//   uint32_t moduleCount, followed by moduleCount entries of { uint32_t length; char name[length]; }
+//   uint32_t breakpointCount, followed by breakpointCount entries of
+//     { uint32_t module; uint32_t flags; uint64_t offset; }
+//   followed by { uint32_t length; char condition[length]; } if (flags & BreakpointHasCondition), and then
+//   { uint32_t length; char message[length]; } if (flags & BreakpointHasLogMessage)
+// Module names are deduplicated into the module table.
+static constexpr uint32_t BreakpointMetadataVersion = 2;
+static constexpr uint32_t BreakpointHasCondition = 1;
+static constexpr uint32_t BreakpointHasLogMessage = 2;
+
+
+static void AppendInteger(std::vector<uint8_t>& buffer, uint64_t value, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		buffer.push_back((uint8_t)(value >> (i * 8)));
+}
+
+
+static void AppendString(std::vector<uint8_t>& buffer, const std::string& value)
+{
+	AppendInteger(buffer, value.size(), 4);
+	buffer.insert(buffer.end(), value.begin(), value.end());
+}
+
+
+static bool ReadInteger(const std::vector<uint8_t>& buffer, size_t& cursor, size_t size, uint64_t& value)
+{
+	if (buffer.size() - cursor < size)
+		return false;
+
+	value = 0;
+	for (size_t i = 0; i < size; i++)
+		value |= ((uint64_t)buffer[cursor + i]) << (i * 8);
+	cursor += size;
+	return true;
+}
+
+
+static bool ReadString(const std::vector<uint8_t>& buffer, size_t& cursor, std::string& value)
+{
+	uint64_t length;
+	if (!ReadInteger(buffer, cursor, 4, length) || (buffer.size() - cursor < length))
+		return false;
+
+	value.assign((const char*)buffer.data() + cursor, length);
+	cursor += length;
+	return true;
+}
+
+
+std::vector<uint8_t> BinaryNinjaDebugger::PackBreakpoints(const std::vector<ModuleNameAndOffset>& breakpoints,
+	const std::map<ModuleNameAndOffset, BreakpointOptions>& options)
+{
+	std::vector<uint8_t> buffer;
+	buffer.reserve(12 + breakpoints.size() * 16);
+
+	std::unordered_map<std::string, uint32_t> moduleIndex;
+	std::vector<const std::string*> modules;
+	std::vector<uint32_t> breakpointModules;
+	breakpointModules.reserve(breakpoints.size());
+	for (const ModuleNameAndOffset& bp : breakpoints)
+	{
+		auto [iter, inserted] = moduleIndex.try_emplace(bp.module, (uint32_t)modules.size());
+		if (inserted)
+			modules.push_back(&iter->first);
+		breakpointModules.push_back(iter->second);
+	}
+
+	AppendInteger(buffer, BreakpointMetadataVersion, 4);
+	AppendInteger(buffer, modules.size(), 4);
+	for (const std::string* module : modules)
+		AppendString(buffer, *module);
+
+	AppendInteger(buffer, breakpoints.size(), 4);
+	for (size_t i = 0; i < breakpoints.size(); i++)
+	{
+		BreakpointOptions bpOptions;
+		if (auto it = options.find(breakpoints[i]); it != options.end())
+			bpOptions = it->second;
+
+		uint32_t flags = 0;
+		if (!bpOptions.condition.empty())
+			flags |= BreakpointHasCondition;
+		if (!bpOptions.logMessage.empty())
+			flags |= BreakpointHasLogMessage;
+
+		AppendInteger(buffer, breakpointModules[i], 4);
+		AppendInteger(buffer, flags, 4);
+		AppendInteger(buffer, breakpoints[i].offset, 8);
+		if (flags & BreakpointHasCondition)
+			AppendString(buffer, bpOptions.condition);
+		if (flags & BreakpointHasLogMessage)
+			AppendString(buffer, bpOptions.logMessage);
+	}
+	return buffer;
+}
+
+
+bool BinaryNinjaDebugger::UnpackBreakpoints(const std::vector<uint8_t>& buffer,
+	std::vector<ModuleNameAndOffset>& breakpoints, std::map<ModuleNameAndOffset, BreakpointOptions>& options)
+{
+	breakpoints.clear();
+	options.clear();
+
+	size_t cursor = 0;
+	uint64_t version, moduleCount;
+	if (!ReadInteger(buffer, cursor, 4, version) || (version == 0) || (version > BreakpointMetadataVersion))
+		return false;
+
+	if (!ReadInteger(buffer, cursor, 4, moduleCount))
+		return false;
+
+	std::vector<std::string> modules;
+	modules.reserve(std::min<uint64_t>(moduleCount, buffer.size() / 4));
+	for (uint64_t i = 0; i < moduleCount; i++)
+	{
+		std::string module;
+		if (!ReadString(buffer, cursor, module))
+			return false;
+		modules.push_back(std::move(module));
+	}
+
+	uint64_t count;
+	if (!ReadInteger(buffer, cursor, 4, count))
+		return false;
+
+	breakpoints.reserve(std::min<uint64_t>(count, buffer.size() / 16));
+	for (uint64_t i = 0; i < count; i++)
+	{
+		uint64_t module, flags, offset;
+		if (!ReadInteger(buffer, cursor, 4, module) || !ReadInteger(buffer, cursor, 4, flags)
+			|| !ReadInteger(buffer, cursor, 8, offset))
+			break;
+
+		BreakpointOptions bpOptions;
+		if (version >= 2)
+		{
+			if ((flags & BreakpointHasCondition) && !ReadString(buffer, cursor, bpOptions.condition))
+				break;
+			if ((flags & BreakpointHasLogMessage) && !ReadString(buffer, cursor, bpOptions.logMessage))
+				break;
+		}
+
+		if (module >= modules.size())
+			continue;
+
+		breakpoints.emplace_back(modules[module], offset);
+		if (!bpOptions.IsEmpty())
+			options[breakpoints.back()] = bpOptions;
+	}
+	return true;
+}
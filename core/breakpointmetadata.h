@@ -0,0 +1,48 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "debuggercommon.h"
+
+namespace BinaryNinjaDebugger {
+	// Options of a breakpoint that are carried out by the adapter when the breakpoint is hit
+	struct BreakpointOptions
+	{
+		std::string condition;
+		// Non-empty for log points, which print the message and do not stop
+		std::string logMessage;
+		// Not persisted
+		uint64_t ignoreCount = 0;
+
+		bool IsEmpty() const { return condition.empty() && logMessage.empty() && (ignoreCount == 0); }
+	};
+
+
+	// Packs the breakpoints into the blob that is stored under "debugger.breakpoints". See breakpointmetadata.cpp for
+	// the layout.
+	std::vector<uint8_t> PackBreakpoints(const std::vector<ModuleNameAndOffset>& breakpoints,
+		const std::map<ModuleNameAndOffset, BreakpointOptions>& options);
+
+	// Unpacks a blob written by PackBreakpoints(). Returns false if it is of an unsupported version or its header is
+	// cut short. A breakpoint that is cut short ends the list, and the ones before it are kept.
+	bool UnpackBreakpoints(const std::vector<uint8_t>& buffer, std::vector<ModuleNameAndOffset>& breakpoints,
+		std::map<ModuleNameAndOffset, BreakpointOptions>& options);
+};  // namespace BinaryNinjaDebugger
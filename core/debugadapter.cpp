@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <inttypes.h>
 #include <binaryninjacore.h>
 #include <binaryninjaapi.h>
 #include <lowlevelilinstruction.h>
@@ -59,6 +60,25 @@ void DebugAdapter::PostDebuggerEvent(const DebuggerEvent& event)
 }
 
 
+void DebugAdapter::PostTargetOutput(TargetOutputChannel channel, const char* data, size_t size)
+{
+	if (size == 0)
+		return;
+
+	if (m_targetOutputCallback)
+	{
+		m_targetOutputCallback(channel, data, size);
+		return;
+	}
+
+	DebuggerEvent event;
+	event.type = StdoutMessageEventType;
+	event.data.messageData.message = std::string(data, size);
+	event.data.messageData.channel = channel;
+	PostDebuggerEvent(event);
+}
+
+
 std::string DebugModule::GetPathBaseName(const std::string& path)
 {
 #ifdef WIN32
@@ -105,6 +125,12 @@ bool DebugAdapter::StepIntoReverse()
 }
 
 
+bool DebugAdapter::StepInstructions(uint64_t count, const std::function<bool(uint64_t)>& stopPredicate)
+{
+	return false;
+}
+
+
 bool DebugAdapter::StepOverReverse()
 {
 	return false;
@@ -162,3 +188,269 @@ bool DebugAdapter::SetProperty(const std::string& name, const BinaryNinja::Ref<B
 {
 	return false;
 }
+
+
+static size_t GetAddressSize(const std::string& archName)
+{
+	auto arch = Architecture::GetByName(archName);
+	return arch ? arch->GetAddressSize() : 8;
+}
+
+
+static bool CompileBreakpointCondition(
+	const std::string& archName, const std::string& condition, BreakpointCondition& compiled)
+{
+	std::string error;
+	if (!compiled.Compile(condition, GetAddressSize(archName), error))
+	{
+		LogWarn("Invalid breakpoint condition \"%s\": %s", condition.c_str(), error.c_str());
+		return false;
+	}
+	return true;
+}
+
+
+static bool CompileBreakpointLogMessage(
+	const std::string& archName, const std::string& message, BreakpointLogMessage& compiled)
+{
+	std::string error;
+	if (!compiled.Compile(message, GetAddressSize(archName), error))
+	{
+		LogWarn("Invalid breakpoint log message \"%s\": %s", message.c_str(), error.c_str());
+		return false;
+	}
+	return true;
+}
+
+
+void DebugAdapter::UpdateBreakpointOptions(
+	const ModuleNameAndOffset& address, const std::function<void(AdapterBreakpointOptions&)>& update)
+{
+	std::unique_lock<std::mutex> lock(m_breakpointOptionsMutex);
+	auto it = std::find_if(m_relativeBreakpointOptions.begin(), m_relativeBreakpointOptions.end(),
+		[&](const auto& entry) { return entry.first == address; });
+	if (it == m_relativeBreakpointOptions.end())
+	{
+		m_relativeBreakpointOptions.emplace_back(address, AdapterBreakpointOptions {});
+		it = m_relativeBreakpointOptions.end() - 1;
+	}
+
+	update(it->second);
+	if (it->second.IsEmpty())
+		m_relativeBreakpointOptions.erase(it);
+
+	m_breakpointOptionsResolved = false;
+}
+
+
+void DebugAdapter::UpdateBreakpointOptions(
+	std::uintptr_t address, const std::function<void(AdapterBreakpointOptions&)>& update)
+{
+	std::unique_lock<std::mutex> lock(m_breakpointOptionsMutex);
+	auto& options = m_absoluteBreakpointOptions[address];
+	update(options);
+	if (options.IsEmpty())
+		m_absoluteBreakpointOptions.erase(address);
+
+	m_breakpointOptionsResolved = false;
+}
+
+
+bool DebugAdapter::SetBreakpointCondition(const ModuleNameAndOffset& address, const std::string& condition)
+{
+	BreakpointCondition compiled;
+	if (!condition.empty() && !CompileBreakpointCondition(m_defaultArchitecture, condition, compiled))
+		return false;
+
+	UpdateBreakpointOptions(address, [&](AdapterBreakpointOptions& options) { options.condition = compiled; });
+	return true;
+}
+
+
+bool DebugAdapter::SetBreakpointCondition(std::uintptr_t address, const std::string& condition)
+{
+	BreakpointCondition compiled;
+	if (!condition.empty() && !CompileBreakpointCondition(m_defaultArchitecture, condition, compiled))
+		return false;
+
+	UpdateBreakpointOptions(address, [&](AdapterBreakpointOptions& options) { options.condition = compiled; });
+	return true;
+}
+
+
+bool DebugAdapter::SetBreakpointLogMessage(const ModuleNameAndOffset& address, const std::string& message)
+{
+	BreakpointLogMessage compiled;
+	if (!message.empty() && !CompileBreakpointLogMessage(m_defaultArchitecture, message, compiled))
+		return false;
+
+	UpdateBreakpointOptions(address, [&](AdapterBreakpointOptions& options) { options.logMessage = compiled; });
+	return true;
+}
+
+
+bool DebugAdapter::SetBreakpointLogMessage(std::uintptr_t address, const std::string& message)
+{
+	BreakpointLogMessage compiled;
+	if (!message.empty() && !CompileBreakpointLogMessage(m_defaultArchitecture, message, compiled))
+		return false;
+
+	UpdateBreakpointOptions(address, [&](AdapterBreakpointOptions& options) { options.logMessage = compiled; });
+	return true;
+}
+
+
+void DebugAdapter::SetBreakpointIgnoreCount(const ModuleNameAndOffset& address, uint64_t count)
+{
+	UpdateBreakpointOptions(address, [&](AdapterBreakpointOptions& options) { options.ignoreCount = count; });
+}
+
+
+void DebugAdapter::SetBreakpointIgnoreCount(std::uintptr_t address, uint64_t count)
+{
+	UpdateBreakpointOptions(address, [&](AdapterBreakpointOptions& options) { options.ignoreCount = count; });
+}
+
+
+uint64_t DebugAdapter::GetBreakpointHitCount(std::uintptr_t address)
+{
+	std::unique_lock<std::mutex> lock(m_breakpointOptionsMutex);
+	auto it = m_breakpointHitCounts.find(address);
+	if (it == m_breakpointHitCounts.end())
+		return 0;
+	return it->second;
+}
+
+
+void DebugAdapter::InvalidateBreakpointConditionAddresses()
+{
+	std::unique_lock<std::mutex> lock(m_breakpointOptionsMutex);
+	m_breakpointOptionsResolved = false;
+}
+
+
+void DebugAdapter::ResolveBreakpointOptions()
+{
+	m_resolvedBreakpointOptions.clear();
+	for (auto& [address, options] : m_absoluteBreakpointOptions)
+		m_resolvedBreakpointOptions[address] = &options;
+
+	if (!m_relativeBreakpointOptions.empty())
+	{
+		std::vector<DebugModule> modules = GetModuleList();
+		for (auto& [address, options] : m_relativeBreakpointOptions)
+		{
+			// Same as DebuggerModules::RelativeAddressToAbsolute()
+			uint64_t absolute = address.offset;
+			if (!address.module.empty())
+			{
+				auto module = std::find_if(modules.begin(), modules.end(),
+					[&](const DebugModule& m) { return m.IsSameBaseModule(address.module); });
+				if (module == modules.end())
+					continue;
+				absolute = module->m_address + address.offset;
+			}
+			m_resolvedBreakpointOptions[absolute] = &options;
+		}
+	}
+	m_breakpointOptionsResolved = true;
+}
+
+
+bool DebugAdapter::ShouldStopAtBreakpoint(std::uintptr_t address)
+{
+	std::string logMessage;
+	{
+		std::unique_lock<std::mutex> lock(m_breakpointOptionsMutex);
+		if (m_relativeBreakpointOptions.empty() && m_absoluteBreakpointOptions.empty())
+		{
+			m_breakpointHitCounts[address]++;
+			return true;
+		}
+
+		if (!m_breakpointOptionsResolved)
+			ResolveBreakpointOptions();
+
+		auto it = m_resolvedBreakpointOptions.find(address);
+		if (it == m_resolvedBreakpointOptions.end())
+		{
+			m_breakpointHitCounts[address]++;
+			return true;
+		}
+
+		AdapterBreakpointOptions* options = it->second;
+		if (!options->condition.IsEmpty())
+		{
+			uint64_t result = 0;
+			if (!options->condition.Evaluate(this, result))
+			{
+				// Stop when in doubt, so the user can see why the condition cannot be evaluated
+				LogWarn("Failed to evaluate breakpoint condition \"%s\" at 0x%" PRIx64,
+					options->condition.GetText().c_str(), (uint64_t)address);
+				m_breakpointHitCounts[address]++;
+				return true;
+			}
+			if (result == 0)
+				return false;
+		}
+
+		m_breakpointHitCounts[address]++;
+		if (options->ignoreCount > 0)
+		{
+			options->ignoreCount--;
+			return false;
+		}
+
+		if (options->logMessage.IsEmpty())
+			return true;
+
+		logMessage = options->logMessage.Format(this);
+	}
+
+	std::unique_lock<std::mutex> lock(m_breakpointLogMutex);
+	if (m_pendingBreakpointLog.size() >= MaxPendingBreakpointLogMessages)
+	{
+		m_pendingBreakpointLog.pop_front();
+		m_droppedBreakpointLogMessages++;
+	}
+	m_pendingBreakpointLog.push_back(std::move(logMessage));
+	return false;
+}
+
+
+bool DebugAdapter::HasPendingBreakpointLog()
+{
+	std::unique_lock<std::mutex> lock(m_breakpointLogMutex);
+	return !m_pendingBreakpointLog.empty();
+}
+
+
+void DebugAdapter::FlushBreakpointLog(bool force)
+{
+	std::string output;
+	{
+		std::unique_lock<std::mutex> lock(m_breakpointLogMutex);
+		if (m_pendingBreakpointLog.empty())
+			return;
+
+		auto now = std::chrono::steady_clock::now();
+		if (!force && (now - m_lastBreakpointLogFlush < BreakpointLogFlushInterval))
+			return;
+
+		if (m_droppedBreakpointLogMessages > 0)
+			output = fmt::format("[{} log point messages dropped]\n", m_droppedBreakpointLogMessages);
+		for (const auto& line : m_pendingBreakpointLog)
+		{
+			output += line;
+			output += '\n';
+		}
+		m_pendingBreakpointLog.clear();
+		m_droppedBreakpointLogMessages = 0;
+		m_lastBreakpointLogFlush = now;
+	}
+
+	DebuggerEvent event;
+	event.type = BreakpointLogEventType;
+	event.data.messageData.message = output;
+	PostDebuggerEvent(event);
+}
@@ -24,12 +24,17 @@ limitations under the License.
 #include <functional>
 #include <unordered_map>
 #include <array>
+#include <mutex>
+#include <deque>
+#include <chrono>
 #include "binaryninjaapi.h"
 #include <fmt/format.h>
 #include "../api/ffi.h"
 #include "ffi_global.h"
 #include "debuggercommon.h"
 #include "debuggerevent.h"
+#include "breakpointcondition.h"
+#include "processlist.h"
 
 DECLARE_DEBUGGER_API_OBJECT(BNDebugAdapter, DebugAdapter);
 
@@ -55,6 +60,9 @@ namespace BinaryNinjaDebugger {
 		DebugAdapterSupportModules,
 		DebugAdapterSupportThreads,
 		DebugAdapterSupportTTD,
+		DebugAdapterSupportStepInstructions,
+		// Adapters that do not support it get a step return emulated with a breakpoint at the return address
+		DebugAdapterSupportStepReturn,
 	};
 
 
@@ -72,26 +80,6 @@ namespace BinaryNinjaDebugger {
 	};
 
 
-	struct DebugProcess
-	{
-		std::uint32_t m_pid {};
-		std::string m_processName {};
-
-		DebugProcess() {}
-
-		DebugProcess(std::uint32_t pid) : m_pid(pid) {}
-
-		DebugProcess(std::uint32_t pid, std::string name) : m_pid(pid), m_processName(name) {}
-
-		bool operator==(const DebugProcess& rhs) const
-		{
-			return (m_pid == rhs.m_pid) && (m_processName == rhs.m_processName);
-		}
-
-		bool operator!=(const DebugProcess& rhs) const { return !(*this == rhs); }
-	};
-
-
 	struct DebugThread
 	{
 		std::uint32_t m_tid {};
@@ -129,6 +117,49 @@ namespace BinaryNinjaDebugger {
 		bool operator!() const { return !this->m_address && !this->m_id && !this->m_is_active; }
 	};
 
+	struct DebugHardwareBreakpoint
+	{
+		std::uintptr_t m_address {};
+		DebugBreakpointType m_type = HardwareExecuteBreakpoint;
+		// The length of the watched range. Must be 1, 2, 4 or 8, and the address must be aligned to it.
+		// Ignored for execution breakpoints.
+		std::size_t m_size = 1;
+
+		DebugHardwareBreakpoint() = default;
+
+		DebugHardwareBreakpoint(std::uintptr_t address, DebugBreakpointType type, std::size_t size) :
+			m_address(address), m_type(type), m_size(size)
+		{}
+
+		bool IsWatchpoint() const { return m_type != HardwareExecuteBreakpoint; }
+
+		bool operator==(const DebugHardwareBreakpoint& rhs) const
+		{
+			return (m_address == rhs.m_address) && (m_type == rhs.m_type) && (m_size == rhs.m_size);
+		}
+	};
+
+	// A watchpoint implemented with page protections rather than debug registers. It can cover any number of bytes,
+	// and there is no limit on how many of them are active.
+	struct SoftwareWatchpoint
+	{
+		std::uintptr_t m_address {};
+		std::size_t m_size {};
+		// One of the watchpoint types
+		DebugBreakpointType m_type = HardwareWriteWatchpoint;
+
+		SoftwareWatchpoint() = default;
+
+		SoftwareWatchpoint(std::uintptr_t address, std::size_t size, DebugBreakpointType type) :
+			m_address(address), m_size(size), m_type(type)
+		{}
+
+		bool operator==(const SoftwareWatchpoint& rhs) const
+		{
+			return (m_address == rhs.m_address) && (m_size == rhs.m_size) && (m_type == rhs.m_type);
+		}
+	};
+
 	struct DebugRegister
 	{
 		std::string m_name {};
@@ -195,6 +226,43 @@ namespace BinaryNinjaDebugger {
 		// TODO: we should not use a vector here; only the DebuggerController should register one here;
 		// Other components should register their callbacks to the controller, who is responsible for notify them.
 		std::function<void(const DebuggerEvent& event)> m_eventCallback;
+		// Where the output of the target goes, see PostTargetOutput()
+		std::function<void(TargetOutputChannel channel, const char* data, size_t size)> m_targetOutputCallback;
+
+		// Per-breakpoint options that are handled by the adapter itself when a breakpoint is hit, see
+		// ShouldStopAtBreakpoint()
+		struct AdapterBreakpointOptions
+		{
+			BreakpointCondition condition;
+			BreakpointLogMessage logMessage;
+			uint64_t ignoreCount = 0;
+
+			bool IsEmpty() const { return condition.IsEmpty() && logMessage.IsEmpty() && (ignoreCount == 0); }
+		};
+
+		// Relative ones are resolved to absolute addresses lazily, the first time a breakpoint is hit after the module
+		// list changes. m_resolvedBreakpointOptions points into the other two containers, and is rebuilt whenever they
+		// change.
+		std::mutex m_breakpointOptionsMutex;
+		std::vector<std::pair<ModuleNameAndOffset, AdapterBreakpointOptions>> m_relativeBreakpointOptions;
+		std::unordered_map<uint64_t, AdapterBreakpointOptions> m_absoluteBreakpointOptions;
+		std::unordered_map<uint64_t, AdapterBreakpointOptions*> m_resolvedBreakpointOptions;
+		bool m_breakpointOptionsResolved = false;
+		std::unordered_map<uint64_t, uint64_t> m_breakpointHitCounts;
+		void ResolveBreakpointOptions();
+		void UpdateBreakpointOptions(
+			const ModuleNameAndOffset& address, const std::function<void(AdapterBreakpointOptions&)>& update);
+		void UpdateBreakpointOptions(
+			std::uintptr_t address, const std::function<void(AdapterBreakpointOptions&)>& update);
+
+		// Output of log points, waiting to be sent in a single BreakpointLogEventType event. It is capped at
+		// MaxPendingBreakpointLogMessages lines, and the oldest ones are dropped after that.
+		std::mutex m_breakpointLogMutex;
+		std::deque<std::string> m_pendingBreakpointLog;
+		size_t m_droppedBreakpointLogMessages = 0;
+		std::chrono::steady_clock::time_point m_lastBreakpointLogFlush;
+		static constexpr size_t MaxPendingBreakpointLogMessages = 10000;
+		static constexpr std::chrono::milliseconds BreakpointLogFlushInterval {100};
 
 	protected:
 		uint64_t m_entryPoint;
@@ -215,6 +283,12 @@ namespace BinaryNinjaDebugger {
 			m_eventCallback = function;
 		}
 
+		void SetTargetOutputCallback(
+			std::function<void(TargetOutputChannel channel, const char* data, size_t size)> function)
+		{
+			m_targetOutputCallback = function;
+		}
+
 		[[nodiscard]] virtual bool Execute(const std::string& path, const LaunchConfigurations& configs = {}) = 0;
 
 		[[nodiscard]] virtual bool ExecuteWithArgs(const std::string& path, const std::string& args,
@@ -260,6 +334,73 @@ namespace BinaryNinjaDebugger {
 
 		virtual std::vector<DebugBreakpoint> GetBreakpointList() const = 0;
 
+		// Temporary breakpoints implement run-to and the emulated step over/return. They never show up in
+		// DebuggerBreakpoints or the UI, and the adapter removes all of them as soon as it reports a stop, or when the
+		// target exits. Adapters that do not support them return false, and the caller falls back to AddBreakpoint().
+		virtual bool AddTemporaryBreakpoint(std::uintptr_t address) { return false; }
+
+		virtual void RemoveTemporaryBreakpoints() {}
+
+		// Coverage breakpoints record the first hit of each address in a bitmap and are removed right away, without
+		// stopping the target. `addresses` must be sorted. GetCoverage() returns one bit per address.
+		virtual bool StartCoverage(const std::vector<uint64_t>& addresses) { return false; }
+
+		virtual std::vector<bool> GetCoverage() { return {}; }
+
+		virtual void StopCoverage() {}
+
+		// Hardware breakpoints and watchpoints use the debug registers of the CPU, so only a few of them (four on
+		// x86_64) can be active at the same time. Adapters that do not support them return false.
+		virtual bool AddHardwareBreakpoint(const DebugHardwareBreakpoint& breakpoint) { return false; }
+
+		virtual bool RemoveHardwareBreakpoint(const DebugHardwareBreakpoint& breakpoint) { return false; }
+
+		// Software watchpoints only exist while the target is running, and can only be changed while it is stopped
+		virtual bool AddSoftwareWatchpoint(const SoftwareWatchpoint& watchpoint) { return false; }
+
+		virtual bool RemoveSoftwareWatchpoint(const SoftwareWatchpoint& watchpoint) { return false; }
+
+		virtual std::vector<SoftwareWatchpoint> GetSoftwareWatchpoints() { return {}; }
+
+		// Attach a condition to a breakpoint. The condition is compiled once and evaluated by the adapter itself when
+		// the breakpoint is hit (see ShouldStopAtBreakpoint()), so a false condition costs no round-trip to the
+		// controller. An empty condition removes it. Returns false if the condition cannot be compiled.
+		virtual bool SetBreakpointCondition(const ModuleNameAndOffset& address, const std::string& condition);
+
+		virtual bool SetBreakpointCondition(std::uintptr_t address, const std::string& condition);
+
+		// Turn a breakpoint into a log point: when hit, the message is formatted and queued, and the target resumes
+		// without stopping. An empty message turns it back into a normal breakpoint.
+		virtual bool SetBreakpointLogMessage(const ModuleNameAndOffset& address, const std::string& message);
+
+		virtual bool SetBreakpointLogMessage(std::uintptr_t address, const std::string& message);
+
+		// Do not stop at the next `count` hits of the breakpoint
+		virtual void SetBreakpointIgnoreCount(const ModuleNameAndOffset& address, uint64_t count);
+
+		virtual void SetBreakpointIgnoreCount(std::uintptr_t address, uint64_t count);
+
+		// Number of times the breakpoint at the address has been hit (and its condition, if any, was true), including
+		// the ignored hits and log point hits
+		virtual uint64_t GetBreakpointHitCount(std::uintptr_t address);
+
+		// Adapters call this when the target stops at a breakpoint. It updates the hit count, and returns false if
+		// the stop should not be reported: the condition is false, the hit is ignored, or the breakpoint is a log
+		// point. In that case the adapter should resume the target right away.
+		bool ShouldStopAtBreakpoint(std::uintptr_t address);
+
+		// Adapters call this when the module list changes, so relative breakpoint options are resolved again
+		void InvalidateBreakpointConditionAddresses();
+
+		// Adapters call this periodically from their event thread, and with `force` right before reporting a stop or
+		// exit. It sends the queued log point output in one BreakpointLogEventType event, at most once per
+		// BreakpointLogFlushInterval unless forced.
+		void FlushBreakpointLog(bool force = false);
+
+		// Whether log point output is waiting to be flushed. Event threads that block without a timeout use it to
+		// decide whether they need one.
+		bool HasPendingBreakpointLog();
+
 		virtual std::unordered_map<std::string, DebugRegister> ReadAllRegisters() = 0;
 
 		virtual DebugRegister ReadRegister(const std::string& reg) = 0;
@@ -288,6 +429,11 @@ namespace BinaryNinjaDebugger {
 
 		virtual bool StepIntoReverse();
 
+		// Single-steps the current thread up to `count` instructions, and only reports one stop at the end. Stepping
+		// ends early when `stopPredicate` returns true for the address of the next instruction, or when the target
+		// stops for any other reason. Adapters that support it must also report DebugAdapterSupportStepInstructions.
+		virtual bool StepInstructions(uint64_t count, const std::function<bool(uint64_t)>& stopPredicate);
+
 		virtual bool StepOver() = 0;
 
 		virtual bool StepOverReverse();
@@ -309,6 +455,11 @@ namespace BinaryNinjaDebugger {
 		// Sub-classes should use it to post debugger events directly (only when needed).
 		void PostDebuggerEvent(const DebuggerEvent& event);
 
+		// Sub-classes pass the output of the target here, as it comes, rather than posting StdoutMessageEventType
+		// events themselves. The controller buffers it and notifies the front-end in batches. Without a target output
+		// callback, it falls back to posting an event for each call.
+		void PostTargetOutput(TargetOutputChannel channel, const char* data, size_t size);
+
 		virtual void WriteStdin(const std::string& msg);
 
 		virtual BinaryNinja::Ref<BinaryNinja::Metadata> GetProperty(const std::string& name);
@@ -16,6 +16,8 @@ limitations under the License.
 
 #include <inttypes.h>
 #include "adapters/lldbadapter.h"
+#include "adapters/gdbadapter.h"
+#include "adapters/elfcoreadapter.h"
 #ifdef WIN32
 	#include "adapters/dbgengadapter.h"
 	#include "adapters/dbgengttdadapter.h"
@@ -23,6 +25,9 @@ limitations under the License.
 	#include "adapters/localwindowskerneladapter.h"
 	#include "adapters/windowsdumpfile.h"
 #endif
+#ifdef DEBUGGER_PTRACE_ADAPTER
+	#include "adapters/ptraceadapter.h"
+#endif
 
 using namespace BinaryNinja;
 using namespace BinaryNinjaDebugger;
@@ -41,10 +46,14 @@ void InitDebugAdapterTypes()
 	InitWindowsDumpFileAdapterType();
 #endif
 
-	// Disable these adapters because they are not tested, and will get replaced later
-	//InitGdbAdapterType();
+	// Disable this adapter because it is not tested, and will get replaced later
 	//InitLldbRspAdapterType();
 	InitLldbAdapterType();
+	InitGdbAdapterType();
+	InitElfCoreAdapterType();
+#ifdef DEBUGGER_PTRACE_ADAPTER
+	InitPtraceAdapterType();
+#endif
 }
 
 
@@ -79,6 +88,20 @@ static void RegisterSettings()
 			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
 			})");
 
+	settings->RegisterSetting("debugger.followForkMode",
+		R"({
+			"title" : "Follow Fork Mode",
+			"type" : "string",
+			"default" : "parent",
+			"enum" : ["parent", "child", "both"],
+			"enumDescriptions" : [
+				"Keep debugging the parent, and let the child run on its own.",
+				"Debug the child, and let the parent run on its own.",
+				"Debug both. The child becomes another process of the same debugging session. Only supported by the ptrace adapter."],
+			"description" : "Which process to debug when the target forks. A process that calls exec is always followed into the new program.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
 #ifdef WIN32
 	settings->RegisterSetting("debugger.x64dbgEngPath",
 		R"({
@@ -134,6 +157,37 @@ static void RegisterSettings()
 			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
 			})");
 
+	settings->RegisterSetting("debugger.automationMode",
+		R"({
+			"title" : "Automation Mode",
+			"type" : "boolean",
+			"default" : false,
+			"description" : "Skip the work that only serves the UI when the target stops, i.e., register hints, stack variable annotations, expression parser values and view refreshes. Analysis updates are deferred until automation mode is turned off. Turn this on when driving the debugger from a script and nobody watches the UI.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
+	settings->RegisterSetting("debugger.targetOutputBufferSize",
+		R"({
+			"title" : "Target Output Buffer Size",
+			"type" : "number",
+			"default" : 1048576,
+			"minValue" : 4096,
+			"maxValue" : 1073741824,
+			"description" : "The number of bytes of stdout, and of stderr, of the target kept for the target console and the API. When the target writes faster than they are read, the oldest output is dropped, and the number of dropped bytes is shown instead. Takes effect on the next launch.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
+	settings->RegisterSetting("debugger.targetOutputNotificationsPerSecond",
+		R"({
+			"title" : "Target Output Notifications Per Second",
+			"type" : "number",
+			"default" : 10,
+			"minValue" : 1,
+			"maxValue" : 1000,
+			"description" : "How many times per second at most the output of the target is sent to the target console and the event callbacks. The output written in between is sent together. Takes effect on the next launch.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
 	settings->RegisterSetting("debugger.safeMode",
 		R"({
 			"title" : "Safe Mode",
@@ -0,0 +1,174 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "debuggercommandqueue.h"
+#include "binaryninjaapi.h"
+
+using namespace BinaryNinja;
+using namespace BinaryNinjaDebugger;
+
+
+DebuggerCommandQueue::~DebuggerCommandQueue()
+{
+	Stop();
+}
+
+
+void DebuggerCommandQueue::Resolve(const std::shared_ptr<Command>& command, DebugStopReason reason)
+{
+	command->promise.set_value(reason);
+	if (command->completion)
+		command->completion(reason);
+}
+
+
+std::shared_future<DebugStopReason> DebuggerCommandQueue::Submit(
+	const std::string& name, Work work, Completion completion, size_t* id)
+{
+	auto command = std::make_shared<Command>();
+	command->name = name;
+	command->work = std::move(work);
+	command->completion = std::move(completion);
+	std::shared_future<DebugStopReason> future = command->promise.get_future().share();
+
+	{
+		std::unique_lock<std::mutex> lock(m_state->mutex);
+		command->id = m_state->nextId++;
+		if (id)
+			*id = command->id;
+
+		if (m_state->stopping)
+		{
+			lock.unlock();
+			Resolve(command, InvalidStatusOrOperation);
+			return future;
+		}
+
+		m_state->pending.push_back(command);
+		if (!m_thread.joinable())
+		{
+			m_thread = std::thread(Run, m_state);
+			m_state->threadId = m_thread.get_id();
+		}
+	}
+	m_state->cv.notify_one();
+	return future;
+}
+
+
+bool DebuggerCommandQueue::Cancel(size_t id)
+{
+	std::shared_ptr<Command> command;
+	{
+		std::unique_lock<std::mutex> lock(m_state->mutex);
+		for (auto it = m_state->pending.begin(); it != m_state->pending.end(); it++)
+		{
+			if ((*it)->id == id)
+			{
+				command = *it;
+				m_state->pending.erase(it);
+				break;
+			}
+		}
+	}
+
+	if (!command)
+		return false;
+
+	Resolve(command, InvalidStatusOrOperation);
+	return true;
+}
+
+
+size_t DebuggerCommandQueue::CancelAll()
+{
+	std::deque<std::shared_ptr<Command>> cancelled;
+	{
+		std::unique_lock<std::mutex> lock(m_state->mutex);
+		cancelled.swap(m_state->pending);
+	}
+
+	for (const auto& command : cancelled)
+		Resolve(command, InvalidStatusOrOperation);
+	return cancelled.size();
+}
+
+
+bool DebuggerCommandQueue::IsIdle()
+{
+	std::unique_lock<std::mutex> lock(m_state->mutex);
+	return !m_state->busy && m_state->pending.empty();
+}
+
+
+size_t DebuggerCommandQueue::GetPendingCount()
+{
+	std::unique_lock<std::mutex> lock(m_state->mutex);
+	return m_state->pending.size();
+}
+
+
+void DebuggerCommandQueue::Run(std::shared_ptr<State> state)
+{
+	while (true)
+	{
+		std::shared_ptr<Command> command;
+		{
+			std::unique_lock<std::mutex> lock(state->mutex);
+			state->busy = false;
+			state->cv.wait(lock, [&]() { return state->stopping || !state->pending.empty(); });
+			if (state->stopping)
+				return;
+
+			command = state->pending.front();
+			state->pending.pop_front();
+			state->busy = true;
+		}
+
+		DebugStopReason reason = InternalError;
+		try
+		{
+			reason = command->work();
+		}
+		catch (const std::exception& e)
+		{
+			LogWarn("Debugger command \"%s\" failed: %s", command->name.c_str(), e.what());
+		}
+		// Nothing but the state may be touched from here on, since the queue may be gone after this
+		Resolve(command, reason);
+	}
+}
+
+
+void DebuggerCommandQueue::Stop()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_state->mutex);
+		m_state->stopping = true;
+	}
+	CancelAll();
+	m_state->cv.notify_all();
+
+	if (m_thread.joinable())
+	{
+		// The last command may stop the queue from its completion callback. The thread then only touches the state,
+		// which it keeps alive, before it exits.
+		if (IsExecutorThread())
+			m_thread.detach();
+		else
+			m_thread.join();
+	}
+}
@@ -0,0 +1,94 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "debuggerevent.h"
+
+namespace BinaryNinjaDebugger {
+	// Runs the asynchronous target control operations (go, step, run to, launch...) of a controller one after
+	// another on a single long-lived thread. An operation that arrives while another one is in flight is queued
+	// rather than rejected. Each command resolves a future, and optionally calls a completion callback on the
+	// executor thread, with its stop reason. Pending commands can be cancelled, in which case they resolve with
+	// InvalidStatusOrOperation without running.
+	class DebuggerCommandQueue
+	{
+	public:
+		using Work = std::function<DebugStopReason()>;
+		using Completion = std::function<void(DebugStopReason)>;
+
+	private:
+		struct Command
+		{
+			size_t id;
+			std::string name;
+			Work work;
+			Completion completion;
+			std::promise<DebugStopReason> promise;
+		};
+
+		// The state shared with the executor thread. The thread holds its own reference, so the queue can be destroyed
+		// from the executor thread itself, e.g., by the completion callback of the last command, while the thread is
+		// still on its way out.
+		struct State
+		{
+			std::mutex mutex;
+			std::condition_variable cv;
+			std::deque<std::shared_ptr<Command>> pending;
+			std::atomic<std::thread::id> threadId;
+			size_t nextId = 1;
+			bool busy = false;
+			bool stopping = false;
+		};
+
+		std::shared_ptr<State> m_state = std::make_shared<State>();
+		std::thread m_thread;
+
+		static void Run(std::shared_ptr<State> state);
+		static void Resolve(const std::shared_ptr<Command>& command, DebugStopReason reason);
+
+	public:
+		DebuggerCommandQueue() = default;
+		~DebuggerCommandQueue();
+
+		// The executor thread is started on the first submission. `id`, if given, receives the id of the command,
+		// which can be passed to Cancel().
+		std::shared_future<DebugStopReason> Submit(
+			const std::string& name, Work work, Completion completion = nullptr, size_t* id = nullptr);
+		// Cancels a command that has not started yet
+		bool Cancel(size_t id);
+		// Cancels all the commands that have not started yet, and returns how many there were
+		size_t CancelAll();
+
+		// Whether there is nothing running or waiting to run
+		bool IsIdle();
+		size_t GetPendingCount();
+		bool IsExecutorThread() const { return std::this_thread::get_id() == m_state->threadId; }
+
+		// Cancels the pending commands, waits for the running one and stops the executor thread. When called from the
+		// executor thread, the thread exits once the running command returns.
+		void Stop();
+	};
+};  // namespace BinaryNinjaDebugger
@@ -16,6 +16,7 @@ limitations under the License.
 
 #include "debuggercontroller.h"
 #include <thread>
+#include <algorithm>
 #include "lowlevelilinstruction.h"
 #include "mediumlevelilinstruction.h"
 #include "highlevelilinstruction.h"
@@ -33,17 +34,30 @@ DebuggerController::DebuggerController(BinaryViewRef data)
 	m_viewStart = m_data->GetStart();
 
 	m_state = new DebuggerState(data, this);
+	m_coverage = new DebuggerCoverage(this);
 	m_adapter = nullptr;
 	m_shouldAnnotateStackVariable = Settings::Instance()->Get<bool>("debugger.stackVariableAnnotations");
-	RegisterEventCallback([this](const DebuggerEvent& event) { EventHandler(event); }, "Debugger Core");
+	m_automationMode = Settings::Instance()->Get<bool>("debugger.automationMode");
+	// The caches must be up-to-date before any other callback sees the event, so this one is called inline
+	RegisterEventCallback(
+		[this](const DebuggerEvent& event) { EventHandler(event); }, "Debugger Core", InlineEventCallbackAffinity);
 }
 
 
 DebuggerController::~DebuggerController()
 {
+	// The queued commands use the state and the adapter, so they must be gone first
+	m_commandQueue.Stop();
+	m_targetOutput.Stop();
 	m_data->UnregisterNotification(this);
 	m_file = nullptr;
 
+	if (m_coverage)
+	{
+		delete m_coverage;
+		m_coverage = nullptr;
+	}
+
 	if (m_state)
 	{
 		delete m_state;
@@ -118,8 +132,7 @@ bool DebuggerController::SetIP(uint64_t address)
 
 bool DebuggerController::Launch()
 {
-	std::thread([&]() { LaunchAndWait(); }).detach();
-	return true;
+	return SubmitCommand(LaunchCommand) != 0;
 }
 
 
@@ -160,6 +173,9 @@ DebugStopReason DebuggerController::LaunchAndWaitInternal()
 
 DebugStopReason DebuggerController::LaunchAndWait()
 {
+	if (!m_commandQueue.IsExecutorThread())
+		return SubmitCommandAndWait(LaunchCommand);
+
 	if (!m_targetControlMutex.try_lock())
 		return InternalError;
 
@@ -174,8 +190,7 @@ DebugStopReason DebuggerController::LaunchAndWait()
 
 bool DebuggerController::Attach()
 {
-	std::thread([&]() { AttachAndWait(); }).detach();
-	return true;
+	return SubmitCommand(AttachCommand) != 0;
 }
 
 
@@ -202,6 +217,9 @@ DebugStopReason DebuggerController::AttachAndWaitInternal()
 
 DebugStopReason DebuggerController::AttachAndWait()
 {
+	if (!m_commandQueue.IsExecutorThread())
+		return SubmitCommandAndWait(AttachCommand);
+
 	if (!m_targetControlMutex.try_lock())
 		return InternalError;
 
@@ -216,8 +234,7 @@ DebugStopReason DebuggerController::AttachAndWait()
 
 bool DebuggerController::Connect()
 {
-	std::thread([&]() { ConnectAndWait(); }).detach();
-	return true;
+	return SubmitCommand(ConnectCommand) != 0;
 }
 
 
@@ -244,6 +261,9 @@ DebugStopReason DebuggerController::ConnectAndWaitInternal()
 
 DebugStopReason DebuggerController::ConnectAndWait()
 {
+	if (!m_commandQueue.IsExecutorThread())
+		return SubmitCommandAndWait(ConnectCommand);
+
 	if (!m_targetControlMutex.try_lock())
 		return InternalError;
 
@@ -309,6 +329,14 @@ bool DebuggerController::CreateDebugAdapter()
 
 	// Forward the DebuggerEvent from the adapters to the controller
 	m_adapter->SetEventCallback([this](const DebuggerEvent& event) { PostDebuggerEvent(event); });
+
+	// Whatever the previous target wrote is sent before the buffer is emptied
+	PublishTargetOutput();
+	m_targetOutput.Configure(Settings::Instance()->Get<uint64_t>("debugger.targetOutputBufferSize"),
+		Settings::Instance()->Get<uint64_t>("debugger.targetOutputNotificationsPerSecond"));
+	m_adapter->SetTargetOutputCallback([this](TargetOutputChannel channel, const char* data, size_t size) {
+		m_targetOutput.Write(channel, data, size);
+	});
 	return true;
 }
 
@@ -320,12 +348,124 @@ void DebuggerController::ApplyBreakpoints()
 }
 
 
+void DebuggerController::FlushBreakpoints()
+{
+	m_state->FlushBreakpoints();
+}
+
+
 bool DebuggerController::CanResumeTarget()
 {
 	return m_state->IsConnected() && (!m_state->IsRunning());
 }
 
 
+std::shared_future<DebugStopReason> DebuggerController::SubmitResumeCommand(const std::string& name,
+	DebuggerCommandQueue::Work work, DebuggerCommandQueue::Completion completion, size_t* id)
+{
+	// This is an API function of the debugger. We only do these checks at the API level. When other commands are
+	// queued or in flight, the target state is checked again when the command runs.
+	if (!CanResumeTarget() && m_commandQueue.IsIdle())
+		return {};
+
+	return m_commandQueue.Submit(
+		name,
+		[this, work]() {
+			if (!CanResumeTarget())
+				return InvalidStatusOrOperation;
+			return work();
+		},
+		std::move(completion), id);
+}
+
+
+size_t DebuggerController::SubmitCommand(DebuggerCommandType type, DebuggerCommandQueue::Completion completion,
+	BNFunctionGraphType il, uint64_t count, const std::vector<uint64_t>& remoteAddresses)
+{
+	size_t id = 0;
+	QueueCommand(type, std::move(completion), il, count, remoteAddresses, &id);
+	return id;
+}
+
+
+DebugStopReason DebuggerController::SubmitCommandAndWait(
+	DebuggerCommandType type, BNFunctionGraphType il, uint64_t count, const std::vector<uint64_t>& remoteAddresses)
+{
+	auto future = QueueCommand(type, nullptr, il, count, remoteAddresses, nullptr);
+	if (!future.valid())
+		return InvalidStatusOrOperation;
+	return future.get();
+}
+
+
+std::shared_future<DebugStopReason> DebuggerController::QueueCommand(DebuggerCommandType type,
+	DebuggerCommandQueue::Completion completion, BNFunctionGraphType il, uint64_t count,
+	const std::vector<uint64_t>& remoteAddresses, size_t* id)
+{
+	std::shared_future<DebugStopReason> future;
+	switch (type)
+	{
+	case LaunchCommand:
+		future = m_commandQueue.Submit("launch", [this]() { return LaunchAndWait(); }, std::move(completion), id);
+		break;
+	case AttachCommand:
+		future = m_commandQueue.Submit("attach", [this]() { return AttachAndWait(); }, std::move(completion), id);
+		break;
+	case ConnectCommand:
+		future = m_commandQueue.Submit("connect", [this]() { return ConnectAndWait(); }, std::move(completion), id);
+		break;
+	case RestartCommand:
+		if (m_state->IsConnected())
+			future =
+				m_commandQueue.Submit("restart", [this]() { return RestartAndWait(); }, std::move(completion), id);
+		break;
+	case GoCommand:
+		future = SubmitResumeCommand("go", [this]() { return GoAndWait(); }, std::move(completion), id);
+		break;
+	case GoReverseCommand:
+		future =
+			SubmitResumeCommand("go reverse", [this]() { return GoReverseAndWait(); }, std::move(completion), id);
+		break;
+	case StepIntoCommand:
+		future = SubmitResumeCommand(
+			"step into", [this, il]() { return StepIntoAndWait(il); }, std::move(completion), id);
+		break;
+	case StepIntoReverseCommand:
+		future = SubmitResumeCommand(
+			"step into reverse", [this, il]() { return StepIntoReverseAndWait(il); }, std::move(completion), id);
+		break;
+	case StepOverCommand:
+		future = SubmitResumeCommand(
+			"step over", [this, il]() { return StepOverAndWait(il); }, std::move(completion), id);
+		break;
+	case StepOverReverseCommand:
+		future = SubmitResumeCommand(
+			"step over reverse", [this, il]() { return StepOverReverseAndWait(il); }, std::move(completion), id);
+		break;
+	case StepReturnCommand:
+		future = SubmitResumeCommand(
+			"step return", [this]() { return StepReturnAndWait(); }, std::move(completion), id);
+		break;
+	case StepReturnReverseCommand:
+		future = SubmitResumeCommand(
+			"step return reverse", [this]() { return StepReturnReverseAndWait(); }, std::move(completion), id);
+		break;
+	case StepInstructionsCommand:
+		future = SubmitResumeCommand(
+			"step instructions", [this, count]() { return StepInstructionsAndWait(count); }, std::move(completion), id);
+		break;
+	case RunToCommand:
+		future = SubmitResumeCommand(
+			"run to", [this, remoteAddresses]() { return RunToAndWait(remoteAddresses); }, std::move(completion), id);
+		break;
+	default:
+		LogWarn("Unknown debugger command type %d", (int)type);
+		break;
+	}
+	return future;
+}
+
+
 bool DebuggerController::ExpectSingleStep(DebugStopReason reason)
 {
 	//	On macOS, the stop reason we get for a single step is also the Breakpoint.
@@ -337,29 +477,20 @@ bool DebuggerController::ExpectSingleStep(DebugStopReason reason)
 
 bool DebuggerController::Go()
 {
-	// This is an API function of the debugger. We only do these checks at the API level.
-	if (!CanResumeTarget())
-		return false;
-
-	std::thread([&]() { GoAndWait(); }).detach();
-
-	return true;
+	return SubmitCommand(GoCommand) != 0;
 }
 
 bool DebuggerController::GoReverse()
 {
-	// This is an API function of the debugger. We only do these checks at the API level.
-	if (!CanResumeTarget())
-		return false;
-
-	std::thread([&]() { GoReverseAndWait(); }).detach();
-
-	return true;
+	return SubmitCommand(GoReverseCommand) != 0;
 }
 
 
 DebugStopReason DebuggerController::GoAndWait()
 {
+	if (!m_commandQueue.IsExecutorThread())
+		return SubmitCommandAndWait(GoCommand);
+
 	if (!m_targetControlMutex.try_lock())
 		return InternalError;
 
@@ -373,6 +504,9 @@ DebugStopReason DebuggerController::GoAndWait()
 
 DebugStopReason DebuggerController::GoReverseAndWait()
 {
+	if (!m_commandQueue.IsExecutorThread())
+		return SubmitCommandAndWait(GoReverseCommand);
+
 	if (!m_targetControlMutex.try_lock())
 		return InternalError;
 
@@ -385,103 +519,122 @@ DebugStopReason DebuggerController::GoReverseAndWait()
 }
 
 
-DebugStopReason DebuggerController::StepIntoIL(BNFunctionGraphType il)
+std::optional<bool> DebuggerController::IsILInstructionStart(
+	const FunctionRef& func, BNFunctionGraphType il, uint64_t address)
 {
+	if (il == HighLevelLanguageRepresentationFunctionGraph)
+		il = HighLevelILFunctionGraph;
+
+	auto key = std::make_pair(func->GetStart(), il);
+	uint64_t generation;
+	{
+		std::unique_lock<std::mutex> lock(m_ilInstructionAddressesMutex);
+		auto it = m_ilInstructionAddresses.find(key);
+		if (it != m_ilInstructionAddresses.end())
+			return std::binary_search(it->second.begin(), it->second.end(), address);
+		generation = m_ilInstructionAddressesGeneration;
+	}
+
+	// Generating the IL can take a while, and must not hold up other lookups or the analysis notifications
+	std::vector<uint64_t> addresses;
 	switch (il)
 	{
-	case NormalFunctionGraph:
+	case LowLevelILFunctionGraph:
 	{
-		return StepIntoAndWaitInternal();
+		LowLevelILFunctionRef llil = func->GetLowLevelILIfAvailable();
+		if (!llil)
+			return std::nullopt;
+		addresses.reserve(llil->GetInstructionCount());
+		for (size_t i = 0; i < llil->GetInstructionCount(); i++)
+			addresses.push_back(llil->GetInstruction(i).address);
+		break;
 	}
-	case LowLevelILFunctionGraph:
+	case MediumLevelILFunctionGraph:
 	{
-		// TODO: This might cause infinite loop
-		while (true)
-		{
-			DebugStopReason reason = StepIntoAndWaitInternal();
-			if (!ExpectSingleStep(reason))
-				return reason;
+		MediumLevelILFunctionRef mlil = func->GetMediumLevelILIfAvailable();
+		if (!mlil)
+			return std::nullopt;
+		addresses.reserve(mlil->GetInstructionCount());
+		for (size_t i = 0; i < mlil->GetInstructionCount(); i++)
+			addresses.push_back(mlil->GetInstruction(i).address);
+		break;
+	}
+	case HighLevelILFunctionGraph:
+	{
+		HighLevelILFunctionRef hlil = func->GetHighLevelILIfAvailable();
+		if (!hlil)
+			return std::nullopt;
+		addresses.reserve(hlil->GetInstructionCount());
+		for (size_t i = 0; i < hlil->GetInstructionCount(); i++)
+			addresses.push_back(hlil->GetInstruction(i).address);
+		break;
+	}
+	default:
+		return std::nullopt;
+	}
 
-			uint64_t newRemoteRip = m_state->IP();
-			std::vector<FunctionRef> functions = GetData()->GetAnalysisFunctionsContainingAddress(newRemoteRip);
-			if (functions.empty())
-				return SingleStep;
+	std::sort(addresses.begin(), addresses.end());
+	addresses.erase(std::unique(addresses.begin(), addresses.end()), addresses.end());
+	bool result = std::binary_search(addresses.begin(), addresses.end(), address);
 
-			for (FunctionRef& func : functions)
-			{
-				LowLevelILFunctionRef llil = func->GetLowLevelILIfAvailable();
-				if (!llil)
-					return SingleStep;
+	// Only cache the addresses if no function was analyzed again while they were generated
+	std::unique_lock<std::mutex> lock(m_ilInstructionAddressesMutex);
+	if (generation == m_ilInstructionAddressesGeneration)
+		m_ilInstructionAddresses.emplace(key, std::move(addresses));
+	return result;
+}
 
-				size_t start = llil->GetInstructionStart(GetData()->GetDefaultArchitecture(), newRemoteRip);
-				if (start < llil->GetInstructionCount())
-				{
-					if (llil->GetInstruction(start).address == newRemoteRip)
-						return SingleStep;
-				}
-			}
-		}
-		break;
-	}
-	case MediumLevelILFunctionGraph:
+
+bool DebuggerController::IsILInstructionStart(BNFunctionGraphType il, uint64_t address)
+{
+	// Stop when we cannot tell, e.g., the address is not in any function or the IL is not available yet
+	std::vector<FunctionRef> functions = GetData()->GetAnalysisFunctionsContainingAddress(address);
+	if (functions.empty())
+		return true;
+
+	for (const FunctionRef& func : functions)
 	{
-		// TODO: This might cause infinite loop
-		while (true)
-		{
-			DebugStopReason reason = StepIntoAndWaitInternal();
-			if (!ExpectSingleStep(reason))
-				return reason;
+		auto isStart = IsILInstructionStart(func, il, address);
+		if (!isStart.has_value() || *isStart)
+			return true;
+	}
+	return false;
+}
 
-			uint64_t newRemoteRip = m_state->IP();
-			std::vector<FunctionRef> functions = GetData()->GetAnalysisFunctionsContainingAddress(newRemoteRip);
-			if (functions.empty())
-				return SingleStep;
 
-			for (FunctionRef& func : functions)
-			{
-				MediumLevelILFunctionRef mlil = func->GetMediumLevelILIfAvailable();
-				if (!mlil)
-					return SingleStep;
+void DebuggerController::OnAnalysisFunctionUpdated(BinaryView* view, Function* func)
+{
+	std::unique_lock<std::mutex> lock(m_ilInstructionAddressesMutex);
+	uint64_t start = func->GetStart();
+	m_ilInstructionAddressesGeneration++;
+	m_ilInstructionAddresses.erase(m_ilInstructionAddresses.lower_bound({start, NormalFunctionGraph}),
+		m_ilInstructionAddresses.upper_bound({start, HighLevelLanguageRepresentationFunctionGraph}));
+}
 
-				size_t start = mlil->GetInstructionStart(GetData()->GetDefaultArchitecture(), newRemoteRip);
-				if (start < mlil->GetInstructionCount())
-				{
-					if (mlil->GetInstruction(start).address == newRemoteRip)
-						return SingleStep;
-				}
-			}
-		}
-		break;
+
+void DebuggerController::OnAnalysisFunctionRemoved(BinaryView* view, Function* func)
+{
+	OnAnalysisFunctionUpdated(view, func);
+}
+
+
+DebugStopReason DebuggerController::StepIntoIL(BNFunctionGraphType il)
+{
+	switch (il)
+	{
+	case NormalFunctionGraph:
+	{
+		return StepIntoAndWaitInternal();
 	}
+	case LowLevelILFunctionGraph:
+	case MediumLevelILFunctionGraph:
 	case HighLevelILFunctionGraph:
 	case HighLevelLanguageRepresentationFunctionGraph:
 	{
-		// TODO: This might cause infinite loop
-		while (true)
-		{
-			DebugStopReason reason = StepIntoAndWaitInternal();
-			if (!ExpectSingleStep(reason))
-				return reason;
-
-			uint64_t newRemoteRip = m_state->IP();
-			std::vector<FunctionRef> functions = GetData()->GetAnalysisFunctionsContainingAddress(newRemoteRip);
-			if (functions.empty())
-				return SingleStep;
-
-			for (FunctionRef& func : functions)
-			{
-				HighLevelILFunctionRef hlil = func->GetHighLevelILIfAvailable();
-				if (!hlil)
-					return SingleStep;
-
-				for (size_t i = 0; i < hlil->GetInstructionCount(); i++)
-				{
-					if (hlil->GetInstruction(i).address == newRemoteRip)
-						return SingleStep;
-				}
-			}
-		}
-		break;
+		// Keep stepping until we reach the start of an IL instruction. The adapter does the stepping on its own when
+		// it can, so we only wait for the target to stop once.
+		return StepInstructionsAndWaitInternal(MaxILStepInstructions,
+			[this, il](uint64_t address) { return IsILInstructionStart(il, address); });
 	}
 	default:
 		LogWarn("step into unimplemented in the current il type");
@@ -499,94 +652,20 @@ DebugStopReason DebuggerController::StepIntoReverseIL(BNFunctionGraphType il)
 		return StepIntoReverseAndWaitInternal();
 	}
 	case LowLevelILFunctionGraph:
-	{
-		// TODO: This might cause infinite loop
-		while (true)
-		{
-			DebugStopReason reason = StepIntoReverseAndWaitInternal();
-			if (!ExpectSingleStep(reason))
-				return reason;
-
-			uint64_t newRemoteRip = m_state->IP();
-			std::vector<FunctionRef> functions = GetData()->GetAnalysisFunctionsContainingAddress(newRemoteRip);
-			if (functions.empty())
-				return SingleStep;
-
-			for (FunctionRef& func : functions)
-			{
-				LowLevelILFunctionRef llil = func->GetLowLevelILIfAvailable();
-				if (!llil)
-					return SingleStep;
-
-				size_t start = llil->GetInstructionStart(GetData()->GetDefaultArchitecture(), newRemoteRip);
-				if (start < llil->GetInstructionCount())
-				{
-					if (llil->GetInstruction(start).address == newRemoteRip)
-						return SingleStep;
-				}
-			}
-		}
-		break;
-	}
 	case MediumLevelILFunctionGraph:
-	{
-		// TODO: This might cause infinite loop
-		while (true)
-		{
-			DebugStopReason reason = StepIntoReverseAndWaitInternal();
-			if (!ExpectSingleStep(reason))
-				return reason;
-
-			uint64_t newRemoteRip = m_state->IP();
-			std::vector<FunctionRef> functions = GetData()->GetAnalysisFunctionsContainingAddress(newRemoteRip);
-			if (functions.empty())
-				return SingleStep;
-
-			for (FunctionRef& func : functions)
-			{
-				MediumLevelILFunctionRef mlil = func->GetMediumLevelILIfAvailable();
-				if (!mlil)
-					return SingleStep;
-
-				size_t start = mlil->GetInstructionStart(GetData()->GetDefaultArchitecture(), newRemoteRip);
-				if (start < mlil->GetInstructionCount())
-				{
-					if (mlil->GetInstruction(start).address == newRemoteRip)
-						return SingleStep;
-				}
-			}
-		}
-		break;
-	}
 	case HighLevelILFunctionGraph:
 	case HighLevelLanguageRepresentationFunctionGraph:
 	{
-		// TODO: This might cause infinite loop
-		while (true)
+		for (uint64_t i = 0; i < MaxILStepInstructions; i++)
 		{
 			DebugStopReason reason = StepIntoReverseAndWaitInternal();
 			if (!ExpectSingleStep(reason))
 				return reason;
 
-			uint64_t newRemoteRip = m_state->IP();
-			std::vector<FunctionRef> functions = GetData()->GetAnalysisFunctionsContainingAddress(newRemoteRip);
-			if (functions.empty())
-				return SingleStep;
-
-			for (FunctionRef& func : functions)
-			{
-				HighLevelILFunctionRef hlil = func->GetHighLevelILIfAvailable();
-				if (!hlil)
-					return SingleStep;
-
-				for (size_t i = 0; i < hlil->GetInstructionCount(); i++)
-				{
-					if (hlil->GetInstruction(i).address == newRemoteRip)
-						return SingleStep;
-				}
-			}
+			if (IsILInstructionStart(il, m_state->IP()))
+				break;
 		}
-		break;
+		return SingleStep;
 	}
 	default:
 		LogWarn("step into unimplemented in the current il type");
@@ -604,26 +683,19 @@ DebugStopReason DebuggerController::StepIntoReverseAndWaitInternal()
 
 bool DebuggerController::StepInto(BNFunctionGraphType il)
 {
-	if (!CanResumeTarget())
-		return false;
-
-	std::thread([&, il]() { StepIntoAndWait(il); }).detach();
-
-	return true;
+	return SubmitCommand(StepIntoCommand, nullptr, il) != 0;
 }
 
 bool DebuggerController::StepIntoReverse(BNFunctionGraphType il)
 {
-	if (!CanResumeTarget())
-		return false;
-
-	std::thread([&, il]() { StepIntoReverseAndWait(il); }).detach();
-
-	return true;
+	return SubmitCommand(StepIntoReverseCommand, nullptr, il) != 0;
 }
 
 DebugStopReason DebuggerController::StepIntoReverseAndWait(BNFunctionGraphType il)
 {
+	if (!m_commandQueue.IsExecutorThread())
+		return SubmitCommandAndWait(StepIntoReverseCommand, il);
+
 	if (!m_targetControlMutex.try_lock())
 		return InternalError;
 
@@ -637,6 +709,9 @@ DebugStopReason DebuggerController::StepIntoReverseAndWait(BNFunctionGraphType i
 
 DebugStopReason DebuggerController::StepIntoAndWait(BNFunctionGraphType il)
 {
+	if (!m_commandQueue.IsExecutorThread())
+		return SubmitCommandAndWait(StepIntoCommand, il);
+
 	if (!m_targetControlMutex.try_lock())
 		return InternalError;
 
@@ -648,6 +723,27 @@ DebugStopReason DebuggerController::StepIntoAndWait(BNFunctionGraphType il)
 	return reason;
 }
 
+bool DebuggerController::StepInstructions(uint64_t count)
+{
+	return SubmitCommand(StepInstructionsCommand, nullptr, NormalFunctionGraph, count) != 0;
+}
+
+DebugStopReason DebuggerController::StepInstructionsAndWait(uint64_t count)
+{
+	if (!m_commandQueue.IsExecutorThread())
+		return SubmitCommandAndWait(StepInstructionsCommand, NormalFunctionGraph, count);
+
+	if (!m_targetControlMutex.try_lock())
+		return InternalError;
+
+	auto reason = StepInstructionsAndWaitInternal(count, nullptr);
+	if (!m_userRequestedBreak && (reason != ProcessExited))
+		NotifyStopped(reason);
+
+	m_targetControlMutex.unlock();
+	return reason;
+}
+
 DebugStopReason DebuggerController::StepOverIL(BNFunctionGraphType il)
 {
 	switch (il)
@@ -857,28 +953,21 @@ DebugStopReason DebuggerController::StepOverReverseIL(BNFunctionGraphType il)
 
 bool DebuggerController::StepOver(BNFunctionGraphType il)
 {
-	if (!CanResumeTarget())
-		return false;
-
-	std::thread([&, il]() { StepOverAndWait(il); }).detach();
-
-	return true;
+	return SubmitCommand(StepOverCommand, nullptr, il) != 0;
 }
 
 
 bool DebuggerController::StepOverReverse(BNFunctionGraphType il)
 {
-	if (!CanResumeTarget())
-		return false;
-
-	std::thread([&, il]() { StepOverReverseAndWait(il); }).detach();
-
-	return true;
+	return SubmitCommand(StepOverReverseCommand, nullptr, il) != 0;
 }
 
 
 DebugStopReason DebuggerController::StepOverAndWait(BNFunctionGraphType il)
 {
+	if (!m_commandQueue.IsExecutorThread())
+		return SubmitCommandAndWait(StepOverCommand, il);
+
 	if (!m_targetControlMutex.try_lock())
 		return InternalError;
 
@@ -893,6 +982,9 @@ DebugStopReason DebuggerController::StepOverAndWait(BNFunctionGraphType il)
 
 DebugStopReason DebuggerController::StepOverReverseAndWait(BNFunctionGraphType il)
 {
+	if (!m_commandQueue.IsExecutorThread())
+		return SubmitCommandAndWait(StepOverReverseCommand, il);
+
 	if (!m_targetControlMutex.try_lock())
 		return InternalError;
 
@@ -905,21 +997,190 @@ DebugStopReason DebuggerController::StepOverReverseAndWait(BNFunctionGraphType i
 }
 
 
+// The frame pointer register, which the adapters use to unwind the stack
+static std::string GetFramePointerRegisterName(Architecture* arch)
+{
+	std::string name = arch->GetName();
+	if (name == "x86_64")
+		return "rbp";
+	if (name == "x86")
+		return "ebp";
+	if (name == "aarch64")
+		return "x29";
+	if (name == "armv7")
+		return "r11";
+	return "";
+}
+
+
+std::optional<uint64_t> DebuggerController::GetReturnAddressInPrologue()
+{
+	uint64_t ip = m_state->IP();
+	std::vector<FunctionRef> functions = GetData()->GetAnalysisFunctionsContainingAddress(ip);
+	if (functions.empty())
+		return std::nullopt;
+
+	FunctionRef func = functions[0];
+	Ref<Architecture> arch = func->GetArchitecture();
+	std::string framePointer = GetFramePointerRegisterName(arch);
+	if (framePointer.empty())
+		return std::nullopt;
+
+	// Once the frame pointer points into the frame of this function, the adapter can unwind the stack. Before that,
+	// i.e., in the prologue, and in functions that do not use a frame pointer, it still holds the frame pointer of
+	// the caller, and unwinding skips the caller.
+	auto framePointerValue = func->GetRegisterValueAtInstruction(arch, ip, arch->GetRegisterByName(framePointer));
+	if (framePointerValue.state == StackFrameOffset)
+		return std::nullopt;
+
+	uint32_t linkRegister = arch->GetLinkRegister();
+	if (linkRegister != BN_INVALID_REGISTER)
+	{
+		// The link register holds the return address until the function overwrites it, e.g., with a call
+		auto linkRegisterValue = func->GetRegisterValueAtInstruction(arch, ip, linkRegister);
+		if (linkRegisterValue.state != EntryValue)
+			return std::nullopt;
+
+		std::string name = arch->GetRegisterName(linkRegister);
+		if (name == "x30")
+			name = "lr";
+		return GetRegisterValue(name);
+	}
+
+	// The return address is at the top of the stack when the function is entered
+	auto stackValue = func->GetRegisterValueAtInstruction(arch, ip, arch->GetStackPointerRegister());
+	if (stackValue.state != StackFrameOffset)
+		return std::nullopt;
+
+	size_t addressSize = arch->GetAddressSize();
+	DataBuffer buffer = ReadMemory(m_state->StackPointer() - stackValue.value, addressSize);
+	if ((buffer.GetLength() != addressSize) || (addressSize > sizeof(uint64_t)))
+		return std::nullopt;
+
+	uint64_t returnAddress = 0;
+	memcpy(&returnAddress, buffer.GetData(), addressSize);
+	return returnAddress;
+}
+
+
+bool DebuggerController::FollowsCall(Architecture* arch, uint64_t address)
+{
+	size_t maxLength = arch->GetMaxInstructionLength();
+	size_t alignment = std::max<size_t>(arch->GetInstructionAlignment(), 1);
+	if (address < maxLength)
+		return false;
+
+	DataBuffer buffer = ReadMemory(address - maxLength, maxLength);
+	if (buffer.GetLength() != maxLength)
+		return false;
+
+	// Instructions can have different lengths, so try every length that ends right at the address
+	const uint8_t* data = (const uint8_t*)buffer.GetData();
+	for (size_t length = alignment; length <= maxLength; length += alignment)
+	{
+		uint64_t start = address - length;
+		const uint8_t* bytes = data + maxLength - length;
+		auto info = m_instructionCache.GetInstructionInfo(arch, start, bytes, length);
+		if (info.has_value() && (info->length == length) && m_instructionCache.IsCall(arch, start, bytes, length))
+			return true;
+	}
+	return false;
+}
+
+
 DebugStopReason DebuggerController::EmulateStepReturnAndWait()
+{
+	// Resume once, and stop at the return address. The same function can be entered recursively and return to the
+	// same address, which we tell apart by the stack pointer: when the current call returns, the stack pointer must be
+	// above its current value.
+	std::optional<uint64_t> returnAddress = GetReturnAddressInPrologue();
+	if (!returnAddress.has_value())
+	{
+		// The adapters may only follow the frame pointer chain, which yields a wrong frame in code that does not
+		// maintain it
+		std::vector<DebugFrame> frames = m_adapter->GetFramesOfThread(m_adapter->GetActiveThreadId());
+		if (frames.size() >= 2)
+			returnAddress = frames[1].m_pc;
+	}
+
+	ArchitectureRef remoteArch = m_state->GetRemoteArchitecture();
+	if (!returnAddress.has_value() || (*returnAddress == 0) || !remoteArch || !FollowsCall(remoteArch, *returnAddress))
+		return RunToReturnInstructionsAndWait();
+
+	return RunToReturnAddressAndWait(*returnAddress);
+}
+
+
+DebugStopReason DebuggerController::RunToReturnAddressAndWait(uint64_t returnAddress)
+{
+	uint64_t stackPointer = m_adapter->GetStackPointer();
+
+	// Only adapters that do not support temporary breakpoints need a regular breakpoint, which must be removed
+	// afterwards. If the user has a breakpoint at the return address, every hit is reported to the user.
+	bool userBreakpoint = m_state->GetBreakpoints()->ContainsAbsolute(returnAddress);
+	bool temporary = m_adapter->AddTemporaryBreakpoint(returnAddress);
+	if (!temporary && !userBreakpoint)
+		m_adapter->AddBreakpoint(returnAddress);
+
+	DebugStopReason reason;
+	while (true)
+	{
+		reason = GoAndWaitInternal();
+		if ((reason != Breakpoint) || userBreakpoint || (m_adapter->GetInstructionOffset() != returnAddress)
+			|| (m_adapter->GetStackPointer() > stackPointer))
+			break;
+
+		// A deeper call of the same function has returned, keep going. Temporary breakpoints are gone after the stop.
+		if (temporary)
+			m_adapter->AddTemporaryBreakpoint(returnAddress);
+	}
+
+	m_adapter->RemoveTemporaryBreakpoints();
+	if (!temporary && !userBreakpoint)
+		m_adapter->RemoveBreakpoint(returnAddress);
+
+	return reason;
+}
+
+
+DebugStopReason DebuggerController::RunToReturnInstructionsAndWait()
 {
 	uint64_t address = m_state->IP();
 	std::vector<FunctionRef> functions = GetData()->GetAnalysisFunctionsContainingAddress(address);
 	if (functions.empty())
 		return InternalError;
 
+	// Find the returns and tail calls by decoding the instructions of the function, which are mostly in the decode
+	// cache already, rather than generating its MLIL
 	std::vector<uint64_t> returnAddresses;
 	FunctionRef function = functions[0];
-	MediumLevelILFunctionRef mlilFunc = function->GetMediumLevelIL();
-	for (size_t i = 0; i < mlilFunc->GetInstructionCount(); i++)
-	{
-		MediumLevelILInstruction instruction = mlilFunc->GetInstruction(i);
-		if ((instruction.operation == MLIL_RET) || (instruction.operation == MLIL_TAILCALL))
-			returnAddresses.push_back(instruction.address);
+	Ref<Platform> platform = function->GetPlatform();
+	for (const Ref<BasicBlock>& block : function->GetBasicBlocks())
+	{
+		Ref<Architecture> arch = block->GetArchitecture();
+		uint64_t start = block->GetStart();
+		DataBuffer buffer = ReadMemory(start, block->GetLength());
+		const uint8_t* data = (const uint8_t*)buffer.GetData();
+		for (size_t offset = 0; offset < buffer.GetLength();)
+		{
+			uint64_t address = start + offset;
+			size_t size = buffer.GetLength() - offset;
+			auto info = m_instructionCache.GetInstructionInfo(arch, address, data + offset, size);
+			if (!info.has_value())
+				break;
+
+			bool isReturn = m_instructionCache.IsReturn(arch, address, data + offset, size);
+			for (size_t i = 0; !isReturn && (i < info->branchCount); i++)
+			{
+				// A jump to another function is a tail call
+				uint64_t target = info->branchTarget[i];
+				isReturn = (info->branchType[i] == UnconditionalBranch) && (target != function->GetStart())
+					&& GetData()->GetAnalysisFunction(platform, target);
+			}
+			if (isReturn)
+				returnAddresses.push_back(address);
+			offset += info->length;
+		}
 	}
 
 	return RunToAndWaitInternal(returnAddresses);
@@ -930,13 +1191,13 @@ DebugStopReason DebuggerController::StepReturnAndWaitInternal()
 {
 	m_userRequestedBreak = false;
 
-	if (true /* StepReturnAvailable() */)
+	if (m_adapter->SupportFeature(DebugAdapterSupportStepReturn))
 	{
 		return ExecuteAdapterAndWait(DebugAdapterStepReturn);
 	}
 	else
 	{
-		// Emulate a step over
+		// Emulate a step return
 		return EmulateStepReturnAndWait();
 	}
 }
@@ -955,28 +1216,21 @@ DebugStopReason DebuggerController::StepReturnReverseAndWaitInternal()
 
 bool DebuggerController::StepReturn()
 {
-	if (!CanResumeTarget())
-		return false;
-
-	std::thread([&]() { StepReturnAndWait(); }).detach();
-
-	return true;
+	return SubmitCommand(StepReturnCommand) != 0;
 }
 
 
 bool DebuggerController::StepReturnReverse()
 {
-	if (!CanResumeTarget())
-		return false;
-
-	std::thread([&]() { StepReturnReverseAndWait(); }).detach();
-
-	return true;
+	return SubmitCommand(StepReturnReverseCommand) != 0;
 }
 
 
 DebugStopReason DebuggerController::StepReturnAndWait()
 {
+	if (!m_commandQueue.IsExecutorThread())
+		return SubmitCommandAndWait(StepReturnCommand);
+
 	if (!m_targetControlMutex.try_lock())
 		return InternalError;
 
@@ -991,6 +1245,9 @@ DebugStopReason DebuggerController::StepReturnAndWait()
 
 DebugStopReason DebuggerController::StepReturnReverseAndWait()
 {
+	if (!m_commandQueue.IsExecutorThread())
+		return SubmitCommandAndWait(StepReturnReverseCommand);
+
 	if (!m_targetControlMutex.try_lock())
 		return InternalError;
 
@@ -1007,23 +1264,26 @@ DebugStopReason DebuggerController::RunToAndWaitInternal(const std::vector<uint6
 {
 	m_userRequestedBreak = false;
 
+	// Temporary breakpoints are removed by the adapter when the target stops. Only adapters that do not support them
+	// need regular breakpoints, which must be removed afterwards unless the user has one at the same address.
+	std::vector<uint64_t> fallbackAddresses;
 	for (uint64_t remoteAddress : remoteAddresses)
 	{
+		if (m_adapter->AddTemporaryBreakpoint(remoteAddress))
+			continue;
+
 		if (!m_state->GetBreakpoints()->ContainsAbsolute(remoteAddress))
 		{
 			m_adapter->AddBreakpoint(remoteAddress);
+			fallbackAddresses.push_back(remoteAddress);
 		}
 	}
 
 	auto reason = GoAndWaitInternal();
 
-	for (uint64_t remoteAddress : remoteAddresses)
-	{
-		if (!m_state->GetBreakpoints()->ContainsAbsolute(remoteAddress))
-		{
-			m_adapter->RemoveBreakpoint(remoteAddress);
-		}
-	}
+	m_adapter->RemoveTemporaryBreakpoints();
+	for (uint64_t remoteAddress : fallbackAddresses)
+		m_adapter->RemoveBreakpoint(remoteAddress);
 
 	NotifyStopped(reason);
 	return reason;
@@ -1032,18 +1292,15 @@ DebugStopReason DebuggerController::RunToAndWaitInternal(const std::vector<uint6
 
 bool DebuggerController::RunTo(const std::vector<uint64_t>& remoteAddresses)
 {
-	// This is an API function of the debugger. We only do these checks at the API level.
-	if (!CanResumeTarget())
-		return false;
-
-	std::thread([&, remoteAddresses]() { RunToAndWait(remoteAddresses); }).detach();
-
-	return true;
+	return SubmitCommand(RunToCommand, nullptr, NormalFunctionGraph, 1, remoteAddresses) != 0;
 }
 
 
 DebugStopReason DebuggerController::RunToAndWait(const std::vector<uint64_t>& remoteAddresses)
 {
+	if (!m_commandQueue.IsExecutorThread())
+		return SubmitCommandAndWait(RunToCommand, NormalFunctionGraph, 1, remoteAddresses);
+
 	if (!m_targetControlMutex.try_lock())
 		return InternalError;
 
@@ -1082,11 +1339,11 @@ void DebuggerController::DetectLoadedModule()
 	if (BinaryNinja::IsUIEnabled())
 	{
 		// When the UI is enabled, let the debugger UI do the work. It can show a progress bar if the operation takes
-		// a while.
+		// a while. Wait for it, so the analysis is updated, and the stop is reported, with the view already rebased.
 		DebuggerEvent event;
 		event.type = ModuleLoadedEvent;
 		event.data.absoluteAddress = remoteBase;
-		PostDebuggerEvent(event);
+		PostDebuggerEventAndWait(event);
 	}
 	else
 	{
@@ -1118,7 +1375,7 @@ void DebuggerController::SetActiveThread(const DebugThread& thread)
 	// TODO: check if the new thread is the same as the old one. If so, do nothing and return
 	m_state->GetThreads()->SetActiveThread(thread);
 	// We only need to update the register values after we switch to a different thread
-	m_state->GetRegisters()->Update();
+	m_state->GetRegisters()->MarkDirty();
 	// Post an event so the stack view can get updated
 	DebuggerEvent event;
 	event.type = ActiveThreadChangedEvent;
@@ -1161,16 +1418,15 @@ std::vector<DebugFrame> DebuggerController::GetFramesOfThread(uint64_t tid)
 
 bool DebuggerController::Restart()
 {
-	if (!m_state->IsConnected())
-		return false;
-
-	std::thread([&]() { RestartAndWait(); }).detach();
-	return true;
+	return SubmitCommand(RestartCommand) != 0;
 }
 
 
 DebugStopReason DebuggerController::RestartAndWait()
 {
+	if (!m_commandQueue.IsExecutorThread())
+		return SubmitCommandAndWait(RestartCommand);
+
 	if (!m_state->IsConnected())
 		return InvalidStatusOrOperation;
 
@@ -1217,7 +1473,10 @@ void DebuggerController::Detach()
 	if (!m_state->IsConnected())
 		return;
 
-	std::thread([&]() { DetachAndWait(); }).detach();
+	// Detaching must not wait behind the queued commands, and makes them meaningless
+	m_commandQueue.CancelAll();
+	DbgRef<DebuggerController> controller = this;
+	std::thread([controller]() { controller->DetachAndWait(); }).detach();
 }
 
 
@@ -1246,7 +1505,10 @@ void DebuggerController::Quit()
 	if (!m_state->IsConnected())
 		return;
 
-	std::thread([&]() { QuitAndWait(); }).detach();
+	// Quitting must not wait behind the queued commands, and makes them meaningless
+	m_commandQueue.CancelAll();
+	DbgRef<DebuggerController> controller = this;
+	std::thread([controller]() { controller->QuitAndWait(); }).detach();
 }
 
 
@@ -1281,7 +1543,9 @@ bool DebuggerController::Pause()
 	if (!(m_state->IsConnected() && m_state->IsRunning()))
 		return false;
 
-	std::thread([&]() { PauseAndWait(); }).detach();
+	// The pause interrupts the command in flight, so it cannot be queued behind it
+	DbgRef<DebuggerController> controller = this;
+	std::thread([controller]() { controller->PauseAndWait(); }).detach();
 
 	return true;
 }
@@ -1323,6 +1587,37 @@ DebugStopReason DebuggerController::StepIntoAndWaitInternal()
 }
 
 
+DebugStopReason DebuggerController::StepInstructionsAndWaitInternal(
+	uint64_t count, const std::function<bool(uint64_t)>& stopPredicate)
+{
+	if (count == 0)
+		return SingleStep;
+
+	if (m_adapter->SupportFeature(DebugAdapterSupportStepInstructions))
+	{
+		m_userRequestedBreak = false;
+		m_stepInstructionsCount = count;
+		m_stepInstructionsPredicate = stopPredicate;
+		auto reason = ExecuteAdapterAndWait(DebugAdapterStepInstructions);
+		m_stepInstructionsPredicate = nullptr;
+		return reason;
+	}
+
+	// The adapter can only step one instruction at a time, so we wait for every one of them
+	DebugStopReason reason = SingleStep;
+	for (uint64_t i = 0; i < count; i++)
+	{
+		reason = StepIntoAndWaitInternal();
+		if (!ExpectSingleStep(reason))
+			return reason;
+
+		if (stopPredicate && stopPredicate(m_state->IP()))
+			break;
+	}
+	return reason;
+}
+
+
 DebugStopReason DebuggerController::EmulateStepOverAndWait()
 {
 	uint64_t remoteIP = m_state->IP();
@@ -1335,33 +1630,18 @@ DebugStopReason DebuggerController::EmulateStepOverAndWait()
 	size_t size = remoteArch->GetMaxInstructionLength();
 	DataBuffer buffer = m_adapter->ReadMemory(remoteIP, size);
 	size_t bytesRead = buffer.GetLength();
+	const uint8_t* data = (const uint8_t*)buffer.GetData();
 
-	Ref<LowLevelILFunction> ilFunc = new LowLevelILFunction(remoteArch, nullptr);
-	ilFunc->SetCurrentAddress(remoteArch, remoteIP);
-	remoteArch->GetInstructionLowLevelIL((const uint8_t*)buffer.GetData(), remoteIP, bytesRead, *ilFunc);
-
-	const auto& instr = (*ilFunc)[0];
-	if (instr.operation != LLIL_CALL)
-	{
+	if (!m_instructionCache.IsCall(remoteArch, remoteIP, data, bytesRead))
 		return StepIntoAndWaitInternal();
-	}
-	else
-	{
-		InstructionInfo info;
-		if (!remoteArch->GetInstructionInfo((const uint8_t*)buffer.GetData(), remoteIP, bytesRead, info))
-		{
-			// Whenever there is a failure, we fail back to step into
-			return StepIntoAndWaitInternal();
-		}
 
-		if (info.length == 0)
-		{
-			return StepIntoAndWaitInternal();
-		}
+	// Whenever there is a failure, we fail back to step into
+	auto info = m_instructionCache.GetInstructionInfo(remoteArch, remoteIP, data, bytesRead);
+	if (!info.has_value())
+		return StepIntoAndWaitInternal();
 
-		uint64_t remoteIPNext = remoteIP + info.length;
-		return RunToAndWaitInternal({remoteIPNext});
-	}
+	uint64_t remoteIPNext = remoteIP + info->length;
+	return RunToAndWaitInternal({remoteIPNext});
 }
 
 
@@ -1549,8 +1829,10 @@ void DebuggerController::EventHandler(const DebuggerEvent& event)
 	case DetachedEventType:
 	case LaunchFailureEventType:
 	{
+		m_coverage->OnTargetExited();
 		m_inputFileLoaded = false;
 		m_initialBreakpointSeen = false;
+		m_state->FlushBreakpoints();
 		RemoveDebuggerMemoryRegion();
 		if (m_accessor)
 		{
@@ -1566,30 +1848,25 @@ void DebuggerController::EventHandler(const DebuggerEvent& event)
 	case TargetStoppedEventType:
 	{
 		m_state->MarkDirty();
-		m_state->UpdateCaches();
+		uint64_t epoch = m_state->GetStopEpoch();
 		m_state->SetConnectionStatus(DebugAdapterConnectedStatus);
 		m_state->SetExecutionStatus(DebugAdapterPausedStatus);
 		m_lastIP = m_currentIP;
 		m_currentIP = m_state->IP();
+		m_state->FlushBreakpoints();
+		m_coverage->Update();
 
+		// This only fetches the modules until the input file is found
 		DetectLoadedModule();
-		UpdateStackVariables();
-		AddRegisterValuesToExpressionParser();
+		ScheduleStopStages(epoch, true);
 		break;
 	}
 	case ActiveThreadChangedEvent:
-	{
-		m_state->UpdateCaches();
-		m_lastIP = m_currentIP;
-		m_currentIP = m_state->IP();
-		AddRegisterValuesToExpressionParser();
-		break;
-	}
 	case RegisterChangedEvent:
 	{
 		m_lastIP = m_currentIP;
 		m_currentIP = m_state->IP();
-		AddRegisterValuesToExpressionParser();
+		ScheduleStopStages(m_state->GetStopEpoch(), false);
 		break;
 	}
 	case ErrorEventType:
@@ -1603,99 +1880,96 @@ void DebuggerController::EventHandler(const DebuggerEvent& event)
 }
 
 
-size_t DebuggerController::RegisterEventCallback(
-	std::function<void(const DebuggerEvent&)> callback, const std::string& name)
+size_t DebuggerController::RegisterEventCallback(std::function<void(const DebuggerEvent&)> callback,
+	const std::string& name, DebuggerEventCallbackAffinity affinity, DebuggerEventTypeMask eventTypes)
 {
 	std::unique_lock<std::recursive_mutex> lock(m_callbackMutex);
-	DebuggerEventCallback object;
-	object.function = callback;
-	object.index = m_callbackIndex++;
-	object.name = name;
-	m_eventCallbacks.push_back(object);
-	return object.index;
+	auto subscriber =
+		std::make_shared<DebuggerEventSubscriber>(callback, m_callbackIndex++, name, affinity, eventTypes);
+	subscriber->Start();
+	m_eventCallbacks.push_back(subscriber);
+	return subscriber->GetIndex();
 }
 
 
 bool DebuggerController::RemoveEventCallback(size_t index)
 {
-	std::unique_lock<std::recursive_mutex> lock(m_callbackMutex);
-	m_disabledCallbacks.insert(index);
-	return RemoveEventCallbackInternal(index);
-}
-
-
-bool DebuggerController::RemoveEventCallbackInternal(size_t index)
-{
-	for (auto it = m_eventCallbacks.begin(); it != m_eventCallbacks.end(); it++)
+	std::shared_ptr<DebuggerEventSubscriber> subscriber;
 	{
-		if (it->index == index)
+		std::unique_lock<std::recursive_mutex> lock(m_callbackMutex);
+		for (auto it = m_eventCallbacks.begin(); it != m_eventCallbacks.end(); it++)
 		{
-			m_eventCallbacks.erase(it);
-			return true;
+			if ((*it)->GetIndex() == index)
+			{
+				subscriber = *it;
+				m_eventCallbacks.erase(it);
+				break;
+			}
 		}
 	}
-	return false;
+
+	if (!subscriber)
+		return false;
+
+	// This may join the worker thread of the subscriber, so it is done without holding m_callbackMutex
+	subscriber->Remove();
+	return true;
 }
 
 
 void DebuggerController::PostDebuggerEvent(const DebuggerEvent& event)
 {
+	// The output the target wrote before it stopped or went away is sent before the event, not after
+	if ((event.type == AdapterStoppedEventType) || (event.type == TargetExitedEventType)
+		|| (event.type == DetachedEventType))
+		PublishTargetOutput();
+
 	std::unique_lock<std::recursive_mutex> callbackLock(m_callbackMutex);
-	std::list<DebuggerEventCallback> eventCallbacks = m_eventCallbacks;
+	std::list<std::shared_ptr<DebuggerEventSubscriber>> eventCallbacks = m_eventCallbacks;
 	callbackLock.unlock();
 
+	// The inline callbacks, e.g., our own EventHandler() and the one waiting for the adapter to stop, run right here.
+	// The others only get the event queued, so the adapter never waits for the UI or a script.
+	std::unique_lock<std::recursive_mutex> dispatchLock(m_dispatchMutex);
 	if (event.type == AdapterStoppedEventType)
 		m_lastAdapterStopEventConsumed = false;
 
-	ExecuteOnMainThreadAndWait([&]() {
-		DebuggerEvent eventToSend = event;
-		if ((eventToSend.type == TargetStoppedEventType) && !m_initialBreakpointSeen)
-		{
-			m_initialBreakpointSeen = true;
-			eventToSend.data.targetStoppedData.reason = InitialBreakpoint;
-		}
-
-		for (const DebuggerEventCallback& cb : eventCallbacks)
-		{
-			if (m_disabledCallbacks.find(cb.index) != m_disabledCallbacks.end())
-				continue;
+	DebuggerEvent eventToSend = event;
+	if ((eventToSend.type == TargetStoppedEventType) && !m_initialBreakpointSeen)
+	{
+		m_initialBreakpointSeen = true;
+		eventToSend.data.targetStoppedData.reason = InitialBreakpoint;
+	}
 
-			cb.function(eventToSend);
-		}
+	for (const auto& subscriber : eventCallbacks)
+		subscriber->Post(eventToSend);
 
-		// If the current event is an AdapterStoppedEvent, and it is not consumed by any callback, then the adapter
-		// stop is not caused by the debugger core. Notify a target stop reason in this case.
-		if (event.type == AdapterStoppedEventType && !m_lastAdapterStopEventConsumed)
+	// If the current event is an AdapterStoppedEvent, and it is not consumed by any callback, then the adapter
+	// stop is not caused by the debugger core. Notify a target stop reason in this case.
+	if (event.type == AdapterStoppedEventType && !m_lastAdapterStopEventConsumed)
+	{
+		DebuggerEvent stopEvent = event;
+		stopEvent.type = TargetStoppedEventType;
+		if (!m_initialBreakpointSeen)
 		{
-			DebuggerEvent stopEvent = event;
-			stopEvent.type = TargetStoppedEventType;
-			if (!m_initialBreakpointSeen)
-			{
-				m_initialBreakpointSeen = true;
-				stopEvent.data.targetStoppedData.reason = InitialBreakpoint;
-			}
-			for (const DebuggerEventCallback& cb : eventCallbacks)
-			{
-				if (m_disabledCallbacks.find(cb.index) != m_disabledCallbacks.end())
-					continue;
-
-				cb.function(stopEvent);
-			}
+			m_initialBreakpointSeen = true;
+			stopEvent.data.targetStoppedData.reason = InitialBreakpoint;
 		}
-	});
-
-	CleanUpDisabledEvent();
+		for (const auto& subscriber : eventCallbacks)
+			subscriber->Post(stopEvent);
+	}
 }
 
 
-void DebuggerController::CleanUpDisabledEvent()
+void DebuggerController::PostDebuggerEventAndWait(const DebuggerEvent& event)
 {
-	std::unique_lock<std::recursive_mutex> lock(m_callbackMutex);
-	for (const auto index : m_disabledCallbacks)
-	{
-		RemoveEventCallbackInternal(index);
-	}
-	m_disabledCallbacks.clear();
+	std::unique_lock<std::recursive_mutex> callbackLock(m_callbackMutex);
+	std::list<std::shared_ptr<DebuggerEventSubscriber>> eventCallbacks = m_eventCallbacks;
+	callbackLock.unlock();
+
+	std::unique_lock<std::recursive_mutex> dispatchLock(m_dispatchMutex);
+	for (const auto& subscriber : eventCallbacks)
+		subscriber->PostAndWait(event);
 }
 
 
@@ -1760,7 +2034,11 @@ bool DebuggerController::WriteMemory(std::uintptr_t address, const DataBuffer& b
 	if (!memory)
 		return false;
 
-	return memory->WriteMemory(address, buffer);
+	if (!memory->WriteMemory(address, buffer))
+		return false;
+
+	m_instructionCache.Invalidate(address, buffer.GetLength());
+	return true;
 }
 
 
@@ -1842,6 +2120,39 @@ void DebuggerController::WriteStdIn(const std::string message)
 }
 
 
+void DebuggerController::PublishTargetOutput()
+{
+	// Under the dispatch mutex, so the batches are posted in order, and a stop event posted meanwhile comes after them
+	std::unique_lock<std::recursive_mutex> lock(m_dispatchMutex);
+	for (auto channel : {TargetStdoutChannel, TargetStderrChannel})
+	{
+		uint64_t& position = m_publishedTargetOutput[channel];
+		while (position < m_targetOutput.GetEndPosition(channel))
+		{
+			DebuggerEvent event;
+			event.type = StdoutMessageEventType;
+			event.data.messageData.channel = channel;
+			event.data.messageData.message = m_targetOutput.Read(
+				channel, position, event.data.messageData.droppedBytes, TargetOutputBuffer::DefaultCapacity);
+			PostDebuggerEvent(event);
+		}
+	}
+}
+
+
+std::string DebuggerController::ReadTargetOutput(
+	TargetOutputChannel channel, uint64_t& position, uint64_t& droppedBytes, size_t maxSize)
+{
+	return m_targetOutput.Read(channel, position, droppedBytes, maxSize);
+}
+
+
+uint64_t DebuggerController::GetTargetOutputPosition(TargetOutputChannel channel)
+{
+	return m_targetOutput.GetEndPosition(channel);
+}
+
+
 std::string DebuggerController::InvokeBackendCommand(const std::string& cmd)
 {
 	if (!m_adapter)
@@ -2037,6 +2348,49 @@ void DebuggerController::UpdateStackVariables()
 }
 
 
+void DebuggerController::SetAutomationMode(bool enabled)
+{
+	if (m_automationMode.exchange(enabled) == enabled)
+		return;
+
+	if (enabled || !m_state->IsConnected() || m_state->IsRunning())
+		return;
+
+	// Catch up on the work skipped at the last stop
+	ScheduleStopStages(m_state->GetStopEpoch(), true);
+	NotifyEvent(ForceMemoryCacheUpdateEvent);
+}
+
+
+bool DebuggerController::IsCurrentStop(uint64_t epoch) const
+{
+	return (epoch == m_state->GetStopEpoch()) && m_state->IsConnected() && !m_state->IsRunning();
+}
+
+
+void DebuggerController::ScheduleStopStages(uint64_t epoch, bool stackVariables)
+{
+	// Both stages only serve the user
+	if (m_automationMode)
+		return;
+
+	DbgRef<DebuggerController> controller = this;
+	WorkerEnqueue(
+		[controller, epoch, stackVariables]() {
+			std::unique_lock<std::mutex> lock(controller->m_stopStageMutex);
+			// Each stage reads the target, so stop as soon as it is resumed
+			if (!controller->IsCurrentStop(epoch))
+				return;
+			controller->AddRegisterValuesToExpressionParser();
+
+			if (!stackVariables || !controller->IsCurrentStop(epoch))
+				return;
+			controller->UpdateStackVariables();
+		},
+		"Debugger Stop Stages");
+}
+
+
 void DebuggerController::AddRegisterValuesToExpressionParser()
 {
 	auto regs = GetAllRegisters();
@@ -2161,6 +2515,8 @@ std::string DebuggerController::GetStopReasonString(DebugStopReason reason)
 		return "UserRequestedBreak";
 	case OperationNotSupported:
 		return "OperationNotSupported";
+	case Watchpoint:
+		return "Watchpoint";
 	default:
 		return "";
 	}
@@ -2207,7 +2563,9 @@ DebugStopReason DebuggerController::ExecuteAdapterAndWait(const DebugAdapterOper
 			}
 			m_lastAdapterStopEventConsumed = true;
 		},
-		"WaitForAdapterStop");
+		"WaitForAdapterStop", InlineEventCallbackAffinity,
+		DebuggerEventTypeBit(AdapterStoppedEventType) | DebuggerEventTypeBit(TargetExitedEventType)
+			| DebuggerEventTypeBit(DetachedEventType));
 
 	bool resumeOK = false;
 	bool operationRequested = false;
@@ -2222,6 +2580,9 @@ DebugStopReason DebuggerController::ExecuteAdapterAndWait(const DebugAdapterOper
 	case DebugAdapterStepInto:
 		resumeOK = m_adapter->StepInto();
 		break;
+	case DebugAdapterStepInstructions:
+		resumeOK = m_adapter->StepInstructions(m_stepInstructionsCount, m_stepInstructionsPredicate);
+		break;
 	case DebugAdapterStepIntoReverse:
         resumeOK = m_adapter->StepIntoReverse();
         break;
@@ -2261,7 +2622,8 @@ DebugStopReason DebuggerController::ExecuteAdapterAndWait(const DebugAdapterOper
 
 	bool ok = false;
 	if ((operation == DebugAdapterGo) || (operation == DebugAdapterStepInto) || (operation == DebugAdapterStepOver)
-		|| (operation == DebugAdapterStepReturn) || (operation == DebugAdapterLaunch)
+		|| (operation == DebugAdapterStepInstructions) || (operation == DebugAdapterStepReturn)
+		|| (operation == DebugAdapterLaunch)
 		|| (operation == DebugAdapterConnect) || (operation == DebugAdapterAttach))
 	{
 		ok = resumeOK;
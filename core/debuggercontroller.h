@@ -23,17 +23,15 @@ limitations under the License.
 #include "ffi_global.h"
 #include "refcountobject.h"
 #include "debuggerfileaccessor.h"
+#include "debuggercoverage.h"
+#include "debuggercommandqueue.h"
+#include "debuggereventsubscriber.h"
+#include "targetoutputbuffer.h"
+#include "../api/decodedinstructioncache.h"
 
 DECLARE_DEBUGGER_API_OBJECT(BNDebuggerController, DebuggerController);
 
 namespace BinaryNinjaDebugger {
-	struct DebuggerEventCallback
-	{
-		std::function<void(const DebuggerEvent& event)> function;
-		size_t index;
-		std::string name;
-	};
-
 	// This is used by the debugger to track stack variables it defined. It is simpler than
 	// BinaryNinja::VariableNameAndType that it does not track the Variable and autoDefined.
 	struct StackVariableNameAndType
@@ -62,6 +60,8 @@ namespace BinaryNinjaDebugger {
 	private:
 		DebugAdapter* m_adapter;
 		DebuggerState* m_state;
+		DebuggerCoverage* m_coverage;
+		BinaryNinjaDebuggerAPI::DecodedInstructionCache m_instructionCache;
 		FileMetadataRef m_file;
 		BinaryViewRef m_data;
 		DebuggerFileAccessor* m_accessor;
@@ -75,9 +75,10 @@ namespace BinaryNinjaDebugger {
 		static size_t g_controllerCount;
 
 		std::atomic<size_t> m_callbackIndex = 0;
-		std::list<DebuggerEventCallback> m_eventCallbacks;
+		std::list<std::shared_ptr<DebuggerEventSubscriber>> m_eventCallbacks;
 		std::recursive_mutex m_callbackMutex;
-		std::set<size_t> m_disabledCallbacks;
+		// Events are dispatched one at a time, so the inline callbacks never run concurrently
+		std::recursive_mutex m_dispatchMutex;
 
 		// m_adapterMutex is a low-level mutex that protects the adapter access. It cannot be locked recursively.
 		// m_targetControlMutex is a high-level mutex that prevents two threads from controlling the debugger at the
@@ -85,6 +86,10 @@ namespace BinaryNinjaDebugger {
 		std::mutex m_adapterMutex;
 		std::recursive_mutex m_targetControlMutex;
 
+		// Runs the asynchronous target control APIs one after another. Pause, quit and detach are not queued, since
+		// they must be able to interrupt the command in flight.
+		DebuggerCommandQueue m_commandQueue;
+
 		uint64_t m_lastIP = 0;
 		uint64_t m_currentIP = 0;
 
@@ -101,13 +106,37 @@ namespace BinaryNinjaDebugger {
 
 		bool m_firstLaunch = true;
 		bool m_shouldAnnotateStackVariable = false;
+		// Skip the presentation-only work on every stop, see the "debugger.automationMode" setting
+		std::atomic_bool m_automationMode = false;
+
+		// The arguments of the pending DebugAdapterStepInstructions operation
+		uint64_t m_stepInstructionsCount = 0;
+		std::function<bool(uint64_t)> m_stepInstructionsPredicate;
+		// An upper bound of the instructions to step through when looking for the start of an IL instruction, so a
+		// tight loop without any IL instruction cannot keep us stepping forever
+		static constexpr uint64_t MaxILStepInstructions = 0x100000;
 
 		void EventHandler(const DebuggerEvent& event);
 		void UpdateStackVariables();
 		void AddRegisterValuesToExpressionParser();
+
+		// Stop handling is lazy: EventHandler() only does what the stop event itself needs, and the stop is published
+		// right after. Registers, threads and modules are fetched on first access, and the annotations below run in
+		// the background. A stage started for an earlier stop epoch gives up.
+		std::mutex m_stopStageMutex;
+		void ScheduleStopStages(uint64_t epoch, bool stackVariables);
+		bool IsCurrentStop(uint64_t epoch) const;
 		bool CreateDebugAdapter();
 		bool CreateDebuggerBinaryView();
 
+		// Sorted addresses of the instructions of a function at an IL level, used to find IL instruction boundaries
+		// while stepping. Built on first use, and dropped when the function is analyzed again. The IL is generated
+		// without holding the mutex, and the generation number tells whether it went stale in the meantime.
+		std::map<std::pair<uint64_t, BNFunctionGraphType>, std::vector<uint64_t>> m_ilInstructionAddresses;
+		uint64_t m_ilInstructionAddressesGeneration = 0;
+		std::mutex m_ilInstructionAddressesMutex;
+		std::optional<bool> IsILInstructionStart(const FunctionRef& func, BNFunctionGraphType il, uint64_t address);
+		bool IsILInstructionStart(BNFunctionGraphType il, uint64_t address);
 		DebugStopReason StepIntoIL(BNFunctionGraphType il);
 		DebugStopReason StepIntoReverseIL(BNFunctionGraphType il);
 		DebugStopReason StepOverIL(BNFunctionGraphType il);
@@ -124,16 +153,38 @@ namespace BinaryNinjaDebugger {
 		DebugStopReason GoReverseAndWaitInternal();
 		DebugStopReason StepIntoAndWaitInternal();
 		DebugStopReason StepIntoReverseAndWaitInternal();
+		// Steps up to `count` instructions, or until `stopPredicate` returns true for the new IP
+		DebugStopReason StepInstructionsAndWaitInternal(
+			uint64_t count, const std::function<bool(uint64_t)>& stopPredicate);
 		DebugStopReason EmulateStepOverAndWait();
 		DebugStopReason StepOverAndWaitInternal();
 		DebugStopReason StepOverReverseAndWaitInternal();
 		DebugStopReason EmulateStepReturnAndWait();
+		// The return address of the current function, found without unwinding when the frame is not set up yet
+		std::optional<uint64_t> GetReturnAddressInPrologue();
+		// Whether the instruction right before `address` is a call, i.e., `address` can be a return address
+		bool FollowsCall(Architecture* arch, uint64_t address);
+		DebugStopReason RunToReturnAddressAndWait(uint64_t returnAddress);
+		// Runs to the return instructions of the current function, used when the stack cannot be unwound
+		DebugStopReason RunToReturnInstructionsAndWait();
 		DebugStopReason StepReturnAndWaitInternal();
 		DebugStopReason StepReturnReverseAndWaitInternal();
 		DebugStopReason RunToAndWaitInternal(const std::vector<uint64_t> &remoteAddresses);
 
 		// Whether we can resume the execution of the target, including stepping.
 		bool CanResumeTarget();
+		// Queues a resume or step. Returns an invalid future if the target cannot be resumed and nothing is queued
+		// before it.
+		std::shared_future<DebugStopReason> SubmitResumeCommand(const std::string& name,
+			DebuggerCommandQueue::Work work, DebuggerCommandQueue::Completion completion = nullptr,
+			size_t* id = nullptr);
+		std::shared_future<DebugStopReason> QueueCommand(DebuggerCommandType type,
+			DebuggerCommandQueue::Completion completion, BNFunctionGraphType il, uint64_t count,
+			const std::vector<uint64_t>& remoteAddresses, size_t* id);
+		// The synchronous operations, e.g., GoAndWait(), are queued like the others, so they wait for the commands
+		// before them instead of failing. When called by a queued command, they run right away.
+		DebugStopReason SubmitCommandAndWait(DebuggerCommandType type, BNFunctionGraphType il = NormalFunctionGraph,
+			uint64_t count = 1, const std::vector<uint64_t>& remoteAddresses = {});
 
 		bool ExpectSingleStep(DebugStopReason reason);
 
@@ -153,6 +204,13 @@ namespace BinaryNinjaDebugger {
 
 		void DetectLoadedModule();
 
+		// The output of the target. StdoutMessageEventType events are posted from it in batches, each with what was
+		// written since the previous one. The positions published so far are guarded by m_dispatchMutex. Declared
+		// last, so its notify thread is stopped before the rest goes away.
+		uint64_t m_publishedTargetOutput[2] = {};
+		TargetOutputBuffer m_targetOutput {[this]() { PublishTargetOutput(); }};
+		void PublishTargetOutput();
+
 	public:
 		DebuggerController(BinaryViewRef data);
 		static DbgRef<DebuggerController> GetController(BinaryViewRef data);
@@ -175,6 +233,8 @@ namespace BinaryNinjaDebugger {
 		void DeleteBreakpoint(uint64_t address);
 		void DeleteBreakpoint(const ModuleNameAndOffset& address);
 		DebugBreakpoint GetAllBreakpoints();
+		// Write any pending breakpoint changes into the BinaryView metadata
+		void FlushBreakpoints();
 
 		// registers
 		uint64_t GetRegisterValue(const std::string& name);
@@ -213,15 +273,17 @@ namespace BinaryNinjaDebugger {
 		bool WriteMemory(std::uintptr_t address, const DataBuffer& buffer);
 
 		// debugger events
-		size_t RegisterEventCallback(
-			std::function<void(const DebuggerEvent& event)> callback, const std::string& name = "");
+		size_t RegisterEventCallback(std::function<void(const DebuggerEvent& event)> callback,
+			const std::string& name = "",
+			DebuggerEventCallbackAffinity affinity = MainThreadEventCallbackAffinity,
+			DebuggerEventTypeMask eventTypes = AllDebuggerEventTypes);
 		bool RemoveEventCallback(size_t index);
-		bool RemoveEventCallbackInternal(size_t index);
 		void NotifyStopped(DebugStopReason reason, void* data = nullptr);
 		void NotifyError(const std::string& error, const std::string& shortError, void* data = nullptr);
 		void NotifyEvent(DebuggerEventType event);
 		void PostDebuggerEvent(const DebuggerEvent& event);
-		void CleanUpDisabledEvent();
+		// Like PostDebuggerEvent(), but only returns once every subscriber has handled the event
+		void PostDebuggerEventAndWait(const DebuggerEvent& event);
 
 		// shortcut for instruction pointer
 		uint64_t GetLastIP() const { return m_lastIP; }
@@ -251,8 +313,15 @@ namespace BinaryNinjaDebugger {
 		bool StepOverReverse(BNFunctionGraphType il);
 		bool StepReturn();
 		bool StepReturnReverse();
+		bool StepInstructions(uint64_t count);
 		bool RunTo(const std::vector<uint64_t>& remoteAddresses);
 		bool Pause();
+		// Queues one of the operations above, and calls `completion` with its stop reason. Returns the id of the
+		// command, which can be passed to CancelCommand(), or 0 if the operation is rejected.
+		size_t SubmitCommand(DebuggerCommandType type, DebuggerCommandQueue::Completion completion = nullptr,
+			BNFunctionGraphType il = NormalFunctionGraph, uint64_t count = 1,
+			const std::vector<uint64_t>& remoteAddresses = {});
+		bool CancelCommand(size_t id) { return m_commandQueue.Cancel(id); }
 
 		DebugStopReason ExecuteAdapterAndWait(const DebugAdapterOperation operation);
 
@@ -269,6 +338,7 @@ namespace BinaryNinjaDebugger {
 		DebugStopReason StepOverReverseAndWait(BNFunctionGraphType il);
 		DebugStopReason StepReturnAndWait();
 		DebugStopReason StepReturnReverseAndWait();
+		DebugStopReason StepInstructionsAndWait(uint64_t count);
 		DebugStopReason RunToAndWait(const std::vector<uint64_t>& remoteAddresses);
 		DebugStopReason PauseAndWait();
 		void DetachAndWait();
@@ -277,6 +347,9 @@ namespace BinaryNinjaDebugger {
 		// getters
 		DebugAdapter* GetAdapter() { return m_adapter; }
 		DebuggerState* GetState() { return m_state; }
+		BinaryNinjaDebuggerAPI::DecodedInstructionCache& GetInstructionCache() { return m_instructionCache; }
+		DebuggerCommandQueue& GetCommandQueue() { return m_commandQueue; }
+		DebuggerCoverage* GetCoverage() { return m_coverage; }
 		BinaryViewRef GetData() { return m_data; }
 		FileMetadataRef GetFile() { return m_file; }
 		void SetData(BinaryViewRef view) {}
@@ -286,6 +359,11 @@ namespace BinaryNinjaDebugger {
 
 		void WriteStdIn(const std::string message);
 
+		// Pulls the output of the target from `position`, see TargetOutputBuffer::Read()
+		std::string ReadTargetOutput(
+			TargetOutputChannel channel, uint64_t& position, uint64_t& droppedBytes, size_t maxSize);
+		uint64_t GetTargetOutputPosition(TargetOutputChannel channel);
+
 		std::string InvokeBackendCommand(const std::string& cmd);
 
 		static std::string GetStopReasonString(DebugStopReason);
@@ -302,15 +380,26 @@ namespace BinaryNinjaDebugger {
 		bool IsFirstLaunch();
 		bool IsTTD();
 
+		bool IsAutomationMode() const { return m_automationMode; }
+		void SetAutomationMode(bool enabled);
+
 		void OnRebased(BinaryView* oldView, BinaryView* newView) override {
 			m_data = newView;
 			m_viewStart = newView->GetStart();
+			{
+				std::unique_lock<std::mutex> lock(m_ilInstructionAddressesMutex);
+				m_ilInstructionAddresses.clear();
+				m_ilInstructionAddressesGeneration++;
+			}
 			// UnregisterNotification() is not designed to be called from one of the callbacks, so we cannot call it
 			// here. Also, there is no need to do so -- the oldView is about to be deleted
 			// oldView->UnregisterNotification(this);
 			newView->RegisterNotification(this);
 		}
 
+		void OnAnalysisFunctionUpdated(BinaryView* view, Function* func) override;
+		void OnAnalysisFunctionRemoved(BinaryView* view, Function* func) override;
+
 		bool RemoveDebuggerMemoryRegion();
 		bool ReAddDebuggerMemoryRegion();
 
@@ -0,0 +1,253 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <map>
+#include "debuggercoverage.h"
+#include "debuggercontroller.h"
+
+using namespace BinaryNinja;
+using namespace BinaryNinjaDebugger;
+
+
+DebuggerCoverage::DebuggerCoverage(DebuggerController* controller) : m_controller(controller) {}
+
+
+size_t DebuggerCoverage::FindBlock(uint64_t address) const
+{
+	auto it = std::lower_bound(m_blocks.begin(), m_blocks.end(), address);
+	if ((it == m_blocks.end()) || (*it != address))
+		return m_blocks.size();
+	return it - m_blocks.begin();
+}
+
+
+bool DebuggerCoverage::Start()
+{
+	std::unique_lock<std::recursive_mutex> lock(m_mutex);
+	DebuggerState* state = m_controller->GetState();
+	DebugAdapter* adapter = state->GetAdapter();
+	if (!adapter || !state->IsConnected())
+	{
+		LogWarn("Coverage can only be collected while the target is running");
+		return false;
+	}
+
+	if (m_active)
+		Stop();
+
+	BinaryViewRef data = m_controller->GetData();
+	if (!data)
+		return false;
+
+	// Blocks can be shared by several functions, so collect them by address first
+	std::map<uint64_t, uint64_t> blocks;
+	m_functions.clear();
+	for (const FunctionRef& func : data->GetAnalysisFunctionList())
+	{
+		// Skip the functions created in the memory of other modules
+		if (!data->IsOffsetBackedByFile(func->GetStart()))
+			continue;
+
+		m_functions.push_back({func->GetStart(), func->GetSymbol()->GetFullName()});
+		for (const Ref<BasicBlock>& block : func->GetBasicBlocks())
+			blocks[block->GetStart()] = block->GetEnd();
+	}
+
+	if (blocks.empty())
+	{
+		LogWarn("No basic blocks to collect coverage for, is the analysis done?");
+		return false;
+	}
+
+	m_blocks.clear();
+	m_blockSizes.clear();
+	m_blocks.reserve(blocks.size());
+	m_blockSizes.reserve(blocks.size());
+	m_moduleEnd = 0;
+	for (const auto& [start, end] : blocks)
+	{
+		m_blocks.push_back(start);
+		m_blockSizes.push_back((uint16_t)std::min<uint64_t>(end - start, std::numeric_limits<uint16_t>::max()));
+		m_moduleEnd = std::max(m_moduleEnd, end);
+	}
+	m_hits.assign(m_blocks.size(), false);
+	m_moduleBase = m_controller->GetViewFileSegmentsStart();
+	m_modulePath = state->GetExecutablePath();
+
+	if (!adapter->StartCoverage(m_blocks))
+	{
+		LogWarn("The debug adapter does not support coverage collection");
+		return false;
+	}
+
+	m_active = true;
+	return true;
+}
+
+
+void DebuggerCoverage::Stop()
+{
+	std::unique_lock<std::recursive_mutex> lock(m_mutex);
+	if (!m_active)
+		return;
+
+	Update();
+	if (DebugAdapter* adapter = m_controller->GetState()->GetAdapter())
+		adapter->StopCoverage();
+	m_active = false;
+}
+
+
+void DebuggerCoverage::Update()
+{
+	std::unique_lock<std::recursive_mutex> lock(m_mutex);
+	if (!m_active)
+		return;
+
+	DebugAdapter* adapter = m_controller->GetState()->GetAdapter();
+	if (!adapter)
+		return;
+
+	std::vector<bool> hits = adapter->GetCoverage();
+	if (hits.size() != m_hits.size())
+		return;
+
+	for (size_t i = 0; i < hits.size(); i++)
+	{
+		if (hits[i])
+			m_hits[i] = true;
+	}
+}
+
+
+void DebuggerCoverage::OnTargetExited()
+{
+	Stop();
+}
+
+
+std::vector<uint64_t> DebuggerCoverage::GetCoveredBlocks()
+{
+	std::unique_lock<std::recursive_mutex> lock(m_mutex);
+	Update();
+	std::vector<uint64_t> result;
+	for (size_t i = 0; i < m_blocks.size(); i++)
+	{
+		if (m_hits[i])
+			result.push_back(m_blocks[i]);
+	}
+	return result;
+}
+
+
+bool DebuggerCoverage::ExportDrcov(const std::string& path)
+{
+	std::unique_lock<std::recursive_mutex> lock(m_mutex);
+	Update();
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		LogWarn("Failed to open %s for writing", path.c_str());
+		return false;
+	}
+
+	size_t count = std::count(m_hits.begin(), m_hits.end(), true);
+	file << "DRCOV VERSION: 2\n";
+	file << "DRCOV FLAVOR: drcov\n";
+	file << "Module Table: version 2, count 1\n";
+	file << "Columns: id, base, end, entry, checksum, timestamp, path\n";
+	file << fmt::format(" 0, 0x{:016x}, 0x{:016x}, 0x0000000000000000, 0x00000000, 0x00000000, {}\n", m_moduleBase,
+		m_moduleEnd, m_modulePath);
+	file << fmt::format("BB Table: {} bbs\n", count);
+
+	// Each entry is a little-endian {uint32_t start; uint16_t size; uint16_t moduleId;}, start being the offset from
+	// the module base
+	for (size_t i = 0; i < m_blocks.size(); i++)
+	{
+		if (!m_hits[i])
+			continue;
+
+		uint32_t start = (uint32_t)(m_blocks[i] - m_moduleBase);
+		uint16_t size = m_blockSizes[i];
+		uint8_t entry[8] = {(uint8_t)start, (uint8_t)(start >> 8), (uint8_t)(start >> 16), (uint8_t)(start >> 24),
+			(uint8_t)size, (uint8_t)(size >> 8), 0, 0};
+		file.write((const char*)entry, sizeof(entry));
+	}
+	return file.good();
+}
+
+
+bool DebuggerCoverage::ExportLcov(const std::string& path)
+{
+	std::unique_lock<std::recursive_mutex> lock(m_mutex);
+	Update();
+
+	std::ofstream file(path);
+	if (!file)
+	{
+		LogWarn("Failed to open %s for writing", path.c_str());
+		return false;
+	}
+
+	file << "TN:\n";
+	file << "SF:" << m_modulePath << "\n";
+
+	size_t functionsHit = 0;
+	for (const CoverageFunction& func : m_functions)
+		file << fmt::format("FN:{},{}\n", func.address - m_moduleBase, func.name);
+	for (const CoverageFunction& func : m_functions)
+	{
+		size_t index = FindBlock(func.address);
+		bool hit = (index < m_blocks.size()) && m_hits[index];
+		if (hit)
+			functionsHit++;
+		file << fmt::format("FNDA:{},{}\n", hit ? 1 : 0, func.name);
+	}
+	file << fmt::format("FNF:{}\nFNH:{}\n", m_functions.size(), functionsHit);
+
+	size_t linesHit = 0;
+	for (size_t i = 0; i < m_blocks.size(); i++)
+	{
+		if (m_hits[i])
+			linesHit++;
+		file << fmt::format("DA:{},{}\n", m_blocks[i] - m_moduleBase, m_hits[i] ? 1 : 0);
+	}
+	file << fmt::format("LF:{}\nLH:{}\n", m_blocks.size(), linesHit);
+	file << "end_of_record\n";
+	return file.good();
+}
+
+
+void DebuggerCoverage::ApplyHighlights()
+{
+	BinaryViewRef data = m_controller->GetData();
+	if (!data)
+		return;
+
+	for (uint64_t address : GetCoveredBlocks())
+	{
+		for (const FunctionRef& func : data->GetAnalysisFunctionsContainingAddress(address))
+		{
+			Ref<BasicBlock> block = func->GetBasicBlockAtAddress(func->GetArchitecture(), address);
+			if (block && (block->GetStart() == address))
+				block->SetAutoBasicBlockHighlight(GreenHighlightColor);
+		}
+	}
+}
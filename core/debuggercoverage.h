@@ -0,0 +1,78 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace BinaryNinjaDebugger {
+	class DebuggerController;
+
+	// Basic block coverage of the input file, collected with breakpoints. A breakpoint is placed on the start of every
+	// basic block found by the analysis. The adapter records the first hit of each one in a bitmap and removes it
+	// right away, without stopping the target, so the overhead drops to zero once the hot code has been covered.
+	class DebuggerCoverage
+	{
+	private:
+		struct CoverageFunction
+		{
+			uint64_t address;
+			std::string name;
+		};
+
+		DebuggerController* m_controller;
+		std::recursive_mutex m_mutex;
+		bool m_active = false;
+
+		// Sorted start addresses of the basic blocks, their sizes, and whether they have been executed
+		std::vector<uint64_t> m_blocks;
+		std::vector<uint16_t> m_blockSizes;
+		std::vector<bool> m_hits;
+		std::vector<CoverageFunction> m_functions;
+
+		uint64_t m_moduleBase = 0;
+		uint64_t m_moduleEnd = 0;
+		std::string m_modulePath;
+
+		size_t FindBlock(uint64_t address) const;
+
+	public:
+		DebuggerCoverage(DebuggerController* controller);
+
+		// The target must be stopped, and the input file must be loaded. Starting again resets the results.
+		bool Start();
+		// Removes the remaining breakpoints. The results are kept until the next Start().
+		void Stop();
+		// Pulls the latest hits from the adapter. Called whenever the target stops or exits.
+		void Update();
+		// The target is gone, so only keep what it has covered
+		void OnTargetExited();
+
+		bool IsActive() const { return m_active; }
+		size_t GetBlockCount() const { return m_blocks.size(); }
+		std::vector<uint64_t> GetCoveredBlocks();
+
+		// drcov (the format of DynamoRIO, which is understood by most coverage visualization tools) and lcov, with
+		// the offsets of the basic blocks from the module base used as line numbers, since there is no source
+		bool ExportDrcov(const std::string& path);
+		bool ExportLcov(const std::string& path);
+		// Highlights the covered basic blocks in the view
+		void ApplyHighlights();
+	};
+};  // namespace BinaryNinjaDebugger
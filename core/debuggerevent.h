@@ -23,7 +23,21 @@ limitations under the License.
 namespace BinaryNinjaDebugger {
 	typedef BNDebuggerEventType DebuggerEventType;
     typedef BNDebugStopReason DebugStopReason;
+    typedef BNDebugBreakpointType DebugBreakpointType;
     typedef BNDebuggerAdapterOperation DebugAdapterOperation;
+	typedef BNDebuggerEventCallbackAffinity DebuggerEventCallbackAffinity;
+	typedef BNTargetOutputChannel TargetOutputChannel;
+	typedef BNDebuggerCommandType DebuggerCommandType;
+
+	// A mask of event types, with the bit (1 << type) set for each type
+	typedef uint64_t DebuggerEventTypeMask;
+	static constexpr DebuggerEventTypeMask AllDebuggerEventTypes = BN_DEBUGGER_ALL_EVENT_TYPES;
+	static_assert(BreakpointLogEventType < 64, "DebuggerEventTypeMask cannot hold all event types");
+
+	constexpr DebuggerEventTypeMask DebuggerEventTypeBit(DebuggerEventType type)
+	{
+		return 1ULL << type;
+	}
 
 	struct TargetStoppedEventData
 	{
@@ -51,6 +65,8 @@ namespace BinaryNinjaDebugger {
 	struct StdoutMessageEventData
 	{
 		std::string message;
+		TargetOutputChannel channel = TargetStdoutChannel;
+		uint64_t droppedBytes = 0;
 	};
 
 
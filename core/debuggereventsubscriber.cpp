@@ -0,0 +1,191 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "debuggereventsubscriber.h"
+#include "binaryninjaapi.h"
+
+using namespace BinaryNinja;
+using namespace BinaryNinjaDebugger;
+
+
+DebuggerEventSubscriber::DebuggerEventSubscriber(std::function<void(const DebuggerEvent& event)> function,
+	size_t index, const std::string& name, DebuggerEventCallbackAffinity affinity, DebuggerEventTypeMask eventTypes) :
+	m_function(std::move(function)),
+	m_index(index), m_name(name), m_affinity(affinity), m_eventTypes(eventTypes)
+{
+	// Without the UI, there is no main thread to keep responsive, nor one that runs the queued work
+	if ((m_affinity == MainThreadEventCallbackAffinity) && !BinaryNinja::IsUIEnabled())
+		m_affinity = WorkerThreadEventCallbackAffinity;
+}
+
+
+void DebuggerEventSubscriber::Start()
+{
+	if (m_affinity == WorkerThreadEventCallbackAffinity)
+		m_worker = std::thread([self = shared_from_this()]() { self->WorkerLoop(); });
+}
+
+
+void DebuggerEventSubscriber::Call(const DebuggerEvent& event)
+{
+	std::unique_lock<std::recursive_mutex> lock(m_callMutex);
+	if (m_removed)
+		return;
+
+	m_function(event);
+}
+
+
+void DebuggerEventSubscriber::Post(const DebuggerEvent& event)
+{
+	if (m_removed || !Accepts(event.type))
+		return;
+
+	if (m_affinity == InlineEventCallbackAffinity)
+	{
+		Call(event);
+		return;
+	}
+
+	bool scheduleDrain = false;
+	{
+		std::unique_lock<std::mutex> lock(m_queueMutex);
+		m_queue.push_back({event, nullptr});
+		if ((m_affinity == MainThreadEventCallbackAffinity) && !m_drainScheduled)
+		{
+			m_drainScheduled = true;
+			scheduleDrain = true;
+		}
+	}
+
+	if (scheduleDrain)
+		ExecuteOnMainThread([self = shared_from_this()]() { self->Drain(); });
+	else
+		m_queueCv.notify_one();
+}
+
+
+void DebuggerEventSubscriber::PostAndWait(const DebuggerEvent& event)
+{
+	if (m_removed || !Accepts(event.type))
+		return;
+
+	if (m_affinity == InlineEventCallbackAffinity)
+	{
+		Call(event);
+		return;
+	}
+
+	if (m_affinity == MainThreadEventCallbackAffinity)
+	{
+		// Runs right away when we are on the main thread already
+		ExecuteOnMainThreadAndWait([&]() { Call(event); });
+		return;
+	}
+
+	if (std::this_thread::get_id() == m_worker.get_id())
+	{
+		Call(event);
+		return;
+	}
+
+	auto handled = std::make_shared<std::promise<void>>();
+	auto future = handled->get_future();
+	{
+		std::unique_lock<std::mutex> lock(m_queueMutex);
+		if (m_stopping)
+			return;
+		m_queue.push_back({event, handled});
+	}
+	m_queueCv.notify_one();
+	future.wait();
+}
+
+
+void DebuggerEventSubscriber::Drain()
+{
+	while (true)
+	{
+		DebuggerEvent event;
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			if (m_queue.empty() || m_removed)
+			{
+				m_drainScheduled = false;
+				return;
+			}
+			event = std::move(m_queue.front().event);
+			m_queue.pop_front();
+		}
+		Call(event);
+	}
+}
+
+
+void DebuggerEventSubscriber::WorkerLoop()
+{
+	while (true)
+	{
+		QueuedEvent queued;
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			m_queueCv.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+			if (m_stopping)
+				return;
+
+			queued = std::move(m_queue.front());
+			m_queue.pop_front();
+		}
+		Call(queued.event);
+		if (queued.handled)
+			queued.handled->set_value();
+	}
+}
+
+
+void DebuggerEventSubscriber::Remove()
+{
+	m_removed = true;
+	{
+		std::unique_lock<std::mutex> lock(m_queueMutex);
+		// Nobody handles the dropped events, so do not keep PostAndWait() waiting for them
+		for (auto& queued : m_queue)
+		{
+			if (queued.handled)
+				queued.handled->set_value();
+		}
+		m_queue.clear();
+		m_stopping = true;
+	}
+	m_queueCv.notify_all();
+
+	// The callback removes itself on the worker. It finishes on its own, and the worker, which keeps the subscriber
+	// alive, exits after it.
+	if (m_worker.joinable() && (std::this_thread::get_id() == m_worker.get_id()))
+	{
+		m_worker.detach();
+		return;
+	}
+
+	// Otherwise, the caller may free what the callback uses as soon as we return, so a call in progress is waited for.
+	// A callback that removes itself inline or on the main thread holds the lock already. A call that starts from now
+	// on sees m_removed and returns.
+	{
+		std::unique_lock<std::recursive_mutex> lock(m_callMutex);
+	}
+	if (m_worker.joinable())
+		m_worker.join();
+}
@@ -0,0 +1,86 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "debuggerevent.h"
+
+namespace BinaryNinjaDebugger {
+	// A debugger event callback, along with the queue of the events it has not received yet. Inline subscribers are
+	// called right away by Post(). The others get their events in order from their own queue, so a slow subscriber
+	// only delays itself, never the adapter or the other subscribers.
+	class DebuggerEventSubscriber : public std::enable_shared_from_this<DebuggerEventSubscriber>
+	{
+		std::function<void(const DebuggerEvent& event)> m_function;
+		size_t m_index;
+		std::string m_name;
+		DebuggerEventCallbackAffinity m_affinity;
+		DebuggerEventTypeMask m_eventTypes;
+
+		// Held while the callback runs, so Remove() can wait for a call in progress. Recursive, since a callback can
+		// remove itself.
+		std::recursive_mutex m_callMutex;
+		std::atomic_bool m_removed = false;
+
+		std::mutex m_queueMutex;
+		std::condition_variable m_queueCv;
+		// An event, and the promise to fulfill once it is handled, for the events posted by PostAndWait()
+		struct QueuedEvent
+		{
+			DebuggerEvent event;
+			std::shared_ptr<std::promise<void>> handled;
+		};
+		std::deque<QueuedEvent> m_queue;
+		// Whether a drain of the queue is already scheduled on the main thread
+		bool m_drainScheduled = false;
+		bool m_stopping = false;
+		std::thread m_worker;
+
+		void Call(const DebuggerEvent& event);
+		void Drain();
+		void WorkerLoop();
+
+	public:
+		DebuggerEventSubscriber(std::function<void(const DebuggerEvent& event)> function, size_t index,
+			const std::string& name, DebuggerEventCallbackAffinity affinity, DebuggerEventTypeMask eventTypes);
+
+		// Starts the worker thread, if the affinity needs one. Must be called once the object is owned by a
+		// shared_ptr.
+		void Start();
+		// Events of a type the subscriber did not ask for are dropped here, before they are copied into the queue
+		void Post(const DebuggerEvent& event);
+		// Delivers the event on the thread of the subscriber, and only returns once the callback has handled it. For
+		// events the caller depends on, e.g., the rebase of the view when the input file is loaded.
+		void PostAndWait(const DebuggerEvent& event);
+		// Drops the queued events, and waits for a call in progress on another thread. Once this returns, the callback
+		// is neither running nor called again, unless it is the callback itself that removes it.
+		void Remove();
+
+		size_t GetIndex() const { return m_index; }
+		const std::string& GetName() const { return m_name; }
+		DebuggerEventCallbackAffinity GetAffinity() const { return m_affinity; }
+		bool Accepts(DebuggerEventType type) const { return (m_eventTypes & DebuggerEventTypeBit(type)) != 0; }
+	};
+};  // namespace BinaryNinjaDebugger
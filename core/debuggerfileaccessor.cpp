@@ -34,7 +34,8 @@ DebuggerFileAccessor::DebuggerFileAccessor(BinaryView* parent)
 	m_controller = DebuggerController::GetController(parent);
 	m_eventCallback = m_controller->RegisterEventCallback([this](const DebuggerEvent& event){
 		eventHandler(event);
-	}, "Process View");
+	}, "Process View", InlineEventCallbackAffinity,
+		DebuggerEventTypeBit(TargetStoppedEventType) | DebuggerEventTypeBit(ForceMemoryCacheUpdateEvent));
 }
 
 
@@ -75,6 +76,11 @@ size_t DebuggerFileAccessor::Write(uint64_t offset, const void *src, size_t len)
 
 void DebuggerFileAccessor::MarkDirty()
 {
+	// Nobody looks at the views in automation mode. The analysis is brought up to date with a ForceMemoryCacheUpdate
+	// once it is turned off.
+	if (m_controller->IsAutomationMode())
+		return;
+
 	// This hack will let the views (linear/graph) update its display
 	if (m_aggressiveAnalysisUpdate)
 	{
@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <inttypes.h>
 #include <chrono>
 #include <thread>
 #include <utility>
@@ -38,6 +39,8 @@ DebuggerRegisters::DebuggerRegisters(DebuggerState* state) : m_state(state)
 
 void DebuggerRegisters::MarkDirty()
 {
+	std::unique_lock<std::recursive_mutex> lock(m_registersMutex);
+	m_epoch++;
 	m_dirty = true;
 	m_registerCache.clear();
 }
@@ -45,6 +48,7 @@ void DebuggerRegisters::MarkDirty()
 
 void DebuggerRegisters::Update()
 {
+	std::unique_lock<std::recursive_mutex> lock(m_registersMutex);
 	DebugAdapter* adapter = m_state->GetAdapter();
 	if (!adapter)
 		return;
@@ -59,6 +63,7 @@ void DebuggerRegisters::Update()
 
 uint64_t DebuggerRegisters::GetRegisterValue(const std::string& name)
 {
+	std::unique_lock<std::recursive_mutex> lock(m_registersMutex);
 	// Unlike the Python implementation, we require the DebuggerState to explicitly check for dirty caches
 	// and update the values when necessary. This is mainly because the update can be expensive.
 	if (IsDirty())
@@ -78,17 +83,20 @@ bool DebuggerRegisters::SetRegisterValue(const std::string& name, uint64_t value
 	if (!adapter)
 		return false;
 
-	auto iter = m_registerCache.find(name);
-	if (iter == m_registerCache.end())
-		return false;
-
-	bool ok = adapter->WriteRegister(name, value);
-	if (!ok)
-		return false;
-
-	// Because some registers are correlated, changing the value of one register could invalidate the value of other
-	// registers as well.
-	MarkDirty();
+	{
+		std::unique_lock<std::recursive_mutex> lock(m_registersMutex);
+		auto iter = m_registerCache.find(name);
+		if (iter == m_registerCache.end())
+			return false;
+
+		bool ok = adapter->WriteRegister(name, value);
+		if (!ok)
+			return false;
+
+		// Because some registers are correlated, changing the value of one register could invalidate the value of
+		// other registers as well.
+		MarkDirty();
+	}
 
 	m_state->GetController()->NotifyEvent(RegisterChangedEvent);
 	return true;
@@ -97,12 +105,15 @@ bool DebuggerRegisters::SetRegisterValue(const std::string& name, uint64_t value
 
 std::vector<DebugRegister> DebuggerRegisters::GetAllRegisters()
 {
-	if (IsDirty())
-		Update();
-
 	std::vector<DebugRegister> result {};
-	for (auto& [reg_name, reg] : m_registerCache)
-		result.push_back(reg);
+	{
+		std::unique_lock<std::recursive_mutex> lock(m_registersMutex);
+		if (IsDirty())
+			Update();
+
+		for (auto& [reg_name, reg] : m_registerCache)
+			result.push_back(reg);
+	}
 
 	std::sort(result.begin(), result.end(), [](const DebugRegister& lhs, const DebugRegister& rhs) {
 		return lhs.m_registerIndex < rhs.m_registerIndex;
@@ -110,7 +121,7 @@ std::vector<DebugRegister> DebuggerRegisters::GetAllRegisters()
 
 	// TODO: maybe we should not hold a m_state at all; instead we just hold a m_controller
 	auto controller = m_state->GetController();
-	if (!controller->GetState()->IsConnected())
+	if (!controller->GetState()->IsConnected() || controller->IsAutomationMode())
 		return result;
 
 	std::map<uint64_t, std::string> regHints;
@@ -141,6 +152,8 @@ DebuggerThreads::DebuggerThreads(DebuggerState* state) : m_state(state)
 
 void DebuggerThreads::MarkDirty()
 {
+	std::unique_lock<std::recursive_mutex> lock(m_threadsMutex);
+	m_epoch++;
 	m_dirty = true;
 	// clearing these here corrupts thread state updating in ::Update() below
 	// m_threads.clear();
@@ -207,6 +220,7 @@ void DebuggerThreads::SymbolizeFrames(std::vector<DebugFrame>& frames)
 
 void DebuggerThreads::Update()
 {
+	std::unique_lock<std::recursive_mutex> lock(m_threadsMutex);
 	if (!m_state)
 		return;
 
@@ -270,6 +284,7 @@ bool DebuggerThreads::SetActiveThread(const DebugThread& thread)
 
 std::vector<DebugThread> DebuggerThreads::GetAllThreads()
 {
+	std::unique_lock<std::recursive_mutex> lock(m_threadsMutex);
 	if (IsDirty())
 		Update();
 	return m_threads;
@@ -278,6 +293,7 @@ std::vector<DebugThread> DebuggerThreads::GetAllThreads()
 
 std::vector<DebugFrame> DebuggerThreads::GetFramesOfThread(uint32_t tid)
 {
+	std::unique_lock<std::recursive_mutex> lock(m_threadsMutex);
 	if (IsDirty())
 		Update();
 
@@ -291,6 +307,7 @@ std::vector<DebugFrame> DebuggerThreads::GetFramesOfThread(uint32_t tid)
 
 bool DebuggerThreads::SuspendThread(std::uint32_t tid)
 {
+	std::unique_lock<std::recursive_mutex> lock(m_threadsMutex);
 	if (!m_state)
 		return false;
 
@@ -314,12 +331,14 @@ bool DebuggerThreads::SuspendThread(std::uint32_t tid)
 		return false;
 
 	thread->m_isFrozen = true;
+	m_epoch++;
 
 	return true;
 }
 
 bool DebuggerThreads::ResumeThread(std::uint32_t tid)
 {
+	std::unique_lock<std::recursive_mutex> lock(m_threadsMutex);
 	if (!m_state)
 		return false;
 
@@ -342,6 +361,7 @@ bool DebuggerThreads::ResumeThread(std::uint32_t tid)
 		return false;
 
 	thread->m_isFrozen = false;
+	m_epoch++;
 
 	return true;
 }
@@ -354,6 +374,8 @@ DebuggerModules::DebuggerModules(DebuggerState* state) : m_state(state)
 
 void DebuggerModules::MarkDirty()
 {
+	std::unique_lock<std::recursive_mutex> lock(m_modulesMutex);
+	m_epoch++;
 	m_dirty = true;
 	m_modules.clear();
 }
@@ -361,6 +383,7 @@ void DebuggerModules::MarkDirty()
 
 void DebuggerModules::Update()
 {
+	std::unique_lock<std::recursive_mutex> lock(m_modulesMutex);
 	DebugAdapter* adapter = m_state->GetAdapter();
 	if (!adapter)
 		return;
@@ -375,6 +398,7 @@ void DebuggerModules::Update()
 
 bool DebuggerModules::GetModuleBase(const std::string& name, uint64_t& address)
 {
+	std::unique_lock<std::recursive_mutex> lock(m_modulesMutex);
 	if (IsDirty())
 		Update();
 
@@ -395,6 +419,7 @@ bool DebuggerModules::GetModuleBase(const std::string& name, uint64_t& address)
 
 DebugModule DebuggerModules::GetModuleByName(const std::string& name)
 {
+	std::unique_lock<std::recursive_mutex> lock(m_modulesMutex);
 	if (IsDirty())
 		Update();
 
@@ -409,6 +434,7 @@ DebugModule DebuggerModules::GetModuleByName(const std::string& name)
 
 DebugModule DebuggerModules::GetModuleForAddress(uint64_t remoteAddress)
 {
+	std::unique_lock<std::recursive_mutex> lock(m_modulesMutex);
 	if (IsDirty())
 		Update();
 
@@ -436,6 +462,7 @@ DebugModule DebuggerModules::GetModuleForAddress(uint64_t remoteAddress)
 
 ModuleNameAndOffset DebuggerModules::AbsoluteAddressToRelative(uint64_t absoluteAddress)
 {
+	std::unique_lock<std::recursive_mutex> lock(m_modulesMutex);
 	if (IsDirty())
 		Update();
 
@@ -457,6 +484,7 @@ ModuleNameAndOffset DebuggerModules::AbsoluteAddressToRelative(uint64_t absolute
 
 uint64_t DebuggerModules::RelativeAddressToAbsolute(const ModuleNameAndOffset& relativeAddress)
 {
+	std::unique_lock<std::recursive_mutex> lock(m_modulesMutex);
 	if (IsDirty())
 		Update();
 
@@ -482,6 +510,7 @@ uint64_t DebuggerModules::RelativeAddressToAbsolute(const ModuleNameAndOffset& r
 
 std::vector<DebugModule> DebuggerModules::GetAllModules()
 {
+	std::unique_lock<std::recursive_mutex> lock(m_modulesMutex);
 	if (IsDirty())
 		Update();
 
@@ -494,8 +523,21 @@ DebuggerBreakpoints::DebuggerBreakpoints(DebuggerState* state, std::vector<Modul
 {}
 
 
+DebuggerBreakpoints::~DebuggerBreakpoints()
+{
+	{
+		std::unique_lock<std::recursive_mutex> lock(m_breakpointMutex);
+		m_stopping = true;
+	}
+	m_flushCondition.notify_all();
+	if (m_flushThread.joinable())
+		m_flushThread.join();
+}
+
+
 bool DebuggerBreakpoints::AddAbsolute(uint64_t remoteAddress)
 {
+	std::unique_lock<std::recursive_mutex> lock(m_breakpointMutex);
 	if (!m_state->GetAdapter())
 		return false;
 
@@ -511,7 +553,7 @@ bool DebuggerBreakpoints::AddAbsolute(uint64_t remoteAddress)
 	{
 		ModuleNameAndOffset info = m_state->GetModules()->AbsoluteAddressToRelative(remoteAddress);
 		m_breakpoints.push_back(info);
-		SerializeMetadata();
+		MarkMetadataDirty();
 	}
 
 	return result;
@@ -520,10 +562,11 @@ bool DebuggerBreakpoints::AddAbsolute(uint64_t remoteAddress)
 
 bool DebuggerBreakpoints::AddOffset(const ModuleNameAndOffset& address)
 {
+	std::unique_lock<std::recursive_mutex> lock(m_breakpointMutex);
 	if (!ContainsOffset(address))
 	{
 		m_breakpoints.push_back(address);
-		SerializeMetadata();
+		MarkMetadataDirty();
 
 		// If the adapter is already created, we ask it to add the breakpoint.
 		// Otherwise, all breakpoints will be added to the adapter when the adapter is created.
@@ -540,18 +583,20 @@ bool DebuggerBreakpoints::AddOffset(const ModuleNameAndOffset& address)
 
 bool DebuggerBreakpoints::RemoveAbsolute(uint64_t remoteAddress)
 {
+	std::unique_lock<std::recursive_mutex> lock(m_breakpointMutex);
 	if (!m_state->GetAdapter())
 		return false;
 
 	ModuleNameAndOffset info = m_state->GetModules()->AbsoluteAddressToRelative(remoteAddress);
 	if (ContainsOffset(info))
 	{
-		auto iter = std::find(m_breakpoints.begin(), m_breakpoints.end(), info);
+		auto iter = FindBreakpoint(info);
 		if (iter != m_breakpoints.end())
 		{
+			RemoveOptions(*iter);
 			m_breakpoints.erase(iter);
 		}
-		SerializeMetadata();
+		MarkMetadataDirty();
 		m_state->GetAdapter()->RemoveBreakpoint(remoteAddress);
 		return true;
 	}
@@ -561,12 +606,16 @@ bool DebuggerBreakpoints::RemoveAbsolute(uint64_t remoteAddress)
 
 bool DebuggerBreakpoints::RemoveOffset(const ModuleNameAndOffset& address)
 {
+	std::unique_lock<std::recursive_mutex> lock(m_breakpointMutex);
 	if (ContainsOffset(address))
 	{
-		if (auto iter = std::find(m_breakpoints.begin(), m_breakpoints.end(), address); iter != m_breakpoints.end())
+		if (auto iter = FindBreakpoint(address); iter != m_breakpoints.end())
+		{
+			RemoveOptions(*iter);
 			m_breakpoints.erase(iter);
+		}
 
-		SerializeMetadata();
+		MarkMetadataDirty();
 
 		if (m_state->GetAdapter() && m_state->IsConnected())
 		{
@@ -582,6 +631,7 @@ bool DebuggerBreakpoints::RemoveOffset(const ModuleNameAndOffset& address)
 
 bool DebuggerBreakpoints::ContainsOffset(const ModuleNameAndOffset& address)
 {
+	std::unique_lock<std::recursive_mutex> lock(m_breakpointMutex);
 	// If there is no backend, then only check if the breakpoint is in the list
 	// This is useful when we deal with the breakpoint before the target is launched
 	if (!m_state->GetAdapter())
@@ -595,6 +645,7 @@ bool DebuggerBreakpoints::ContainsOffset(const ModuleNameAndOffset& address)
 
 bool DebuggerBreakpoints::ContainsAbsolute(uint64_t address)
 {
+	std::unique_lock<std::recursive_mutex> lock(m_breakpointMutex);
 	if (!m_state->GetAdapter())
 		return false;
 
@@ -612,61 +663,368 @@ bool DebuggerBreakpoints::ContainsAbsolute(uint64_t address)
 }
 
 
-void DebuggerBreakpoints::SerializeMetadata()
+std::vector<ModuleNameAndOffset>::iterator DebuggerBreakpoints::FindBreakpoint(const ModuleNameAndOffset& address)
+{
+	return std::find(m_breakpoints.begin(), m_breakpoints.end(), address);
+}
+
+
+void DebuggerBreakpoints::RemoveOptions(const ModuleNameAndOffset& address)
+{
+	if ((m_options.erase(address) == 0) || !m_state->GetAdapter())
+		return;
+
+	m_state->GetAdapter()->SetBreakpointCondition(address, "");
+	m_state->GetAdapter()->SetBreakpointLogMessage(address, "");
+	m_state->GetAdapter()->SetBreakpointIgnoreCount(address, 0);
+}
+
+
+bool DebuggerBreakpoints::ValidateOptions(const BreakpointOptions& options)
+{
+	// The adapter compiles them again, but validating here rejects a bad condition even when there is no adapter yet
+	auto arch = m_state->GetRemoteArchitecture();
+	size_t addressSize = arch ? arch->GetAddressSize() : 8;
+	std::string error;
+	if (!options.condition.empty())
+	{
+		BreakpointCondition compiled;
+		if (!compiled.Compile(options.condition, addressSize, error))
+		{
+			LogWarn("Invalid breakpoint condition \"%s\": %s", options.condition.c_str(), error.c_str());
+			return false;
+		}
+	}
+	if (!options.logMessage.empty())
+	{
+		BreakpointLogMessage compiled;
+		if (!compiled.Compile(options.logMessage, addressSize, error))
+		{
+			LogWarn("Invalid breakpoint log message \"%s\": %s", options.logMessage.c_str(), error.c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+
+bool DebuggerBreakpoints::SetOptions(
+	const ModuleNameAndOffset& address, const std::function<void(BreakpointOptions&)>& update)
+{
+	std::unique_lock<std::recursive_mutex> lock(m_breakpointMutex);
+	auto iter = FindBreakpoint(address);
+	if (iter == m_breakpoints.end())
+		return false;
+
+	BreakpointOptions options;
+	if (auto existing = m_options.find(*iter); existing != m_options.end())
+		options = existing->second;
+	update(options);
+	if (!ValidateOptions(options))
+		return false;
+
+	if (auto adapter = m_state->GetAdapter())
+	{
+		adapter->SetBreakpointCondition(*iter, options.condition);
+		adapter->SetBreakpointLogMessage(*iter, options.logMessage);
+		adapter->SetBreakpointIgnoreCount(*iter, options.ignoreCount);
+	}
+
+	if (options.IsEmpty())
+		m_options.erase(*iter);
+	else
+		m_options[*iter] = options;
+
+	MarkMetadataDirty();
+	return true;
+}
+
+
+bool DebuggerBreakpoints::SetConditionOffset(const ModuleNameAndOffset& address, const std::string& condition)
+{
+	return SetOptions(address, [&](BreakpointOptions& options) { options.condition = condition; });
+}
+
+
+bool DebuggerBreakpoints::SetConditionAbsolute(uint64_t remoteAddress, const std::string& condition)
+{
+	ModuleNameAndOffset info = m_state->GetModules()->AbsoluteAddressToRelative(remoteAddress);
+	return SetConditionOffset(info, condition);
+}
+
+
+std::string DebuggerBreakpoints::GetConditionOffset(const ModuleNameAndOffset& address)
+{
+	return GetOptionsOffset(address).condition;
+}
+
+
+std::string DebuggerBreakpoints::GetConditionAbsolute(uint64_t remoteAddress)
+{
+	return GetOptionsAbsolute(remoteAddress).condition;
+}
+
+
+bool DebuggerBreakpoints::SetLogMessageOffset(const ModuleNameAndOffset& address, const std::string& message)
+{
+	return SetOptions(address, [&](BreakpointOptions& options) { options.logMessage = message; });
+}
+
+
+bool DebuggerBreakpoints::SetLogMessageAbsolute(uint64_t remoteAddress, const std::string& message)
+{
+	ModuleNameAndOffset info = m_state->GetModules()->AbsoluteAddressToRelative(remoteAddress);
+	return SetLogMessageOffset(info, message);
+}
+
+
+bool DebuggerBreakpoints::SetIgnoreCountOffset(const ModuleNameAndOffset& address, uint64_t count)
+{
+	return SetOptions(address, [&](BreakpointOptions& options) { options.ignoreCount = count; });
+}
+
+
+bool DebuggerBreakpoints::SetIgnoreCountAbsolute(uint64_t remoteAddress, uint64_t count)
+{
+	ModuleNameAndOffset info = m_state->GetModules()->AbsoluteAddressToRelative(remoteAddress);
+	return SetIgnoreCountOffset(info, count);
+}
+
+
+BreakpointOptions DebuggerBreakpoints::GetOptionsOffset(const ModuleNameAndOffset& address)
+{
+	std::unique_lock<std::recursive_mutex> lock(m_breakpointMutex);
+	auto iter = FindBreakpoint(address);
+	if (iter == m_breakpoints.end())
+		return {};
+
+	auto options = m_options.find(*iter);
+	if (options == m_options.end())
+		return {};
+
+	return options->second;
+}
+
+
+BreakpointOptions DebuggerBreakpoints::GetOptionsAbsolute(uint64_t remoteAddress)
+{
+	ModuleNameAndOffset info = m_state->GetModules()->AbsoluteAddressToRelative(remoteAddress);
+	return GetOptionsOffset(info);
+}
+
+
+uint64_t DebuggerBreakpoints::GetHitCountAbsolute(uint64_t remoteAddress)
+{
+	if (!m_state->GetAdapter())
+		return 0;
+
+	return m_state->GetAdapter()->GetBreakpointHitCount(remoteAddress);
+}
+
+
+uint64_t DebuggerBreakpoints::GetHitCountOffset(const ModuleNameAndOffset& address)
 {
-	// TODO: who should free these Metadata objects?
-	std::vector<Ref<Metadata>> breakpoints;
-	for (const ModuleNameAndOffset& bp : m_breakpoints)
+	if (!m_state->GetAdapter() || !m_state->IsConnected())
+		return 0;
+
+	return GetHitCountAbsolute(m_state->GetModules()->RelativeAddressToAbsolute(address));
+}
+
+
+void DebuggerBreakpoints::MarkMetadataDirty()
+{
+	std::unique_lock<std::recursive_mutex> lock(m_breakpointMutex);
+	m_metadataDirty = true;
+	// Throttle the writes so adding or removing many breakpoints in a row does not rewrite the metadata every time.
+	// The rest is written out at the end of the interval by the flush thread, so the metadata is up to date even if
+	// nothing calls FlushMetadata(), e.g., when a headless script saves the database.
+	auto now = std::chrono::steady_clock::now();
+	if (now - m_lastSerialized >= BreakpointMetadataInterval)
 	{
-		std::map<std::string, Ref<Metadata>> info;
-		info["module"] = new Metadata(bp.module);
-		info["offset"] = new Metadata(bp.offset);
-		breakpoints.push_back(new Metadata(info));
+		SerializeMetadata();
+		return;
 	}
-	m_state->GetController()->GetData()->StoreMetadata("debugger.breakpoints", new Metadata(breakpoints));
+
+	if (!m_flushThread.joinable())
+		m_flushThread = std::thread([this]() { RunFlushThread(); });
+	m_flushCondition.notify_all();
+}
+
+
+void DebuggerBreakpoints::RunFlushThread()
+{
+	std::unique_lock<std::recursive_mutex> lock(m_breakpointMutex);
+	while (true)
+	{
+		m_flushCondition.wait(lock, [this]() { return m_metadataDirty || m_stopping; });
+		if (m_stopping)
+			break;
+
+		// Let the changes of the rest of the interval pile up, so they are written together
+		if (m_flushCondition.wait_until(
+				lock, m_lastSerialized + BreakpointMetadataInterval, [this]() { return m_stopping; }))
+			break;
+
+		// FlushMetadata() may have beaten us to it
+		if (m_metadataDirty)
+			SerializeMetadata();
+	}
+}
+
+
+void DebuggerBreakpoints::FlushMetadata()
+{
+	std::unique_lock<std::recursive_mutex> lock(m_breakpointMutex);
+	if (m_metadataDirty)
+		SerializeMetadata();
+}
+
+
+void DebuggerBreakpoints::SerializeMetadata()
+{
+	std::unique_lock<std::recursive_mutex> lock(m_breakpointMutex);
+	m_state->GetController()->GetData()->StoreMetadata(
+		"debugger.breakpoints", new Metadata(PackBreakpoints(m_breakpoints, m_options)));
+	m_metadataDirty = false;
+	m_lastSerialized = std::chrono::steady_clock::now();
 }
 
 
 void DebuggerBreakpoints::UnserializedMetadata()
 {
 	Ref<Metadata> metadata = m_state->GetController()->GetData()->QueryMetadata("debugger.breakpoints");
-	if (!metadata || (!metadata->IsArray()))
+	if (!metadata)
 		return;
 
-	vector<Ref<Metadata>> array = metadata->GetArray();
 	std::vector<ModuleNameAndOffset> newBreakpoints;
+	std::map<ModuleNameAndOffset, BreakpointOptions> newOptions;
+	if (metadata->IsRaw())
+	{
+		if (!UnpackBreakpoints(metadata->GetRaw(), newBreakpoints, newOptions))
+		{
+			LogWarn("Unsupported or truncated breakpoint metadata, breakpoints not loaded");
+			return;
+		}
+	}
+	else if (metadata->IsArray())
+	{
+		// Breakpoints saved by older versions are an array of {"module": ..., "offset": ...} key-value stores. They
+		// are converted to the packed format by the next flush.
+		vector<Ref<Metadata>> array = metadata->GetArray();
+		newBreakpoints.reserve(array.size());
+		for (auto& element : array)
+		{
+			if (!element || (!element->IsKeyValueStore()))
+				continue;
+
+			std::map<std::string, Ref<Metadata>> info = element->GetKeyValueStore();
+			auto module = info.find("module");
+			auto offset = info.find("offset");
+			if ((module == info.end()) || !module->second || !module->second->IsString())
+				continue;
 
-	for (auto& element : array)
+			if ((offset == info.end()) || !offset->second || !offset->second->IsUnsignedInteger())
+				continue;
+
+			newBreakpoints.emplace_back(module->second->GetString(), offset->second->GetUnsignedInteger());
+		}
+	}
+	else
 	{
-		if (!element || (!element->IsKeyValueStore()))
-			continue;
+		return;
+	}
 
-		std::map<std::string, Ref<Metadata>> info = element->GetKeyValueStore();
-		ModuleNameAndOffset address;
+	std::unique_lock<std::recursive_mutex> lock(m_breakpointMutex);
+	m_breakpoints = std::move(newBreakpoints);
+	m_options = std::move(newOptions);
+	m_metadataDirty = metadata->IsArray();
+}
 
-		if (!(info["module"] && info["module"]->IsString()))
-			continue;
 
-		address.module = info["module"]->GetString();
+std::vector<ModuleNameAndOffset> DebuggerBreakpoints::GetBreakpointList() const
+{
+	std::unique_lock<std::recursive_mutex> lock(m_breakpointMutex);
+	return m_breakpoints;
+}
 
-		if (!(info["offset"] && info["offset"]->IsUnsignedInteger()))
-			continue;
 
-		address.offset = info["offset"]->GetUnsignedInteger();
-		newBreakpoints.push_back(address);
+bool DebuggerBreakpoints::AddHardware(const DebugHardwareBreakpoint& breakpoint)
+{
+	DebugHardwareBreakpoint bp = breakpoint;
+	if (bp.IsWatchpoint())
+	{
+		if ((bp.m_size != 1) && (bp.m_size != 2) && (bp.m_size != 4) && (bp.m_size != 8))
+		{
+			LogWarn("Invalid watchpoint size %zu, must be 1, 2, 4 or 8", bp.m_size);
+			return false;
+		}
+		if ((bp.m_address % bp.m_size) != 0)
+		{
+			LogWarn("Watchpoint address 0x%" PRIx64 " is not aligned to its size %zu", (uint64_t)bp.m_address,
+				bp.m_size);
+			return false;
+		}
+	}
+	else
+	{
+		bp.m_size = 1;
 	}
 
-	m_breakpoints = newBreakpoints;
+	if (std::find(m_hardwareBreakpoints.begin(), m_hardwareBreakpoints.end(), bp) != m_hardwareBreakpoints.end())
+		return true;
+
+	// The debug registers are a scarce resource, so report the failure rather than keeping a breakpoint that is
+	// not active
+	if (m_state->GetAdapter() && m_state->IsConnected())
+	{
+		if (!m_state->GetAdapter()->AddHardwareBreakpoint(bp))
+			return false;
+	}
+
+	m_hardwareBreakpoints.push_back(bp);
+	return true;
+}
+
+
+bool DebuggerBreakpoints::RemoveHardware(const DebugHardwareBreakpoint& breakpoint)
+{
+	DebugHardwareBreakpoint bp = breakpoint;
+	if (!bp.IsWatchpoint())
+		bp.m_size = 1;
+
+	auto iter = std::find(m_hardwareBreakpoints.begin(), m_hardwareBreakpoints.end(), bp);
+	if (iter == m_hardwareBreakpoints.end())
+		return false;
+
+	m_hardwareBreakpoints.erase(iter);
+	if (m_state->GetAdapter() && m_state->IsConnected())
+		m_state->GetAdapter()->RemoveHardwareBreakpoint(bp);
+
+	return true;
 }
 
 
 void DebuggerBreakpoints::Apply()
 {
+	std::unique_lock<std::recursive_mutex> lock(m_breakpointMutex);
 	if (!m_state->GetAdapter())
 		return;
 
 	for (const ModuleNameAndOffset& address : m_breakpoints)
 		m_state->GetAdapter()->AddBreakpoint(address);
+
+	for (const DebugHardwareBreakpoint& bp : m_hardwareBreakpoints)
+	{
+		if (!m_state->GetAdapter()->AddHardwareBreakpoint(bp))
+			LogWarn("Failed to add hardware breakpoint at 0x%" PRIx64, (uint64_t)bp.m_address);
+	}
+
+	for (const auto& [address, options] : m_options)
+	{
+		m_state->GetAdapter()->SetBreakpointCondition(address, options.condition);
+		m_state->GetAdapter()->SetBreakpointLogMessage(address, options.logMessage);
+		m_state->GetAdapter()->SetBreakpointIgnoreCount(address, options.ignoreCount);
+	}
 }
 
 
@@ -676,6 +1034,7 @@ DebuggerMemory::DebuggerMemory(DebuggerState* state) : m_state(state) {}
 void DebuggerMemory::MarkDirty()
 {
 	std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
+	m_epoch++;
 	for (auto& it: m_valueCache)
 	{
 		if (it.second.status == UpToDateStatus)
@@ -887,6 +1246,8 @@ DebuggerState::DebuggerState(BinaryViewRef data, DebuggerController* controller)
 
 DebuggerState::~DebuggerState()
 {
+	m_breakpoints->FlushMetadata();
+
 	delete m_adapter;
 	delete m_modules;
 	delete m_registers;
@@ -950,6 +1311,7 @@ bool DebuggerState::SetActiveThread(const DebugThread& thread)
 
 void DebuggerState::MarkDirty()
 {
+	m_stopEpoch++;
 	m_registers->MarkDirty();
 	m_threads->MarkDirty();
 	m_modules->MarkDirty();
@@ -988,6 +1350,12 @@ void DebuggerState::ApplyBreakpoints()
 }
 
 
+void DebuggerState::FlushBreakpoints()
+{
+	m_breakpoints->FlushMetadata();
+}
+
+
 Ref<Architecture> DebuggerState::GetRemoteArchitecture() const
 {
 	return m_controller->GetData()->GetDefaultArchitecture();
@@ -16,10 +16,17 @@ limitations under the License.
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include "binaryninjaapi.h"
 #include "ui/uitypes.h"
 #include "debugadaptertype.h"
 #include "debuggercommon.h"
+#include "breakpointmetadata.h"
 #include "semaphore.h"
 #include "ffi_global.h"
 #include "refcountobject.h"
@@ -38,6 +45,10 @@ namespace BinaryNinjaDebugger {
 		DebuggerState* m_state;
 		std::unordered_map<std::string, DebugRegister> m_registerCache;
 		bool m_dirty;
+		// The caches are filled on first access, which can happen on any thread
+		std::recursive_mutex m_registersMutex;
+		// Bumped every time the cache is invalidated, see DebuggerState::GetStopEpoch()
+		std::atomic<uint64_t> m_epoch = 0;
 
 	public:
 		DebuggerRegisters(DebuggerState* state);
@@ -46,6 +57,7 @@ namespace BinaryNinjaDebugger {
 		bool SetRegisterValue(const std::string& name, uint64_t value);
 		void MarkDirty();
 		bool IsDirty() const { return m_dirty; }
+		uint64_t GetEpoch() const { return m_epoch; }
 		void Update();
 		std::vector<DebugRegister> GetAllRegisters();
 	};
@@ -57,12 +69,15 @@ namespace BinaryNinjaDebugger {
 		DebuggerState* m_state;
 		std::vector<DebugModule> m_modules;
 		bool m_dirty;
+		std::recursive_mutex m_modulesMutex;
+		std::atomic<uint64_t> m_epoch = 0;
 
 	public:
 		DebuggerModules(DebuggerState* state);
 		void MarkDirty();
 		void Update();
 		bool IsDirty() const { return m_dirty; }
+		uint64_t GetEpoch() const { return m_epoch; }
 
 		std::vector<DebugModule> GetAllModules();
 		// TODO: These conversion functions are not very robust for lookup failures. They need to be improved for it.
@@ -79,19 +94,64 @@ namespace BinaryNinjaDebugger {
 	private:
 		DebuggerState* m_state;
 		std::vector<ModuleNameAndOffset> m_breakpoints;
+		// Keyed by the entries in m_breakpoints, see FindBreakpoint()
+		std::map<ModuleNameAndOffset, BreakpointOptions> m_options;
+		// Hardware breakpoints and watchpoints are kept by absolute address and are not saved in the metadata, since
+		// the data they watch (heap, stack) rarely lives at the same address in the next run
+		std::vector<DebugHardwareBreakpoint> m_hardwareBreakpoints;
+
+		// Guards the list and the options against the flush thread, and against the API calls of other threads
+		mutable std::recursive_mutex m_breakpointMutex;
+
+		// The breakpoint list is persisted lazily. Changes only mark the metadata as dirty, and it is written out at
+		// most once per BreakpointMetadataInterval while breakpoints are being edited, with the last change of a
+		// burst written by m_flushThread at the end of its interval, plus whenever FlushMetadata() is called (target
+		// stop/exit, file save, teardown).
+		bool m_metadataDirty = false;
+		std::chrono::steady_clock::time_point m_lastSerialized;
+		static constexpr std::chrono::milliseconds BreakpointMetadataInterval {1000};
+		std::condition_variable_any m_flushCondition;
+		bool m_stopping = false;
+		// Started by the first change that falls into the interval
+		std::thread m_flushThread;
+		void MarkMetadataDirty();
+		void RunFlushThread();
+		// ModuleNameAndOffset::operator== compares the base name of the module, so the entry stored in the list can
+		// differ from the one passed in. Use this to get the stored one.
+		std::vector<ModuleNameAndOffset>::iterator FindBreakpoint(const ModuleNameAndOffset& address);
+		void RemoveOptions(const ModuleNameAndOffset& address);
+		bool ValidateOptions(const BreakpointOptions& options);
+		bool SetOptions(const ModuleNameAndOffset& address, const std::function<void(BreakpointOptions&)>& update);
 
 	public:
 		DebuggerBreakpoints(DebuggerState* state, std::vector<ModuleNameAndOffset> initial = {});
+		~DebuggerBreakpoints();
 		bool AddAbsolute(uint64_t remoteAddress);
 		bool AddOffset(const ModuleNameAndOffset& address);
 		bool RemoveAbsolute(uint64_t remoteAddress);
 		bool RemoveOffset(const ModuleNameAndOffset& address);
 		bool ContainsAbsolute(uint64_t address);
 		bool ContainsOffset(const ModuleNameAndOffset& address);
+		bool SetConditionAbsolute(uint64_t remoteAddress, const std::string& condition);
+		bool SetConditionOffset(const ModuleNameAndOffset& address, const std::string& condition);
+		std::string GetConditionAbsolute(uint64_t remoteAddress);
+		std::string GetConditionOffset(const ModuleNameAndOffset& address);
+		bool SetLogMessageAbsolute(uint64_t remoteAddress, const std::string& message);
+		bool SetLogMessageOffset(const ModuleNameAndOffset& address, const std::string& message);
+		bool SetIgnoreCountAbsolute(uint64_t remoteAddress, uint64_t count);
+		bool SetIgnoreCountOffset(const ModuleNameAndOffset& address, uint64_t count);
+		BreakpointOptions GetOptionsAbsolute(uint64_t remoteAddress);
+		BreakpointOptions GetOptionsOffset(const ModuleNameAndOffset& address);
+		uint64_t GetHitCountAbsolute(uint64_t remoteAddress);
+		uint64_t GetHitCountOffset(const ModuleNameAndOffset& address);
+		bool AddHardware(const DebugHardwareBreakpoint& breakpoint);
+		bool RemoveHardware(const DebugHardwareBreakpoint& breakpoint);
+		std::vector<DebugHardwareBreakpoint> GetHardwareBreakpointList() const { return m_hardwareBreakpoints; }
 		void Apply();
 		void SerializeMetadata();
 		void UnserializedMetadata();
-		std::vector<ModuleNameAndOffset> GetBreakpointList() const { return m_breakpoints; }
+		void FlushMetadata();
+		std::vector<ModuleNameAndOffset> GetBreakpointList() const;
 	};
 
 
@@ -102,6 +162,8 @@ namespace BinaryNinjaDebugger {
 		std::vector<DebugThread> m_threads;
 		std::map<uint32_t, std::vector<DebugFrame>> m_frames;
 		bool m_dirty;
+		std::recursive_mutex m_threadsMutex;
+		std::atomic<uint64_t> m_epoch = 0;
 
 	public:
 		DebuggerThreads(DebuggerState* state);
@@ -110,6 +172,7 @@ namespace BinaryNinjaDebugger {
 		DebugThread GetActiveThread() const;
 		bool SetActiveThread(const DebugThread& thread);
 		bool IsDirty() const { return m_dirty; }
+		uint64_t GetEpoch() const { return m_epoch; }
 		std::vector<DebugThread> GetAllThreads();
 		std::vector<DebugFrame> GetFramesOfThread(uint32_t tid);
 		bool SuspendThread(std::uint32_t tid);
@@ -138,11 +201,13 @@ namespace BinaryNinjaDebugger {
 		DebuggerState* m_state;
 		std::map<uint64_t, MemoryBytesCache> m_valueCache;
 		std::recursive_mutex m_memoryMutex;
+		std::atomic<uint64_t> m_epoch = 0;
 
 	public:
 		DebuggerMemory(DebuggerState* state);
 
 		void MarkDirty();
+		uint64_t GetEpoch() const { return m_epoch; }
 		DataBuffer ReadBlock(uint64_t block);
 		DataBuffer ReadMemory(uint64_t offset, size_t len);
 		bool WriteMemory(std::uintptr_t address, const DataBuffer& buffer);
@@ -169,6 +234,7 @@ namespace BinaryNinjaDebugger {
 		DebuggerThreads* m_threads;
 		DebuggerBreakpoints* m_breakpoints;
 		DebuggerMemory* m_memory;
+		std::atomic<uint64_t> m_stopEpoch = 0;
 
 		std::string m_executablePath;
 		std::string m_inputFile;
@@ -245,12 +311,24 @@ namespace BinaryNinjaDebugger {
 		// retrieve the DebuggerThreads object and then call SetActiveThread() on it. They call this function.
 		bool SetActiveThread(const DebugThread& thread);
 
+		// Invalidates all the caches, and starts a new stop epoch
 		void MarkDirty();
 		void UpdateCaches();
 
+		// The stop epoch changes every time the target runs, i.e., once per stop or exit. Each cache also has an epoch
+		// that changes whenever its content may have changed, which includes the changes made while the target is
+		// stopped (e.g., writing a register or memory, switching the active thread). Data derived from the target can
+		// be cached along with the epoch it was computed in, and is still current as long as the epoch is the same.
+		uint64_t GetStopEpoch() const { return m_stopEpoch; }
+		uint64_t GetRegistersEpoch() const { return m_registers->GetEpoch(); }
+		uint64_t GetMemoryEpoch() const { return m_memory->GetEpoch(); }
+		uint64_t GetModulesEpoch() const { return m_modules->GetEpoch(); }
+		uint64_t GetThreadsEpoch() const { return m_threads->GetEpoch(); }
+
 		bool GetRemoteBase(uint64_t& address);
 
 		void ApplyBreakpoints();
+		void FlushBreakpoints();
 
 		void SetConnectionStatus(DebugAdapterConnectionStatus status) { m_connectionStatus = status; }
 		void SetExecutionStatus(DebugAdapterTargetStatus status) { m_targetStatus = status; }
@@ -191,6 +191,10 @@ BNDebugProcess* BNDebuggerGetProcessList(BNDebuggerController* controller, size_
 	{
 		results[i].m_pid = processes[i].m_pid;
 		results[i].m_processName = BNDebuggerAllocString(processes[i].m_processName.c_str());
+		results[i].m_parentPid = processes[i].m_parentPid;
+		results[i].m_user = BNDebuggerAllocString(processes[i].m_user.c_str());
+		results[i].m_architecture = BNDebuggerAllocString(processes[i].m_architecture.c_str());
+		results[i].m_commandLine = BNDebuggerAllocString(processes[i].m_commandLine.c_str());
 	}
 
 	return results;
@@ -202,6 +206,9 @@ void BNDebuggerFreeProcessList(BNDebugProcess* processes, size_t count)
 	for (size_t i = 0; i < count; i++)
 	{
 		BNDebuggerFreeString(processes[i].m_processName);
+		BNDebuggerFreeString(processes[i].m_user);
+		BNDebuggerFreeString(processes[i].m_architecture);
+		BNDebuggerFreeString(processes[i].m_commandLine);
 	}
 
 	delete[] processes;
@@ -446,6 +453,55 @@ void BNDebuggerPause(BNDebuggerController* controller)
 }
 
 
+size_t BNDebuggerCancelPendingCommands(BNDebuggerController* controller)
+{
+	return controller->object->GetCommandQueue().CancelAll();
+}
+
+
+size_t BNDebuggerGetPendingCommandCount(BNDebuggerController* controller)
+{
+	return controller->object->GetCommandQueue().GetPendingCount();
+}
+
+
+size_t BNDebuggerSubmitCommand(BNDebuggerController* controller, BNDebuggerCommandType type, BNFunctionGraphType il,
+	uint64_t count, const uint64_t* remoteAddresses, size_t addressCount,
+	void (*completion)(void* ctx, BNDebugStopReason reason), void* ctx)
+{
+	std::vector<uint64_t> addresses;
+	addresses.reserve(addressCount);
+	for (size_t i = 0; i < addressCount; i++)
+	{
+		addresses.push_back(remoteAddresses[i]);
+	}
+
+	DebuggerCommandQueue::Completion callback;
+	if (completion)
+		callback = [completion, ctx](DebugStopReason reason) { completion(ctx, reason); };
+
+	return controller->object->SubmitCommand(type, callback, il, count, addresses);
+}
+
+
+bool BNDebuggerCancelCommand(BNDebuggerController* controller, size_t id)
+{
+	return controller->object->CancelCommand(id);
+}
+
+
+bool BNDebuggerIsAutomationMode(BNDebuggerController* controller)
+{
+	return controller->object->IsAutomationMode();
+}
+
+
+void BNDebuggerSetAutomationMode(BNDebuggerController* controller, bool enabled)
+{
+	controller->object->SetAutomationMode(enabled);
+}
+
+
 // Convenience function, either launch the target process or connect to a remote, depending on the selected adapter
 void BNDebuggerLaunchOrConnect(BNDebuggerController* controller)
 {
@@ -512,6 +568,12 @@ bool BNDebuggerStepReturnReverse(BNDebuggerController* controller)
 }
 
 
+bool BNDebuggerStepInstructions(BNDebuggerController* controller, uint64_t count)
+{
+	return controller->object->StepInstructions(count);
+}
+
+
 bool BNDebuggerRunTo(BNDebuggerController* controller, const uint64_t* remoteAddresses, size_t count)
 {
 	std::vector<uint64_t> addresses;
@@ -571,6 +633,12 @@ BNDebugStopReason BNDebuggerStepReturnReverseAndWait(BNDebuggerController* contr
 }
 
 
+BNDebugStopReason BNDebuggerStepInstructionsAndWait(BNDebuggerController* controller, uint64_t count)
+{
+	return controller->object->StepInstructionsAndWait(count);
+}
+
+
 BNDebugStopReason BNDebuggerRunToAndWait(
 	BNDebuggerController* controller, const uint64_t* remoteAddresses, size_t count)
 {
@@ -781,6 +849,10 @@ BNDebugBreakpoint* BNDebuggerGetBreakpoints(BNDebuggerController* controller, si
 		result[i].offset = breakpoints[i].offset;
 		result[i].address = remoteAddress;
 		result[i].enabled = enabled;
+		BreakpointOptions options = state->GetBreakpoints()->GetOptionsOffset(breakpoints[i]);
+		result[i].condition = BNDebuggerAllocString(options.condition.c_str());
+		result[i].logMessage = BNDebuggerAllocString(options.logMessage.c_str());
+		result[i].hitCount = state->GetBreakpoints()->GetHitCountOffset(breakpoints[i]);
 	}
 	return result;
 }
@@ -791,6 +863,8 @@ void BNDebuggerFreeBreakpoints(BNDebugBreakpoint* breakpoints, size_t count)
 	for (size_t i = 0; i < count; i++)
 	{
 		BNDebuggerFreeString(breakpoints[i].module);
+		BNDebuggerFreeString(breakpoints[i].condition);
+		BNDebuggerFreeString(breakpoints[i].logMessage);
 	}
 	delete[] breakpoints;
 }
@@ -832,6 +906,36 @@ uint64_t BNDebuggerGetLastIP(BNDebuggerController* controller)
 }
 
 
+uint64_t BNDebuggerGetStopEpoch(BNDebuggerController* controller)
+{
+	return controller->object->GetState()->GetStopEpoch();
+}
+
+
+uint64_t BNDebuggerGetRegistersEpoch(BNDebuggerController* controller)
+{
+	return controller->object->GetState()->GetRegistersEpoch();
+}
+
+
+uint64_t BNDebuggerGetMemoryEpoch(BNDebuggerController* controller)
+{
+	return controller->object->GetState()->GetMemoryEpoch();
+}
+
+
+uint64_t BNDebuggerGetModulesEpoch(BNDebuggerController* controller)
+{
+	return controller->object->GetState()->GetModulesEpoch();
+}
+
+
+uint64_t BNDebuggerGetThreadsEpoch(BNDebuggerController* controller)
+{
+	return controller->object->GetState()->GetThreadsEpoch();
+}
+
+
 bool BNDebuggerSetIP(BNDebuggerController* controller, uint64_t address)
 {
 	return controller->object->SetIP(address);
@@ -866,6 +970,267 @@ bool BNDebuggerContainsRelativeBreakpoint(BNDebuggerController* controller, cons
 }
 
 
+void BNDebuggerFlushBreakpoints(BNDebuggerController* controller)
+{
+	controller->object->FlushBreakpoints();
+}
+
+
+bool BNDebuggerAddHardwareBreakpoint(
+	BNDebuggerController* controller, uint64_t address, BNDebugBreakpointType type, size_t size)
+{
+	DebuggerState* state = controller->object->GetState();
+	if (!state)
+		return false;
+
+	return state->GetBreakpoints()->AddHardware(DebugHardwareBreakpoint(address, type, size));
+}
+
+
+bool BNDebuggerRemoveHardwareBreakpoint(
+	BNDebuggerController* controller, uint64_t address, BNDebugBreakpointType type, size_t size)
+{
+	DebuggerState* state = controller->object->GetState();
+	if (!state)
+		return false;
+
+	return state->GetBreakpoints()->RemoveHardware(DebugHardwareBreakpoint(address, type, size));
+}
+
+
+BNDebugHardwareBreakpoint* BNDebuggerGetHardwareBreakpoints(BNDebuggerController* controller, size_t* count)
+{
+	DebuggerState* state = controller->object->GetState();
+	std::vector<DebugHardwareBreakpoint> breakpoints = state->GetBreakpoints()->GetHardwareBreakpointList();
+	*count = breakpoints.size();
+
+	BNDebugHardwareBreakpoint* result = new BNDebugHardwareBreakpoint[breakpoints.size()];
+	for (size_t i = 0; i < breakpoints.size(); i++)
+	{
+		result[i].address = breakpoints[i].m_address;
+		result[i].type = breakpoints[i].m_type;
+		result[i].size = breakpoints[i].m_size;
+	}
+	return result;
+}
+
+
+void BNDebuggerFreeHardwareBreakpoints(BNDebugHardwareBreakpoint* breakpoints)
+{
+	delete[] breakpoints;
+}
+
+
+bool BNDebuggerAddSoftwareWatchpoint(
+	BNDebuggerController* controller, uint64_t address, size_t size, BNDebugBreakpointType type)
+{
+	DebuggerState* state = controller->object->GetState();
+	if (!state || !state->GetAdapter() || !state->IsConnected())
+		return false;
+
+	return state->GetAdapter()->AddSoftwareWatchpoint(SoftwareWatchpoint(address, size, type));
+}
+
+
+bool BNDebuggerRemoveSoftwareWatchpoint(
+	BNDebuggerController* controller, uint64_t address, size_t size, BNDebugBreakpointType type)
+{
+	DebuggerState* state = controller->object->GetState();
+	if (!state || !state->GetAdapter() || !state->IsConnected())
+		return false;
+
+	return state->GetAdapter()->RemoveSoftwareWatchpoint(SoftwareWatchpoint(address, size, type));
+}
+
+
+BNDebugSoftwareWatchpoint* BNDebuggerGetSoftwareWatchpoints(BNDebuggerController* controller, size_t* count)
+{
+	DebuggerState* state = controller->object->GetState();
+	std::vector<SoftwareWatchpoint> watchpoints;
+	if (state && state->GetAdapter() && state->IsConnected())
+		watchpoints = state->GetAdapter()->GetSoftwareWatchpoints();
+	*count = watchpoints.size();
+
+	BNDebugSoftwareWatchpoint* result = new BNDebugSoftwareWatchpoint[watchpoints.size()];
+	for (size_t i = 0; i < watchpoints.size(); i++)
+	{
+		result[i].address = watchpoints[i].m_address;
+		result[i].size = watchpoints[i].m_size;
+		result[i].type = watchpoints[i].m_type;
+	}
+	return result;
+}
+
+
+void BNDebuggerFreeSoftwareWatchpoints(BNDebugSoftwareWatchpoint* watchpoints)
+{
+	delete[] watchpoints;
+}
+
+
+bool BNDebuggerStartCoverage(BNDebuggerController* controller)
+{
+	return controller->object->GetCoverage()->Start();
+}
+
+
+void BNDebuggerStopCoverage(BNDebuggerController* controller)
+{
+	controller->object->GetCoverage()->Stop();
+}
+
+
+bool BNDebuggerIsCoverageActive(BNDebuggerController* controller)
+{
+	return controller->object->GetCoverage()->IsActive();
+}
+
+
+size_t BNDebuggerGetCoverageBlockCount(BNDebuggerController* controller)
+{
+	return controller->object->GetCoverage()->GetBlockCount();
+}
+
+
+uint64_t* BNDebuggerGetCoveredBlocks(BNDebuggerController* controller, size_t* count)
+{
+	std::vector<uint64_t> blocks = controller->object->GetCoverage()->GetCoveredBlocks();
+	*count = blocks.size();
+
+	uint64_t* result = new uint64_t[blocks.size()];
+	std::copy(blocks.begin(), blocks.end(), result);
+	return result;
+}
+
+
+void BNDebuggerFreeCoveredBlocks(uint64_t* blocks)
+{
+	delete[] blocks;
+}
+
+
+bool BNDebuggerExportCoverageDrcov(BNDebuggerController* controller, const char* path)
+{
+	return controller->object->GetCoverage()->ExportDrcov(path);
+}
+
+
+bool BNDebuggerExportCoverageLcov(BNDebuggerController* controller, const char* path)
+{
+	return controller->object->GetCoverage()->ExportLcov(path);
+}
+
+
+void BNDebuggerApplyCoverageHighlights(BNDebuggerController* controller)
+{
+	controller->object->GetCoverage()->ApplyHighlights();
+}
+
+
+bool BNDebuggerSetAbsoluteBreakpointCondition(BNDebuggerController* controller, uint64_t address, const char* condition)
+{
+	DebuggerState* state = controller->object->GetState();
+	if (!state)
+		return false;
+
+	return state->GetBreakpoints()->SetConditionAbsolute(address, condition);
+}
+
+
+bool BNDebuggerSetRelativeBreakpointCondition(
+	BNDebuggerController* controller, const char* module, uint64_t offset, const char* condition)
+{
+	DebuggerState* state = controller->object->GetState();
+	if (!state)
+		return false;
+
+	return state->GetBreakpoints()->SetConditionOffset(ModuleNameAndOffset(module, offset), condition);
+}
+
+
+char* BNDebuggerGetAbsoluteBreakpointCondition(BNDebuggerController* controller, uint64_t address)
+{
+	DebuggerState* state = controller->object->GetState();
+	if (!state)
+		return BNDebuggerAllocString("");
+
+	return BNDebuggerAllocString(state->GetBreakpoints()->GetConditionAbsolute(address).c_str());
+}
+
+
+char* BNDebuggerGetRelativeBreakpointCondition(BNDebuggerController* controller, const char* module, uint64_t offset)
+{
+	DebuggerState* state = controller->object->GetState();
+	if (!state)
+		return BNDebuggerAllocString("");
+
+	return BNDebuggerAllocString(
+		state->GetBreakpoints()->GetConditionOffset(ModuleNameAndOffset(module, offset)).c_str());
+}
+
+
+bool BNDebuggerSetAbsoluteBreakpointLogMessage(BNDebuggerController* controller, uint64_t address, const char* message)
+{
+	DebuggerState* state = controller->object->GetState();
+	if (!state)
+		return false;
+
+	return state->GetBreakpoints()->SetLogMessageAbsolute(address, message);
+}
+
+
+bool BNDebuggerSetRelativeBreakpointLogMessage(
+	BNDebuggerController* controller, const char* module, uint64_t offset, const char* message)
+{
+	DebuggerState* state = controller->object->GetState();
+	if (!state)
+		return false;
+
+	return state->GetBreakpoints()->SetLogMessageOffset(ModuleNameAndOffset(module, offset), message);
+}
+
+
+bool BNDebuggerSetAbsoluteBreakpointIgnoreCount(BNDebuggerController* controller, uint64_t address, uint64_t count)
+{
+	DebuggerState* state = controller->object->GetState();
+	if (!state)
+		return false;
+
+	return state->GetBreakpoints()->SetIgnoreCountAbsolute(address, count);
+}
+
+
+bool BNDebuggerSetRelativeBreakpointIgnoreCount(
+	BNDebuggerController* controller, const char* module, uint64_t offset, uint64_t count)
+{
+	DebuggerState* state = controller->object->GetState();
+	if (!state)
+		return false;
+
+	return state->GetBreakpoints()->SetIgnoreCountOffset(ModuleNameAndOffset(module, offset), count);
+}
+
+
+uint64_t BNDebuggerGetAbsoluteBreakpointHitCount(BNDebuggerController* controller, uint64_t address)
+{
+	DebuggerState* state = controller->object->GetState();
+	if (!state)
+		return 0;
+
+	return state->GetBreakpoints()->GetHitCountAbsolute(address);
+}
+
+
+uint64_t BNDebuggerGetRelativeBreakpointHitCount(BNDebuggerController* controller, const char* module, uint64_t offset)
+{
+	DebuggerState* state = controller->object->GetState();
+	if (!state)
+		return 0;
+
+	return state->GetBreakpoints()->GetHitCountOffset(ModuleNameAndOffset(module, offset));
+}
+
+
 uint64_t BNDebuggerRelativeAddressToAbsolute(BNDebuggerController* controller, const char* module, uint64_t offset)
 {
 	DebuggerState* state = controller->object->GetState();
@@ -907,11 +1272,17 @@ bool BNDebuggerIsSameBaseModule(const char* module1, const char* module2)
 }
 
 
-size_t BNDebuggerRegisterEventCallback(
-	BNDebuggerController* controller, void (*callback)(void* ctx, BNDebuggerEvent* event), const char* name, void* ctx)
+size_t BNDebuggerRegisterEventCallback(BNDebuggerController* controller,
+	void (*callback)(void* ctx, BNDebuggerEvent* event), void (*release)(void* ctx), const char* name, void* ctx,
+	BNDebuggerEventCallbackAffinity affinity, uint64_t eventTypes)
 {
+	// Goes away with the last copy of the callback, i.e., once the subscriber is removed and no call is running
+	std::shared_ptr<void> releaser(ctx, [release](void* ctx) {
+		if (release)
+			release(ctx);
+	});
 	return controller->object->RegisterEventCallback(
-		[=](const DebuggerEvent& event) {
+		[=, releaser = std::move(releaser)](const DebuggerEvent& event) {
 			BNDebuggerEvent* evt = new BNDebuggerEvent;
 
 			evt->type = event.type;
@@ -932,6 +1303,8 @@ size_t BNDebuggerRegisterEventCallback(
 			evt->data.absoluteAddress = event.data.absoluteAddress;
 
 			evt->data.messageData.message = BNDebuggerAllocString(event.data.messageData.message.c_str());
+			evt->data.messageData.channel = event.data.messageData.channel;
+			evt->data.messageData.droppedBytes = event.data.messageData.droppedBytes;
 
 			callback(ctx, evt);
 
@@ -941,7 +1314,7 @@ size_t BNDebuggerRegisterEventCallback(
 			BNDebuggerFreeString(evt->data.messageData.message);
 			delete evt;
 		},
-		name);
+		name, affinity, eventTypes);
 }
 
 
@@ -963,6 +1336,21 @@ void BNDebuggerWriteStdin(BNDebuggerController* controller, const char* data, si
 }
 
 
+BNDataBuffer* BNDebuggerReadTargetOutput(BNDebuggerController* controller, BNTargetOutputChannel channel,
+	uint64_t* position, uint64_t* droppedBytes, size_t maxSize)
+{
+	std::string output = controller->object->ReadTargetOutput(channel, *position, *droppedBytes, maxSize);
+	DataBuffer* data = new DataBuffer(output.data(), output.size());
+	return data->GetBufferObject();
+}
+
+
+uint64_t BNDebuggerGetTargetOutputPosition(BNDebuggerController* controller, BNTargetOutputChannel channel)
+{
+	return controller->object->GetTargetOutputPosition(channel);
+}
+
+
 DEBUGGER_FFI_API char* BNDebuggerInvokeBackendCommand(BNDebuggerController* controller, const char* cmd)
 {
 	std::string output = controller->object->InvokeBackendCommand(std::string(cmd));
@@ -1045,6 +1433,8 @@ void BNDebuggerPostDebuggerEvent(BNDebuggerController* controller, BNDebuggerEve
 	evt.data.absoluteAddress = event->data.absoluteAddress;
 
 	evt.data.messageData.message = event->data.messageData.message;
+	evt.data.messageData.channel = event->data.messageData.channel;
+	evt.data.messageData.droppedBytes = event->data.messageData.droppedBytes;
 
 	controller->object->PostDebuggerEvent(evt);
 }
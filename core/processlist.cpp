@@ -0,0 +1,262 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "processlist.h"
+#include <algorithm>
+#include <cstdlib>
+
+#ifdef __linux__
+	#include <cerrno>
+	#include <cstring>
+	#include <unordered_map>
+	#include <dirent.h>
+	#include <elf.h>
+	#include <fcntl.h>
+	#include <pwd.h>
+	#include <unistd.h>
+	#include <sys/stat.h>
+#endif
+
+using namespace BinaryNinjaDebugger;
+
+
+bool BinaryNinjaDebugger::ParseProcStat(const std::string& stat, DebugProcess& process)
+{
+	// "pid (comm) state ppid ...". The comm can contain anything, including spaces and parentheses, so it ends at the
+	// last ')'.
+	size_t commStart = stat.find('(');
+	size_t commEnd = stat.rfind(')');
+	if ((commStart == std::string::npos) || (commEnd == std::string::npos) || (commEnd < commStart))
+		return false;
+
+	process.m_processName = stat.substr(commStart + 1, commEnd - commStart - 1);
+	if (commEnd + 4 < stat.size())
+		process.m_parentPid = (uint32_t)strtoul(stat.c_str() + commEnd + 4, nullptr, 10);
+	return true;
+}
+
+
+void BinaryNinjaDebugger::ParseProcCmdline(std::string cmdline, DebugProcess& process)
+{
+	// Kernel threads have no arguments
+	while (!cmdline.empty() && (cmdline.back() == '\0'))
+		cmdline.pop_back();
+
+	// The comm is truncated to 15 characters, so prefer the file name of the program when it is longer
+	std::string program = cmdline.substr(0, cmdline.find('\0'));
+	size_t slash = program.rfind('/');
+	if (slash != std::string::npos)
+		program = program.substr(slash + 1);
+	if ((program.size() > process.m_processName.size())
+		&& (program.compare(0, process.m_processName.size(), process.m_processName) == 0))
+		process.m_processName = program;
+
+	std::replace(cmdline.begin(), cmdline.end(), '\0', ' ');
+	process.m_commandLine = cmdline;
+}
+
+
+// The PID, parent, user and triple columns are padded to a minimum width, but grow with their content, e.g., for user
+// names longer than 10 characters, so the last column does not start at a fixed offset.
+bool BinaryNinjaDebugger::ParseProcessListRow(const std::string& line, DebugProcess& process, std::string& last)
+{
+	// The header ends with "N matching processes were found on ...", which starts with a number too
+	if (line.find("matching processes were found on") != std::string::npos)
+		return false;
+
+	size_t pos = 0;
+	auto readColumn = [&](size_t width) -> std::string {
+		size_t start = pos;
+		size_t end = std::min(line.size(), start + width);
+		if (line.find_first_not_of(' ', start) >= end)
+		{
+			// An empty column, e.g., the user of a process on Windows
+			pos = std::min(line.size(), start + width + 1);
+			return "";
+		}
+		end = line.find(' ', start);
+		if (end == std::string::npos)
+			end = line.size();
+		pos = std::min(line.size(), std::max(start + width, end) + 1);
+		return line.substr(start, end - start);
+	};
+
+	std::string pid = readColumn(6);
+	std::string parentPid = readColumn(6);
+	if (pid.empty() || (pid.find_first_not_of("0123456789") != std::string::npos) || parentPid.empty()
+		|| (parentPid.find_first_not_of("0123456789") != std::string::npos))
+		return false;
+
+	process.m_pid = (uint32_t)strtoul(pid.c_str(), nullptr, 10);
+	process.m_parentPid = (uint32_t)strtoul(parentPid.c_str(), nullptr, 10);
+	process.m_user = readColumn(10);
+	// Only keep the architecture of the triple, e.g., "x86_64" of "x86_64-pc-linux-gnu"
+	std::string triple = readColumn(30);
+	process.m_architecture = triple.substr(0, triple.find('-'));
+
+	size_t lastStart = line.find_first_not_of(' ', pos);
+	last = (lastStart == std::string::npos) ? "" : line.substr(lastStart);
+	return true;
+}
+
+
+#ifdef __linux__
+
+// Reads a whole file of /proc. Their sizes are unknown to stat(), so read until the end.
+static bool ReadProcFile(int procFd, const std::string& path, std::string& content, size_t limit = 0x10000)
+{
+	int fd = openat(procFd, path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	content.clear();
+	char buffer[0x1000];
+	while (content.size() < limit)
+	{
+		ssize_t size = read(fd, buffer, sizeof(buffer));
+		if (size < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (size == 0)
+			break;
+		content.append(buffer, size);
+	}
+	close(fd);
+	return true;
+}
+
+
+static std::string GetElfArchitecture(int procFd, const std::string& pid)
+{
+	// Only the owner (or root) may open the executable of a process, the rest are left without an architecture
+	int fd = openat(procFd, (pid + "/exe").c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return "";
+
+	uint8_t header[EI_NIDENT + 4] {};
+	ssize_t size = pread(fd, header, sizeof(header), 0);
+	close(fd);
+	if ((size != (ssize_t)sizeof(header)) || (memcmp(header, ELFMAG, SELFMAG) != 0))
+		return "";
+
+	bool is64Bit = header[EI_CLASS] == ELFCLASS64;
+	// e_machine follows e_type, right after the identification bytes
+	uint16_t machine = (header[EI_DATA] == ELFDATA2MSB) ? ((header[EI_NIDENT + 2] << 8) | header[EI_NIDENT + 3]) :
+															(header[EI_NIDENT + 2] | (header[EI_NIDENT + 3] << 8));
+	switch (machine)
+	{
+	case EM_X86_64:
+		return "x86_64";
+	case EM_386:
+		return "x86";
+	case EM_AARCH64:
+		return "aarch64";
+	case EM_ARM:
+		return "armv7";
+	case EM_PPC:
+		return "ppc";
+	case EM_PPC64:
+		return "ppc64";
+	case EM_MIPS:
+		return is64Bit ? "mips64" : "mips32";
+	case EM_RISCV:
+		return is64Bit ? "rv64gc" : "rv32gc";
+	default:
+		return "";
+	}
+}
+
+
+static std::string GetUserName(uid_t uid, std::unordered_map<uid_t, std::string>& cache)
+{
+	auto it = cache.find(uid);
+	if (it != cache.end())
+		return it->second;
+
+	std::string name = std::to_string(uid);
+	passwd entry {};
+	passwd* result = nullptr;
+	char buffer[0x400];
+	if ((getpwuid_r(uid, &entry, buffer, sizeof(buffer), &result) == 0) && result && result->pw_name)
+		name = result->pw_name;
+
+	cache[uid] = name;
+	return name;
+}
+
+
+bool BinaryNinjaDebugger::GetLocalProcessList(std::vector<DebugProcess>& processes)
+{
+	int procFd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (procFd < 0)
+		return false;
+
+	DIR* dir = fdopendir(dup(procFd));
+	if (!dir)
+	{
+		close(procFd);
+		return false;
+	}
+
+	processes.clear();
+	// Most processes belong to a few users, so do not look each of them up every time
+	std::unordered_map<uid_t, std::string> users;
+	std::string content;
+	while (dirent* entry = readdir(dir))
+	{
+		char* end = nullptr;
+		unsigned long pid = strtoul(entry->d_name, &end, 10);
+		if ((pid == 0) || !end || (*end != '\0'))
+			continue;
+
+		const std::string name = entry->d_name;
+		// The process can exit at any point, in which case it is just left out
+		if (!ReadProcFile(procFd, name + "/stat", content, 0x1000))
+			continue;
+
+		DebugProcess process((uint32_t)pid);
+		if (!ParseProcStat(content, process))
+			continue;
+
+		struct stat status {};
+		if (fstatat(procFd, entry->d_name, &status, 0) == 0)
+			process.m_user = GetUserName(status.st_uid, users);
+
+		if (ReadProcFile(procFd, name + "/cmdline", content))
+			ParseProcCmdline(content, process);
+
+		if (!process.m_commandLine.empty())
+			process.m_architecture = GetElfArchitecture(procFd, name);
+
+		processes.push_back(std::move(process));
+	}
+
+	closedir(dir);
+	close(procFd);
+	return true;
+}
+
+#else
+
+bool BinaryNinjaDebugger::GetLocalProcessList(std::vector<DebugProcess>& processes)
+{
+	return false;
+}
+
+#endif
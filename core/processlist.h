@@ -0,0 +1,66 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace BinaryNinjaDebugger {
+	struct DebugProcess
+	{
+		std::uint32_t m_pid {};
+		std::string m_processName {};
+		// Left empty (or zero) when the backend does not know them
+		std::uint32_t m_parentPid {};
+		std::string m_user {};
+		std::string m_architecture {};
+		std::string m_commandLine {};
+
+		DebugProcess() {}
+
+		DebugProcess(std::uint32_t pid) : m_pid(pid) {}
+
+		DebugProcess(std::uint32_t pid, std::string name) : m_pid(pid), m_processName(name) {}
+
+		bool operator==(const DebugProcess& rhs) const
+		{
+			return (m_pid == rhs.m_pid) && (m_processName == rhs.m_processName) && (m_parentPid == rhs.m_parentPid)
+				&& (m_user == rhs.m_user) && (m_architecture == rhs.m_architecture)
+				&& (m_commandLine == rhs.m_commandLine);
+		}
+
+		bool operator!=(const DebugProcess& rhs) const { return !(*this == rhs); }
+	};
+
+
+	// Lists the processes of the local machine straight from /proc, with their parent, user, architecture and command
+	// line. This is a handful of small reads per process, far cheaper than going through the process listing of a
+	// debugger backend. Only Linux is supported; on other hosts it returns false and the caller should fall back to
+	// its own listing.
+	bool GetLocalProcessList(std::vector<DebugProcess>& processes);
+
+	// Fills in the name and the parent of a process from the content of /proc/<pid>/stat
+	bool ParseProcStat(const std::string& stat, DebugProcess& process);
+	// Fills in the command line of a process from the content of /proc/<pid>/cmdline, whose arguments are separated by
+	// NUL. The program name replaces the name from stat when that one is a truncated prefix of it.
+	void ParseProcCmdline(std::string cmdline, DebugProcess& process);
+
+	// Parses a row of the `platform process list` command of LLDB. `last` receives the last column, which is the name,
+	// or the arguments with --show-args. Returns false for the header and the other rows that do not list a process.
+	bool ParseProcessListRow(const std::string& line, DebugProcess& process, std::string& last);
+};  // namespace BinaryNinjaDebugger
@@ -0,0 +1,163 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include "softwarewatchpoints.h"
+
+using namespace BinaryNinjaDebugger;
+
+
+SoftwareWatchpoints::SoftwareWatchpoints(uint64_t pageSize) : m_pageSize(pageSize) {}
+
+
+void SoftwareWatchpoints::SetPageSize(uint64_t pageSize)
+{
+	// The page size can only change before anything is protected
+	if (m_pages.empty() && (pageSize != 0) && ((pageSize & (pageSize - 1)) == 0))
+		m_pageSize = pageSize;
+}
+
+
+uint32_t SoftwareWatchpoints::ComputeProtection(uint64_t page, uint32_t original) const
+{
+	uint32_t protection = original;
+	for (const SoftwareWatchpoint& watchpoint : m_watchpoints)
+	{
+		if ((watchpoint.m_address >= page + m_pageSize) || (watchpoint.m_address + watchpoint.m_size <= page))
+			continue;
+
+		if (watchpoint.m_type == HardwareWriteWatchpoint)
+			protection &= ~ProtectionWrite;
+		else
+			// A writable page is always readable on x86, so read watchpoints need to take both away
+			protection &= ~(ProtectionRead | ProtectionWrite);
+	}
+	return protection;
+}
+
+
+bool SoftwareWatchpoints::UpdatePages(uint64_t start, uint64_t end, const SetProtectionCallback& setProtection)
+{
+	bool ok = true;
+	for (uint64_t page = PageOf(start); page < end; page += m_pageSize)
+	{
+		auto it = m_pages.find(page);
+		if (it == m_pages.end())
+			continue;
+
+		uint32_t protection = ComputeProtection(page, it->second.original);
+		if (protection != it->second.current)
+		{
+			if (setProtection(page, m_pageSize, protection))
+				it->second.current = protection;
+			else
+				ok = false;
+		}
+
+		if (it->second.current == it->second.original)
+			m_pages.erase(it);
+	}
+	return ok;
+}
+
+
+bool SoftwareWatchpoints::Add(const SoftwareWatchpoint& watchpoint, const GetProtectionCallback& getProtection,
+	const SetProtectionCallback& setProtection)
+{
+	if ((watchpoint.m_size == 0) || (watchpoint.m_type == SoftwareBreakpoint)
+		|| (watchpoint.m_type == HardwareExecuteBreakpoint))
+		return false;
+
+	if (std::find(m_watchpoints.begin(), m_watchpoints.end(), watchpoint) != m_watchpoints.end())
+		return true;
+
+	uint64_t end = watchpoint.m_address + watchpoint.m_size;
+	for (uint64_t page = PageOf(watchpoint.m_address); page < end; page += m_pageSize)
+	{
+		if (m_pages.find(page) != m_pages.end())
+			continue;
+
+		auto protection = getProtection(page);
+		if (!protection.has_value())
+		{
+			UpdatePages(watchpoint.m_address, end, setProtection);
+			return false;
+		}
+		m_pages[page] = Page {*protection, *protection};
+	}
+
+	m_watchpoints.push_back(watchpoint);
+	if (!UpdatePages(watchpoint.m_address, end, setProtection))
+	{
+		m_watchpoints.pop_back();
+		UpdatePages(watchpoint.m_address, end, setProtection);
+		return false;
+	}
+	return true;
+}
+
+
+bool SoftwareWatchpoints::Remove(const SoftwareWatchpoint& watchpoint, const SetProtectionCallback& setProtection)
+{
+	auto it = std::find(m_watchpoints.begin(), m_watchpoints.end(), watchpoint);
+	if (it == m_watchpoints.end())
+		return false;
+
+	m_watchpoints.erase(it);
+	return UpdatePages(watchpoint.m_address, watchpoint.m_address + watchpoint.m_size, setProtection);
+}
+
+
+void SoftwareWatchpoints::Clear()
+{
+	m_watchpoints.clear();
+	m_pages.clear();
+	m_steppingPage.reset();
+	m_steppingHit = false;
+}
+
+
+bool SoftwareWatchpoints::BeginStep(uint64_t faultAddress, const SetProtectionCallback& setProtection)
+{
+	uint64_t page = PageOf(faultAddress);
+	auto it = m_pages.find(page);
+	if (it == m_pages.end())
+		return false;
+
+	if (!setProtection(page, m_pageSize, it->second.original))
+		return false;
+
+	m_steppingHit = std::any_of(m_watchpoints.begin(), m_watchpoints.end(), [&](const SoftwareWatchpoint& watchpoint) {
+		return (faultAddress >= watchpoint.m_address) && (faultAddress < watchpoint.m_address + watchpoint.m_size);
+	});
+	m_steppingPage = page;
+	return true;
+}
+
+
+bool SoftwareWatchpoints::FinishStep(const SetProtectionCallback& setProtection)
+{
+	if (!m_steppingPage.has_value())
+		return false;
+
+	uint64_t page = *m_steppingPage;
+	m_steppingPage.reset();
+	auto it = m_pages.find(page);
+	if (it != m_pages.end())
+		setProtection(page, m_pageSize, it->second.current);
+
+	return m_steppingHit;
+}
@@ -0,0 +1,87 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <vector>
+#include "debugadapter.h"
+
+namespace BinaryNinjaDebugger {
+	// Software watchpoints remove write permission (and read permission, for read/access watchpoints) from the pages
+	// that hold the watched ranges. An access to such a page faults; the adapter then asks BeginStep() whether the
+	// fault is ours, single-steps the faulting instruction with the page unprotected, and calls FinishStep() to
+	// protect the page again. Only accesses that hit a watched range are reported as a stop, the rest resume silently.
+	//
+	// This class only does the bookkeeping. Changing the page protection, catching the fault and stepping are up to
+	// the adapter, which provides them through the callbacks.
+	class SoftwareWatchpoints
+	{
+	public:
+		// Same values as PROT_READ, PROT_WRITE and PROT_EXEC
+		static constexpr uint32_t ProtectionRead = 1;
+		static constexpr uint32_t ProtectionWrite = 2;
+		static constexpr uint32_t ProtectionExecute = 4;
+
+		using GetProtectionCallback = std::function<std::optional<uint32_t>(uint64_t page)>;
+		using SetProtectionCallback = std::function<bool(uint64_t page, uint64_t size, uint32_t protection)>;
+
+	private:
+		struct Page
+		{
+			uint32_t original;
+			uint32_t current;
+		};
+
+		uint64_t m_pageSize;
+		std::vector<SoftwareWatchpoint> m_watchpoints;
+		std::map<uint64_t, Page> m_pages;
+
+		// The page that is unprotected while the faulting instruction is single-stepped
+		std::optional<uint64_t> m_steppingPage;
+		bool m_steppingHit = false;
+
+		uint64_t PageOf(uint64_t address) const { return address & ~(m_pageSize - 1); }
+		uint32_t ComputeProtection(uint64_t page, uint32_t original) const;
+		bool UpdatePages(uint64_t start, uint64_t end, const SetProtectionCallback& setProtection);
+
+	public:
+		SoftwareWatchpoints(uint64_t pageSize = 0x1000);
+
+		void SetPageSize(uint64_t pageSize);
+		uint64_t GetPageSize() const { return m_pageSize; }
+
+		bool Add(const SoftwareWatchpoint& watchpoint, const GetProtectionCallback& getProtection,
+			const SetProtectionCallback& setProtection);
+		bool Remove(const SoftwareWatchpoint& watchpoint, const SetProtectionCallback& setProtection);
+		// Forgets everything without touching the target, e.g., after it exits
+		void Clear();
+
+		// Returns false if `faultAddress` is not in a page protected by us. Otherwise, unprotects the page and records
+		// whether the access hit a watched range; the caller must then single-step the faulting thread and call
+		// FinishStep().
+		bool BeginStep(uint64_t faultAddress, const SetProtectionCallback& setProtection);
+		// Protects the page again after the single step. Returns whether the access hit a watched range.
+		bool FinishStep(const SetProtectionCallback& setProtection);
+		bool IsStepping() const { return m_steppingPage.has_value(); }
+
+		bool IsEmpty() const { return m_watchpoints.empty(); }
+		std::vector<SoftwareWatchpoint> GetWatchpoints() const { return m_watchpoints; }
+	};
+};  // namespace BinaryNinjaDebugger
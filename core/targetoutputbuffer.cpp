@@ -0,0 +1,164 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "targetoutputbuffer.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace BinaryNinjaDebugger;
+
+
+TargetOutputBuffer::TargetOutputBuffer(Notify notify) : m_notify(std::move(notify))
+{
+	Configure(DefaultCapacity, DefaultNotificationsPerSecond);
+}
+
+
+TargetOutputBuffer::~TargetOutputBuffer()
+{
+	Stop();
+}
+
+
+void TargetOutputBuffer::Configure(size_t capacity, size_t notificationsPerSecond)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_capacity = std::max<size_t>(capacity, 0x1000);
+	m_interval = std::chrono::steady_clock::duration(std::chrono::seconds(1))
+		/ std::max<size_t>(notificationsPerSecond, 1);
+	for (auto& channel : m_channels)
+	{
+		// The rest of the vector is allocated as the output comes in
+		channel.data.clear();
+		channel.data.shrink_to_fit();
+		channel.start = channel.end;
+	}
+}
+
+
+void TargetOutputBuffer::Write(TargetOutputChannel channel, const char* data, size_t size)
+{
+	if (size == 0)
+		return;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	Channel& target = m_channels[channel == TargetStderrChannel ? 1 : 0];
+	if (target.data.size() != m_capacity)
+	{
+		// Configure() dropped the content, so start over where the positions are
+		target.data.assign(m_capacity, 0);
+	}
+
+	// Only the last m_capacity bytes of a large write would survive anyway
+	uint64_t end = target.end + size;
+	if (size > m_capacity)
+	{
+		data += size - m_capacity;
+		size = m_capacity;
+	}
+
+	size_t offset = (size_t)((end - size) % m_capacity);
+	size_t first = std::min(size, m_capacity - offset);
+	memcpy(target.data.data() + offset, data, first);
+	memcpy(target.data.data(), data + first, size - first);
+	target.end = end;
+
+	m_pending = true;
+	if (!m_thread.joinable() && !m_stopping)
+		m_thread = std::thread([this]() { Run(); });
+	lock.unlock();
+	m_cv.notify_one();
+}
+
+
+std::string TargetOutputBuffer::Read(
+	TargetOutputChannel channel, uint64_t& position, uint64_t& droppedBytes, size_t maxSize) const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	const Channel& source = m_channels[channel == TargetStderrChannel ? 1 : 0];
+
+	// Only the last `capacity` bytes written since Configure() are kept
+	uint64_t kept = std::min<uint64_t>(source.end, source.data.size());
+	uint64_t oldest = std::max(source.end - kept, source.start);
+	droppedBytes = 0;
+	if (position < oldest)
+	{
+		droppedBytes = oldest - position;
+		position = oldest;
+	}
+	if (position > source.end)
+		position = source.end;
+
+	size_t size = (size_t)std::min<uint64_t>(source.end - position, maxSize);
+	std::string result(size, '\0');
+	if (size > 0)
+	{
+		size_t offset = (size_t)(position % source.data.size());
+		size_t first = std::min(size, source.data.size() - offset);
+		memcpy(result.data(), source.data.data() + offset, first);
+		memcpy(result.data() + first, source.data.data(), size - first);
+	}
+	position += size;
+	return result;
+}
+
+
+uint64_t TargetOutputBuffer::GetEndPosition(TargetOutputChannel channel) const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_channels[channel == TargetStderrChannel ? 1 : 0].end;
+}
+
+
+void TargetOutputBuffer::Run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto lastNotification = std::chrono::steady_clock::now() - m_interval;
+	while (true)
+	{
+		m_cv.wait(lock, [this]() { return m_pending || m_stopping; });
+		if (m_stopping)
+			break;
+
+		// Let the writes of the rest of the interval pile up, so they are notified together
+		if (m_cv.wait_until(lock, lastNotification + m_interval, [this]() { return m_stopping; }))
+			break;
+
+		m_pending = false;
+		lastNotification = std::chrono::steady_clock::now();
+		lock.unlock();
+		if (m_notify)
+			m_notify();
+		lock.lock();
+	}
+}
+
+
+void TargetOutputBuffer::Stop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_stopping = true;
+	lock.unlock();
+	m_cv.notify_all();
+
+	if (!m_thread.joinable())
+		return;
+	// The notify callback may end up here, e.g., if it destroys the owner
+	if (m_thread.get_id() == std::this_thread::get_id())
+		m_thread.detach();
+	else
+		m_thread.join();
+}
@@ -0,0 +1,90 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "debuggerevent.h"
+
+namespace BinaryNinjaDebugger {
+	// Keeps the latest output of the target, one ring buffer per channel (stdout and stderr). The adapter writes to it
+	// without waiting for anyone, and the readers pull from it at their own pace, so a target that logs heavily costs
+	// a bounded amount of memory. When a reader falls behind by more than the capacity, the oldest output is
+	// overwritten, and the reader is told how many bytes it missed.
+	//
+	// Every byte ever written to a channel has a position, which only grows. A reader keeps the position it has read up
+	// to and passes it to Read().
+	//
+	// The notify callback is called on a thread of the buffer when there is new output, at most a given number of
+	// times per second, however many writes there were in between.
+	class TargetOutputBuffer
+	{
+	public:
+		static constexpr size_t DefaultCapacity = 0x100000;
+		static constexpr size_t DefaultNotificationsPerSecond = 10;
+
+		using Notify = std::function<void()>;
+
+	private:
+		struct Channel
+		{
+			std::vector<char> data;
+			// The position of the first byte written since Configure(). Nothing before it is kept.
+			uint64_t start = 0;
+			// The position after the last byte written
+			uint64_t end = 0;
+		};
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_cv;
+		Channel m_channels[2];
+		size_t m_capacity = DefaultCapacity;
+		std::chrono::steady_clock::duration m_interval;
+
+		Notify m_notify;
+		std::thread m_thread;
+		bool m_pending = false;
+		bool m_stopping = false;
+
+		void Run();
+
+	public:
+		TargetOutputBuffer(Notify notify);
+		~TargetOutputBuffer();
+
+		// Drops the output kept so far. The positions carry on from where they were.
+		void Configure(size_t capacity, size_t notificationsPerSecond);
+
+		// The notify thread is started on the first write
+		void Write(TargetOutputChannel channel, const char* data, size_t size);
+
+		// Reads up to `maxSize` bytes from `position`, and moves `position` past them. If the output at `position` has
+		// been overwritten already, reading starts from the oldest byte kept instead, and `droppedBytes` receives the
+		// number of bytes skipped.
+		std::string Read(TargetOutputChannel channel, uint64_t& position, uint64_t& droppedBytes, size_t maxSize) const;
+		// The position after the last byte written, i.e., where a reader only interested in new output starts
+		uint64_t GetEndPosition(TargetOutputChannel channel) const;
+
+		// Stops the notify thread. Writes after this are still kept, but no longer notified.
+		void Stop();
+	};
+};  // namespace BinaryNinjaDebugger
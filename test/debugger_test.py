@@ -3,18 +3,28 @@
 # unit tests for debugger
 
 import os
+import re
 import sys
+import glob
 import time
+import socket
+import shutil
+import struct
 import platform
+import statistics
+import tempfile
 import threading
 import subprocess
 import unittest
 
-from binaryninja import load
+from binaryninja import load, Settings
 try:
-    from debugger import DebuggerController, DebugStopReason
+    from debugger import DebuggerController, DebugStopReason, DebuggerEventType, DebuggerEventCallbackAffinity, \
+        DebugBreakpointType, DebuggerCommandType, TargetOutputChannel, ModuleNameAndOffset
 except:
-    from binaryninja.debugger import DebuggerController, DebugStopReason
+    from binaryninja.debugger import DebuggerController, DebugStopReason, DebuggerEventType, \
+        DebuggerEventCallbackAffinity, DebugBreakpointType, DebuggerCommandType, TargetOutputChannel, \
+        ModuleNameAndOffset
 
 # 'helloworld' -> '{BN_SOURCE_ROOT}\public\debugger\test\binaries\Windows-x64\helloworld.exe' (windows)
 # 'helloworld' -> '{BN_SOURCE_ROOT}/public/debugger/test/binaries/Darwin/arm64/helloworld' (linux, macOS)
@@ -44,40 +54,39 @@ def is_wow64(fpath):
     return a == '64bit' and b.startswith('Windows')
 
 
-def sleep_and_go(dbg):
-    time.sleep(0.1)
-    return dbg.go_and_wait()
-
-
-def sleep_and_step_into(dbg):
-    time.sleep(0.1)
-    return dbg.step_into_and_wait()
-
-
 class DebuggerAPI(unittest.TestCase):
+    # The adapter the tests run on, or None for the default one of the system
+    adapter_type = None
+
     # Always skip the base class so it will never be executed
     @unittest.skip("do not run the base test class")
     def setUp(self) -> None:
         self.arch = ''
 
+    def new_controller(self, bv):
+        dbg = DebuggerController(bv)
+        if self.adapter_type is not None:
+            dbg.adapter_type = self.adapter_type
+        return dbg
+
     def test_repeated_use(self):
         fpath = name_to_fpath('helloworld', self.arch)
         bv = load(fpath)
 
         def run_once():
-            dbg = DebuggerController(bv)
+            dbg = self.new_controller(bv)
             dbg.cmd_line = 'foobar'
             self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
 
             # continue execution to the entry point, and check the stop reason
-            reason = sleep_and_step_into(dbg)
+            reason = dbg.step_into_and_wait()
             self.assertEqual(reason, DebugStopReason.SingleStep)
-            reason = sleep_and_step_into(dbg)
+            reason = dbg.step_into_and_wait()
             self.assertEqual(reason, DebugStopReason.SingleStep)
-            reason = sleep_and_step_into(dbg)
+            reason = dbg.step_into_and_wait()
             self.assertEqual(reason, DebugStopReason.SingleStep)
             # go until executing done
-            reason = sleep_and_go(dbg)
+            reason = dbg.go_and_wait()
             self.assertEqual(reason, DebugStopReason.ProcessExited)
 
         # Do the same thing for 10 times
@@ -100,15 +109,65 @@ class DebuggerAPI(unittest.TestCase):
                     ('123', [123])]
 
         for arg, expected in testvals:
-            dbg = DebuggerController(bv)
+            dbg = self.new_controller(bv)
             dbg.cmd_line = arg
 
             self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
-            reason = sleep_and_go(dbg)
+            reason = dbg.go_and_wait()
             self.assertEqual(reason, DebugStopReason.ProcessExited)
             exit_code = dbg.exit_code
             self.assertIn(exit_code, expected)
 
+    def test_target_output(self):
+        fpath = name_to_fpath('helloworld', self.arch)
+        bv = load(fpath)
+        dbg = self.new_controller(bv)
+        dbg.cmd_line = 'foobar'
+
+        messages = []
+        exited = threading.Event()
+
+        def on_event(event):
+            if event.type == DebuggerEventType.StdoutMessageEventType:
+                messages.append(event.data.message_data)
+            else:
+                exited.set()
+
+        callback = dbg.register_event_callback(on_event, 'target output test',
+                                               DebuggerEventCallbackAffinity.WorkerThreadEventCallbackAffinity,
+                                               [DebuggerEventType.StdoutMessageEventType,
+                                                DebuggerEventType.TargetExitedEventType])
+        self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+        stdout = TargetOutputChannel.TargetStdoutChannel
+        start = dbg.target_output_position(stdout)
+
+        self.assertEqual(dbg.go_and_wait(), DebugStopReason.ProcessExited)
+        # The output is flushed before the exit is reported
+        self.assertTrue(exited.wait(5))
+        dbg.remove_event_callback(callback)
+        output = ''.join(message.message for message in messages
+                         if message.channel == TargetOutputChannel.TargetStdoutChannel)
+        self.assertIn('Hello, world!', output)
+        self.assertIn('argv[1]: foobar', output)
+        self.assertEqual(sum(message.dropped_bytes for message in messages), 0)
+
+        # The same output can be read back, in pieces
+        end = dbg.target_output_position(stdout)
+        self.assertGreater(end, start)
+        data, position, dropped = dbg.read_target_output(stdout, start, 4)
+        self.assertEqual(len(data), 4)
+        self.assertEqual(position, start + 4)
+        rest, position, dropped = dbg.read_target_output(stdout, position)
+        self.assertEqual(position, end)
+        self.assertEqual(dropped, 0)
+        self.assertIn(b'argv[1]: foobar', data + rest)
+
+        # Nothing new, and nothing was written to stderr
+        data, position, dropped = dbg.read_target_output(stdout, end)
+        self.assertEqual((data, position), (b'', end))
+        stderr = TargetOutputChannel.TargetStderrChannel
+        self.assertEqual(dbg.read_target_output(stderr, 0)[0], b'')
+
     def expect_segfault(self, reason):
         if platform.system() == 'Linux':
             self.assertEqual(reason, DebugStopReason.SignalSegv)
@@ -118,12 +177,12 @@ class DebuggerAPI(unittest.TestCase):
     def test_exception_segfault(self):
         fpath = name_to_fpath('do_exception', self.arch)
         bv = load(fpath)
-        dbg = DebuggerController(bv)
+        dbg = self.new_controller(bv)
 
         dbg.cmd_line = 'segfault'
         self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
         # time.sleep(1)
-        reason = sleep_and_go(dbg)
+        reason = dbg.go_and_wait()
         self.expect_segfault(reason)
         dbg.quit_and_wait()
 
@@ -131,7 +190,7 @@ class DebuggerAPI(unittest.TestCase):
     # def test_exception_illegalinstr(self):
     #     fpath = name_to_fpath('do_exception', self.arch)
     #     bv = load(fpath)
-    #     dbg = DebuggerController(bv)
+    #     dbg = self.new_controller(bv)
     #     dbg.cmd_line = 'illegalinstr'
     #     self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
     #     dbg.go()
@@ -153,31 +212,93 @@ class DebuggerAPI(unittest.TestCase):
     def test_exception_divzero(self):
         fpath = name_to_fpath('do_exception', self.arch)
         bv = load(fpath)
-        dbg = DebuggerController(bv)
+        dbg = self.new_controller(bv)
         if not self.arch == 'arm64':
             dbg.cmd_line = 'divzero'
             self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
-            reason = sleep_and_go(dbg)
+            reason = dbg.go_and_wait()
             self.expect_divide_by_zero(reason)
             dbg.quit_and_wait()
 
     def test_step_into(self):
         fpath = name_to_fpath('helloworld', self.arch)
         bv = load(fpath)
-        dbg = DebuggerController(bv)
+        dbg = self.new_controller(bv)
         dbg.cmd_line = 'foobar'
         self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
-        reason = sleep_and_step_into(dbg)
+        reason = dbg.step_into_and_wait()
         self.assertEqual(reason, DebugStopReason.SingleStep)
-        reason = sleep_and_step_into(dbg)
+        reason = dbg.step_into_and_wait()
         self.assertEqual(reason, DebugStopReason.SingleStep)
-        reason = sleep_and_go(dbg)
+        reason = dbg.go_and_wait()
         self.assertEqual(reason, DebugStopReason.ProcessExited)
 
+    def test_step_instructions(self):
+        fpath = name_to_fpath('helloworld', self.arch)
+        bv = load(fpath)
+        dbg = self.new_controller(bv)
+        self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+        for i in range(5):
+            self.assertEqual(dbg.step_into_and_wait(), DebugStopReason.SingleStep)
+        expected = dbg.ip
+        dbg.quit_and_wait()
+
+        self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+        self.assertEqual(dbg.step_instructions_and_wait(5), DebugStopReason.SingleStep)
+        self.assertEqual(dbg.ip, expected)
+        dbg.quit_and_wait()
+
+    def test_queued_commands(self):
+        fpath = name_to_fpath('helloworld', self.arch)
+        bv = load(fpath)
+        dbg = self.new_controller(bv)
+        self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+        for i in range(5):
+            self.assertEqual(dbg.step_into_and_wait(), DebugStopReason.SingleStep)
+        expected = dbg.ip
+        dbg.quit_and_wait()
+
+        # Queue the steps back to back, each one is requested before the previous one finishes
+        self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+        self.assertTrue(dbg.step_into())
+        self.assertTrue(dbg.step_into())
+        reasons = []
+        completed = threading.Event()
+
+        def on_completion(reason):
+            reasons.append(reason)
+            if len(reasons) == 3:
+                completed.set()
+
+        steps = [dbg.submit_command(DebuggerCommandType.StepIntoCommand, completion=on_completion)
+                 for i in range(3)]
+        self.assertNotIn(None, steps)
+        # The commands run in order, so the previous ones are done once the last one is
+        for step in steps:
+            self.assertEqual(step.result(timeout=10), DebugStopReason.SingleStep)
+        self.assertTrue(completed.wait(10))
+        self.assertEqual(reasons, [DebugStopReason.SingleStep] * 3)
+        self.assertEqual(dbg.ip, expected)
+
+        # The synchronous calls wait for the queued commands instead of failing
+        self.assertTrue(dbg.step_into())
+        self.assertEqual(dbg.step_into_and_wait(), DebugStopReason.SingleStep)
+        self.assertTrue(dbg.step_into())
+        self.assertEqual(dbg.go_and_wait(), DebugStopReason.ProcessExited)
+        self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+
+        # A command that is cancelled before it starts resolves without running
+        go = dbg.submit_command(DebuggerCommandType.GoCommand)
+        step = dbg.submit_command(DebuggerCommandType.StepIntoCommand)
+        step.cancel()
+        self.assertEqual(step.result(timeout=10), DebugStopReason.InvalidStatusOrOperation)
+        self.assertEqual(go.result(timeout=10), DebugStopReason.ProcessExited)
+        dbg.quit_and_wait()
+
     def test_breakpoint(self):
         fpath = name_to_fpath('helloworld', self.arch)
         bv = load(fpath)
-        dbg = DebuggerController(bv)
+        dbg = self.new_controller(bv)
         self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
         # TODO: right now we are not returning whether the operation succeeds, so we cannot use assertTrue/assertFalse
         # breakpoint set/clear should fail at 0
@@ -192,10 +313,203 @@ class DebuggerAPI(unittest.TestCase):
         self.assertEqual(dbg.ip, entry)
         dbg.quit_and_wait()
 
-    def test_register_read_write(self):
+    # The expression of the first argument of a function, when the target stops at its first instruction
+    def first_argument(self):
+        if self.arch == 'x86':
+            return 'u32[esp + 4]'
+        if self.arch == 'arm64':
+            return 'x0'
+        if platform.system() == 'Windows':
+            return 'rcx'
+        return 'rdi'
+
+    # helloworld_func calls hello() with 0, 1, 2 and 3
+    def launch_helloworld_func(self):
+        fpath = name_to_fpath('helloworld_func', self.arch)
+        bv = load(fpath)
+        dbg = self.new_controller(bv)
+        self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+        hello = dbg.data.get_functions_by_name('hello')[0].start
+        return dbg, hello
+
+    def test_breakpoint_condition(self):
+        dbg, hello = self.launch_helloworld_func()
+        arg = self.first_argument()
+        dbg.add_breakpoint(hello)
+        self.assertFalse(dbg.set_breakpoint_condition(hello, f'{arg} =='))
+        self.assertTrue(dbg.set_breakpoint_condition(hello, f'{arg} == 2'))
+        self.assertEqual(dbg.get_breakpoint_condition(hello), f'{arg} == 2')
+
+        # The calls with 0 and 1 neither stop nor count as hits
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.Breakpoint)
+        self.assertEqual(dbg.ip, hello)
+        self.assertEqual(dbg.get_breakpoint_hit_count(hello), 1)
+
+        # An empty condition makes the breakpoint unconditional again
+        self.assertTrue(dbg.set_breakpoint_condition(hello, ''))
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.Breakpoint)
+        self.assertEqual(dbg.get_breakpoint_hit_count(hello), 2)
+
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.ProcessExited)
+
+    def test_breakpoint_ignore_count(self):
+        dbg, hello = self.launch_helloworld_func()
+        dbg.add_breakpoint(hello)
+        self.assertTrue(dbg.set_breakpoint_ignore_count(hello, 2))
+
+        # Ignored hits still count
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.Breakpoint)
+        self.assertEqual(dbg.get_breakpoint_hit_count(hello), 3)
+
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.Breakpoint)
+        self.assertEqual(dbg.get_breakpoint_hit_count(hello), 4)
+
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.ProcessExited)
+
+    def test_breakpoint_log_message(self):
+        dbg, hello = self.launch_helloworld_func()
+        arg = self.first_argument()
+
+        messages = []
+        done = threading.Event()
+
+        def on_event(event):
+            messages.append(event.data.message_data.message)
+            if 'hello(3)' in ''.join(messages):
+                done.set()
+
+        callback = dbg.register_event_callback(on_event, 'log point test',
+                                               DebuggerEventCallbackAffinity.WorkerThreadEventCallbackAffinity,
+                                               [DebuggerEventType.BreakpointLogEventType])
+        dbg.add_breakpoint(hello)
+        self.assertFalse(dbg.set_breakpoint_log_message(hello, f'hello({{{arg}:d'))
+        self.assertTrue(dbg.set_breakpoint_log_message(hello, f'hello({{{arg}:d}})'))
+
+        # Log points never stop the target
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.ProcessExited)
+        self.assertTrue(done.wait(5))
+        dbg.remove_event_callback(callback)
+        lines = ''.join(messages).splitlines()
+        self.assertEqual(lines, ['hello(0)', 'hello(1)', 'hello(2)', 'hello(3)'])
+
+    # Stops at the call of hello(1)
+    def run_to_call_of_hello(self):
+        dbg, hello = self.launch_helloworld_func()
+        call = sorted(ref.address for ref in dbg.data.get_code_refs(hello))[1]
+        dbg.add_breakpoint(call)
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.Breakpoint)
+        self.assertEqual(dbg.ip, call)
+        dbg.delete_breakpoint(call)
+        return dbg, hello
+
+    def test_breakpoint_metadata(self):
+        if self.adapter_type is not None:
+            self.skipTest('Covered by the classes of the default adapter')
         fpath = name_to_fpath('helloworld', self.arch)
+        module = os.path.basename(fpath)
+
+        def saved_breakpoints(blob):
+            # What a new session on a view with the blob loads
+            view = load(fpath)
+            view.store_metadata('debugger.breakpoints', blob)
+            return [(bp.module, bp.offset, bp.condition, bp.log_message) for bp in DebuggerController(view).breakpoints]
+
+        # Older versions saved an array of key-value stores. It is upgraded to the packed blob by the next flush.
         bv = load(fpath)
+        bv.store_metadata('debugger.breakpoints',
+                          [{'module': module, 'offset': 0x10}, {'module': module, 'offset': 0x20}])
         dbg = DebuggerController(bv)
+        self.assertEqual([(bp.module, bp.offset) for bp in dbg.breakpoints], [(module, 0x10), (module, 0x20)])
+        dbg.flush_breakpoints()
+        blob = bv.query_metadata('debugger.breakpoints')
+        self.assertIsInstance(blob, bytes)
+        self.assertEqual(saved_breakpoints(blob), [(module, 0x10, '', ''), (module, 0x20, '', '')])
+
+        # Right after a write, the changes are held back, and written out at the end of the interval without a flush
+        dbg.add_breakpoint(ModuleNameAndOffset(module, 0x30))
+        self.assertTrue(dbg.set_breakpoint_condition(ModuleNameAndOffset(module, 0x30), '1 + 1 == 2'))
+        dbg.add_breakpoint(ModuleNameAndOffset('libc.so.6', 0x40))
+        time.sleep(2)
+        self.assertEqual(saved_breakpoints(bv.query_metadata('debugger.breakpoints')),
+                         [(module, 0x10, '', ''), (module, 0x20, '', ''), (module, 0x30, '1 + 1 == 2', ''),
+                          ('libc.so.6', 0x40, '', '')])
+
+    def test_step_return_from_prologue(self):
+        dbg, hello = self.run_to_call_of_hello()
+        call = dbg.ip
+        after_call = call + dbg.data.get_instruction_length(call)
+        dbg.step_into_and_wait()
+        self.assertEqual(dbg.ip, hello)
+
+        # The frame of hello() is not set up yet, so the return address cannot be found by unwinding
+        dbg.step_return_and_wait()
+        self.assertEqual(dbg.ip, after_call)
+        dbg.quit_and_wait()
+
+    def test_step_onto_conditional_breakpoint(self):
+        dbg, hello = self.run_to_call_of_hello()
+
+        # A step that lands on a breakpoint whose condition is false still ends there
+        dbg.add_breakpoint(hello)
+        self.assertTrue(dbg.set_breakpoint_condition(hello, f'{self.first_argument()} == 100'))
+        reason = dbg.step_into_and_wait()
+        self.assertIn(reason, [DebugStopReason.SingleStep, DebugStopReason.Breakpoint])
+        self.assertEqual(dbg.ip, hello)
+        dbg.quit_and_wait()
+
+    @unittest.skipIf(platform.machine() in ['arm64', 'aarch64'], 'A call does not write to the stack on arm64')
+    def test_hardware_watchpoint(self):
+        dbg, hello = self.run_to_call_of_hello()
+        # The call writes the return address right below the stack pointer
+        size = dbg.remote_arch.address_size
+        slot = dbg.stack_pointer - size
+        self.assertTrue(dbg.add_hardware_breakpoint(slot, DebugBreakpointType.HardwareWriteWatchpoint, size))
+        self.assertIn(slot, [bp.address for bp in dbg.hardware_breakpoints])
+
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.Watchpoint)
+        self.assertEqual(dbg.ip, hello)
+
+        self.assertTrue(dbg.remove_hardware_breakpoint(slot, DebugBreakpointType.HardwareWriteWatchpoint, size))
+        self.assertFalse(dbg.remove_hardware_breakpoint(slot, DebugBreakpointType.HardwareWriteWatchpoint, size))
+        self.assertEqual(len(dbg.hardware_breakpoints), 0)
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.ProcessExited)
+
+    @unittest.skipIf(platform.system() != 'Linux', 'Software watchpoints are only supported on Linux')
+    def test_software_watchpoint(self):
+        if self.adapter_type == 'PTRACE':
+            self.skipTest('The ptrace adapter has no software watchpoints')
+        dbg, hello = self.run_to_call_of_hello()
+        # Either the call or the prologue of hello() writes right below the stack pointer
+        size = 0x40
+        slot = dbg.stack_pointer - size
+        self.assertTrue(dbg.add_software_watchpoint(slot, size))
+        self.assertEqual([(wp.address, wp.size) for wp in dbg.software_watchpoints], [(slot, size)])
+
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.Watchpoint)
+        self.assertGreaterEqual(dbg.ip, hello)
+        self.assertLess(dbg.ip, hello + 0x20)
+
+        self.assertTrue(dbg.remove_software_watchpoint(slot, size))
+        self.assertFalse(dbg.remove_software_watchpoint(slot, size))
+        self.assertEqual(len(dbg.software_watchpoints), 0)
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.ProcessExited)
+
+    def test_register_read_write(self):
+        fpath = name_to_fpath('helloworld', self.arch)
+        bv = load(fpath)
+        dbg = self.new_controller(bv)
         self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
 
         arch_name = bv.arch.name
@@ -227,7 +541,7 @@ class DebuggerAPI(unittest.TestCase):
     def test_memory_read_write(self):
         fpath = name_to_fpath('helloworld', self.arch)
         bv = load(fpath)
-        dbg = DebuggerController(bv)
+        dbg = self.new_controller(bv)
         self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
 
         # Due to https://github.com/Vector35/debugger/issues/124, we have to skip the bytes at the entry point
@@ -244,11 +558,76 @@ class DebuggerAPI(unittest.TestCase):
 
         dbg.quit_and_wait()
 
+    def test_epochs(self):
+        fpath = name_to_fpath('helloworld', self.arch)
+        bv = load(fpath)
+        dbg = self.new_controller(bv)
+        self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+
+        def epochs():
+            return dbg.stop_epoch, dbg.registers_epoch, dbg.memory_epoch, dbg.modules_epoch, dbg.threads_epoch
+
+        # Reading the target does not change them
+        before = epochs()
+        dbg.read_memory(dbg.ip, 16)
+        self.assertGreater(len(dbg.regs), 0)
+        self.assertGreater(len(dbg.threads), 0)
+        self.assertEqual(epochs(), before)
+
+        # Running the target changes all of them
+        self.assertEqual(dbg.step_into_and_wait(), DebugStopReason.SingleStep)
+        after = epochs()
+        for old, new in zip(before, after):
+            self.assertNotEqual(old, new)
+
+        # Edits while stopped only change the epoch of their cache
+        scratch = {'x86': 'eax', 'arm64': 'x9'}.get(self.arch, 'rax')
+        dbg.set_reg_value(scratch, 0x1234)
+        self.assertNotEqual(dbg.registers_epoch, after[1])
+        self.assertEqual(dbg.stop_epoch, after[0])
+        self.assertEqual(dbg.memory_epoch, after[2])
+
+        memory_epoch = dbg.memory_epoch
+        addr = dbg.stack_pointer - 0x100
+        dbg.write_memory(addr, dbg.read_memory(addr, 8))
+        self.assertNotEqual(dbg.memory_epoch, memory_epoch)
+        self.assertEqual(dbg.stop_epoch, after[0])
+
+        dbg.quit_and_wait()
+
+    def test_stop_latency(self):
+        # nopspeed spins through nops for several seconds, so the target is always busy when it is paused
+        if self.arch != 'x86_64':
+            self.skipTest('nopspeed runs x86_64 code')
+        fpath = name_to_fpath('nopspeed', self.arch)
+        bv = load(fpath)
+        dbg = self.new_controller(bv)
+        self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+
+        pauses = []
+        for i in range(10):
+            dbg.go()
+            time.sleep(0.1)
+            start = time.perf_counter()
+            dbg.pause_and_wait()
+            pauses.append(time.perf_counter() - start)
+            self.assertNotEqual(dbg.stop_reason, DebugStopReason.ProcessExited)
+
+        start = time.perf_counter()
+        dbg.quit_and_wait()
+        quit = time.perf_counter() - start
+
+        print(f'\n{type(self).__name__}: pause median {statistics.median(pauses) * 1000:.1f}ms, '
+              f'max {max(pauses) * 1000:.1f}ms, quit {quit * 1000:.1f}ms')
+        # Neither waits out a polling interval of the adapter
+        self.assertLess(statistics.median(pauses), 0.5)
+        self.assertLess(quit, 0.5)
+
     # @unittest.skip
     def test_thread(self):
         fpath = name_to_fpath('helloworld_thread', self.arch)
         bv = load(fpath)
-        dbg = DebuggerController(bv)
+        dbg = self.new_controller(bv)
         self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
 
         dbg.go()
@@ -273,20 +652,17 @@ class DebuggerAPI(unittest.TestCase):
     def test_restart(self):
         fpath = name_to_fpath('helloworld_thread', self.arch)
         bv = load(fpath)
-        dbg = DebuggerController(bv)
+        dbg = self.new_controller(bv)
         self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
 
-        time.sleep(0.1)
         dbg.go()
         time.sleep(1)
         dbg.pause_and_wait()
         self.assertGreater(len(dbg.threads), 1)
 
-        time.sleep(0.1)
         ret = dbg.restart_and_wait()
         self.assertNotIn(ret, [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
 
-        time.sleep(0.1)
         dbg.go()
         time.sleep(1)
         ret = dbg.restart_and_wait()
@@ -297,28 +673,28 @@ class DebuggerAPI(unittest.TestCase):
         if self.arch == 'x86_64':
             fpath = name_to_fpath('asmtest', 'x86_64')
             bv = load(fpath)
-            dbg = DebuggerController(bv)
+            dbg = self.new_controller(bv)
             self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
             entry = dbg.data.entry_point
             self.assertEqual(dbg.ip, entry)
 
             # TODO: we can use BN to disassemble the binary and find out how long is the instruction
             # step into nop
-            sleep_and_step_into(dbg)
+            dbg.step_into_and_wait()
             self.assertEqual(dbg.ip, entry+1)
             # step into call, return
-            sleep_and_step_into(dbg)
-            sleep_and_step_into(dbg)
+            dbg.step_into_and_wait()
+            dbg.step_into_and_wait()
             # back
             self.assertEqual(dbg.ip, entry+6)
-            sleep_and_step_into(dbg)
+            dbg.step_into_and_wait()
             # step into call, return
-            sleep_and_step_into(dbg)
-            sleep_and_step_into(dbg)
+            dbg.step_into_and_wait()
+            dbg.step_into_and_wait()
             # back
             self.assertEqual(dbg.ip, entry+12)
 
-            reason = sleep_and_go(dbg)
+            reason = dbg.go_and_wait()
             self.assertEqual(reason, DebugStopReason.ProcessExited)
 
     @unittest.skipIf(platform.system() == 'Linux', 'Cannot attach to pid unless running as root')
@@ -339,13 +715,123 @@ class DebuggerAPI(unittest.TestCase):
 
         self.assertIsNotNone(pid)
         bv = load(fpath)
-        dbg = DebuggerController(bv)
+        dbg = self.new_controller(bv)
         dbg.pid_attach = pid
         self.assertTrue(dbg.attach_and_wait())
         self.assertGreater(len(dbg.regs), 0)
 
         dbg.quit_and_wait()
 
+    # fork_test forks a child that runs in_child() and exits with 3. The parent waits for it, runs in_parent() and
+    # exits with 5.
+    def launch_fork_test(self, mode):
+        fpath = name_to_fpath('fork_test', self.arch)
+        if not os.path.exists(fpath):
+            self.skipTest('fork_test is not built for this architecture')
+        Settings().set_string('debugger.followForkMode', mode)
+        self.addCleanup(Settings().reset, 'debugger.followForkMode')
+
+        bv = load(fpath)
+        dbg = self.new_controller(bv)
+        self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+        in_child = dbg.data.get_functions_by_name('in_child')[0].start
+        in_parent = dbg.data.get_functions_by_name('in_parent')[0].start
+        dbg.add_breakpoint(in_child)
+        dbg.add_breakpoint(in_parent)
+        return dbg, in_child, in_parent
+
+    def expect_fork_test_exit(self, dbg, exit_code):
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.ProcessExited)
+        self.assertEqual(dbg.exit_code, exit_code)
+        output = dbg.read_target_output(TargetOutputChannel.TargetStdoutChannel, 0)[0]
+        self.assertIn(b'In the child 0', output)
+        return output
+
+    @unittest.skipIf(platform.system() != 'Linux', 'fork_test only runs on Linux')
+    def test_fork_follow_parent(self):
+        dbg, in_child, in_parent = self.launch_fork_test('parent')
+        # The child does not inherit the breakpoints, so it neither stops nor dies of a SIGTRAP
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.Breakpoint)
+        self.assertEqual(dbg.ip, in_parent)
+        output = self.expect_fork_test_exit(dbg, 5)
+        self.assertIn(b'the child exited with 3', output)
+
+    @unittest.skipIf(platform.system() != 'Linux', 'fork_test only runs on Linux')
+    def test_fork_follow_child(self):
+        dbg, in_child, in_parent = self.launch_fork_test('child')
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.Breakpoint)
+        self.assertEqual(dbg.ip, in_child)
+        # The session ends with the child, and the parent runs on without the debugger
+        self.expect_fork_test_exit(dbg, 3)
+
+    @unittest.skipIf(platform.system() != 'Linux', 'fork_test only runs on Linux')
+    def test_fork_follow_both(self):
+        if self.adapter_type != 'PTRACE':
+            self.skipTest('Only the ptrace adapter follows both processes')
+        dbg, in_child, in_parent = self.launch_fork_test('both')
+        # The parent waits for the child, so the child stops first. Its exit does not end the session.
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.Breakpoint)
+        self.assertEqual(dbg.ip, in_child)
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.Breakpoint)
+        self.assertEqual(dbg.ip, in_parent)
+        output = self.expect_fork_test_exit(dbg, 5)
+        self.assertIn(b'the child exited with 3', output)
+
+    @unittest.skipIf(platform.system() != 'Linux' or shutil.which('gdbserver') is None, 'Needs gdbserver on Linux')
+    def test_gdb_rsp_adapter(self):
+        if self.adapter_type is not None:
+            self.skipTest('Covered by the classes of the default adapter')
+        fpath = name_to_fpath('helloworld_func', self.arch)
+        bv = load(fpath)
+        with socket.socket() as s:
+            s.bind(('127.0.0.1', 0))
+            port = s.getsockname()[1]
+        server = subprocess.Popen(['gdbserver', f'127.0.0.1:{port}', fpath],
+                                  stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        try:
+            # Wait for gdbserver to listen
+            for i in range(50):
+                with socket.socket() as s:
+                    if s.connect_ex(('127.0.0.1', port)) != 0:
+                        time.sleep(0.1)
+                        continue
+                break
+
+            dbg = DebuggerController(bv)
+            dbg.adapter_type = 'GDB RSP'
+            dbg.remote_host = '127.0.0.1'
+            dbg.remote_port = port
+            self.assertNotIn(dbg.connect_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+            self.assertGreater(len(dbg.regs), 0)
+            self.assertGreater(len(dbg.threads), 0)
+            self.assertIn(os.path.basename(fpath), [os.path.basename(module.name) for module in dbg.modules])
+
+            hello = dbg.data.get_functions_by_name('hello')[0].start
+            dbg.add_breakpoint(hello)
+            reason = dbg.go_and_wait()
+            self.assertEqual(reason, DebugStopReason.Breakpoint)
+            self.assertEqual(dbg.ip, hello)
+            if self.arch != 'x86':
+                self.assertEqual(dbg.get_reg_value(self.first_argument()), 0)
+            # The breakpoint is not visible in the memory read back from the stub
+            self.assertEqual(bytes(dbg.read_memory(hello, 8)), bv.read(bv.get_functions_by_name('hello')[0].start, 8))
+
+            self.assertEqual(dbg.step_into_and_wait(), DebugStopReason.SingleStep)
+            self.assertNotEqual(dbg.ip, hello)
+
+            dbg.delete_breakpoint(hello)
+            reason = dbg.go_and_wait()
+            self.assertEqual(reason, DebugStopReason.ProcessExited)
+            dbg.quit_and_wait()
+        finally:
+            server.kill()
+            server.wait()
+
 
 @unittest.skipIf(platform.machine() not in ['arm64', 'aarch64'], "Only run arm64 tests on arm Mac or Linux")
 class DebuggerArm64Test(DebuggerAPI):
@@ -365,6 +851,132 @@ class Debuggerx86Test(DebuggerAPI):
         self.arch = 'x86'
 
 
+# The same tests on the ptrace adapter, which only supports x86_64 and arm64 Linux
+@unittest.skipIf(platform.system() != 'Linux' or platform.machine() not in ['arm64', 'aarch64'],
+                 'The ptrace adapter only runs on Linux')
+class DebuggerPtraceArm64Test(DebuggerAPI):
+    adapter_type = 'PTRACE'
+
+    def setUp(self) -> None:
+        self.arch = 'arm64'
+
+
+@unittest.skipIf(platform.system() != 'Linux' or platform.machine() != 'x86_64',
+                 'The ptrace adapter only runs on Linux')
+class DebuggerPtracex64Test(DebuggerAPI):
+    adapter_type = 'PTRACE'
+
+    def setUp(self) -> None:
+        self.arch = 'x86_64'
+
+
+def elf_file_offset(path, address):
+    # The offset in an ELF file of an address relative to its load base, from the PT_LOAD program headers
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[4] == 2:
+        phoff, = struct.unpack_from('<Q', data, 0x20)
+        phentsize, phnum = struct.unpack_from('<HH', data, 0x36)
+        layout, fields = '<IIQQQQ', (2, 3, 5)
+    else:
+        phoff, = struct.unpack_from('<I', data, 0x1c)
+        phentsize, phnum = struct.unpack_from('<HH', data, 0x2a)
+        layout, fields = '<IIIIII', (1, 2, 4)
+    for i in range(phnum):
+        header = struct.unpack_from(layout, data, phoff + i * phentsize)
+        offset, vaddr, filesz = (header[field] for field in fields)
+        if header[0] == 1 and vaddr <= address < vaddr + filesz:
+            return offset + address - vaddr
+    return None
+
+
+@unittest.skipIf(platform.system() != 'Linux' or platform.machine() not in ['x86_64', 'arm64', 'aarch64'],
+                 'The core files are generated on x86_64 and arm64 Linux')
+class DebuggerElfCoreTest(unittest.TestCase):
+    def setUp(self) -> None:
+        self.arch = 'x86_64' if platform.machine() == 'x86_64' else 'arm64'
+
+    def generate_core(self, fpath, args):
+        with open('/proc/sys/kernel/core_pattern') as f:
+            pattern = f.read().strip()
+        if pattern.startswith('|'):
+            self.skipTest(f'The cores are piped to {pattern[1:].split()[0]}')
+
+        workdir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, workdir, True)
+        start = time.time()
+
+        def enable_core_dumps():
+            import resource
+            hard = resource.getrlimit(resource.RLIMIT_CORE)[1]
+            resource.setrlimit(resource.RLIMIT_CORE, (hard, hard))
+
+        process = subprocess.run([fpath] + args, cwd=workdir, preexec_fn=enable_core_dumps,
+                                 stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        self.assertLess(process.returncode, 0)
+
+        # Any %-specifier, and the pid that core_uses_pid appends, can be in the name
+        cores = [path for path in glob.glob(os.path.join(workdir, re.sub('%.', '*', pattern)) + '*')
+                 if os.path.getmtime(path) >= start - 1]
+        if not cores:
+            self.skipTest('No core file was written')
+        core = max(cores, key=os.path.getmtime)
+        if not core.startswith(workdir):
+            self.addCleanup(os.remove, core)
+        return core
+
+    def test_segfault_core(self):
+        fpath = name_to_fpath('do_exception', self.arch)
+        core = self.generate_core(fpath, ['segfault'])
+
+        bv = load(fpath)
+        dbg = DebuggerController(bv)
+        dbg.adapter_type = 'ELF_CORE_FILE'
+        dbg.executable_path = core
+        self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+        self.assertEqual(dbg.stop_reason, DebugStopReason.SignalSegv)
+
+        # The process is single-threaded, and it stopped on the load from 0xDEADBEEF in main()
+        threads = dbg.threads
+        self.assertEqual(len(threads), 1)
+        self.assertEqual(threads[0].rip, dbg.ip)
+        pc, sp = ('rip', 'rsp') if self.arch == 'x86_64' else ('pc', 'sp')
+        self.assertEqual(dbg.get_reg_value(pc), dbg.ip)
+        self.assertEqual(dbg.get_reg_value(sp), dbg.stack_pointer)
+        self.assertIn(0xdeadbeef, [reg.value for reg in dbg.regs.regs.values()])
+
+        modules = {os.path.basename(module.name): module for module in dbg.modules}
+        self.assertIn('do_exception', modules)
+        self.assertTrue(any(name.startswith('libc') for name in modules))
+        main = modules['do_exception']
+        self.assertTrue(main.address <= dbg.ip < main.address + main.size)
+
+        # The stack is anonymous memory, which is in a PT_LOAD segment of the core
+        self.assertEqual(len(dbg.read_memory(dbg.stack_pointer, 0x40)), 0x40)
+        # The ELF header of every module is kept in the core
+        self.assertEqual(bytes(dbg.read_memory(main.address, 4)), b'\x7fELF')
+
+        # The code is left out of the core, and is read from the mapped file by its NT_FILE entry
+        omitted = [int(line.split('-')[0], 16) for line in dbg.execute_backend_command('info').splitlines()
+                   if line.endswith(' (0x0 bytes in the core)')]
+        checked = 0
+        for address in omitted:
+            module = next((module for module in modules.values()
+                           if module.address <= address < module.address + module.size), None)
+            if module is None:
+                continue
+            offset = elf_file_offset(module.name, address - module.address)
+            if offset is None:
+                continue
+            with open(module.name, 'rb') as f:
+                f.seek(offset)
+                expected = f.read(0x100)
+            self.assertEqual(bytes(dbg.read_memory(address, len(expected))), expected)
+            checked += 1
+        self.assertGreater(checked, 0)
+        dbg.quit_and_wait()
+
+
 def filter_test_suite(suite, keyword):
     result = unittest.TestSuite()
     for child in suite._tests:
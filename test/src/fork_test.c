@@ -0,0 +1,34 @@
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// The child runs this and exits with 3, while the parent waits for it, runs in_parent() and exits with 5
+
+int in_child(int a)
+{
+	printf("In the child %d\n", a);
+	fflush(stdout);
+	return a + 3;
+}
+
+int in_parent(int a)
+{
+	printf("In the parent, the child exited with %d\n", a);
+	fflush(stdout);
+	return 5;
+}
+
+int main(int ac, char **av)
+{
+	pid_t pid = fork();
+	if (pid < 0)
+		return 1;
+	if (pid == 0)
+		return in_child(0);
+
+	int status = 0;
+	if (waitpid(pid, &status, 0) != pid)
+		return 2;
+	return in_parent(WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+}
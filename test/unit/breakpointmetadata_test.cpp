@@ -0,0 +1,138 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include "unittest.h"
+#include "breakpointmetadata.h"
+
+using namespace BinaryNinjaDebugger;
+
+
+// operator== of ModuleNameAndOffset only compares the base names of the modules
+static bool SameBreakpoints(const std::vector<ModuleNameAndOffset>& a, const std::vector<ModuleNameAndOffset>& b)
+{
+	return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+		[](const ModuleNameAndOffset& x, const ModuleNameAndOffset& y) {
+			return (x.module == y.module) && (x.offset == y.offset);
+		});
+}
+
+
+static size_t CountOccurrences(const std::vector<uint8_t>& buffer, const std::string& text)
+{
+	size_t count = 0;
+	for (auto it = buffer.begin(); (it = std::search(it, buffer.end(), text.begin(), text.end())) != buffer.end(); ++it)
+		count++;
+	return count;
+}
+
+
+TEST(RoundTripsBreakpoints)
+{
+	std::vector<ModuleNameAndOffset> breakpoints = {{"/usr/bin/helloworld", 0x1139}, {"/usr/lib/libc.so.6", 0x80e50},
+		{"/usr/bin/helloworld", 0x1160}, {"/usr/bin/helloworld", 0xffffffffffff0000}};
+	std::map<ModuleNameAndOffset, BreakpointOptions> options;
+	options[breakpoints[0]].condition = "rdi == 100";
+	options[breakpoints[1]].logMessage = "malloc({rdi})";
+	options[breakpoints[2]].condition = "rax != 0";
+	options[breakpoints[2]].logMessage = "returned {rax}";
+	// The ignore count is not persisted
+	options[breakpoints[3]].ignoreCount = 5;
+
+	std::vector<uint8_t> blob = PackBreakpoints(breakpoints, options);
+	// The modules are stored once
+	CHECK_EQUAL(CountOccurrences(blob, "/usr/bin/helloworld"), 1u);
+	CHECK_EQUAL(CountOccurrences(blob, "/usr/lib/libc.so.6"), 1u);
+
+	std::vector<ModuleNameAndOffset> loaded;
+	std::map<ModuleNameAndOffset, BreakpointOptions> loadedOptions;
+	CHECK(UnpackBreakpoints(blob, loaded, loadedOptions));
+	CHECK(SameBreakpoints(loaded, breakpoints));
+	CHECK_EQUAL(loadedOptions.size(), 3u);
+	CHECK_EQUAL(loadedOptions[breakpoints[0]].condition, std::string("rdi == 100"));
+	CHECK_EQUAL(loadedOptions[breakpoints[0]].logMessage, std::string());
+	CHECK_EQUAL(loadedOptions[breakpoints[1]].condition, std::string());
+	CHECK_EQUAL(loadedOptions[breakpoints[1]].logMessage, std::string("malloc({rdi})"));
+	CHECK_EQUAL(loadedOptions[breakpoints[2]].condition, std::string("rax != 0"));
+	CHECK_EQUAL(loadedOptions[breakpoints[2]].logMessage, std::string("returned {rax}"));
+	CHECK(loadedOptions.find(breakpoints[3]) == loadedOptions.end());
+
+	// Packing what was loaded gives the same blob
+	CHECK(PackBreakpoints(loaded, loadedOptions) == blob);
+
+	CHECK(UnpackBreakpoints(PackBreakpoints({}, {}), loaded, loadedOptions));
+	CHECK(loaded.empty());
+	CHECK(loadedOptions.empty());
+}
+
+
+TEST(ReadsVersion1)
+{
+	// Version 1 had no options, so the flags are not followed by any strings
+	const uint8_t blob[] = {1, 0, 0, 0, 1, 0, 0, 0, 3, 0, 0, 0, 'a', 'b', 'c', 2, 0, 0, 0, 0, 0, 0, 0, 3, 0, 0, 0,
+		0x10, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x20, 0, 0, 0, 0, 0, 0, 0};
+	std::vector<ModuleNameAndOffset> loaded;
+	std::map<ModuleNameAndOffset, BreakpointOptions> loadedOptions;
+	CHECK(UnpackBreakpoints(std::vector<uint8_t>(blob, blob + sizeof(blob)), loaded, loadedOptions));
+	CHECK(SameBreakpoints(loaded, {{"abc", 0x10}, {"abc", 0x20}}));
+	CHECK(loadedOptions.empty());
+}
+
+
+TEST(RejectsUnsupportedBlobs)
+{
+	std::vector<ModuleNameAndOffset> loaded;
+	std::map<ModuleNameAndOffset, BreakpointOptions> loadedOptions;
+	CHECK(!UnpackBreakpoints({}, loaded, loadedOptions));
+	CHECK(!UnpackBreakpoints({0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, loaded, loadedOptions));
+	// A version from the future
+	CHECK(!UnpackBreakpoints({3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, loaded, loadedOptions));
+	// The module table is cut short
+	CHECK(!UnpackBreakpoints({2, 0, 0, 0, 1, 0, 0, 0, 3, 0, 0, 0, 'a'}, loaded, loadedOptions));
+}
+
+
+TEST(KeepsTheBreakpointsBeforeATruncatedOne)
+{
+	std::vector<ModuleNameAndOffset> breakpoints = {{"a", 1}, {"a", 2}, {"b", 3}};
+	std::map<ModuleNameAndOffset, BreakpointOptions> options;
+	options[breakpoints[2]].condition = "x0 == 1";
+	std::vector<uint8_t> blob = PackBreakpoints(breakpoints, options);
+
+	// Cut into the condition of the last one
+	blob.resize(blob.size() - 2);
+	std::vector<ModuleNameAndOffset> loaded;
+	std::map<ModuleNameAndOffset, BreakpointOptions> loadedOptions;
+	CHECK(UnpackBreakpoints(blob, loaded, loadedOptions));
+	CHECK(SameBreakpoints(loaded, {{"a", 1}, {"a", 2}}));
+	CHECK(loadedOptions.empty());
+}
+
+
+TEST(SkipsBreakpointsOfUnknownModules)
+{
+	std::vector<uint8_t> blob = PackBreakpoints({{"a", 1}, {"a", 2}}, {});
+	// Point the second breakpoint past the end of the module table
+	size_t second = blob.size() - 16;
+	blob[second] = 7;
+	std::vector<ModuleNameAndOffset> loaded;
+	std::map<ModuleNameAndOffset, BreakpointOptions> loadedOptions;
+	CHECK(UnpackBreakpoints(blob, loaded, loadedOptions));
+	CHECK(SameBreakpoints(loaded, {{"a", 1}}));
+}
+
+
+UNIT_TEST_MAIN()
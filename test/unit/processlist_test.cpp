@@ -0,0 +1,148 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <cinttypes>
+#include <cstdio>
+#include "unittest.h"
+#include "processlist.h"
+
+#ifdef __linux__
+	#include <unistd.h>
+#endif
+
+using namespace BinaryNinjaDebugger;
+
+
+TEST(ParsesProcStat)
+{
+	DebugProcess process(1234);
+	CHECK(ParseProcStat("1234 (bash) S 1 1234 1234 34816 1234 4194560 1089 0 0 0", process));
+	CHECK_EQUAL(process.m_processName, std::string("bash"));
+	CHECK_EQUAL(process.m_parentPid, 1u);
+
+	// The name can contain spaces and parentheses
+	CHECK(ParseProcStat("77 (a (b) c) R 42 77 77 0 -1", process));
+	CHECK_EQUAL(process.m_processName, std::string("a (b) c"));
+	CHECK_EQUAL(process.m_parentPid, 42u);
+
+	CHECK(ParseProcStat("2 (kthreadd) S 0 0 0 0 -1", process));
+	CHECK_EQUAL(process.m_parentPid, 0u);
+
+	CHECK(!ParseProcStat("", process));
+	CHECK(!ParseProcStat("12 ) S 1 (", process));
+}
+
+
+TEST(ParsesProcCmdline)
+{
+	DebugProcess process(1, "python3.11");
+	ParseProcCmdline(std::string("/usr/bin/python3.11\0script.py\0--flag\0", 38), process);
+	CHECK_EQUAL(process.m_processName, std::string("python3.11"));
+	CHECK_EQUAL(process.m_commandLine, std::string("/usr/bin/python3.11 script.py --flag"));
+
+	// The name in stat is cut to 15 characters
+	process = DebugProcess(1, "a-very-long-pro");
+	ParseProcCmdline(std::string("/opt/a-very-long-program\0-x\0", 28), process);
+	CHECK_EQUAL(process.m_processName, std::string("a-very-long-program"));
+	CHECK_EQUAL(process.m_commandLine, std::string("/opt/a-very-long-program -x"));
+
+	// A program that renamed itself keeps its name
+	process = DebugProcess(1, "worker");
+	ParseProcCmdline(std::string("/usr/sbin/daemon-main\0", 22), process);
+	CHECK_EQUAL(process.m_processName, std::string("worker"));
+
+	// Kernel threads have no command line
+	process = DebugProcess(2, "kthreadd");
+	ParseProcCmdline("", process);
+	CHECK_EQUAL(process.m_processName, std::string("kthreadd"));
+	CHECK_EQUAL(process.m_commandLine, std::string());
+}
+
+
+// Formats a row the way `platform process list` of LLDB does
+static std::string FormatRow(
+	uint64_t pid, uint64_t parentPid, const char* user, const char* triple, const std::string& last)
+{
+	char row[0x200];
+	snprintf(row, sizeof(row), "%-6" PRIu64 " %-6" PRIu64 " %-10s %-30s %s", pid, parentPid, user, triple,
+		last.c_str());
+	return row;
+}
+
+
+TEST(ParsesLldbProcessListRows)
+{
+	DebugProcess process;
+	std::string last;
+	CHECK(ParseProcessListRow(FormatRow(1, 0, "root", "x86_64-pc-linux-gnu", "systemd"), process, last));
+	CHECK_EQUAL(process.m_pid, 1u);
+	CHECK_EQUAL(process.m_parentPid, 0u);
+	CHECK_EQUAL(process.m_user, std::string("root"));
+	CHECK_EQUAL(process.m_architecture, std::string("x86_64"));
+	CHECK_EQUAL(last, std::string("systemd"));
+
+	// Long user names and PIDs push the following columns to the right
+	CHECK(ParseProcessListRow(
+		FormatRow(4194303, 1234567, "averylongusername", "arm64-apple-macosx", "/Applications/My App.app/a b"),
+		process, last));
+	CHECK_EQUAL(process.m_pid, 4194303u);
+	CHECK_EQUAL(process.m_parentPid, 1234567u);
+	CHECK_EQUAL(process.m_user, std::string("averylongusername"));
+	CHECK_EQUAL(process.m_architecture, std::string("arm64"));
+	CHECK_EQUAL(last, std::string("/Applications/My App.app/a b"));
+
+	// No user, e.g., on Windows
+	CHECK(ParseProcessListRow(FormatRow(4, 0, "", "x86_64-pc-windows-msvc", "System"), process, last));
+	CHECK_EQUAL(process.m_user, std::string());
+	CHECK_EQUAL(process.m_architecture, std::string("x86_64"));
+	CHECK_EQUAL(last, std::string("System"));
+
+	// The header
+	CHECK(!ParseProcessListRow("12 matching processes were found on \"host\"", process, last));
+	CHECK(!ParseProcessListRow(
+		"PID    PARENT USER       TRIPLE                         NAME", process, last));
+	CHECK(!ParseProcessListRow(
+		"====== ====== ========== ============================== ============================", process, last));
+	CHECK(!ParseProcessListRow("", process, last));
+}
+
+
+#ifdef __linux__
+TEST(ListsTheLocalProcesses)
+{
+	std::vector<DebugProcess> processes;
+	CHECK(GetLocalProcessList(processes));
+
+	const DebugProcess* self = nullptr;
+	for (const auto& process : processes)
+	{
+		if (process.m_pid == (uint32_t)getpid())
+			self = &process;
+	}
+	CHECK(self != nullptr);
+	if (!self)
+		return;
+
+	CHECK_EQUAL(self->m_processName, std::string("processlist_test"));
+	CHECK_EQUAL(self->m_parentPid, (uint32_t)getppid());
+	CHECK(!self->m_user.empty());
+	CHECK(self->m_commandLine.find("processlist_test") != std::string::npos);
+	CHECK(!self->m_architecture.empty());
+}
+#endif
+
+
+UNIT_TEST_MAIN()
@@ -0,0 +1,218 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "unittest.h"
+#include "adapters/rspconnection.h"
+
+#ifndef WIN32
+	#include <arpa/inet.h>
+	#include <netinet/in.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+#endif
+
+using namespace BinaryNinjaDebugger;
+
+
+TEST(ComputesTheChecksum)
+{
+	CHECK_EQUAL(RspConnection::Checksum(""), 0);
+	CHECK_EQUAL(RspConnection::Checksum("OK"), 0x9a);
+	CHECK_EQUAL(RspConnection::FramePacket("OK"), std::string("$OK#9a"));
+	CHECK_EQUAL(RspConnection::FramePacket("qSupported"), std::string("$qSupported#37"));
+	// The sum wraps around
+	CHECK_EQUAL(RspConnection::Checksum(std::string(3, '\xff')), 0xfd);
+}
+
+
+TEST(EscapesBinaryData)
+{
+	const uint8_t special[] = {'$', '#', '}', '*', 'a', 0};
+	CHECK_EQUAL(RspConnection::EscapeBinary(special, sizeof(special)), std::string("}\x04}\x03}\x5d}\x0a" "a", 9)
+		+ std::string(1, '\0'));
+
+	std::string all;
+	for (int i = 0; i < 256; i++)
+		all += (char)i;
+	std::string escaped = RspConnection::EscapeBinary((const uint8_t*)all.data(), all.size());
+	CHECK_EQUAL(escaped.size(), all.size() + 4);
+	CHECK_EQUAL(escaped.find_first_of("$#*"), std::string::npos);
+	CHECK_EQUAL(RspConnection::DecodePayload(escaped), all);
+}
+
+
+TEST(DecodesRunLengthEncoding)
+{
+	// ' ' is 32, i.e., the previous character three more times
+	CHECK_EQUAL(RspConnection::DecodePayload("0* "), std::string("0000"));
+	// '"' is 34, five more
+	CHECK_EQUAL(RspConnection::DecodePayload("ab*\"c"), std::string("abbbbbbc"));
+	// The repeated character can be an escaped one
+	CHECK_EQUAL(RspConnection::DecodePayload("}]*!"), std::string("}}}}}"));
+	// A '*' with nothing to repeat is kept
+	CHECK_EQUAL(RspConnection::DecodePayload("*"), std::string("*"));
+	CHECK_EQUAL(RspConnection::DecodePayload("a*"), std::string("a*"));
+}
+
+
+TEST(ConvertsHex)
+{
+	const uint8_t bytes[] = {0x01, 0xab, 0x00, 0xff};
+	CHECK_EQUAL(RspConnection::ToHex(bytes, sizeof(bytes)), std::string("01ab00ff"));
+	CHECK_EQUAL(RspConnection::ToHex(std::string("hi")), std::string("6869"));
+
+	std::vector<uint8_t> data;
+	CHECK(RspConnection::FromHex("01AB00ff", data));
+	CHECK(data == std::vector<uint8_t>(bytes, bytes + sizeof(bytes)));
+
+	CHECK(!RspConnection::FromHex("0g", data));
+	CHECK(!RspConnection::FromHex("012", data));
+	CHECK(RspConnection::FromHex("", data));
+	CHECK(data.empty());
+}
+
+
+TEST(ReadsUnavailableRegistersAsZero)
+{
+	// A "g" reply where the stub cannot read the second register
+	std::vector<uint8_t> data;
+	CHECK(RspConnection::FromHex("11223344xxxxxxxx55", data));
+	CHECK(data == std::vector<uint8_t>({0x11, 0x22, 0x33, 0x44, 0, 0, 0, 0, 0x55}));
+
+	// Only a whole "xx" byte is unavailable
+	CHECK(!RspConnection::FromHex("x1", data));
+	CHECK(!RspConnection::FromHex("1x", data));
+}
+
+
+TEST(TellsErrorReplies)
+{
+	CHECK(RspConnection::IsErrorReply("E01"));
+	CHECK(RspConnection::IsErrorReply("Eff"));
+	CHECK(!RspConnection::IsErrorReply("OK"));
+	CHECK(!RspConnection::IsErrorReply("E1"));
+	// A memory read that happens to start with 'E'
+	CHECK(!RspConnection::IsErrorReply("E0123456"));
+}
+
+
+#ifndef WIN32
+// A stub on the loopback interface that we write the replies to and read the requests from by hand
+class LoopbackStub
+{
+	int m_listener = -1;
+	int m_socket = -1;
+
+public:
+	bool Connect(RspConnection& connection)
+	{
+		m_listener = socket(AF_INET, SOCK_STREAM, 0);
+		sockaddr_in address {};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		socklen_t length = sizeof(address);
+		if ((bind(m_listener, (sockaddr*)&address, sizeof(address)) != 0) || (listen(m_listener, 1) != 0)
+			|| (getsockname(m_listener, (sockaddr*)&address, &length) != 0))
+			return false;
+
+		std::string error;
+		if (!connection.Connect("127.0.0.1", ntohs(address.sin_port), error))
+			return false;
+		m_socket = accept(m_listener, nullptr, nullptr);
+		return m_socket >= 0;
+	}
+
+	~LoopbackStub()
+	{
+		if (m_socket >= 0)
+			close(m_socket);
+		if (m_listener >= 0)
+			close(m_listener);
+	}
+
+	void Send(const std::string& data)
+	{
+		CHECK_EQUAL(send(m_socket, data.data(), data.size(), 0), (ssize_t)data.size());
+	}
+
+	std::string Receive(size_t size)
+	{
+		std::string result;
+		char buffer[0x100];
+		while (result.size() < size)
+		{
+			auto received = recv(m_socket, buffer, std::min(sizeof(buffer), size - result.size()), 0);
+			if (received <= 0)
+				break;
+			result.append(buffer, received);
+		}
+		return result;
+	}
+};
+
+
+TEST(AcknowledgesPackets)
+{
+	RspConnection connection;
+	LoopbackStub stub;
+	CHECK(stub.Connect(connection));
+
+	// A corrupted packet is rejected, and the one after it is decoded and accepted
+	stub.Send("+$0* #00" + RspConnection::FramePacket("0* "));
+	std::string payload;
+	CHECK(connection.ReceivePacket(payload, 5000));
+	CHECK_EQUAL(payload, std::string("0000"));
+	CHECK_EQUAL(stub.Receive(2), std::string("-+"));
+
+	// The stub asks for the last packet again
+	CHECK(connection.SendPacket("g"));
+	CHECK_EQUAL(stub.Receive(5), std::string("$g#67"));
+	stub.Send("-" + RspConnection::FramePacket("OK"));
+	CHECK(connection.ReceivePacket(payload, 5000));
+	CHECK_EQUAL(payload, std::string("OK"));
+	CHECK_EQUAL(stub.Receive(6), std::string("$g#67+"));
+
+	bool timedOut = false;
+	CHECK(!connection.ReceivePacket(payload, 10, &timedOut));
+	CHECK(timedOut);
+}
+
+
+TEST(PipelinesRequestsWithoutAcknowledgements)
+{
+	RspConnection connection;
+	LoopbackStub stub;
+	CHECK(stub.Connect(connection));
+	connection.SetAckMode(false);
+
+	// The replies are all there before the requests go out, so the requests must not wait for them one by one
+	stub.Send(
+		RspConnection::FramePacket("OK") + RspConnection::FramePacket("E01") + RspConnection::FramePacket("1*!"));
+	auto replies = connection.TransactPipelined({"m0,1", "m1,1", "m2,1"}, 2);
+	CHECK_EQUAL(replies.size(), 3u);
+	CHECK(replies[0] == std::optional<std::string>("OK"));
+	CHECK(replies[1] == std::optional<std::string>("E01"));
+	CHECK(replies[2] == std::optional<std::string>("11111"));
+
+	std::string expected = RspConnection::FramePacket("m0,1") + RspConnection::FramePacket("m1,1")
+		+ RspConnection::FramePacket("m2,1");
+	// No acknowledgements in between
+	CHECK_EQUAL(stub.Receive(expected.size()), expected);
+}
+#endif
+
+
+UNIT_TEST_MAIN()
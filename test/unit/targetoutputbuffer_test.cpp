@@ -0,0 +1,164 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "unittest.h"
+#include "targetoutputbuffer.h"
+
+using namespace BinaryNinjaDebugger;
+
+
+// Distinct bytes, so a wrong offset in the ring buffer shows
+static std::string Pattern(uint64_t position, size_t size)
+{
+	std::string result;
+	for (size_t i = 0; i < size; i++)
+		result += (char)('a' + (position + i) % 26);
+	return result;
+}
+
+
+TEST(ReadsWhatIsWritten)
+{
+	TargetOutputBuffer buffer(nullptr);
+	buffer.Write(TargetStdoutChannel, "hello ", 6);
+	buffer.Write(TargetStdoutChannel, "world", 5);
+
+	uint64_t position = 0, dropped = 0;
+	CHECK_EQUAL(buffer.Read(TargetStdoutChannel, position, dropped, 0x100), std::string("hello world"));
+	CHECK_EQUAL(position, 11u);
+	CHECK_EQUAL(dropped, 0u);
+	CHECK_EQUAL(buffer.GetEndPosition(TargetStdoutChannel), 11u);
+
+	// Nothing new
+	CHECK_EQUAL(buffer.Read(TargetStdoutChannel, position, dropped, 0x100), std::string());
+	CHECK_EQUAL(position, 11u);
+
+	// A position past the end is moved back to it
+	position = 100;
+	CHECK_EQUAL(buffer.Read(TargetStdoutChannel, position, dropped, 0x100), std::string());
+	CHECK_EQUAL(position, 11u);
+}
+
+
+TEST(KeepsTheChannelsApart)
+{
+	TargetOutputBuffer buffer(nullptr);
+	buffer.Write(TargetStdoutChannel, "out", 3);
+	buffer.Write(TargetStderrChannel, "error", 5);
+
+	uint64_t position = 0, dropped = 0;
+	CHECK_EQUAL(buffer.Read(TargetStderrChannel, position, dropped, 0x100), std::string("error"));
+	position = 0;
+	CHECK_EQUAL(buffer.Read(TargetStdoutChannel, position, dropped, 0x100), std::string("out"));
+	CHECK_EQUAL(buffer.GetEndPosition(TargetStderrChannel), 5u);
+}
+
+
+TEST(WrapsAround)
+{
+	TargetOutputBuffer buffer(nullptr);
+	buffer.Configure(0x1000, TargetOutputBuffer::DefaultNotificationsPerSecond);
+
+	// Three writes that end past the capacity, and a read that lags behind
+	uint64_t written = 0;
+	for (size_t size : {0xc00, 0x300, 0x500})
+	{
+		std::string data = Pattern(written, size);
+		buffer.Write(TargetStdoutChannel, data.data(), data.size());
+		written += size;
+	}
+	CHECK_EQUAL(buffer.GetEndPosition(TargetStdoutChannel), 0x1400u);
+
+	uint64_t position = 0, dropped = 0;
+	std::string result = buffer.Read(TargetStdoutChannel, position, dropped, 0x800);
+	CHECK_EQUAL(dropped, 0x400u);
+	CHECK_EQUAL(result, Pattern(0x400, 0x800));
+	CHECK_EQUAL(position, 0xc00u);
+
+	// The rest crosses the end of the ring
+	result = buffer.Read(TargetStdoutChannel, position, dropped, 0x1000);
+	CHECK_EQUAL(dropped, 0u);
+	CHECK_EQUAL(result, Pattern(0xc00, 0x800));
+	CHECK_EQUAL(position, 0x1400u);
+}
+
+
+TEST(KeepsTheEndOfALargeWrite)
+{
+	TargetOutputBuffer buffer(nullptr);
+	buffer.Configure(0x1000, TargetOutputBuffer::DefaultNotificationsPerSecond);
+
+	std::string data = Pattern(0, 0x2345);
+	buffer.Write(TargetStdoutChannel, data.data(), data.size());
+
+	uint64_t position = 0, dropped = 0;
+	std::string result = buffer.Read(TargetStdoutChannel, position, dropped, 0x10000);
+	CHECK_EQUAL(dropped, 0x1345u);
+	CHECK_EQUAL(result, Pattern(0x1345, 0x1000));
+	CHECK_EQUAL(position, 0x2345u);
+}
+
+
+TEST(CountsTheOutputDroppedByConfigure)
+{
+	TargetOutputBuffer buffer(nullptr);
+	buffer.Write(TargetStdoutChannel, "before", 6);
+	buffer.Configure(0x2000, TargetOutputBuffer::DefaultNotificationsPerSecond);
+
+	// The positions carry on, and what was written before is gone
+	uint64_t position = 0, dropped = 0;
+	CHECK_EQUAL(buffer.Read(TargetStdoutChannel, position, dropped, 0x100), std::string());
+	CHECK_EQUAL(dropped, 6u);
+	CHECK_EQUAL(position, 6u);
+
+	buffer.Write(TargetStdoutChannel, "after", 5);
+	position = 0;
+	CHECK_EQUAL(buffer.Read(TargetStdoutChannel, position, dropped, 0x100), std::string("after"));
+	CHECK_EQUAL(dropped, 6u);
+	CHECK_EQUAL(position, 11u);
+
+	// Shrinking the buffer drops the output as well
+	buffer.Configure(0x1000, TargetOutputBuffer::DefaultNotificationsPerSecond);
+	std::string data = Pattern(11, 0x10);
+	buffer.Write(TargetStdoutChannel, data.data(), data.size());
+	position = 6;
+	CHECK_EQUAL(buffer.Read(TargetStdoutChannel, position, dropped, 0x100), data);
+	CHECK_EQUAL(dropped, 5u);
+	CHECK_EQUAL(position, 0x1bu);
+}
+
+
+TEST(NotifiesOnWrite)
+{
+	std::mutex mutex;
+	std::condition_variable cv;
+	int notifications = 0;
+	TargetOutputBuffer buffer([&]() {
+		std::unique_lock<std::mutex> lock(mutex);
+		notifications++;
+		cv.notify_all();
+	});
+	buffer.Configure(0x1000, 1000);
+
+	buffer.Write(TargetStdoutChannel, "x", 1);
+	std::unique_lock<std::mutex> lock(mutex);
+	CHECK(cv.wait_for(lock, std::chrono::seconds(5), [&]() { return notifications > 0; }));
+	lock.unlock();
+	buffer.Stop();
+}
+
+
+UNIT_TEST_MAIN()
@@ -0,0 +1,96 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A minimal test runner, so the unit tests build without any dependency. Each test is a function registered with
+// TEST(); CHECK() and CHECK_EQUAL() report a failure and let the test go on.
+namespace UnitTest {
+	struct Test
+	{
+		const char* name;
+		std::function<void()> function;
+	};
+
+	inline std::vector<Test>& GetTests()
+	{
+		static std::vector<Test> tests;
+		return tests;
+	}
+
+	inline int& GetFailureCount()
+	{
+		static int failures = 0;
+		return failures;
+	}
+
+	struct Registration
+	{
+		Registration(const char* name, std::function<void()> function)
+		{
+			GetTests().push_back({name, std::move(function)});
+		}
+	};
+
+	inline void Fail(const char* file, int line, const std::string& message)
+	{
+		fprintf(stderr, "%s:%d: %s\n", file, line, message.c_str());
+		GetFailureCount()++;
+	}
+
+	inline int RunAll()
+	{
+		for (const auto& test : GetTests())
+		{
+			int failures = GetFailureCount();
+			test.function();
+			printf("%s: %s\n", GetFailureCount() == failures ? "PASS" : "FAIL", test.name);
+		}
+		return GetFailureCount() == 0 ? 0 : 1;
+	}
+};  // namespace UnitTest
+
+#define TEST(name) \
+	static void name(); \
+	static UnitTest::Registration name##Registration(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do \
+	{ \
+		if (!(expression)) \
+			UnitTest::Fail(__FILE__, __LINE__, "CHECK(" #expression ") failed"); \
+	} while (0)
+
+#define CHECK_EQUAL(actual, expected) \
+	do \
+	{ \
+		auto actualValue = (actual); \
+		auto expectedValue = (expected); \
+		if (!(actualValue == expectedValue)) \
+			UnitTest::Fail(__FILE__, __LINE__, "CHECK_EQUAL(" #actual ", " #expected ") failed"); \
+	} while (0)
+
+#define UNIT_TEST_MAIN() \
+	int main() \
+	{ \
+		return UnitTest::RunAll(); \
+	}
@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include "attachprocess.h"
+#include <unordered_map>
 
 
 using namespace BinaryNinjaDebuggerAPI;
@@ -23,12 +24,22 @@ using namespace std;
 
 constexpr int SortFilterRole = Qt::UserRole + 1;
 
-ProcessItem::ProcessItem(uint32_t pid, std::string processName) : m_pid(pid), m_processName(processName) {}
+ProcessItem::ProcessItem(uint32_t pid, std::string processName) :
+	m_pid(pid), m_processName(processName), m_parentPid(0)
+{}
+
+
+ProcessItem::ProcessItem(const DebugProcess& process) :
+	m_pid(process.m_pid), m_processName(process.m_processName), m_parentPid(process.m_parentPid),
+	m_user(process.m_user), m_architecture(process.m_architecture), m_commandLine(process.m_commandLine)
+{}
 
 
 bool ProcessItem::operator==(const ProcessItem& other) const
 {
-	return (m_pid == other.pid()) && (m_processName == other.processName());
+	return (m_pid == other.pid()) && (m_processName == other.processName()) && (m_parentPid == other.parentPid())
+		&& (m_user == other.user()) && (m_architecture == other.architecture())
+		&& (m_commandLine == other.commandLine());
 }
 
 
@@ -70,7 +81,8 @@ QModelIndex ProcessListModel::index(int row, int column, const QModelIndex&) con
 		return QModelIndex();
 	}
 
-	return createIndex(row, column, (void*)&m_items[row]);
+	// No pointer into m_items, it moves when updateRows() inserts or removes rows
+	return createIndex(row, column);
 }
 
 
@@ -79,33 +91,40 @@ QVariant ProcessListModel::data(const QModelIndex& index, int role) const
 	if (index.column() >= columnCount() || (size_t)index.row() >= m_items.size())
 		return QVariant();
 
-	ProcessItem* item = static_cast<ProcessItem*>(index.internalPointer());
-	if (!item)
-		return QVariant();
+	const ProcessItem* item = &m_items[index.row()];
 
 	if ((role != Qt::DisplayRole) && (role != Qt::SizeHintRole) && (role != SortFilterRole))
 		return QVariant();
 
+	QString text;
 	switch (index.column())
 	{
 	case ProcessListModel::PidColumn:
-	{
-		QString text = QString::asprintf("%d", item->pid());
-		if (role == Qt::SizeHintRole)
-			return QVariant((qulonglong)text.size());
-
-		return QVariant(text);
-	}
+		text = QString::asprintf("%d", item->pid());
+		break;
 	case ProcessListModel::ProcessNameColumn:
-	{
-		QString text = QString::fromStdString(item->processName());
-		if (role == Qt::SizeHintRole)
-			return QVariant((qulonglong)text.size());
-
-		return QVariant(text);
-	}
+		text = QString::fromStdString(item->processName());
+		break;
+	case ProcessListModel::ParentPidColumn:
+		text = QString::asprintf("%d", item->parentPid());
+		break;
+	case ProcessListModel::UserColumn:
+		text = QString::fromStdString(item->user());
+		break;
+	case ProcessListModel::ArchitectureColumn:
+		text = QString::fromStdString(item->architecture());
+		break;
+	case ProcessListModel::CommandLineColumn:
+		text = QString::fromStdString(item->commandLine());
+		break;
+	default:
+		return QVariant();
 	}
-	return QVariant();
+
+	if (role == Qt::SizeHintRole)
+		return QVariant((qulonglong)text.size());
+
+	return QVariant(text);
 }
 
 
@@ -123,6 +142,14 @@ QVariant ProcessListModel::headerData(int column, Qt::Orientation orientation, i
 		return "PID";
 	case ProcessListModel::ProcessNameColumn:
 		return "Name";
+	case ProcessListModel::ParentPidColumn:
+		return "PPID";
+	case ProcessListModel::UserColumn:
+		return "User";
+	case ProcessListModel::ArchitectureColumn:
+		return "Arch";
+	case ProcessListModel::CommandLineColumn:
+		return "Command Line";
 	}
 	return QVariant();
 }
@@ -130,15 +157,65 @@ QVariant ProcessListModel::headerData(int column, Qt::Orientation orientation, i
 
 void ProcessListModel::updateRows(std::vector<DebugProcess> processList)
 {
-	beginResetModel();
+	// The first listing is loaded at once
+	if (m_items.empty())
+	{
+		beginResetModel();
+		for (const DebugProcess& process : processList)
+			m_items.emplace_back(process);
+		if (m_sortColumn >= 0)
+			std::sort(m_items.begin(), m_items.end(),
+				[&](const ProcessItem& a, const ProcessItem& b) { return lessThan(a, b); });
+		endResetModel();
+		return;
+	}
 
-	std::vector<ProcessItem> newProcessList;
+	std::unordered_map<uint32_t, const DebugProcess*> latest;
 	for (const DebugProcess& process : processList)
-		newProcessList.emplace_back(process.m_pid, process.m_processName);
+		latest[process.m_pid] = &process;
 
-	m_items = newProcessList;
+	// Remove the processes that exited, bottom up so the rows above keep their indices, and update the ones that
+	// changed, e.g., after an exec
+	for (int row = (int)m_items.size() - 1; row >= 0; row--)
+	{
+		auto it = latest.find(m_items[row].pid());
+		if (it == latest.end())
+		{
+			int first = row;
+			while ((first > 0) && (latest.find(m_items[first - 1].pid()) == latest.end()))
+				first--;
+			beginRemoveRows(QModelIndex(), first, row);
+			m_items.erase(m_items.begin() + first, m_items.begin() + row + 1);
+			endRemoveRows();
+			row = first;
+			continue;
+		}
 
-	endResetModel();
+		ProcessItem item(*it->second);
+		if (item != m_items[row])
+		{
+			m_items[row] = item;
+			emit dataChanged(index(row, 0), index(row, columnCount() - 1));
+		}
+		latest.erase(it);
+	}
+
+	// What is left started since the last refresh. Insert each of them where the current order puts it.
+	for (const DebugProcess& process : processList)
+	{
+		if (latest.find(process.m_pid) == latest.end())
+			continue;
+
+		ProcessItem item(process);
+		auto position = m_items.end();
+		if (m_sortColumn >= 0)
+			position = std::upper_bound(m_items.begin(), m_items.end(), item,
+				[&](const ProcessItem& a, const ProcessItem& b) { return lessThan(a, b); });
+		int row = (int)(position - m_items.begin());
+		beginInsertRows(QModelIndex(), row, row);
+		m_items.insert(position, item);
+		endInsertRows();
+	}
 }
 
 ProcessItemDelegate::ProcessItemDelegate(QWidget* parent) : QStyledItemDelegate(parent)
@@ -166,10 +243,14 @@ void ProcessItemDelegate::paint(QPainter* painter, const QStyleOptionViewItem& o
 	switch (idx.column())
 	{
 	case ProcessListModel::PidColumn:
+	case ProcessListModel::ParentPidColumn:
 		painter->setPen(getThemeColor(NumberColor).rgba());
 		painter->drawText(textRect, data.toString());
 		break;
 	case ProcessListModel::ProcessNameColumn:
+	case ProcessListModel::UserColumn:
+	case ProcessListModel::ArchitectureColumn:
+	case ProcessListModel::CommandLineColumn:
 		painter->setPen(option.palette.color(QPalette::WindowText).rgba());
 		painter->drawText(textRect, data.toString());
 		break;
@@ -202,25 +283,40 @@ ProcessListFilterProxyModel::ProcessListFilterProxyModel(QObject* parent) : QSor
 	setFilterCaseSensitivity(Qt::CaseInsensitive);
 }
 
+bool ProcessListModel::lessThan(const ProcessItem& a, const ProcessItem& b) const
+{
+	auto compare = [&](const auto& x, const auto& y) {
+		if (m_sortOrder == Qt::AscendingOrder)
+			return x < y;
+		else
+			return x > y;
+	};
+
+	switch (m_sortColumn)
+	{
+	case ProcessListModel::PidColumn:
+		return compare(a.pid(), b.pid());
+	case ProcessListModel::ProcessNameColumn:
+		return compare(a.processName(), b.processName());
+	case ProcessListModel::ParentPidColumn:
+		return compare(a.parentPid(), b.parentPid());
+	case ProcessListModel::UserColumn:
+		return compare(a.user(), b.user());
+	case ProcessListModel::ArchitectureColumn:
+		return compare(a.architecture(), b.architecture());
+	case ProcessListModel::CommandLineColumn:
+		return compare(a.commandLine(), b.commandLine());
+	}
+	return false;
+}
+
+
 void ProcessListModel::sort(int col, Qt::SortOrder order)
 {
-	std::sort(m_items.begin(), m_items.end(), [&](ProcessItem a, ProcessItem b) {
-		if (col == ProcessListModel::PidColumn)
-		{
-			if (order == Qt::AscendingOrder)
-				return a.pid() < b.pid();
-			else
-				return a.pid() > b.pid();
-		}
-		else if (col == ProcessListModel::ProcessNameColumn)
-		{
-			if (order == Qt::AscendingOrder)
-				return a.processName() < b.processName();
-			else
-				return a.processName() > b.processName();
-		}
-		return false;
-	});
+	m_sortColumn = col;
+	m_sortOrder = order;
+	std::sort(m_items.begin(), m_items.end(),
+		[&](const ProcessItem& a, const ProcessItem& b) { return lessThan(a, b); });
 }
 
 
@@ -309,6 +405,9 @@ void ProcessListWidget::updateColumnWidths()
 {
 	resizeColumnToContents(ProcessListModel::PidColumn);
 	resizeColumnToContents(ProcessListModel::ProcessNameColumn);
+	resizeColumnToContents(ProcessListModel::ParentPidColumn);
+	resizeColumnToContents(ProcessListModel::UserColumn);
+	resizeColumnToContents(ProcessListModel::ArchitectureColumn);
 }
 
 
@@ -342,7 +441,7 @@ void ProcessListWidget::activateFirstItem() {}
 AttachProcessDialog::AttachProcessDialog(QWidget* parent, DbgRef<DebuggerController> controller) : QDialog(parent)
 {
 	setWindowTitle("Attach to process");
-	setMinimumSize(UIContext::getScaledWindowSize(450, 600));
+	setMinimumSize(UIContext::getScaledWindowSize(800, 600));
 	setSizeGripEnabled(true);
 	setModal(true);
 
@@ -34,11 +34,20 @@ class ProcessItem
 private:
 	uint32_t m_pid;
 	std::string m_processName;
+	uint32_t m_parentPid;
+	std::string m_user;
+	std::string m_architecture;
+	std::string m_commandLine;
 
 public:
 	ProcessItem(uint32_t pid, std::string processName);
+	ProcessItem(const DebugProcess& process);
 	uint32_t pid() const { return m_pid; }
 	std::string processName() const { return m_processName; }
+	uint32_t parentPid() const { return m_parentPid; }
+	std::string user() const { return m_user; }
+	std::string architecture() const { return m_architecture; }
+	std::string commandLine() const { return m_commandLine; }
 	bool operator==(const ProcessItem& other) const;
 	bool operator!=(const ProcessItem& other) const;
 	bool operator<(const ProcessItem& other) const;
@@ -53,12 +62,21 @@ class ProcessListModel : public QAbstractTableModel
 
 protected:
 	std::vector<ProcessItem> m_items;
+	// The order of m_items, kept by updateRows() for the processes that show up later
+	int m_sortColumn = -1;
+	Qt::SortOrder m_sortOrder = Qt::AscendingOrder;
+
+	bool lessThan(const ProcessItem& a, const ProcessItem& b) const;
 
 public:
 	enum ColumnHeaders
 	{
 		PidColumn,
 		ProcessNameColumn,
+		ParentPidColumn,
+		UserColumn,
+		ArchitectureColumn,
+		CommandLineColumn,
 	};
 
 	ProcessListModel(QWidget* parent);
@@ -74,13 +92,15 @@ public:
 	virtual int columnCount(const QModelIndex& parent = QModelIndex()) const override
 	{
 		(void)parent;
-		return 2;
+		return 6;
 	}
 	ProcessItem getRow(int row) const;
 	virtual QVariant data(const QModelIndex& i, int role) const override;
 	virtual QVariant headerData(int column, Qt::Orientation orientation, int role) const override;
 	virtual void sort(int col, Qt::SortOrder order) override;
-	
+
+	// Only the rows of the processes that started, exited or changed are touched, so the selection and the scroll
+	// position survive a refresh
 	void updateRows(std::vector<DebugProcess> processList);
 };
 
@@ -68,7 +68,8 @@ std::vector<DisassemblyTextLine> CodeDataRenderer::GetLinesForData(BinaryView* d
 		uint64_t lineAddr = addr + totalRead;
 		size_t length = codeSize - totalRead;
 		std::vector<InstructionTextToken> insnTokens;
-		auto ok = arch->GetInstructionText((uint8_t*)buffer.GetDataAt(totalRead), lineAddr, length, insnTokens);
+		auto ok = m_instructionCache.GetInstructionText(
+			arch, lineAddr, (const uint8_t*)buffer.GetDataAt(totalRead), length, insnTokens);
 		if ((!ok) || (insnTokens.empty()))
 		{
 			insnTokens = {InstructionTextToken(TextToken, "??")};
@@ -17,9 +17,13 @@ limitations under the License.
 #pragma once
 
 #include "binaryninjaapi.h"
+#include "decodedinstructioncache.h"
 
 class CodeDataRenderer : public BinaryNinja::DataRenderer
 {
+	// The code blobs are disassembled again on every repaint
+	BinaryNinjaDebuggerAPI::DecodedInstructionCache m_instructionCache;
+
 public:
 	CodeDataRenderer();
 	virtual bool IsValidForData(BinaryNinja::BinaryView* data, uint64_t addr, BinaryNinja::Type* type,
@@ -70,7 +70,7 @@ void DebugAdapterScriptingInstance::SetCurrentBinaryView(BinaryNinja::BinaryView
 			{
 				m_debuggerEventCallback = m_controller->RegisterEventCallback(
 					[&](const DebuggerEvent& event) {
-						if (event.type == BackendMessageEventType)
+						if ((event.type == BackendMessageEventType) || (event.type == BreakpointLogEventType))
 						{
 							const std::string message = event.data.messageData.message;
 							Output(message);
@@ -350,7 +350,10 @@ DebugModulesWidget::DebugModulesWidget(ViewFrame* view, BinaryViewRef data) : QT
 				break;
 			}
 		},
-		"Modules Widget");
+		"Modules Widget", MainThreadEventCallbackAffinity,
+		DebuggerEventTypeBit(TargetStoppedEventType) | DebuggerEventTypeBit(TargetExitedEventType)
+			| DebuggerEventTypeBit(DetachedEventType) | DebuggerEventTypeBit(QuitDebuggingEventType)
+			| DebuggerEventTypeBit(BackEndDisconnectedEventType));
 
 	updateContent();
 }
@@ -42,9 +42,11 @@ bool TargetScriptingProvider::InstallModules(const std::string& modules)
 }
 
 
-TargetScriptingInstance::TargetScriptingInstance(ScriptingProvider* provider) : ScriptingInstance(provider)
+TargetScriptingInstance::TargetScriptingInstance(ScriptingProvider* provider) :
+	ScriptingInstance(provider), m_refresh(std::make_shared<TargetConsoleRefresh>())
 {
 	m_readyStatus = NotReadyForInput;
+	m_refresh->instance = this;
 }
 
 
@@ -52,6 +54,37 @@ TargetScriptingInstance::~TargetScriptingInstance()
 {
 	if (m_controller)
 		m_controller->RemoveEventCallback(m_debuggerEventCallback);
+
+	std::unique_lock<std::mutex> lock(m_refresh->mutex);
+	m_refresh->instance = nullptr;
+}
+
+
+void TargetScriptingInstance::ReadTargetOutput()
+{
+	if (!m_controller)
+		return;
+
+	for (auto channel : {TargetStdoutChannel, TargetStderrChannel})
+	{
+		uint64_t& position = m_outputPositions[channel];
+		while (true)
+		{
+			uint64_t droppedBytes = 0;
+			DataBuffer data = m_controller->ReadTargetOutput(channel, position, droppedBytes);
+			// The target wrote faster than the console could keep up, and the buffer overflowed
+			if (droppedBytes > 0)
+				Error("\n[" + std::to_string(droppedBytes) + " bytes of output dropped]\n");
+			if (data.GetLength() == 0)
+				break;
+
+			const std::string message((const char*)data.GetData(), data.GetLength());
+			if (channel == TargetStderrChannel)
+				Error(message);
+			else
+				Output(message);
+		}
+	}
 }
 
 
@@ -68,15 +101,24 @@ void TargetScriptingInstance::SetCurrentBinaryView(BinaryNinja::BinaryView* view
 			m_controller = DebuggerController::GetController(view);
 			if (m_controller)
 			{
+				// Only the output from now on
+				for (auto channel : {TargetStdoutChannel, TargetStderrChannel})
+					m_outputPositions[channel] = m_controller->GetTargetOutputPosition(channel);
+
 				m_debuggerEventCallback = m_controller->RegisterEventCallback(
-					[&](const DebuggerEvent& event) {
-						if (event.type == StdoutMessageEventType)
-						{
-							const std::string message = event.data.messageData.message;
-							Output(message);
-						}
+					[refresh = m_refresh](const DebuggerEvent&) {
+						if (refresh->pending.exchange(true))
+							return;
+
+						ExecuteOnMainThread([refresh]() {
+							// Cleared first, so output that comes in while reading schedules another refresh
+							refresh->pending = false;
+							std::unique_lock<std::mutex> lock(refresh->mutex);
+							if (refresh->instance)
+								refresh->instance->ReadTargetOutput();
+						});
 					},
-					"Target Console");
+					"Target Console", InlineEventCallbackAffinity, DebuggerEventTypeBit(StdoutMessageEventType));
 			}
 		}
 		else
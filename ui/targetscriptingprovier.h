@@ -16,10 +16,24 @@ limitations under the License.
 
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include "binaryninjaapi.h"
 #include "debuggerapi.h"
 #include "uitypes.h"
 
+class TargetScriptingInstance;
+
+// Shared with the event callback and the refreshes it schedules, which can outlive the instance
+struct TargetConsoleRefresh
+{
+	std::mutex mutex;
+	TargetScriptingInstance* instance = nullptr;
+	std::atomic_bool pending = false;
+};
+
+
 class TargetScriptingInstance : public ScriptingInstance
 {
 private:
@@ -28,6 +42,12 @@ private:
 	size_t m_debuggerEventCallback = -1;
 	BNScriptingProviderInputReadyState m_readyStatus;
 
+	// The console reads the output of the target from its own positions, rather than taking it from the events. The
+	// events only schedule a refresh on the main thread, and at most one is pending, however fast the target writes.
+	std::shared_ptr<TargetConsoleRefresh> m_refresh;
+	uint64_t m_outputPositions[2] = {};
+	void ReadTargetOutput();
+
 public:
 	TargetScriptingInstance(ScriptingProvider* provider);
 	~TargetScriptingInstance();
@@ -627,7 +627,9 @@ ThreadFramesWidget::ThreadFramesWidget(QWidget* parent, ViewFrame* frame, Binary
 				break;
 			}
 		},
-		"Thread Frame");
+		"Thread Frame", MainThreadEventCallbackAffinity,
+		DebuggerEventTypeBit(TargetStoppedEventType) | DebuggerEventTypeBit(ActiveThreadChangedEvent)
+			| DebuggerEventTypeBit(RegisterChangedEvent) | DebuggerEventTypeBit(ThreadStateChangedEvent));
 
 	updateContent();
 }
@@ -74,6 +74,13 @@ void NotificationListener::OnAfterOpenFile(UIContext* context, FileContext* file
 
 bool NotificationListener::OnBeforeSaveFile(UIContext* context, FileContext* file, ViewFrame* frame)
 {
+	// Breakpoint changes are persisted lazily, so make sure the latest ones end up in the saved database
+	if (DebuggerController::ControllerExists(file->getMetadata()))
+	{
+		auto controller = DebuggerController::GetController(file->getMetadata());
+		if (controller)
+			controller->FlushBreakpoints();
+	}
 	return true;
 }
 